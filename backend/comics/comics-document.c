@@ -25,6 +25,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <sys/mman.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
@@ -33,11 +34,18 @@
 
 #include "comics-document.h"
 #include "ev-document-misc.h"
+#include "ev-document-parallel-render.h"
 #include "ev-file-helpers.h"
 #include "ev-archive.h"
 
 #define BLOCK_SIZE 10240
 
+/* Size of the file where the data of the pages is spilled */
+#define SPILL_CACHE_SIZE (256 * 1024 * 1024)
+
+/* Pages read ahead of the rendered one, in the reading direction */
+#define PREFETCH_PAGES 4
+
 typedef struct _ComicsDocumentClass ComicsDocumentClass;
 
 struct _ComicsDocumentClass
@@ -53,9 +61,57 @@ struct _ComicsDocument
 	gchar         *archive_uri;
 	GPtrArray     *page_names; /* elem: char * */
 	GHashTable    *page_positions; /* key: char *, value: uint + 1 */
+	GArray        *page_info; /* elem: ComicsPageInfo, same index as page_positions */
+
+	/* Pages are decoded by several threads, but the archive is read
+	 * by one at a time, with archive_mutex held. The page info and
+	 * everything below are protected by cache_mutex, which is never
+	 * held while the archive is read, so that pages in the spill cache
+	 * don't wait for a read of the archive. archive_mutex is taken
+	 * first when both are needed.
+	 */
+	GMutex         archive_mutex;
+	GMutex         cache_mutex;
+	GThreadPool   *prefetch_pool;
+	GArray        *prefetch_pages; /* elem: ComicsPrefetchPage, in archive order */
+	gint           last_page;
+
+	/* Archives can only be read forward, so the data of the pages
+	 * is copied to a temp file as they are read, see
+	 * comics_spill_cache_store().
+	 */
+	int            spill_fd;
+	guchar        *spill_data;
+	GList         *spill_free; /* elem: ComicsSpillExtent, sorted by offset */
+	GQueue         spill_lru; /* elem: uint position, most recently used first */
 };
 
-EV_BACKEND_REGISTER (ComicsDocument, comics_document)
+typedef struct {
+	gint64  offset; /* in the spill cache, -1 if not there */
+	gsize   size;
+	GList  *link; /* in spill_lru */
+	guint   pins; /* data in use, it can not be evicted */
+	gint    width; /* -1 if unknown */
+	gint    height;
+} ComicsPageInfo;
+
+typedef struct {
+	gsize offset;
+	gsize size;
+} ComicsSpillExtent;
+
+typedef struct {
+	guint pos; /* in the archive */
+	gint  page;
+} ComicsPrefetchPage;
+
+static void comics_document_parallel_render_iface_init (EvDocumentParallelRenderInterface *iface);
+
+EV_BACKEND_REGISTER_WITH_CODE (ComicsDocument, comics_document,
+	{
+		EV_BACKEND_IMPLEMENT_INTERFACE (EV_TYPE_DOCUMENT_PARALLEL_RENDER,
+						comics_document_parallel_render_iface_init);
+	})
 
 #define FORMAT_UNKNOWN     0
 #define FORMAT_SUPPORTED   1
@@ -144,6 +200,365 @@ is_apple_double (const char *name)
 	return ret;
 }
 
+static void
+comics_spill_cache_open (ComicsDocument *comics_document)
+{
+	ComicsSpillExtent *extent;
+	gchar *filename = NULL;
+	GError *error = NULL;
+	void *data;
+	int fd;
+
+	fd = ev_mkstemp ("comics.XXXXXX", &filename, &error);
+	if (fd == -1) {
+		g_debug ("Could not create the spill cache: %s", error->message);
+		g_error_free (error);
+		return;
+	}
+
+	/* Nobody else needs the file, it goes away with the fd */
+	g_unlink (filename);
+	g_free (filename);
+
+	if (ftruncate (fd, SPILL_CACHE_SIZE) == -1) {
+		g_debug ("Could not create the spill cache: %s", g_strerror (errno));
+		close (fd);
+		return;
+	}
+
+	/* The file is sparse: pages are written with pwrite(), that fails
+	 * cleanly when the disk is full, and the mapping is only used to
+	 * read the extents that were written.
+	 */
+	data = mmap (NULL, SPILL_CACHE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		g_debug ("Could not map the spill cache: %s", g_strerror (errno));
+		close (fd);
+		return;
+	}
+
+	comics_document->spill_fd = fd;
+	comics_document->spill_data = data;
+
+	extent = g_new (ComicsSpillExtent, 1);
+	extent->offset = 0;
+	extent->size = SPILL_CACHE_SIZE;
+	comics_document->spill_free = g_list_prepend (NULL, extent);
+}
+
+static void
+comics_spill_cache_close (ComicsDocument *comics_document)
+{
+	if (comics_document->spill_data) {
+		munmap (comics_document->spill_data, SPILL_CACHE_SIZE);
+		comics_document->spill_data = NULL;
+	}
+	if (comics_document->spill_fd != -1) {
+		close (comics_document->spill_fd);
+		comics_document->spill_fd = -1;
+	}
+	g_list_free_full (comics_document->spill_free, g_free);
+	comics_document->spill_free = NULL;
+	g_queue_clear (&comics_document->spill_lru);
+}
+
+/* First fit, the free extents are few since the cache is mostly
+ * filled in archive order and freed extents are merged.
+ */
+static gboolean
+comics_spill_cache_alloc (ComicsDocument *comics_document,
+			  gsize           size,
+			  gsize          *offset)
+{
+	GList *l;
+
+	for (l = comics_document->spill_free; l; l = g_list_next (l)) {
+		ComicsSpillExtent *extent = l->data;
+
+		if (extent->size < size)
+			continue;
+
+		*offset = extent->offset;
+		extent->offset += size;
+		extent->size -= size;
+		if (extent->size == 0) {
+			comics_document->spill_free = g_list_delete_link (comics_document->spill_free, l);
+			g_free (extent);
+		}
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static void
+comics_spill_cache_release (ComicsDocument *comics_document,
+			    gsize           offset,
+			    gsize           size)
+{
+	ComicsSpillExtent *extent, *prev = NULL;
+	GList *l;
+
+	for (l = comics_document->spill_free; l; l = g_list_next (l)) {
+		extent = l->data;
+		if (extent->offset > offset)
+			break;
+		prev = extent;
+	}
+
+	if (prev && prev->offset + prev->size == offset) {
+		prev->size += size;
+		extent = prev;
+	} else {
+		extent = g_new (ComicsSpillExtent, 1);
+		extent->offset = offset;
+		extent->size = size;
+		comics_document->spill_free = g_list_insert_before (comics_document->spill_free, l, extent);
+	}
+
+	/* Merge with the next extent */
+	if (l && extent->offset + extent->size == ((ComicsSpillExtent *) l->data)->offset) {
+		extent->size += ((ComicsSpillExtent *) l->data)->size;
+		g_free (l->data);
+		comics_document->spill_free = g_list_delete_link (comics_document->spill_free, l);
+	}
+}
+
+static gboolean
+comics_spill_cache_evict (ComicsDocument *comics_document)
+{
+	GList *l;
+
+	for (l = comics_document->spill_lru.tail; l; l = g_list_previous (l)) {
+		ComicsPageInfo *info;
+
+		info = &g_array_index (comics_document->page_info, ComicsPageInfo,
+				       GPOINTER_TO_UINT (l->data));
+		if (info->pins > 0)
+			continue;
+
+		g_queue_delete_link (&comics_document->spill_lru, l);
+		comics_spill_cache_release (comics_document, info->offset, info->size);
+		info->offset = -1;
+		info->link = NULL;
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
+static gboolean
+comics_spill_cache_write (ComicsDocument *comics_document,
+			  gsize           offset,
+			  GBytes         *bytes)
+{
+	const guchar *data;
+	gsize size, written = 0;
+
+	data = g_bytes_get_data (bytes, &size);
+	while (written < size) {
+		ssize_t n;
+
+		n = pwrite (comics_document->spill_fd, data + written,
+			    size - written, offset + written);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			g_debug ("Could not write to the spill cache: %s", g_strerror (errno));
+			return FALSE;
+		}
+		written += n;
+	}
+
+	return TRUE;
+}
+
+/* Copies the data of the page at @pos to the spill cache. Pages are only
+ * evicted to make room when @evict is %TRUE: while loading, the first pages
+ * of the archive are kept rather than the last ones.
+ */
+static void
+comics_spill_cache_store (ComicsDocument *comics_document,
+			  guint           pos,
+			  GBytes         *bytes,
+			  gboolean        evict)
+{
+	ComicsPageInfo *info;
+	gsize size = g_bytes_get_size (bytes);
+	gsize offset;
+
+	if (!comics_document->spill_data || size == 0 || size > SPILL_CACHE_SIZE)
+		return;
+
+	info = &g_array_index (comics_document->page_info, ComicsPageInfo, pos);
+	if (info->offset != -1)
+		return;
+
+	while (!comics_spill_cache_alloc (comics_document, size, &offset)) {
+		if (!evict || !comics_spill_cache_evict (comics_document))
+			return;
+	}
+
+	if (!comics_spill_cache_write (comics_document, offset, bytes)) {
+		comics_spill_cache_release (comics_document, offset, size);
+		return;
+	}
+
+	info->offset = offset;
+	info->size = size;
+	g_queue_push_head (&comics_document->spill_lru, GUINT_TO_POINTER (pos));
+	info->link = comics_document->spill_lru.head;
+}
+
+typedef struct {
+	ComicsDocument *comics_document;
+	guint           pos;
+} ComicsSpillPin;
+
+static void
+comics_spill_cache_unpin (ComicsSpillPin *pin)
+{
+	ComicsDocument *comics_document = pin->comics_document;
+
+	g_mutex_lock (&comics_document->cache_mutex);
+	g_array_index (comics_document->page_info, ComicsPageInfo, pin->pos).pins--;
+	g_mutex_unlock (&comics_document->cache_mutex);
+
+	g_free (pin);
+}
+
+/* The returned bytes point to the spill cache, the page is not
+ * evicted until they are released. Called with cache_mutex held.
+ */
+static GBytes *
+comics_spill_cache_lookup (ComicsDocument *comics_document,
+			   guint           pos)
+{
+	ComicsPageInfo *info;
+	ComicsSpillPin *pin;
+
+	info = &g_array_index (comics_document->page_info, ComicsPageInfo, pos);
+	if (info->offset == -1)
+		return NULL;
+
+	g_queue_unlink (&comics_document->spill_lru, info->link);
+	g_queue_push_head_link (&comics_document->spill_lru, info->link);
+
+	info->pins++;
+	pin = g_new (ComicsSpillPin, 1);
+	pin->comics_document = comics_document;
+	pin->pos = pos;
+
+	return g_bytes_new_with_free_func (comics_document->spill_data + info->offset,
+					   info->size,
+					   (GDestroyNotify) comics_spill_cache_unpin,
+					   pin);
+}
+
+/* Reads the data of the current entry of the archive */
+static GBytes *
+archive_read_entry_data (EvArchive  *archive,
+			 GError    **error)
+{
+	GByteArray *data;
+	gint64 size;
+	gssize read;
+
+	size = ev_archive_get_entry_size (archive);
+	data = g_byte_array_sized_new (size > 0 ? size : BLOCK_SIZE);
+
+	do {
+		guint len = data->len;
+
+		g_byte_array_set_size (data, len + BLOCK_SIZE);
+		read = ev_archive_read_data (archive, data->data + len, BLOCK_SIZE, error);
+		g_byte_array_set_size (data, len + MAX (read, 0));
+	} while (read > 0);
+
+	if (read < 0) {
+		g_byte_array_unref (data);
+		return NULL;
+	}
+
+	return g_byte_array_free_to_bytes (data);
+}
+
+typedef struct {
+	gboolean got_info;
+	int height;
+	int width;
+} PixbufInfo;
+
+static void
+get_page_size_prepared_cb (GdkPixbufLoader *loader,
+			   int              width,
+			   int              height,
+			   PixbufInfo      *info)
+{
+	info->got_info = TRUE;
+	info->height = height;
+	info->width = width;
+}
+
+/* Only the header of the image is decoded */
+static gboolean
+get_image_size (GBytes *bytes,
+		int    *width,
+		int    *height)
+{
+	GdkPixbufLoader *loader;
+	const guchar *data;
+	gsize size, written;
+	PixbufInfo info;
+
+	loader = gdk_pixbuf_loader_new ();
+	info.got_info = FALSE;
+	g_signal_connect (loader, "size-prepared",
+			  G_CALLBACK (get_page_size_prepared_cb),
+			  &info);
+
+	data = g_bytes_get_data (bytes, &size);
+	for (written = 0; written < size && !info.got_info; written += BLOCK_SIZE) {
+		if (!gdk_pixbuf_loader_write (loader, data + written,
+					      MIN (BLOCK_SIZE, size - written), NULL))
+			break;
+	}
+
+	gdk_pixbuf_loader_close (loader, NULL);
+	g_object_unref (loader);
+
+	if (info.got_info) {
+		*width = info.width;
+		*height = info.height;
+	}
+
+	return info.got_info;
+}
+
+static void
+comics_document_add_page_info (ComicsDocument *comics_document,
+			       GBytes         *bytes)
+{
+	ComicsPageInfo info;
+	guint pos = comics_document->page_info->len;
+
+	info.offset = -1;
+	info.size = 0;
+	info.link = NULL;
+	info.pins = 0;
+	if (!bytes || !get_image_size (bytes, &info.width, &info.height)) {
+		info.width = -1;
+		info.height = -1;
+	}
+	g_array_append_val (comics_document->page_info, info);
+
+	if (bytes)
+		comics_spill_cache_store (comics_document, pos, bytes, FALSE);
+}
+
 static gboolean
 archive_reopen_if_needed (ComicsDocument  *comics_document,
 			  const char      *page_wanted,
@@ -176,8 +591,13 @@ comics_document_list (ComicsDocument  *comics_document,
 {
 	GPtrArray *array = NULL;
 	gboolean has_encrypted_files, has_unsupported_images, has_archive_errors;
+	gboolean read_pages;
 	GHashTable *supported_extensions = NULL;
 
+	/* Only the names are needed to find the first page */
+	read_pages = !(ev_document_get_load_flags (EV_DOCUMENT (comics_document)) &
+		       EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE);
+
 	if (!ev_archive_open_filename (comics_document->archive, comics_document->archive_path, error)) {
 		if (*error != NULL) {
 			g_warning ("Fatal error handling archive (%s): %s", G_STRFUNC, (*error)->message);
@@ -197,9 +617,11 @@ comics_document_list (ComicsDocument  *comics_document,
 	has_unsupported_images = FALSE;
 	has_archive_errors = FALSE;
 	array = g_ptr_array_sized_new (64);
+	comics_document->page_info = g_array_sized_new (FALSE, FALSE, sizeof (ComicsPageInfo), 64);
 
 	while (1) {
 		const char *name;
+		GBytes *bytes;
 		int supported;
 
 		if (!ev_archive_read_next_header (comics_document->archive, error)) {
@@ -237,6 +659,22 @@ comics_document_list (ComicsDocument  *comics_document,
 
 		g_debug ("Adding '%s' to the list of files in the comics", name);
 		g_ptr_array_add (array, g_strdup (name));
+
+		/* The archive is read only once: the size of the pages and
+		 * their data are kept while going through it.
+		 */
+		if (!read_pages) {
+			comics_document_add_page_info (comics_document, NULL);
+			continue;
+		}
+
+		bytes = archive_read_entry_data (comics_document->archive, error);
+		if (!bytes) {
+			g_debug ("Error reading '%s' in archive: %s", name, (*error)->message);
+			g_clear_error (error);
+		}
+		comics_document_add_page_info (comics_document, bytes);
+		g_clear_pointer (&bytes, g_bytes_unref);
 	}
 
 out:
@@ -365,6 +803,10 @@ comics_document_load (EvDocument *document,
 
 	comics_document->archive_uri = g_strdup (uri);
 
+	/* A single page is decompressed only once */
+	if (!(ev_document_get_load_flags (document) & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE))
+		comics_spill_cache_open (comics_document);
+
 	mime_type = ev_file_get_mime_type (uri, FALSE, error);
 	if (mime_type == NULL)
 		return FALSE;
@@ -410,52 +852,47 @@ comics_document_get_n_pages (EvDocument *document)
 	return comics_document->page_names->len;
 }
 
-typedef struct {
-	gboolean got_info;
-	int height;
-	int width;
-} PixbufInfo;
-
-static void
-get_page_size_prepared_cb (GdkPixbufLoader *loader,
-			   int              width,
-			   int              height,
-			   PixbufInfo      *info)
-{
-	info->got_info = TRUE;
-	info->height = height;
-	info->width = width;
-}
-
-static void
-comics_document_get_page_size (EvDocument *document,
-			       EvPage     *page,
-			       double     *width,
-			       double     *height)
+/* Returns the data of the page, from the spill cache if it is there
+ * or read from the archive otherwise. Called without the mutexes held.
+ */
+static GBytes *
+comics_document_get_page_data (ComicsDocument *comics_document,
+			       gint            page)
 {
-	GdkPixbufLoader *loader;
-	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
 	const char *page_path;
-	PixbufInfo info;
+	GBytes *bytes = NULL;
 	GError *error = NULL;
-
-	page_path = g_ptr_array_index (comics_document->page_names, page->index);
+	guint pos;
+
+	page_path = g_ptr_array_index (comics_document->page_names, page);
+	pos = GPOINTER_TO_UINT (g_hash_table_lookup (comics_document->page_positions, page_path)) - 1;
+
+	g_mutex_lock (&comics_document->cache_mutex);
+	bytes = comics_spill_cache_lookup (comics_document, pos);
+	g_mutex_unlock (&comics_document->cache_mutex);
+	if (bytes)
+		return bytes;
+
+	g_mutex_lock (&comics_document->archive_mutex);
+
+	/* The page may have been read while waiting for the archive */
+	g_mutex_lock (&comics_document->cache_mutex);
+	bytes = comics_spill_cache_lookup (comics_document, pos);
+	g_mutex_unlock (&comics_document->cache_mutex);
+	if (bytes) {
+		g_mutex_unlock (&comics_document->archive_mutex);
+		return bytes;
+	}
 
 	if (!archive_reopen_if_needed (comics_document, page_path, &error)) {
+		g_mutex_unlock (&comics_document->archive_mutex);
 		g_warning ("Fatal error opening archive: %s", error->message);
 		g_error_free (error);
-		return;
+		return NULL;
 	}
 
-	loader = gdk_pixbuf_loader_new ();
-	info.got_info = FALSE;
-	g_signal_connect (loader, "size-prepared",
-			  G_CALLBACK (get_page_size_prepared_cb),
-			  &info);
-
 	while (1) {
 		const char *name;
-		GError *error = NULL;
 
 		if (!ev_archive_read_next_header (comics_document->archive, &error)) {
 			if (error != NULL) {
@@ -467,79 +904,109 @@ comics_document_get_page_size (EvDocument *document,
 
 		name = ev_archive_get_entry_pathname (comics_document->archive);
 		if (g_strcmp0 (name, page_path) == 0) {
-			char buf[BLOCK_SIZE];
-			gssize read;
-			gint64 left;
-
-			left = ev_archive_get_entry_size (comics_document->archive);
-			read = ev_archive_read_data (comics_document->archive, buf,
-						     MIN(BLOCK_SIZE, left), &error);
-			while (read > 0 && !info.got_info) {
-				if (!gdk_pixbuf_loader_write (loader, (guchar *) buf, read, &error)) {
-					read = -1;
-					break;
-				}
-				left -= read;
-				read = ev_archive_read_data (comics_document->archive, buf,
-							     MIN(BLOCK_SIZE, left), &error);
-			}
-			if (read < 0) {
+			bytes = archive_read_entry_data (comics_document->archive, &error);
+			if (!bytes) {
 				g_warning ("Fatal error reading '%s' in archive: %s", name, error->message);
 				g_error_free (error);
+			} else if (g_bytes_get_size (bytes) == 0) {
+				g_warning ("Read an empty file from the archive");
+				g_clear_pointer (&bytes, g_bytes_unref);
+			} else {
+				g_mutex_lock (&comics_document->cache_mutex);
+				comics_spill_cache_store (comics_document, pos, bytes, TRUE);
+				g_mutex_unlock (&comics_document->cache_mutex);
 			}
 			break;
 		}
 	}
 
-	gdk_pixbuf_loader_close (loader, NULL);
-	g_object_unref (loader);
+	g_mutex_unlock (&comics_document->archive_mutex);
 
-	if (info.got_info) {
-		if (width)
-			*width = info.width;
-		if (height)
-			*height = info.height;
-	}
+	return bytes;
 }
 
 static void
-render_pixbuf_size_prepared_cb (GdkPixbufLoader *loader,
-				gint             width,
-				gint             height,
-				EvRenderContext *rc)
+comics_document_get_page_size (EvDocument *document,
+			       EvPage     *page,
+			       double     *width,
+			       double     *height)
 {
-	int scaled_width, scaled_height;
+	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
+	ComicsPageInfo *info;
+	const char *page_path;
+	GBytes *bytes;
+	gint page_width, page_height;
+	guint pos;
 
-	ev_render_context_compute_scaled_size (rc, width, height, &scaled_width, &scaled_height);
-	gdk_pixbuf_loader_set_size (loader, scaled_width, scaled_height);
+	page_path = g_ptr_array_index (comics_document->page_names, page->index);
+	pos = GPOINTER_TO_UINT (g_hash_table_lookup (comics_document->page_positions, page_path)) - 1;
+
+	g_mutex_lock (&comics_document->cache_mutex);
+	info = &g_array_index (comics_document->page_info, ComicsPageInfo, pos);
+	page_width = info->width;
+	page_height = info->height;
+	g_mutex_unlock (&comics_document->cache_mutex);
+
+	/* The size is found when loading, unless the page could not be read */
+	if (page_width == -1) {
+		bytes = comics_document_get_page_data (comics_document, page->index);
+		if (!bytes || !get_image_size (bytes, &page_width, &page_height)) {
+			page_width = -1;
+			page_height = -1;
+		}
+		g_clear_pointer (&bytes, g_bytes_unref);
+
+		g_mutex_lock (&comics_document->cache_mutex);
+		info->width = page_width;
+		info->height = page_height;
+		g_mutex_unlock (&comics_document->cache_mutex);
+	}
+
+	if (page_width != -1) {
+		if (width)
+			*width = page_width;
+		if (height)
+			*height = page_height;
+	}
 }
 
-static GdkPixbuf *
-comics_document_render_pixbuf (EvDocument      *document,
-			       EvRenderContext *rc)
+/* Reads the pages queued by comics_document_prefetch() in one pass
+ * through the archive */
+static void
+comics_document_prefetch_pages (gpointer        data,
+				ComicsDocument *comics_document)
 {
-	GdkPixbufLoader *loader;
-	GdkPixbuf *tmp_pixbuf;
-	GdkPixbuf *rotated_pixbuf = NULL;
-	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
-	const char *page_path;
+	GArray *pages;
 	GError *error = NULL;
+	const char *first_path;
+	guint i = 0;
 
-	page_path = g_ptr_array_index (comics_document->page_names, rc->page->index);
+	g_mutex_lock (&comics_document->cache_mutex);
+	pages = comics_document->prefetch_pages;
+	comics_document->prefetch_pages = NULL;
+	g_mutex_unlock (&comics_document->cache_mutex);
 
-	if (!archive_reopen_if_needed (comics_document, page_path, &error)) {
-		g_warning ("Fatal error opening archive: %s", error->message);
+	if (!pages)
+		return;
+
+	g_mutex_lock (&comics_document->archive_mutex);
+
+	first_path = g_ptr_array_index (comics_document->page_names,
+					g_array_index (pages, ComicsPrefetchPage, 0).page);
+	if (!archive_reopen_if_needed (comics_document, first_path, &error)) {
+		g_mutex_unlock (&comics_document->archive_mutex);
+		g_debug ("Error opening archive to prefetch pages: %s", error->message);
 		g_error_free (error);
-		return NULL;
+		g_array_unref (pages);
+		return;
 	}
 
-	loader = gdk_pixbuf_loader_new ();
-	g_signal_connect (loader, "size-prepared",
-			  G_CALLBACK (render_pixbuf_size_prepared_cb),
-			  rc);
-
-	while (1) {
+	while (i < pages->len) {
+		ComicsPrefetchPage *prefetch_page = &g_array_index (pages, ComicsPrefetchPage, i);
+		ComicsPageInfo *info;
 		const char *name;
+		GBytes *bytes;
+		gboolean cached;
 
 		if (!ev_archive_read_next_header (comics_document->archive, &error)) {
 			if (error != NULL) {
@@ -550,69 +1017,279 @@ comics_document_render_pixbuf (EvDocument      *document,
 		}
 
 		name = ev_archive_get_entry_pathname (comics_document->archive);
-		if (g_strcmp0 (name, page_path) == 0) {
-			size_t size = ev_archive_get_entry_size (comics_document->archive);
-			char *buf;
-			ssize_t read;
-
-			buf = g_malloc (size);
-			read = ev_archive_read_data (comics_document->archive, buf, size, &error);
-			if (read <= 0) {
-				if (read < 0) {
-					g_warning ("Fatal error reading '%s' in archive: %s", name, error->message);
-					g_error_free (error);
-				} else {
-					g_warning ("Read an empty file from the archive");
-				}
-			} else {
-				gdk_pixbuf_loader_write (loader, (guchar *) buf, size, NULL);
-			}
-			g_free (buf);
-			gdk_pixbuf_loader_close (loader, NULL);
-			break;
+		if (GPOINTER_TO_UINT (g_hash_table_lookup (comics_document->page_positions, name)) != prefetch_page->pos + 1)
+			continue;
+		i++;
+
+		/* It may have been rendered in the meantime */
+		g_mutex_lock (&comics_document->cache_mutex);
+		info = &g_array_index (comics_document->page_info, ComicsPageInfo, prefetch_page->pos);
+		cached = info->offset != -1;
+		g_mutex_unlock (&comics_document->cache_mutex);
+		if (cached)
+			continue;
+
+		bytes = archive_read_entry_data (comics_document->archive, NULL);
+		if (bytes && g_bytes_get_size (bytes) > 0) {
+			g_mutex_lock (&comics_document->cache_mutex);
+			comics_spill_cache_store (comics_document, prefetch_page->pos, bytes, TRUE);
+			g_mutex_unlock (&comics_document->cache_mutex);
 		}
+		g_clear_pointer (&bytes, g_bytes_unref);
 	}
 
-	tmp_pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
-	if (tmp_pixbuf) {
-		if ((rc->rotation % 360) == 0)
-			rotated_pixbuf = g_object_ref (tmp_pixbuf);
-		else
-			rotated_pixbuf = gdk_pixbuf_rotate_simple (tmp_pixbuf,
-								   360 - rc->rotation);
+	g_mutex_unlock (&comics_document->archive_mutex);
+
+	g_array_unref (pages);
+}
+
+static gint
+compare_prefetch_pages (gconstpointer a,
+			gconstpointer b)
+{
+	const ComicsPrefetchPage *page_a = a;
+	const ComicsPrefetchPage *page_b = b;
+
+	return page_a->pos < page_b->pos ? -1 : page_a->pos > page_b->pos;
+}
+
+/* Reads the next pages in the reading direction from the archive in
+ * a background thread, so that they are in the spill cache when they
+ * are rendered. Archives can only be read forward, so they are read in
+ * archive order, in a single pass, when reading backwards too.
+ */
+static void
+comics_document_prefetch (ComicsDocument *comics_document,
+			  gint            page)
+{
+	gint n_pages = comics_document->page_names->len;
+	gint direction;
+	gboolean pending;
+	GArray *pages;
+	gint i;
+
+	g_mutex_lock (&comics_document->cache_mutex);
+
+	direction = page >= comics_document->last_page ? 1 : -1;
+	comics_document->last_page = page;
+
+	if (!comics_document->spill_data) {
+		g_mutex_unlock (&comics_document->cache_mutex);
+		return;
 	}
-	g_object_unref (loader);
 
-	return rotated_pixbuf;
+	if (!comics_document->prefetch_pool) {
+		comics_document->prefetch_pool =
+			g_thread_pool_new ((GFunc) comics_document_prefetch_pages,
+					   comics_document, 1, FALSE, NULL);
+	}
+
+	pages = g_array_sized_new (FALSE, FALSE, sizeof (ComicsPrefetchPage), PREFETCH_PAGES);
+	for (i = 1; i <= PREFETCH_PAGES; i++) {
+		ComicsPrefetchPage prefetch_page;
+		ComicsPageInfo *info;
+		const char *page_path;
+		gint next = page + i * direction;
+
+		if (next < 0 || next >= n_pages)
+			break;
+
+		page_path = g_ptr_array_index (comics_document->page_names, next);
+		prefetch_page.pos = GPOINTER_TO_UINT (g_hash_table_lookup (comics_document->page_positions, page_path)) - 1;
+		prefetch_page.page = next;
+		info = &g_array_index (comics_document->page_info, ComicsPageInfo, prefetch_page.pos);
+		if (info->offset != -1)
+			continue;
+
+		g_array_append_val (pages, prefetch_page);
+	}
+
+	if (pages->len == 0) {
+		g_array_unref (pages);
+		g_mutex_unlock (&comics_document->cache_mutex);
+		return;
+	}
+
+	g_array_sort (pages, compare_prefetch_pages);
+
+	/* Pages not read yet for a previous page are not needed anymore */
+	pending = comics_document->prefetch_pages != NULL;
+	g_clear_pointer (&comics_document->prefetch_pages, g_array_unref);
+	comics_document->prefetch_pages = pages;
+	if (!pending)
+		g_thread_pool_push (comics_document->prefetch_pool, GINT_TO_POINTER (1), NULL);
+
+	g_mutex_unlock (&comics_document->cache_mutex);
+}
+
+static void
+render_pixbuf_size_prepared_cb (GdkPixbufLoader *loader,
+				gint             width,
+				gint             height,
+				EvRenderContext *rc)
+{
+	int scaled_width, scaled_height;
+
+	ev_render_context_compute_scaled_size (rc, width, height, &scaled_width, &scaled_height);
+	gdk_pixbuf_loader_set_size (loader, scaled_width, scaled_height);
 }
 
+/* Rotates @pixbuf clockwise by @rotation and converts it to a cairo
+ * surface in a single pass, instead of a copy for every step.
+ */
 static cairo_surface_t *
-comics_document_render (EvDocument      *document,
-			EvRenderContext *rc)
+surface_from_pixbuf_rotated (GdkPixbuf *pixbuf,
+			     gint       rotation)
 {
-	GdkPixbuf       *pixbuf;
 	cairo_surface_t *surface;
+	const guchar *src;
+	guchar *dst;
+	gboolean has_alpha;
+	gint width, height, src_stride, dst_stride, n_channels;
+	gint x, y;
+
+	width = gdk_pixbuf_get_width (pixbuf);
+	height = gdk_pixbuf_get_height (pixbuf);
+	has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+	n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+	src_stride = gdk_pixbuf_get_rowstride (pixbuf);
+	src = gdk_pixbuf_read_pixels (pixbuf);
+
+	rotation = ((rotation % 360) + 360) % 360;
+	if (rotation == 90 || rotation == 270)
+		surface = cairo_image_surface_create (has_alpha ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24,
+						      height, width);
+	else
+		surface = cairo_image_surface_create (has_alpha ? CAIRO_FORMAT_ARGB32 : CAIRO_FORMAT_RGB24,
+						      width, height);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+		return surface;
+
+	cairo_surface_flush (surface);
+	dst = cairo_image_surface_get_data (surface);
+	dst_stride = cairo_image_surface_get_stride (surface);
+
+	for (y = 0; y < height; y++) {
+		const guchar *p = src + y * src_stride;
+
+		for (x = 0; x < width; x++, p += n_channels) {
+			guint r = p[0], g = p[1], b = p[2];
+			guint a = has_alpha ? p[3] : 0xff;
+			gint dx, dy;
+
+			/* Cairo wants premultiplied alpha */
+			if (a != 0xff) {
+				r = (r * a + 127) / 255;
+				g = (g * a + 127) / 255;
+				b = (b * a + 127) / 255;
+			}
 
-	pixbuf = comics_document_render_pixbuf (document, rc);
-	if (!pixbuf)
+			switch (rotation) {
+			case 90:
+				dx = height - 1 - y;
+				dy = x;
+				break;
+			case 180:
+				dx = width - 1 - x;
+				dy = height - 1 - y;
+				break;
+			case 270:
+				dx = y;
+				dy = width - 1 - x;
+				break;
+			default:
+				dx = x;
+				dy = y;
+				break;
+			}
+
+			*(guint32 *) (dst + dy * dst_stride + dx * 4) = (a << 24) | (r << 16) | (g << 8) | b;
+		}
+	}
+
+	cairo_surface_mark_dirty (surface);
+
+	return surface;
+}
+
+/* Decodes the page straight to the size of @rc. This does not need
+ * the document lock, only reading the data of the page is serialized.
+ */
+static cairo_surface_t *
+comics_document_render_surface (ComicsDocument  *comics_document,
+				EvRenderContext *rc)
+{
+	GdkPixbufLoader *loader;
+	GdkPixbuf *pixbuf;
+	cairo_surface_t *surface = NULL;
+	GBytes *bytes;
+
+	bytes = comics_document_get_page_data (comics_document, rc->page->index);
+	comics_document_prefetch (comics_document, rc->page->index);
+	if (!bytes)
 		return NULL;
-	surface = ev_document_misc_surface_from_pixbuf (pixbuf);
-	g_clear_object (&pixbuf);
+
+	loader = gdk_pixbuf_loader_new ();
+	g_signal_connect (loader, "size-prepared",
+			  G_CALLBACK (render_pixbuf_size_prepared_cb),
+			  rc);
+
+	gdk_pixbuf_loader_write_bytes (loader, bytes, NULL);
+	gdk_pixbuf_loader_close (loader, NULL);
+	g_bytes_unref (bytes);
+
+	pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+	if (pixbuf)
+		surface = surface_from_pixbuf_rotated (pixbuf, rc->rotation);
+	g_object_unref (loader);
 
 	return surface;
 }
 
+static cairo_surface_t *
+comics_document_render (EvDocument      *document,
+			EvRenderContext *rc)
+{
+	return comics_document_render_surface (COMICS_DOCUMENT (document), rc);
+}
+
+static gboolean
+comics_document_parallel_render_sync (EvDocumentParallelRender *document)
+{
+	/* Nothing is shared with the document lock */
+	return TRUE;
+}
+
+static cairo_surface_t *
+comics_document_parallel_render_render_page (EvDocumentParallelRender *document,
+					     EvRenderContext          *rc)
+{
+	return comics_document_render_surface (COMICS_DOCUMENT (document), rc);
+}
+
 static void
 comics_document_finalize (GObject *object)
 {
 	ComicsDocument *comics_document = COMICS_DOCUMENT (object);
 
+	/* The prefetch threads use the document without a reference,
+	 * wait for them before freeing anything they read. Queued pages
+	 * are dropped.
+	 */
+	if (comics_document->prefetch_pool)
+		g_thread_pool_free (comics_document->prefetch_pool, TRUE, TRUE);
+	g_clear_pointer (&comics_document->prefetch_pages, g_array_unref);
+
 	if (comics_document->page_names) {
                 g_ptr_array_foreach (comics_document->page_names, (GFunc) g_free, NULL);
                 g_ptr_array_free (comics_document->page_names, TRUE);
 	}
 
 	g_clear_pointer (&comics_document->page_positions, g_hash_table_destroy);
+	g_clear_pointer (&comics_document->page_info, g_array_unref);
+	comics_spill_cache_close (comics_document);
+	g_mutex_clear (&comics_document->archive_mutex);
+	g_mutex_clear (&comics_document->cache_mutex);
 	g_clear_object (&comics_document->archive);
 	g_free (comics_document->archive_path);
 	g_free (comics_document->archive_uri);
@@ -639,4 +1316,15 @@ static void
 comics_document_init (ComicsDocument *comics_document)
 {
 	comics_document->archive = ev_archive_new ();
+	comics_document->spill_fd = -1;
+	g_queue_init (&comics_document->spill_lru);
+	g_mutex_init (&comics_document->archive_mutex);
+	g_mutex_init (&comics_document->cache_mutex);
+}
+
+static void
+comics_document_parallel_render_iface_init (EvDocumentParallelRenderInterface *iface)
+{
+	iface->sync = comics_document_parallel_render_sync;
+	iface->render_page = comics_document_parallel_render_render_page;
 }
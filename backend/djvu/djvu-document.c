@@ -220,6 +220,14 @@ djvu_document_load (EvDocument  *document,
 
 	djvu_document->n_pages = ddjvu_document_get_pagenum (djvu_document->d_document);
 
+	/* Page titles and file ids are only needed for labels and links */
+	if (ev_document_get_load_flags (document) & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE) {
+		djvu_document->file_ids = g_hash_table_new (g_str_hash, g_str_equal);
+		g_free (filename);
+
+		return TRUE;
+	}
+
 	if (djvu_document->n_pages > 0) {
 		djvu_document->fileinfo_pages = g_new0 (ddjvu_fileinfo_t, djvu_document->n_pages);
 		djvu_document->file_ids = g_hash_table_new (g_str_hash, g_str_equal);
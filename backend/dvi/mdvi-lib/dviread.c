@@ -565,17 +565,18 @@ int mdvi_configure(DviContext *dvi, DviParamCode option, ...)
 		case MDVI_SET_YDPI:
 			np.vdpi = va_arg(ap, Uint);
 			break;
+		/*
+		 * The glyphs shrunk by the previous factors are kept,
+		 * font_get_glyph() picks those for the new ones.
+		 */
 		case MDVI_SET_SHRINK:
 			np.hshrink = np.vshrink = va_arg(ap, Uint);
-			reset_font = MDVI_FONTSEL_GREY|MDVI_FONTSEL_BITMAP;
 			break;
 		case MDVI_SET_XSHRINK:
 			np.hshrink = va_arg(ap, Uint);
-			reset_font = MDVI_FONTSEL_GREY|MDVI_FONTSEL_BITMAP;
 			break;
 		case MDVI_SET_YSHRINK:
 			np.vshrink = va_arg(ap, Uint);
-			reset_font = MDVI_FONTSEL_GREY|MDVI_FONTSEL_BITMAP;
 			break;
 		case MDVI_SET_ORIENTATION:
 			np.orientation = va_arg(ap, DviOrientation);
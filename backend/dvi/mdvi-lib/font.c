@@ -24,6 +24,33 @@
 
 static ListHead fontlist;
 
+/*
+ * Glyphs shrunk for other factors than the current one are kept in a
+ * cache attached to each glyph, so that rendering alternately at a few
+ * scales (a page, its thumbnail, a presentation) does not shrink every
+ * glyph again at each change. The glyphs in use are not in the cache,
+ * whose size is capped by freeing the least recently cached first.
+ */
+#define GLYPH_CACHE_MAX_SIZE	(16 * 1024 * 1024)
+
+struct _DviGlyphCache {
+	DviGlyphCache *next;	/* LRU list, must be first */
+	DviGlyphCache *prev;
+	DviGlyphCache *chnext;	/* other factors of the same glyph */
+	DviFontChar *ch;
+	Ushort	hshrink;
+	Ushort	vshrink;
+	Ulong	fg;
+	Ulong	bg;
+	DviGlyph shrunk;
+	DviGlyph grey;
+	DviFreeImage free_image;
+	size_t	size;
+};
+
+static ListHead glyph_cache;
+static size_t glyph_cache_size;
+
 extern char *_mdvi_fallback_font;
 
 extern void vf_free_macros(DviFont *);
@@ -343,6 +370,119 @@ static int load_one_glyph(DviContext *dvi, DviFont *font, int code)
 	return 0;
 }
 
+static size_t glyph_cache_entry_size(DviGlyphCache *gc)
+{
+	size_t	size = 0;
+
+	if(MDVI_GLYPH_NONEMPTY(gc->shrunk.data)) {
+		BITMAP	*bm = (BITMAP *)gc->shrunk.data;
+
+		size += (size_t)bm->stride * bm->height;
+	}
+	/* device images, assume 32 bits per pixel */
+	if(MDVI_GLYPH_NONEMPTY(gc->grey.data))
+		size += (size_t)gc->grey.w * gc->grey.h * 4;
+
+	return size;
+}
+
+static void glyph_cache_remove(DviGlyphCache *gc)
+{
+	DviGlyphCache **ptr;
+
+	for(ptr = &gc->ch->cache; *ptr != gc; ptr = &(*ptr)->chnext)
+		;
+	*ptr = gc->chnext;
+	listh_remove(&glyph_cache, LIST(gc));
+	glyph_cache_size -= gc->size;
+	if(MDVI_GLYPH_NONEMPTY(gc->shrunk.data))
+		bitmap_destroy((BITMAP *)gc->shrunk.data);
+	if(MDVI_GLYPH_NONEMPTY(gc->grey.data) && gc->free_image)
+		gc->free_image(gc->grey.data);
+	mdvi_free(gc);
+}
+
+/* frees the bitmaps selected by `what' from the cache of `ch' */
+static void glyph_cache_reset(DviFontChar *ch, int what)
+{
+	DviGlyphCache *gc, *next;
+
+	for(gc = ch->cache; gc; gc = next) {
+		next = gc->chnext;
+		if(what & MDVI_FONTSEL_BITMAP) {
+			if(MDVI_GLYPH_NONEMPTY(gc->shrunk.data))
+				bitmap_destroy((BITMAP *)gc->shrunk.data);
+			gc->shrunk.data = NULL;
+		}
+		if(what & MDVI_FONTSEL_GREY) {
+			if(MDVI_GLYPH_NONEMPTY(gc->grey.data) && gc->free_image)
+				gc->free_image(gc->grey.data);
+			gc->grey.data = NULL;
+		}
+		glyph_cache_size -= gc->size;
+		gc->size = glyph_cache_entry_size(gc);
+		glyph_cache_size += gc->size;
+		if(MDVI_GLYPH_UNSET(gc->shrunk.data) && 
+		   MDVI_GLYPH_UNSET(gc->grey.data))
+			glyph_cache_remove(gc);
+	}
+}
+
+/*
+ * Makes the shrunk bitmaps of `ch' those for the current shrink factors,
+ * caching the previous ones. Fonts are shared by all the DVI contexts, so
+ * this is done for every glyph drawn rather than when the factors change.
+ */
+static void glyph_cache_swap(DviContext *dvi, DviFontChar *ch)
+{
+	DviGlyphCache *gc;
+	Ushort	h = dvi->params.hshrink;
+	Ushort	v = dvi->params.vshrink;
+
+	if(ch->hshrink == h && ch->vshrink == v)
+		return;
+
+	if(!MDVI_GLYPH_UNSET(ch->shrunk.data) ||
+	   !MDVI_GLYPH_UNSET(ch->grey.data)) {
+		gc = xalloc(DviGlyphCache);
+		gc->ch = ch;
+		gc->hshrink = ch->hshrink;
+		gc->vshrink = ch->vshrink;
+		gc->fg = ch->fg;
+		gc->bg = ch->bg;
+		gc->shrunk = ch->shrunk;
+		gc->grey = ch->grey;
+		gc->free_image = dvi->device.free_image;
+		gc->size = glyph_cache_entry_size(gc);
+		gc->chnext = ch->cache;
+		ch->cache = gc;
+		listh_append(&glyph_cache, LIST(gc));
+		glyph_cache_size += gc->size;
+		ch->shrunk.data = NULL;
+		ch->grey.data = NULL;
+	}
+	ch->hshrink = h;
+	ch->vshrink = v;
+
+	for(gc = ch->cache; gc; gc = gc->chnext) {
+		if(gc->hshrink == h && gc->vshrink == v)
+			break;
+	}
+	if(gc) {
+		DEBUG((DBG_FONTS, "reusing glyph shrunk by %dx%d\n", h, v));
+		ch->shrunk = gc->shrunk;
+		ch->grey = gc->grey;
+		ch->fg = gc->fg;
+		ch->bg = gc->bg;
+		gc->shrunk.data = NULL;
+		gc->grey.data = NULL;
+		glyph_cache_remove(gc);
+	}
+
+	while(glyph_cache_size > GLYPH_CACHE_MAX_SIZE && glyph_cache.head)
+		glyph_cache_remove((DviGlyphCache *)glyph_cache.head);
+}
+
 DviFontChar *font_get_glyph(DviContext *dvi, DviFont *font, int code)
 {
 	DviFontChar *ch;
@@ -366,6 +506,10 @@ again:
 	/* yes, we have to do this again */
 	ch = FONTCHAR(font, code);
 
+	/* only glyphs from files are ever shrunk */
+	if(font->finfo->getglyph != NULL)
+		glyph_cache_swap(dvi, ch);
+
 	/* Got the glyph. If we also have the right scaled glyph, do no more */
 	if(!ch->width || !ch->height ||
 	   font->finfo->getglyph == NULL ||
@@ -400,6 +544,8 @@ void	font_reset_one_glyph(DviDevice *dev, DviFontChar *ch, int what)
 {
 	if(!glyph_present(ch))
 		return;
+	glyph_cache_reset(ch, (what & MDVI_FONTSEL_GLYPH) ?
+		MDVI_FONTSEL_BITMAP|MDVI_FONTSEL_GREY : what);
 	if(what & MDVI_FONTSEL_BITMAP) {
 		if(MDVI_GLYPH_NONEMPTY(ch->shrunk.data))
 			bitmap_destroy((BITMAP *)ch->shrunk.data);
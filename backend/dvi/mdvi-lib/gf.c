@@ -340,6 +340,9 @@ static int gf_load_font(DviParams *unused, DviFont *font)
 		ch->glyph.data = NULL;
 		ch->shrunk.data = NULL;
 		ch->grey.data = NULL;
+		ch->hshrink = 0;
+		ch->vshrink = 0;
+		ch->cache = NULL;
 		ch->flags = 0;
 		ch->loaded = 0;
 	}	
@@ -31,6 +31,7 @@
 typedef struct _DviGlyph DviGlyph;
 typedef struct _DviDevice DviDevice;
 typedef struct _DviFontChar DviFontChar;
+typedef struct _DviGlyphCache DviGlyphCache;
 typedef struct _DviFontRef DviFontRef;
 typedef struct _DviFontInfo DviFontInfo;
 typedef struct _DviFont DviFont;
@@ -201,6 +202,11 @@ struct _DviFontChar {
 	DviGlyph glyph;
 	DviGlyph shrunk;
 	DviGlyph grey;
+	/* shrink factors of `shrunk' and `grey' */
+	Ushort	hshrink;
+	Ushort	vshrink;
+	/* shrunk bitmaps for other shrink factors */
+	DviGlyphCache *cache;
 };
 
 struct _DviFontRef {
@@ -25,6 +25,8 @@
 #include <string.h>
 #ifdef _WIN32
 #include <io.h>
+#else
+#include <unistd.h>
 #endif
 #include <gtk/gtk.h>
 #include <poppler.h>
@@ -55,6 +57,8 @@
 #include "ev-document-annotations.h"
 #include "ev-document-attachments.h"
 #include "ev-document-text.h"
+#include "ev-document-parallel-render.h"
+#include "ev-document-fingerprint.h"
 #include "ev-form-field-private.h"
 #include "ev-selection.h"
 #include "ev-transition-effect.h"
@@ -62,6 +66,7 @@
 #include "ev-image.h"
 #include "ev-media.h"
 #include "ev-file-helpers.h"
+#include "ev-byte-source.h"
 
 #if (defined (HAVE_CAIRO_PDF) || defined (HAVE_CAIRO_PS))
 #define HAVE_CAIRO_PRINT
@@ -71,6 +76,11 @@
 #define HAVE_POPPLER_LOAD_FD
 #endif
 
+/* Default maximum number of render copies of a document,
+ * can be overridden with EV_PDF_RENDER_COPIES, 0 disables them.
+ */
+#define PDF_MAX_RENDER_COPIES 4
+
 typedef struct {
 	EvFileExporterFormat format;
 
@@ -99,6 +109,8 @@ struct _PdfDocument
 	EvDocument parent_instance;
 
 	PopplerDocument *document;
+	/* The source of documents loaded from a file */
+	EvByteSource *source;
 	gchar *password;
 	gboolean forms_modified;
 	gboolean annots_modified;
@@ -111,8 +123,45 @@ struct _PdfDocument
 	PdfPrintContext *print_ctx;
 
 	GHashTable *annots;
+
+	/* Incremented on every form field or annotation change */
+	guint contents_serial;
+	/* Incremented on every layer visibility change */
+	gint layers_serial;
+
+	/* Render copies: PopplerDocuments opened on the contents of the
+	 * document, used to render pages from several threads without the
+	 * document lock. They read the file the document was loaded from,
+	 * until forms or annotations are modified: the contents are then
+	 * saved, in a thread, to an unlinked temporary file they read instead.
+	 * Protected by render_copies_mutex, and changed with the document
+	 * lock held too.
+	 */
+	GMutex render_copies_mutex;
+	GCond render_copies_cond;
+	EvByteSource *render_copies_source;
+	guint render_copies_contents_serial;
+	gboolean render_copies_stale;
+	gboolean render_copies_failed;
+	gboolean render_copies_saving;
+	/* Contents change seen last, and when, to save the copies again
+	 * only once the contents stop changing. Protected by the document lock.
+	 */
+	guint render_copies_pending_serial;
+	gint64 render_copies_pending_time;
+	GQueue idle_render_copies;
+	guint n_render_copies;
+	guint max_render_copies;
+	GArray *render_copies_layers;
+	gint render_copies_layers_serial;
 };
 
+typedef struct {
+	PopplerDocument *document;
+	guint contents_serial;
+	gint layers_serial;
+} PdfRenderCopy;
+
 static void pdf_document_security_iface_init             (EvDocumentSecurityInterface    *iface);
 static void pdf_document_document_links_iface_init       (EvDocumentLinksInterface       *iface);
 static void pdf_document_document_images_iface_init      (EvDocumentImagesInterface      *iface);
@@ -128,6 +177,8 @@ static void pdf_document_file_exporter_iface_init        (EvFileExporterInterfac
 static void pdf_selection_iface_init                     (EvSelectionInterface           *iface);
 static void pdf_document_page_transition_iface_init      (EvDocumentTransitionInterface  *iface);
 static void pdf_document_text_iface_init                 (EvDocumentTextInterface        *iface);
+static void pdf_document_parallel_render_iface_init      (EvDocumentParallelRenderInterface *iface);
+static void pdf_document_fingerprint_iface_init          (EvDocumentFingerprintInterface *iface);
 static int  pdf_document_get_n_pages			 (EvDocument                     *document);
 
 static EvLinkDest *ev_link_dest_from_dest    (PdfDocument       *pdf_document,
@@ -172,8 +223,19 @@ EV_BACKEND_REGISTER_WITH_CODE (PdfDocument, pdf_document,
 								 pdf_document_page_transition_iface_init);
 				 EV_BACKEND_IMPLEMENT_INTERFACE (EV_TYPE_DOCUMENT_TEXT,
 								 pdf_document_text_iface_init);
+				 EV_BACKEND_IMPLEMENT_INTERFACE (EV_TYPE_DOCUMENT_PARALLEL_RENDER,
+								 pdf_document_parallel_render_iface_init);
+				 EV_BACKEND_IMPLEMENT_INTERFACE (EV_TYPE_DOCUMENT_FINGERPRINT,
+								 pdf_document_fingerprint_iface_init);
 			 });
 
+static void
+pdf_render_copy_free (PdfRenderCopy *copy)
+{
+	g_object_unref (copy->document);
+	g_free (copy);
+}
+
 static void
 pdf_document_dispose (GObject *object)
 {
@@ -190,16 +252,45 @@ pdf_document_dispose (GObject *object)
 	}
 
         g_clear_object (&pdf_document->document);
+        g_clear_object (&pdf_document->source);
         g_clear_pointer (&pdf_document->font_info, poppler_font_info_free);
         g_clear_pointer (&pdf_document->fonts_iter, poppler_fonts_iter_free);
 
+	g_queue_clear_full (&pdf_document->idle_render_copies,
+			    (GDestroyNotify) pdf_render_copy_free);
+	g_clear_object (&pdf_document->render_copies_source);
+	g_clear_pointer (&pdf_document->render_copies_layers, g_array_unref);
+
 	G_OBJECT_CLASS (pdf_document_parent_class)->dispose (object);
 }
 
+static void
+pdf_document_finalize (GObject *object)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (object);
+
+	g_mutex_clear (&pdf_document->render_copies_mutex);
+	g_cond_clear (&pdf_document->render_copies_cond);
+
+	G_OBJECT_CLASS (pdf_document_parent_class)->finalize (object);
+}
+
 static void
 pdf_document_init (PdfDocument *pdf_document)
 {
+	const gchar *env;
+
 	pdf_document->password = NULL;
+
+	g_mutex_init (&pdf_document->render_copies_mutex);
+	g_cond_init (&pdf_document->render_copies_cond);
+	pdf_document->render_copies_stale = TRUE;
+
+	env = g_getenv ("EV_PDF_RENDER_COPIES");
+	if (env != NULL)
+		pdf_document->max_render_copies = (guint) g_ascii_strtoull (env, NULL, 10);
+	else
+		pdf_document->max_render_copies = CLAMP (g_get_num_processors (), 1, PDF_MAX_RENDER_COPIES);
 }
 
 static void
@@ -259,15 +350,34 @@ pdf_document_load (EvDocument   *document,
 {
 	GError *poppler_error = NULL;
 	PdfDocument *pdf_document = PDF_DOCUMENT (document);
+	EvByteSource *source;
+	GInputStream *stream;
 
+	source = ev_byte_source_new_for_uri (uri, NULL, error);
+	if (!source)
+		return FALSE;
+
+	/* Poppler reads the parts it needs through the source */
+	stream = ev_byte_source_get_stream (source);
 	pdf_document->document =
-		poppler_document_new_from_file (uri, pdf_document->password, &poppler_error);
+		poppler_document_new_from_stream (stream,
+						  ev_byte_source_get_size (source),
+						  pdf_document->password,
+						  NULL, &poppler_error);
+	g_object_unref (stream);
 
 	if (pdf_document->document == NULL) {
+		g_object_unref (source);
 		convert_error (poppler_error, error);
 		return FALSE;
 	}
 
+	pdf_document->source = source;
+
+	/* Render copies can read the file right away */
+	pdf_document->render_copies_source = g_object_ref (source);
+	pdf_document->render_copies_stale = FALSE;
+
 	return TRUE;
 }
 
@@ -403,10 +513,18 @@ pdf_page_render (PopplerPage     *page,
 	cairo_t *cr;
 	double page_width, page_height;
 	double xscale, yscale;
+	gint area_x, area_y, area_width, area_height;
 
-	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-					      width, height);
-	cr = cairo_create (surface);
+	if (ev_render_context_get_area (rc, &area_x, &area_y, &area_width, &area_height)) {
+		surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						      area_width, area_height);
+		cr = cairo_create (surface);
+		cairo_translate (cr, -area_x, -area_y);
+	} else {
+		surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						      width, height);
+		cr = cairo_create (surface);
+	}
 
 	switch (rc->rotation) {
 	        case 90:
@@ -467,9 +585,7 @@ make_thumbnail_for_page (PopplerPage     *poppler_page,
 	GdkPixbuf *pixbuf;
 	cairo_surface_t *surface;
 
-	ev_document_fc_mutex_lock ();
 	surface = pdf_page_render (poppler_page, width, height, rc);
-	ev_document_fc_mutex_unlock ();
 
 	pixbuf = ev_document_misc_pixbuf_from_surface (surface);
 	cairo_surface_destroy (surface);
@@ -562,9 +678,7 @@ pdf_document_get_thumbnail_surface (EvDocument      *document,
 		}
 	}
 
-	ev_document_fc_mutex_lock ();
 	surface = pdf_page_render (poppler_page, width, height, rc);
-	ev_document_fc_mutex_unlock ();
 
 	return surface;
 }
@@ -776,6 +890,19 @@ pdf_document_support_synctex (EvDocument *document)
 	return TRUE;
 }
 
+/* poppler >= 22.02 protects its global state, including font lookups */
+static gboolean
+pdf_document_is_render_thread_safe (EvDocument *document)
+{
+	return TRUE;
+}
+
+static gboolean
+pdf_document_supports_render_area (EvDocument *document)
+{
+	return TRUE;
+}
+
 static void
 pdf_document_class_init (PdfDocumentClass *klass)
 {
@@ -783,6 +910,7 @@ pdf_document_class_init (PdfDocumentClass *klass)
 	EvDocumentClass *ev_document_class = EV_DOCUMENT_CLASS (klass);
 
 	g_object_class->dispose = pdf_document_dispose;
+	g_object_class->finalize = pdf_document_finalize;
 
 	ev_document_class->save = pdf_document_save;
 	ev_document_class->load = pdf_document_load;
@@ -798,6 +926,8 @@ pdf_document_class_init (PdfDocumentClass *klass)
 	ev_document_class->get_info = pdf_document_get_info;
 	ev_document_class->get_backend_info = pdf_document_get_backend_info;
 	ev_document_class->support_synctex = pdf_document_support_synctex;
+	ev_document_class->is_render_thread_safe = pdf_document_is_render_thread_safe;
+	ev_document_class->supports_render_area = pdf_document_supports_render_area;
 #ifdef HAVE_POPPLER_LOAD_FD
         ev_document_class->load_fd = pdf_document_load_fd;
 #endif
@@ -807,8 +937,8 @@ pdf_document_class_init (PdfDocumentClass *klass)
 static gboolean
 pdf_document_has_document_security (EvDocumentSecurity *document_security)
 {
-	/* FIXME: do we really need to have this? */
-	return FALSE;
+	/* Documents opened with a password */
+	return PDF_DOCUMENT (document_security)->password != NULL;
 }
 
 static void
@@ -1573,22 +1703,15 @@ pdf_document_find_find_text_with_options (EvDocumentFind *document_find,
 }
 
 static GList *
-pdf_document_find_find_text_extended (EvDocumentFind *document_find,
-				      EvPage         *page,
-				      const gchar    *text,
-				      EvFindOptions   options)
+pdf_page_find_text_extended (PopplerPage   *poppler_page,
+			     const gchar   *text,
+			     EvFindOptions  options)
 {
 	GList *matches, *l;
-	PopplerPage *poppler_page;
 	gdouble height;
 	GList *retval = NULL;
 	guint find_flags = 0;
 
-	g_return_val_if_fail (POPPLER_IS_PAGE (page->backend_page), NULL);
-	g_return_val_if_fail (text != NULL, NULL);
-
-	poppler_page = POPPLER_PAGE (page->backend_page);
-
 	if (options & EV_FIND_CASE_SENSITIVE)
 		find_flags |= POPPLER_FIND_CASE_SENSITIVE;
 #if POPPLER_CHECK_VERSION(0, 76, 0)
@@ -1632,6 +1755,19 @@ pdf_document_find_find_text_extended (EvDocumentFind *document_find,
 	return g_list_reverse (retval);
 }
 
+static GList *
+pdf_document_find_find_text_extended (EvDocumentFind *document_find,
+				      EvPage         *page,
+				      const gchar    *text,
+				      EvFindOptions   options)
+{
+	g_return_val_if_fail (POPPLER_IS_PAGE (page->backend_page), NULL);
+	g_return_val_if_fail (text != NULL, NULL);
+
+	return pdf_page_find_text_extended (POPPLER_PAGE (page->backend_page),
+					    text, options);
+}
+
 static GList *
 pdf_document_find_find_text (EvDocumentFind *document_find,
 			     EvPage         *page,
@@ -2502,6 +2638,7 @@ pdf_document_forms_form_field_text_set_text (EvDocumentForms *document,
 
 	poppler_form_field_text_set_text (poppler_field, text);
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
+	PDF_DOCUMENT (document)->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
 
@@ -2518,6 +2655,7 @@ pdf_document_forms_form_field_button_set_state (EvDocumentForms *document,
 
 	poppler_form_field_button_set_state (poppler_field, state);
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
+	PDF_DOCUMENT (document)->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
 
@@ -2600,6 +2738,7 @@ pdf_document_forms_form_field_choice_select_item (EvDocumentForms *document,
 
 	poppler_form_field_choice_select_item (poppler_field, index);
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
+	PDF_DOCUMENT (document)->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
 
@@ -2616,6 +2755,7 @@ pdf_document_forms_form_field_choice_toggle_item (EvDocumentForms *document,
 
 	poppler_form_field_choice_toggle_item (poppler_field, index);
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
+	PDF_DOCUMENT (document)->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
 
@@ -2631,6 +2771,7 @@ pdf_document_forms_form_field_choice_unselect_all (EvDocumentForms *document,
 
 	poppler_form_field_choice_unselect_all (poppler_field);
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
+	PDF_DOCUMENT (document)->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
 
@@ -2647,6 +2788,7 @@ pdf_document_forms_form_field_choice_set_text (EvDocumentForms *document,
 
 	poppler_form_field_choice_set_text (poppler_field, text);
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
+	PDF_DOCUMENT (document)->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
 
@@ -3135,6 +3277,7 @@ pdf_document_annotations_remove_annotation (EvDocumentAnnotations *document_anno
         }
 
         pdf_document->annots_modified = TRUE;
+        pdf_document->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document_annotations), TRUE);
 }
 
@@ -3351,6 +3494,7 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 	}
 
 	pdf_document->annots_modified = TRUE;
+	pdf_document->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document_annotations), TRUE);
 }
 
@@ -3570,6 +3714,7 @@ pdf_document_annotations_save_annotation (EvDocumentAnnotations *document_annota
 	}
 
 	PDF_DOCUMENT (document_annotations)->annots_modified = TRUE;
+	PDF_DOCUMENT (document_annotations)->contents_serial++;
 	ev_document_set_modified (EV_DOCUMENT (document_annotations), TRUE);
 }
 
@@ -4081,6 +4226,7 @@ pdf_document_layers_show_layer (EvDocumentLayers *document,
 
 	poppler_layer = POPPLER_LAYER (g_object_get_data (G_OBJECT (layer), "poppler-layer"));
 	poppler_layer_show (poppler_layer);
+	g_atomic_int_inc (&PDF_DOCUMENT (document)->layers_serial);
 }
 
 static void
@@ -4091,6 +4237,7 @@ pdf_document_layers_hide_layer (EvDocumentLayers *document,
 
 	poppler_layer = POPPLER_LAYER (g_object_get_data (G_OBJECT (layer), "poppler-layer"));
 	poppler_layer_hide (poppler_layer);
+	g_atomic_int_inc (&PDF_DOCUMENT (document)->layers_serial);
 }
 
 static gboolean
@@ -4112,3 +4259,472 @@ pdf_document_document_layers_iface_init (EvDocumentLayersInterface *iface)
 	iface->hide_layer = pdf_document_layers_hide_layer;
 	iface->layer_is_visible = pdf_document_layers_layer_is_visible;
 }
+
+/* EvDocumentParallelRender */
+static void
+pdf_document_get_layers_visibility (PopplerLayersIter *iter,
+				    GArray            *visibility)
+{
+	do {
+		PopplerLayer      *layer;
+		PopplerLayersIter *child;
+		gboolean           visible;
+
+		layer = poppler_layers_iter_get_layer (iter);
+		if (layer) {
+			visible = poppler_layer_is_visible (layer);
+			g_array_append_val (visibility, visible);
+			g_object_unref (layer);
+		}
+
+		child = poppler_layers_iter_get_child (iter);
+		if (child) {
+			pdf_document_get_layers_visibility (child, visibility);
+			poppler_layers_iter_free (child);
+		}
+	} while (poppler_layers_iter_next (iter));
+}
+
+static void
+pdf_document_set_layers_visibility (PopplerLayersIter *iter,
+				    GArray            *visibility,
+				    guint             *index)
+{
+	do {
+		PopplerLayer      *layer;
+		PopplerLayersIter *child;
+
+		layer = poppler_layers_iter_get_layer (iter);
+		if (layer) {
+			if (*index < visibility->len) {
+				if (g_array_index (visibility, gboolean, *index))
+					poppler_layer_show (layer);
+				else
+					poppler_layer_hide (layer);
+			}
+			(*index)++;
+			g_object_unref (layer);
+		}
+
+		child = poppler_layers_iter_get_child (iter);
+		if (child) {
+			pdf_document_set_layers_visibility (child, visibility, index);
+			poppler_layers_iter_free (child);
+		}
+	} while (poppler_layers_iter_next (iter));
+}
+
+/* Time the contents must stay unchanged before they are saved for the
+ * render copies. Pages are rendered with the document lock until then.
+ */
+#define PDF_RENDER_COPIES_SAVE_DELAY (G_USEC_PER_SEC / 2)
+
+/* Saves the current contents of the document, including modified
+ * forms and annotations, so that render copies see them too. The file
+ * is unlinked right away: the mapping is private to evince, so it
+ * can't be truncated under the render copies like the original
+ * document can.
+ */
+static GMappedFile *
+pdf_document_save_for_render_copies (PdfDocument *pdf_document)
+{
+	GMappedFile *mapped_file = NULL;
+	gchar       *filename;
+	gchar       *uri;
+	gint         fd;
+
+	fd = ev_mkstemp ("pdf-render.XXXXXX", &filename, NULL);
+	if (fd == -1)
+		return NULL;
+	close (fd);
+
+	uri = g_filename_to_uri (filename, NULL, NULL);
+	if (uri && poppler_document_save (pdf_document->document, uri, NULL))
+		mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+
+	ev_tmp_filename_unlink (filename);
+	g_free (filename);
+	g_free (uri);
+
+	return mapped_file;
+}
+
+/* Saves the contents for the render copies in a thread, so that it is
+ * not done by the render job that noticed the change */
+static void
+save_render_copies_thread (GTask        *task,
+			   gpointer      source_object,
+			   gpointer      task_data,
+			   GCancellable *cancellable)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (source_object);
+	GMappedFile *mapped_file;
+
+	ev_document_lock (EV_DOCUMENT (pdf_document));
+
+	mapped_file = pdf_document_save_for_render_copies (pdf_document);
+
+	g_mutex_lock (&pdf_document->render_copies_mutex);
+	g_clear_object (&pdf_document->render_copies_source);
+	if (mapped_file) {
+		GBytes *bytes = g_mapped_file_get_bytes (mapped_file);
+
+		pdf_document->render_copies_source = ev_byte_source_new_for_bytes (bytes);
+		pdf_document->render_copies_contents_serial = pdf_document->contents_serial;
+		pdf_document->render_copies_stale = FALSE;
+		g_bytes_unref (bytes);
+		g_mapped_file_unref (mapped_file);
+
+		/* Copies opened on the old contents still in use are freed
+		 * when released, and new ones are only opened once there
+		 * are fewer than max_render_copies copies left.
+		 */
+		while (!g_queue_is_empty (&pdf_document->idle_render_copies)) {
+			pdf_render_copy_free (g_queue_pop_head (&pdf_document->idle_render_copies));
+			pdf_document->n_render_copies--;
+		}
+		g_cond_broadcast (&pdf_document->render_copies_cond);
+	} else {
+		/* Render from the main document from now on */
+		pdf_document->render_copies_failed = TRUE;
+	}
+	g_mutex_unlock (&pdf_document->render_copies_mutex);
+
+	pdf_document->render_copies_saving = FALSE;
+
+	ev_document_unlock (EV_DOCUMENT (pdf_document));
+}
+
+static gboolean
+pdf_document_parallel_render_sync (EvDocumentParallelRender *document)
+{
+	PdfDocument       *pdf_document = PDF_DOCUMENT (document);
+	gint               layers_serial;
+	gboolean           retval;
+
+	/* A single page is rendered once, nothing is rendered in parallel */
+	if (pdf_document->max_render_copies == 0 ||
+	    pdf_document->render_copies_failed ||
+	    ev_document_get_load_flags (EV_DOCUMENT (document)) & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE)
+		return FALSE;
+
+	if (pdf_document->render_copies_stale ||
+	    pdf_document->contents_serial != pdf_document->render_copies_contents_serial) {
+		gint64 now = g_get_monotonic_time ();
+
+		if (!pdf_document->render_copies_stale) {
+			g_mutex_lock (&pdf_document->render_copies_mutex);
+			pdf_document->render_copies_stale = TRUE;
+			g_mutex_unlock (&pdf_document->render_copies_mutex);
+		}
+
+		/* Every motion of an annotation drag changes the contents:
+		 * wait until they settle instead of saving the whole
+		 * document for each of them. Documents not loaded from a
+		 * file are saved right away.
+		 */
+		if (pdf_document->render_copies_pending_serial != pdf_document->contents_serial) {
+			pdf_document->render_copies_pending_serial = pdf_document->contents_serial;
+			pdf_document->render_copies_pending_time = now;
+		}
+
+		if (!pdf_document->render_copies_saving &&
+		    now - pdf_document->render_copies_pending_time >= PDF_RENDER_COPIES_SAVE_DELAY) {
+			GTask *task;
+
+			pdf_document->render_copies_saving = TRUE;
+			task = g_task_new (pdf_document, NULL, NULL, NULL);
+			g_task_run_in_thread (task, save_render_copies_thread);
+			g_object_unref (task);
+		}
+
+		return FALSE;
+	}
+
+	layers_serial = g_atomic_int_get (&pdf_document->layers_serial);
+
+	g_mutex_lock (&pdf_document->render_copies_mutex);
+
+	if (layers_serial != pdf_document->render_copies_layers_serial) {
+		PopplerLayersIter *iter;
+
+		g_clear_pointer (&pdf_document->render_copies_layers, g_array_unref);
+		iter = poppler_layers_iter_new (pdf_document->document);
+		if (iter) {
+			pdf_document->render_copies_layers = g_array_new (FALSE, FALSE, sizeof (gboolean));
+			pdf_document_get_layers_visibility (iter, pdf_document->render_copies_layers);
+			poppler_layers_iter_free (iter);
+		}
+		pdf_document->render_copies_layers_serial = layers_serial;
+	}
+
+	retval = pdf_document->render_copies_source != NULL;
+
+	g_mutex_unlock (&pdf_document->render_copies_mutex);
+
+	return retval;
+}
+
+/* Searches run in the background: they never wait for a copy and
+ * never take the last one available, that is left for rendering.
+ */
+static PdfRenderCopy *
+pdf_document_acquire_render_copy (PdfDocument *pdf_document,
+				  gboolean     background)
+{
+	PdfRenderCopy *copy = NULL;
+	EvByteSource  *source;
+	GInputStream  *stream;
+	guint          contents_serial;
+
+	g_mutex_lock (&pdf_document->render_copies_mutex);
+
+	while (!copy) {
+		/* Don't use outdated contents, the caller falls back to
+		 * the main document */
+		if (!pdf_document->render_copies_source ||
+		    pdf_document->render_copies_stale)
+			break;
+
+		if (background &&
+		    g_queue_get_length (&pdf_document->idle_render_copies) +
+		    pdf_document->max_render_copies - pdf_document->n_render_copies < 2) {
+			g_mutex_unlock (&pdf_document->render_copies_mutex);
+			return NULL;
+		}
+
+		copy = g_queue_pop_head (&pdf_document->idle_render_copies);
+		if (copy)
+			break;
+
+		if (pdf_document->n_render_copies < pdf_document->max_render_copies)
+			break;
+
+		g_cond_wait (&pdf_document->render_copies_cond,
+			     &pdf_document->render_copies_mutex);
+	}
+
+	if (copy || !pdf_document->render_copies_source ||
+	    pdf_document->render_copies_stale) {
+		g_mutex_unlock (&pdf_document->render_copies_mutex);
+		return copy;
+	}
+
+	/* Open a new copy without holding the lock, it can take a while */
+	pdf_document->n_render_copies++;
+	source = g_object_ref (pdf_document->render_copies_source);
+	contents_serial = pdf_document->render_copies_contents_serial;
+	g_mutex_unlock (&pdf_document->render_copies_mutex);
+
+	copy = g_new0 (PdfRenderCopy, 1);
+	stream = ev_byte_source_get_stream (source);
+	copy->document = poppler_document_new_from_stream (stream,
+							   ev_byte_source_get_size (source),
+							   pdf_document->password,
+							   NULL, NULL);
+	copy->contents_serial = contents_serial;
+	copy->layers_serial = -1;
+	g_object_unref (stream);
+	g_object_unref (source);
+
+	if (!copy->document) {
+		g_free (copy);
+		g_mutex_lock (&pdf_document->render_copies_mutex);
+		pdf_document->n_render_copies--;
+		g_cond_signal (&pdf_document->render_copies_cond);
+		g_mutex_unlock (&pdf_document->render_copies_mutex);
+		return NULL;
+	}
+
+	return copy;
+}
+
+static void
+pdf_document_release_render_copy (PdfDocument   *pdf_document,
+				  PdfRenderCopy *copy)
+{
+	g_mutex_lock (&pdf_document->render_copies_mutex);
+	if (copy->contents_serial == pdf_document->render_copies_contents_serial &&
+	    !pdf_document->render_copies_stale) {
+		g_queue_push_head (&pdf_document->idle_render_copies, copy);
+		copy = NULL;
+	} else {
+		pdf_document->n_render_copies--;
+	}
+	g_cond_signal (&pdf_document->render_copies_cond);
+	g_mutex_unlock (&pdf_document->render_copies_mutex);
+
+	if (copy)
+		pdf_render_copy_free (copy);
+}
+
+static void
+pdf_document_sync_render_copy_layers (PdfDocument   *pdf_document,
+				      PdfRenderCopy *copy)
+{
+	g_mutex_lock (&pdf_document->render_copies_mutex);
+	if (copy->layers_serial != pdf_document->render_copies_layers_serial) {
+		if (pdf_document->render_copies_layers) {
+			PopplerLayersIter *iter;
+			guint              index = 0;
+
+			iter = poppler_layers_iter_new (copy->document);
+			if (iter) {
+				pdf_document_set_layers_visibility (iter,
+								    pdf_document->render_copies_layers,
+								    &index);
+				poppler_layers_iter_free (iter);
+			}
+		}
+		copy->layers_serial = pdf_document->render_copies_layers_serial;
+	}
+	g_mutex_unlock (&pdf_document->render_copies_mutex);
+}
+
+static cairo_surface_t *
+pdf_document_parallel_render_render_page (EvDocumentParallelRender *document,
+					  EvRenderContext          *rc)
+{
+	PdfDocument     *pdf_document = PDF_DOCUMENT (document);
+	PdfRenderCopy   *copy;
+	PopplerPage     *poppler_page;
+	cairo_surface_t *surface;
+	double           width_points, height_points;
+	gint             width, height;
+
+	copy = pdf_document_acquire_render_copy (pdf_document, FALSE);
+	if (!copy)
+		return NULL;
+
+	pdf_document_sync_render_copy_layers (pdf_document, copy);
+
+	poppler_page = poppler_document_get_page (copy->document, rc->page->index);
+	if (!poppler_page) {
+		pdf_document_release_render_copy (pdf_document, copy);
+		return NULL;
+	}
+
+	poppler_page_get_size (poppler_page,
+			       &width_points, &height_points);
+
+	ev_render_context_compute_transformed_size (rc, width_points, height_points,
+						    &width, &height);
+	surface = pdf_page_render (poppler_page, width, height, rc);
+	g_object_unref (poppler_page);
+
+	pdf_document_release_render_copy (pdf_document, copy);
+
+	return surface;
+}
+
+static gboolean
+pdf_document_parallel_render_find_text (EvDocumentParallelRender *document,
+					gint                      page,
+					const gchar              *text,
+					EvFindOptions             options,
+					GList                   **matches)
+{
+	PdfDocument   *pdf_document = PDF_DOCUMENT (document);
+	PdfRenderCopy *copy;
+	PopplerPage   *poppler_page;
+
+	copy = pdf_document_acquire_render_copy (pdf_document, TRUE);
+	if (!copy)
+		return FALSE;
+
+	pdf_document_sync_render_copy_layers (pdf_document, copy);
+
+	poppler_page = poppler_document_get_page (copy->document, page);
+	if (!poppler_page) {
+		pdf_document_release_render_copy (pdf_document, copy);
+		return FALSE;
+	}
+
+	*matches = pdf_page_find_text_extended (poppler_page, text, options);
+	g_object_unref (poppler_page);
+
+	pdf_document_release_render_copy (pdf_document, copy);
+
+	return TRUE;
+}
+
+static void
+pdf_document_parallel_render_iface_init (EvDocumentParallelRenderInterface *iface)
+{
+	iface->sync = pdf_document_parallel_render_sync;
+	iface->render_page = pdf_document_parallel_render_render_page;
+	iface->find_text = pdf_document_parallel_render_find_text;
+}
+
+/* EvDocumentFingerprint */
+
+/* Resolution, in pixels per point, of the rendering hashed in the
+ * fingerprints of pages: the page at its own size. The text alone
+ * doesn't change when only the graphics of a page do, and poppler
+ * doesn't give access to the content streams of pages.
+ */
+#define FINGERPRINT_SCALE 1.0
+
+static gchar *
+pdf_document_fingerprint_get_page_fingerprint (EvDocumentFingerprint *document_fingerprint,
+					       EvPage                *page)
+{
+	PdfDocument     *pdf_document = PDF_DOCUMENT (document_fingerprint);
+	PopplerPage     *poppler_page = POPPLER_PAGE (page->backend_page);
+	GChecksum       *checksum;
+	cairo_surface_t *surface;
+	cairo_t         *cr;
+	gdouble          size[2];
+	gchar           *text;
+	gchar           *fingerprint;
+	gint             width, height;
+
+	poppler_page_get_size (poppler_page, &size[0], &size[1]);
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	g_checksum_update (checksum, (const guchar *) size, sizeof (size));
+
+	text = poppler_page_get_text (poppler_page);
+	if (text)
+		g_checksum_update (checksum, (const guchar *) text, strlen (text) + 1);
+	g_free (text);
+
+	width = MAX ((gint) ceil (size[0] * FINGERPRINT_SCALE), 1);
+	height = MAX ((gint) ceil (size[1] * FINGERPRINT_SCALE), 1);
+	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy (surface);
+		g_checksum_free (checksum);
+
+		return NULL;
+	}
+
+	cr = cairo_create (surface);
+	cairo_scale (cr, FINGERPRINT_SCALE, FINGERPRINT_SCALE);
+	poppler_page_render (poppler_page, cr);
+	cairo_destroy (cr);
+
+	cairo_surface_flush (surface);
+	g_checksum_update (checksum, cairo_image_surface_get_data (surface),
+			   cairo_image_surface_get_stride (surface) * height);
+	cairo_surface_destroy (surface);
+
+	/* Parts of the page may have been read from a newer version of
+	 * the file, or not at all */
+	if (pdf_document->source && ev_byte_source_is_changed (pdf_document->source)) {
+		g_checksum_free (checksum);
+
+		return NULL;
+	}
+
+	fingerprint = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+
+	return fingerprint;
+}
+
+static void
+pdf_document_fingerprint_iface_init (EvDocumentFingerprintInterface *iface)
+{
+	iface->get_page_fingerprint = pdf_document_fingerprint_get_page_fingerprint;
+}
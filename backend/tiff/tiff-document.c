@@ -34,6 +34,7 @@
 #include "ev-document-misc.h"
 #include "ev-file-exporter.h"
 #include "ev-file-helpers.h"
+#include "ev-byte-source.h"
 
 struct _TiffDocumentClass
 {
@@ -45,6 +46,8 @@ struct _TiffDocument
   EvDocument parent_instance;
 
   TIFF *tiff;
+  EvByteSource *source;
+  toff_t offset;
   gint n_pages;
   TIFF2PSContext *ps_export_ctx;
   
@@ -78,43 +81,132 @@ pop_handlers (void)
 	TIFFSetWarningHandler (orig_warning_handler);
 }
 
+/* libtiff reads the document through these, from a byte source
+ * instead of from the file, so that files that are not local can
+ * be read without copying them first.
+ */
+static tsize_t
+tiff_document_read_proc (thandle_t handle,
+			 tdata_t   buffer,
+			 tsize_t   size)
+{
+	TiffDocument *tiff_document = TIFF_DOCUMENT (handle);
+	gssize n_read;
+
+	n_read = ev_byte_source_read (tiff_document->source, tiff_document->offset,
+				      buffer, size, NULL, NULL);
+	if (n_read > 0)
+		tiff_document->offset += n_read;
+
+	return n_read;
+}
+
+static tsize_t
+tiff_document_write_proc (thandle_t handle,
+			  tdata_t   buffer,
+			  tsize_t   size)
+{
+	return -1;
+}
+
+static toff_t
+tiff_document_seek_proc (thandle_t handle,
+			 toff_t    offset,
+			 int       whence)
+{
+	TiffDocument *tiff_document = TIFF_DOCUMENT (handle);
+
+	switch (whence) {
+	case SEEK_SET:
+		tiff_document->offset = offset;
+		break;
+	case SEEK_CUR:
+		tiff_document->offset += offset;
+		break;
+	case SEEK_END: {
+		goffset size = ev_byte_source_get_size (tiff_document->source);
+
+		if (size == -1)
+			return (toff_t) -1;
+		tiff_document->offset = size + offset;
+		break;
+	}
+	default:
+		return (toff_t) -1;
+	}
+
+	return tiff_document->offset;
+}
+
+static int
+tiff_document_close_proc (thandle_t handle)
+{
+	return 0;
+}
+
+static toff_t
+tiff_document_size_proc (thandle_t handle)
+{
+	TiffDocument *tiff_document = TIFF_DOCUMENT (handle);
+
+	return MAX (ev_byte_source_get_size (tiff_document->source), 0);
+}
+
+/* Sources already in memory are used in place */
+static int
+tiff_document_map_proc (thandle_t  handle,
+			tdata_t   *data,
+			toff_t    *size)
+{
+	TiffDocument *tiff_document = TIFF_DOCUMENT (handle);
+	GBytes *bytes;
+	gsize bytes_size;
+
+	bytes = ev_byte_source_get_bytes (tiff_document->source);
+	if (!bytes)
+		return 0;
+
+	*data = (tdata_t) g_bytes_get_data (bytes, &bytes_size);
+	*size = bytes_size;
+
+	return 1;
+}
+
+static void
+tiff_document_unmap_proc (thandle_t handle,
+			  tdata_t   data,
+			  toff_t    size)
+{
+}
+
 static gboolean
 tiff_document_load (EvDocument  *document,
 		    const char  *uri,
 		    GError     **error)
 {
 	TiffDocument *tiff_document = TIFF_DOCUMENT (document);
-	gchar *filename;
+	EvByteSource *source;
 	TIFF *tiff;
-	
-	filename = g_filename_from_uri (uri, NULL, error);
-	if (!filename)
-		return FALSE;
-	
-	push_handlers ();
 
-#ifdef G_OS_WIN32
-{
-	wchar_t *wfilename = g_utf8_to_utf16 (filename, -1, NULL, NULL, error);
-	if (wfilename == NULL) {
+	source = ev_byte_source_new_for_uri (uri, NULL, error);
+	if (!source)
 		return FALSE;
-	}
 
-	tiff = TIFFOpenW (wfilename, "r");
+	g_clear_object (&tiff_document->source);
+	tiff_document->source = source;
+	tiff_document->offset = 0;
+
+	push_handlers ();
+
+	tiff = TIFFClientOpen (uri, "r", (thandle_t) tiff_document,
+			       tiff_document_read_proc,
+			       tiff_document_write_proc,
+			       tiff_document_seek_proc,
+			       tiff_document_close_proc,
+			       tiff_document_size_proc,
+			       tiff_document_map_proc,
+			       tiff_document_unmap_proc);
 
-	g_free (wfilename);
-}
-#else
-	tiff = TIFFOpen (filename, "r");
-#endif
-	if (tiff) {
-		guint32 w, h;
-		
-		/* FIXME: unused data? why bother here */
-		TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &w);
-		TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &h);
-	}
-	
 	if (!tiff) {
 		pop_handlers ();
 
@@ -123,13 +215,12 @@ tiff_document_load (EvDocument  *document,
 				     EV_DOCUMENT_ERROR_INVALID,
 				     _("Invalid document"));
 
-		g_free (filename);
+		g_clear_object (&tiff_document->source);
 		return FALSE;
 	}
 	
 	tiff_document->tiff = tiff;
 	g_free (tiff_document->uri);
-	g_free (filename);
 	tiff_document->uri = g_strdup (uri);
 	
 	pop_handlers ();
@@ -154,6 +245,12 @@ tiff_document_get_n_pages (EvDocument  *document)
 	g_return_val_if_fail (TIFF_IS_DOCUMENT (document), 0);
 	g_return_val_if_fail (tiff_document->tiff != NULL, 0);
 	
+	/* Counting the pages reads every directory of the file, only the
+	 * first one is needed for a thumbnail */
+	if (tiff_document->n_pages == -1 &&
+	    ev_document_get_load_flags (document) & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE)
+		tiff_document->n_pages = 1;
+
 	if (tiff_document->n_pages == -1) {
 		push_handlers ();
 		tiff_document->n_pages = 0;
@@ -454,6 +551,7 @@ tiff_document_finalize (GObject *object)
 
 	if (tiff_document->tiff)
 		TIFFClose (tiff_document->tiff);
+	g_clear_object (&tiff_document->source);
 	if (tiff_document->uri)
 		g_free (tiff_document->uri);
 
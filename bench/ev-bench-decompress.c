@@ -0,0 +1,171 @@
+/* ev-bench-decompress.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Loads compressed documents (.gz, .bz2 or .xz) and renders their first
+ * page, with the decompressed contents streamed to the backend, and with
+ * them written to a temporary file that is loaded afterwards, and
+ * reports the time taken by each of them.
+ *
+ *   ev-bench-decompress [--runs N] FILE...
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <evince-document.h>
+
+#include "ev-bench-utils.h"
+
+static gint n_runs = 5;
+static const gchar **file_arguments;
+
+static const GOptionEntry options[] = {
+	{ "runs", 'n', 0, G_OPTION_ARG_INT, &n_runs, "Number of times every document is loaded", "N" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "FILE..." },
+	{ NULL }
+};
+
+static EvCompressionType
+get_compression_type (const gchar *uri)
+{
+	if (g_str_has_suffix (uri, ".gz"))
+		return EV_COMPRESSION_GZIP;
+	if (g_str_has_suffix (uri, ".bz2"))
+		return EV_COMPRESSION_BZIP2;
+	if (g_str_has_suffix (uri, ".xz"))
+		return EV_COMPRESSION_LZMA;
+
+	return EV_COMPRESSION_NONE;
+}
+
+/* Loads the document at @uri and renders its first page, returns the
+ * time it took in microseconds, or -1 on error */
+static gint64
+bench_load_document (const gchar      *uri,
+		     EvCompressionType compression,
+		     gboolean          tmp_file)
+{
+	EvDocument      *document;
+	EvPage          *page;
+	EvRenderContext *rc;
+	cairo_surface_t *surface;
+	GError          *error = NULL;
+	gchar           *tmp_uri = NULL;
+	gint64           started;
+
+	started = g_get_monotonic_time ();
+
+	if (tmp_file) {
+		tmp_uri = ev_file_uncompress (uri, compression, &error);
+		if (!tmp_uri) {
+			g_printerr ("Error decompressing %s: %s\n", uri, error->message);
+			g_error_free (error);
+			return -1;
+		}
+	}
+
+	document = ev_document_factory_get_document_full (tmp_uri ? tmp_uri : uri,
+							  EV_DOCUMENT_LOAD_FLAG_NO_CACHE,
+							  &error);
+	if (!document) {
+		g_printerr ("Error loading %s: %s\n", uri, error->message);
+		g_error_free (error);
+		ev_tmp_uri_unlink (tmp_uri);
+		g_free (tmp_uri);
+		return -1;
+	}
+
+	page = ev_document_get_page (document, 0);
+	rc = ev_render_context_new (page, 0, 1.);
+	ev_document_lock (document);
+	surface = ev_document_render (document, rc);
+	ev_document_unlock (document);
+	g_clear_pointer (&surface, cairo_surface_destroy);
+	g_object_unref (rc);
+	g_object_unref (page);
+	g_object_unref (document);
+
+	ev_tmp_uri_unlink (tmp_uri);
+	g_free (tmp_uri);
+
+	return g_get_monotonic_time () - started;
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GError         *error = NULL;
+	guint           i;
+
+	context = g_option_context_new ("- benchmark loading compressed documents");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error) ||
+	    !file_arguments || n_runs < 1) {
+		g_printerr ("%s\n", error ? error->message : "A file is needed");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (!ev_init ())
+		return EXIT_FAILURE;
+
+	for (i = 0; file_arguments[i]; i++) {
+		static const gchar *path_names[] = { "stream", "temporary file" };
+		EvCompressionType   compression;
+		gchar              *uri;
+		guint               path;
+
+		uri = ev_bench_get_uri (file_arguments[i]);
+		compression = get_compression_type (uri);
+		if (compression == EV_COMPRESSION_NONE) {
+			g_printerr ("%s is not a compressed document\n", file_arguments[i]);
+			g_free (uri);
+			continue;
+		}
+
+		for (path = 0; path < G_N_ELEMENTS (path_names); path++) {
+			GArray *times;
+			gint    run;
+
+			times = g_array_new (FALSE, FALSE, sizeof (gint64));
+			for (run = 0; run < n_runs; run++) {
+				gint64 time;
+
+				time = bench_load_document (uri, compression, path == 1);
+				if (time < 0)
+					break;
+				g_array_append_val (times, time);
+			}
+
+			if (times->len > 0) {
+				g_print ("%s, %s: %u runs, load and first page p50 %.2f ms max %.2f ms\n",
+					 file_arguments[i], path_names[path], times->len,
+					 ev_bench_percentile (times, 50) / 1000.,
+					 ev_bench_percentile (times, 100) / 1000.);
+			}
+			g_array_unref (times);
+		}
+		g_free (uri);
+	}
+
+	ev_shutdown ();
+
+	return EXIT_SUCCESS;
+}
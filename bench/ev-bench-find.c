@@ -0,0 +1,213 @@
+/* ev-bench-find.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Searches a document for a text with 1, 2, 4 and 8 worker threads,
+ * and as many PDF render copies, and reports the pages searched per
+ * second, the time to the first results and the latency of the urgent
+ * render jobs pushed while the search runs, like a view scrolling.
+ *
+ *   ev-bench-find [--interval MS] FILE TEXT
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <evince-document.h>
+#include <evince-view.h>
+
+#include "ev-bench-utils.h"
+
+static gint render_interval = 50;
+static const gchar **arguments;
+
+static const GOptionEntry options[] = {
+	{ "interval", 'i', 0, G_OPTION_ARG_INT, &render_interval, "Interval between render jobs pushed during the search, 0 for none", "MS" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &arguments, NULL, "FILE TEXT" },
+	{ NULL }
+};
+
+typedef struct {
+	GMainLoop  *loop;
+	EvDocument *document;
+	gint64      started;
+	gint64      first_update;
+	gint64      finished;
+	gint        n_matches;
+	gint        next_page;
+	gint        n_renders_pending;
+	guint       render_timeout_id;
+	gboolean    search_finished;
+	GArray     *latencies;
+} BenchData;
+
+static void
+bench_maybe_quit (BenchData *data)
+{
+	if (data->search_finished && data->n_renders_pending == 0)
+		g_main_loop_quit (data->loop);
+}
+
+static void
+find_updated_cb (EvJobFind *job,
+		 gint       page,
+		 BenchData *data)
+{
+	if (data->first_update == 0)
+		data->first_update = g_get_monotonic_time ();
+	data->n_matches += g_list_length (job->pages[page]);
+}
+
+static void
+find_finished_cb (EvJob     *job,
+		  BenchData *data)
+{
+	data->finished = g_get_monotonic_time ();
+	data->search_finished = TRUE;
+	if (data->render_timeout_id > 0) {
+		g_source_remove (data->render_timeout_id);
+		data->render_timeout_id = 0;
+	}
+	bench_maybe_quit (data);
+}
+
+static void
+render_finished_cb (EvJob     *job,
+		    BenchData *data)
+{
+	gint64 latency;
+
+	latency = g_get_monotonic_time () - GPOINTER_TO_SIZE (g_object_get_data (G_OBJECT (job), "pushed"));
+	g_array_append_val (data->latencies, latency);
+
+	g_signal_handlers_disconnect_by_data (job, data);
+	g_object_unref (job);
+
+	data->n_renders_pending--;
+	bench_maybe_quit (data);
+}
+
+static gboolean
+push_render_cb (BenchData *data)
+{
+	EvJob *job;
+
+	job = ev_job_render_new (data->document, data->next_page, 0, 1., -1, -1);
+	g_object_set_data (G_OBJECT (job), "pushed",
+			   GSIZE_TO_POINTER (g_get_monotonic_time ()));
+	g_signal_connect (job, "finished",
+			  G_CALLBACK (render_finished_cb), data);
+	data->n_renders_pending++;
+	ev_job_scheduler_push_job (job, EV_JOB_PRIORITY_URGENT);
+
+	data->next_page = (data->next_page + 1) % ev_document_get_n_pages (data->document);
+
+	return G_SOURCE_CONTINUE;
+}
+
+int
+main (int argc, char **argv)
+{
+	static const guint n_workers[] = { 1, 2, 4, 8 };
+	GOptionContext *context;
+	BenchData       data = { NULL, };
+	GError         *error = NULL;
+	gchar          *uri;
+	guint           i;
+
+	context = g_option_context_new ("- benchmark searching a document");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error) ||
+	    !arguments || !arguments[0] || !arguments[1]) {
+		g_printerr ("%s\n", error ? error->message : "A file and a text are needed");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (!ev_init ())
+		return EXIT_FAILURE;
+
+	uri = ev_bench_get_uri (arguments[0]);
+	data.loop = g_main_loop_new (NULL, FALSE);
+	data.latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	for (i = 0; i < G_N_ELEMENTS (n_workers); i++) {
+		EvJob  *job;
+		gchar  *n_copies;
+		gint    n_pages;
+		gdouble elapsed;
+
+		/* Render copies are set up when documents are loaded */
+		n_copies = g_strdup_printf ("%u", n_workers[i]);
+		g_setenv ("EV_PDF_RENDER_COPIES", n_copies, TRUE);
+		g_free (n_copies);
+		ev_job_scheduler_set_n_threads (n_workers[i]);
+
+		data.document = ev_document_factory_get_document (uri, &error);
+		if (!data.document) {
+			g_printerr ("Error loading %s: %s\n", arguments[0], error->message);
+			return EXIT_FAILURE;
+		}
+		n_pages = ev_document_get_n_pages (data.document);
+
+		data.first_update = 0;
+		data.n_matches = 0;
+		data.next_page = 0;
+		data.search_finished = FALSE;
+		g_array_set_size (data.latencies, 0);
+
+		job = ev_job_find_new (data.document, 0, n_pages, arguments[1], FALSE);
+		g_signal_connect (job, "updated",
+				  G_CALLBACK (find_updated_cb), &data);
+		g_signal_connect (job, "finished",
+				  G_CALLBACK (find_finished_cb), &data);
+
+		if (render_interval > 0)
+			data.render_timeout_id = g_timeout_add (render_interval,
+								(GSourceFunc)push_render_cb,
+								&data);
+
+		data.started = g_get_monotonic_time ();
+		ev_job_scheduler_push_job (job, EV_JOB_PRIORITY_NONE);
+		g_main_loop_run (data.loop);
+		elapsed = (data.finished - data.started) / (gdouble) G_USEC_PER_SEC;
+
+		g_print ("%u workers: %d pages, %d matches, %.2f s, %.1f pages/s, "
+			 "first results %.2f ms",
+			 n_workers[i], n_pages, data.n_matches, elapsed, n_pages / elapsed,
+			 data.first_update ? (data.first_update - data.started) / 1000. : 0.);
+		if (data.latencies->len > 0) {
+			g_print (", %u renders p50 %.2f ms p99 %.2f ms",
+				 data.latencies->len,
+				 ev_bench_percentile (data.latencies, 50) / 1000.,
+				 ev_bench_percentile (data.latencies, 99) / 1000.);
+		}
+		g_print ("\n");
+
+		g_signal_handlers_disconnect_by_data (job, &data);
+		g_object_unref (job);
+		g_object_unref (data.document);
+	}
+
+	g_array_unref (data.latencies);
+	g_main_loop_unref (data.loop);
+	g_free (uri);
+	ev_shutdown ();
+
+	return EXIT_SUCCESS;
+}
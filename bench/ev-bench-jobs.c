@@ -0,0 +1,277 @@
+/* ev-bench-jobs.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Pushes thousands of render and thumbnail jobs for the pages of a
+ * document to the job scheduler, and reports the throughput and, for
+ * every priority, the time jobs waited in the queues before running.
+ *
+ *   ev-bench-jobs [--jobs N] [--threads N] FILE
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <evince-document.h>
+#include <evince-view.h>
+
+#include "ev-bench-utils.h"
+
+/* Render and thumbnail jobs recording when a worker picked them */
+typedef struct {
+	EvJobRender parent;
+	gint64      started;
+} BenchJobRender;
+
+typedef struct {
+	EvJobRenderClass parent_class;
+} BenchJobRenderClass;
+
+typedef struct {
+	EvJobThumbnail parent;
+	gint64         started;
+} BenchJobThumbnail;
+
+typedef struct {
+	EvJobThumbnailClass parent_class;
+} BenchJobThumbnailClass;
+
+static GType bench_job_render_get_type (void);
+static GType bench_job_thumbnail_get_type (void);
+
+G_DEFINE_TYPE (BenchJobRender, bench_job_render, EV_TYPE_JOB_RENDER)
+G_DEFINE_TYPE (BenchJobThumbnail, bench_job_thumbnail, EV_TYPE_JOB_THUMBNAIL)
+
+static gboolean
+bench_job_render_run (EvJob *job)
+{
+	((BenchJobRender *) job)->started = g_get_monotonic_time ();
+
+	return EV_JOB_CLASS (bench_job_render_parent_class)->run (job);
+}
+
+static void
+bench_job_render_init (BenchJobRender *job)
+{
+}
+
+static void
+bench_job_render_class_init (BenchJobRenderClass *klass)
+{
+	EV_JOB_CLASS (klass)->run = bench_job_render_run;
+}
+
+static gboolean
+bench_job_thumbnail_run (EvJob *job)
+{
+	((BenchJobThumbnail *) job)->started = g_get_monotonic_time ();
+
+	return EV_JOB_CLASS (bench_job_thumbnail_parent_class)->run (job);
+}
+
+static void
+bench_job_thumbnail_init (BenchJobThumbnail *job)
+{
+}
+
+static void
+bench_job_thumbnail_class_init (BenchJobThumbnailClass *klass)
+{
+	EV_JOB_CLASS (klass)->run = bench_job_thumbnail_run;
+}
+
+typedef struct {
+	GMainLoop *loop;
+	gint       n_pending;
+	gint64     pushed[EV_JOB_N_PRIORITIES];
+	GArray    *waits[EV_JOB_N_PRIORITIES];
+	GArray    *latencies[EV_JOB_N_PRIORITIES];
+} BenchData;
+
+typedef struct {
+	BenchData    *data;
+	EvJobPriority priority;
+	gint64        pushed;
+} BenchJobInfo;
+
+static gint n_jobs = 4000;
+static gint n_threads = 0;
+static const gchar **file_arguments;
+
+static const GOptionEntry options[] = {
+	{ "jobs", 'n', 0, G_OPTION_ARG_INT, &n_jobs, "Number of jobs to push", "N" },
+	{ "threads", 't', 0, G_OPTION_ARG_INT, &n_threads, "Number of worker threads", "N" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "FILE" },
+	{ NULL }
+};
+
+static void
+job_finished_cb (EvJob        *job,
+		 BenchJobInfo *info)
+{
+	BenchData *data = info->data;
+	gint64     started, wait, latency;
+
+	if (EV_IS_JOB_RENDER (job))
+		started = ((BenchJobRender *) job)->started;
+	else
+		started = ((BenchJobThumbnail *) job)->started;
+
+	wait = started - info->pushed;
+	latency = g_get_monotonic_time () - info->pushed;
+	g_array_append_val (data->waits[info->priority], wait);
+	g_array_append_val (data->latencies[info->priority], latency);
+
+	g_signal_handlers_disconnect_by_data (job, info);
+	g_object_unref (job);
+	g_free (info);
+
+	if (--data->n_pending == 0)
+		g_main_loop_quit (data->loop);
+}
+
+static EvJob *
+bench_job_new (EvDocument   *document,
+	       gint          page,
+	       EvJobPriority priority)
+{
+	if (priority == EV_JOB_PRIORITY_HIGH) {
+		EvJobThumbnail *job;
+
+		/* Same as ev_job_thumbnail_new_with_target_size() */
+		job = g_object_new (bench_job_thumbnail_get_type (), NULL);
+		EV_JOB (job)->document = g_object_ref (document);
+		job->page = page;
+		job->scale = 1.;
+		job->has_frame = FALSE;
+		job->format = EV_JOB_THUMBNAIL_SURFACE;
+		job->target_width = 128;
+		job->target_height = -1;
+
+		return EV_JOB (job);
+	} else {
+		EvJobRender *job;
+
+		/* Same as ev_job_render_new() */
+		job = g_object_new (bench_job_render_get_type (), NULL);
+		EV_JOB (job)->document = g_object_ref (document);
+		job->page = page;
+		job->scale = 0.5;
+		job->target_width = -1;
+		job->target_height = -1;
+
+		return EV_JOB (job);
+	}
+}
+
+int
+main (int argc, char **argv)
+{
+	static const gchar *priority_names[] = { "urgent", "high", "low", "none" };
+	GOptionContext *context;
+	EvDocument     *document;
+	BenchData       data = { NULL, };
+	GTimer         *timer;
+	GError         *error = NULL;
+	gchar          *uri;
+	gint            n_pages, i;
+
+	context = g_option_context_new ("- benchmark the job scheduler");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error) ||
+	    !file_arguments || n_jobs < 1) {
+		g_printerr ("%s\n", error ? error->message : "A file is needed");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (!ev_init ())
+		return EXIT_FAILURE;
+
+	uri = ev_bench_get_uri (file_arguments[0]);
+	document = ev_document_factory_get_document (uri, &error);
+	g_free (uri);
+	if (!document) {
+		g_printerr ("Error loading %s: %s\n", file_arguments[0], error->message);
+		return EXIT_FAILURE;
+	}
+	n_pages = ev_document_get_n_pages (document);
+
+	if (n_threads > 0)
+		ev_job_scheduler_set_n_threads (n_threads);
+
+	data.loop = g_main_loop_new (NULL, FALSE);
+	for (i = 0; i < EV_JOB_N_PRIORITIES; i++) {
+		data.waits[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+		data.latencies[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+	}
+
+	timer = g_timer_new ();
+
+	/* Like a view scrolling through the document: a visible page, its
+	 * thumbnail and two pages around it for every step */
+	for (i = 0; i < n_jobs; i++) {
+		static const EvJobPriority priorities[] = {
+			EV_JOB_PRIORITY_URGENT, EV_JOB_PRIORITY_HIGH,
+			EV_JOB_PRIORITY_LOW, EV_JOB_PRIORITY_LOW
+		};
+		BenchJobInfo *info;
+		EvJob        *job;
+
+		info = g_new (BenchJobInfo, 1);
+		info->data = &data;
+		info->priority = priorities[i % G_N_ELEMENTS (priorities)];
+
+		job = bench_job_new (document, (i / 4) % n_pages, info->priority);
+		g_signal_connect (job, "finished",
+				  G_CALLBACK (job_finished_cb), info);
+
+		data.n_pending++;
+		info->pushed = g_get_monotonic_time ();
+		ev_job_scheduler_push_job (job, info->priority);
+	}
+
+	g_main_loop_run (data.loop);
+	g_timer_stop (timer);
+
+	g_print ("%d jobs, %u threads, %.2f s, %.1f jobs/s\n",
+		 n_jobs, ev_job_scheduler_get_n_threads (),
+		 g_timer_elapsed (timer, NULL),
+		 n_jobs / g_timer_elapsed (timer, NULL));
+	for (i = 0; i < EV_JOB_N_PRIORITIES; i++) {
+		if (data.waits[i]->len == 0)
+			continue;
+
+		g_print ("%-8s %5u jobs  queue wait p50 %8.2f ms p99 %8.2f ms  "
+			 "latency p50 %8.2f ms p99 %8.2f ms\n",
+			 priority_names[i], data.waits[i]->len,
+			 ev_bench_percentile (data.waits[i], 50) / 1000.,
+			 ev_bench_percentile (data.waits[i], 99) / 1000.,
+			 ev_bench_percentile (data.latencies[i], 50) / 1000.,
+			 ev_bench_percentile (data.latencies[i], 99) / 1000.);
+		g_array_unref (data.waits[i]);
+		g_array_unref (data.latencies[i]);
+	}
+
+	g_timer_destroy (timer);
+	g_main_loop_unref (data.loop);
+	g_object_unref (document);
+	ev_shutdown ();
+
+	return EXIT_SUCCESS;
+}
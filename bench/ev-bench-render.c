@@ -0,0 +1,156 @@
+/* ev-bench-render.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Renders the pages of a corpus of documents with 1, 2, 4 and 8 worker
+ * threads, and as many PDF render copies, and reports the pages rendered
+ * per second for each of them.
+ *
+ *   ev-bench-render [--pages N] [--scale S] FILE...
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <evince-document.h>
+#include <evince-view.h>
+
+#include "ev-bench-utils.h"
+
+static gint n_pages_max = 200;
+static gdouble scale = 1.5;
+static const gchar **file_arguments;
+
+static const GOptionEntry options[] = {
+	{ "pages", 'n', 0, G_OPTION_ARG_INT, &n_pages_max, "Maximum number of pages rendered per document", "N" },
+	{ "scale", 's', 0, G_OPTION_ARG_DOUBLE, &scale, "Scale of the rendered pages", "S" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "FILE..." },
+	{ NULL }
+};
+
+typedef struct {
+	GMainLoop *loop;
+	gint       n_pending;
+	gint       n_failed;
+} BenchData;
+
+static void
+job_finished_cb (EvJob     *job,
+		 BenchData *data)
+{
+	if (ev_job_is_failed (job))
+		data->n_failed++;
+
+	g_signal_handlers_disconnect_by_data (job, data);
+	g_object_unref (job);
+
+	if (--data->n_pending == 0)
+		g_main_loop_quit (data->loop);
+}
+
+/* Renders the pages of @uri, returns the number of pages rendered */
+static gint
+bench_render_document (const gchar *uri,
+		       BenchData   *data)
+{
+	EvDocument *document;
+	GError     *error = NULL;
+	gint        n_pages, i;
+
+	document = ev_document_factory_get_document (uri, &error);
+	if (!document) {
+		g_printerr ("Error loading %s: %s\n", uri, error->message);
+		g_error_free (error);
+		return 0;
+	}
+
+	n_pages = MIN (ev_document_get_n_pages (document), n_pages_max);
+	for (i = 0; i < n_pages; i++) {
+		EvJob *job;
+
+		job = ev_job_render_new (document, i, 0, scale, -1, -1);
+		g_signal_connect (job, "finished",
+				  G_CALLBACK (job_finished_cb), data);
+		data->n_pending++;
+		ev_job_scheduler_push_job (job, EV_JOB_PRIORITY_URGENT);
+	}
+
+	if (data->n_pending > 0)
+		g_main_loop_run (data->loop);
+	g_object_unref (document);
+
+	return n_pages;
+}
+
+int
+main (int argc, char **argv)
+{
+	static const guint n_workers[] = { 1, 2, 4, 8 };
+	GOptionContext *context;
+	BenchData       data = { NULL, };
+	GError         *error = NULL;
+	guint           i, j;
+
+	context = g_option_context_new ("- benchmark parallel page rendering");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error) ||
+	    !file_arguments || n_pages_max < 1) {
+		g_printerr ("%s\n", error ? error->message : "A file is needed");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (!ev_init ())
+		return EXIT_FAILURE;
+
+	data.loop = g_main_loop_new (NULL, FALSE);
+
+	for (i = 0; i < G_N_ELEMENTS (n_workers); i++) {
+		GTimer *timer;
+		gchar  *n_copies;
+		gint    n_pages = 0;
+
+		/* Render copies are set up when documents are loaded */
+		n_copies = g_strdup_printf ("%u", n_workers[i]);
+		g_setenv ("EV_PDF_RENDER_COPIES", n_copies, TRUE);
+		g_free (n_copies);
+		ev_job_scheduler_set_n_threads (n_workers[i]);
+
+		data.n_failed = 0;
+		timer = g_timer_new ();
+		for (j = 0; file_arguments[j]; j++) {
+			gchar *uri;
+
+			uri = ev_bench_get_uri (file_arguments[j]);
+			n_pages += bench_render_document (uri, &data);
+			g_free (uri);
+		}
+		g_timer_stop (timer);
+
+		g_print ("%u workers: %d pages, %d failed, %.2f s, %.1f pages/s\n",
+			 n_workers[i], n_pages, data.n_failed,
+			 g_timer_elapsed (timer, NULL),
+			 n_pages / g_timer_elapsed (timer, NULL));
+		g_timer_destroy (timer);
+	}
+
+	g_main_loop_unref (data.loop);
+	ev_shutdown ();
+
+	return EXIT_SUCCESS;
+}
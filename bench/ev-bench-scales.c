@@ -0,0 +1,161 @@
+/* ev-bench-render.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Renders the pages of a document, meant for DVI documents, at the
+ * scales of a thumbnail, the view and a presentation, once with the
+ * three scales interleaved for every page, like a view with its sidebar
+ * and a presentation window open, and once with a scale at a time, and
+ * reports the render time per scale for each of them.
+ *
+ *   ev-bench-scales [--pages N] FILE
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <evince-document.h>
+
+#include "ev-bench-utils.h"
+
+static gint n_pages_max = 300;
+static const gchar **file_arguments;
+
+static const GOptionEntry options[] = {
+	{ "pages", 'n', 0, G_OPTION_ARG_INT, &n_pages_max, "Maximum number of pages rendered", "N" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "FILE" },
+	{ NULL }
+};
+
+static const gdouble scales[] = { 0.2, 1., 2. };
+static const gchar *scale_names[] = { "thumbnail", "view", "presentation" };
+
+/* Renders @page_index of @document at @scale, returns the time it took
+ * in microseconds */
+static gint64
+bench_render_page (EvDocument *document,
+		   gint        page_index,
+		   gdouble     scale)
+{
+	EvPage          *page;
+	EvRenderContext *rc;
+	cairo_surface_t *surface;
+	gint64           started;
+
+	started = g_get_monotonic_time ();
+
+	page = ev_document_get_page (document, page_index);
+	rc = ev_render_context_new (page, 0, scale);
+	ev_document_lock (document);
+	surface = ev_document_render (document, rc);
+	ev_document_unlock (document);
+	g_clear_pointer (&surface, cairo_surface_destroy);
+	g_object_unref (rc);
+	g_object_unref (page);
+
+	return g_get_monotonic_time () - started;
+}
+
+static void
+bench_print_times (const gchar *name,
+		   GArray     **times)
+{
+	gint64 total = 0;
+	guint  i, j;
+
+	for (i = 0; i < G_N_ELEMENTS (scales); i++) {
+		for (j = 0; j < times[i]->len; j++)
+			total += g_array_index (times[i], gint64, j);
+	}
+
+	g_print ("%s: %.2f s\n", name, total / (gdouble) G_USEC_PER_SEC);
+	for (i = 0; i < G_N_ELEMENTS (scales); i++) {
+		g_print ("  %-12s %.2f  %4u pages  p50 %8.2f ms p99 %8.2f ms\n",
+			 scale_names[i], scales[i], times[i]->len,
+			 ev_bench_percentile (times[i], 50) / 1000.,
+			 ev_bench_percentile (times[i], 99) / 1000.);
+		g_array_set_size (times[i], 0);
+	}
+}
+
+int
+main (int argc, char **argv)
+{
+	GOptionContext *context;
+	EvDocument     *document;
+	GArray         *times[G_N_ELEMENTS (scales)];
+	GError         *error = NULL;
+	gchar          *uri;
+	gint            n_pages, i;
+	guint           j;
+
+	context = g_option_context_new ("- benchmark rendering pages at several scales");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error) ||
+	    !file_arguments || n_pages_max < 1) {
+		g_printerr ("%s\n", error ? error->message : "A file is needed");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (!ev_init ())
+		return EXIT_FAILURE;
+
+	uri = ev_bench_get_uri (file_arguments[0]);
+	document = ev_document_factory_get_document (uri, &error);
+	g_free (uri);
+	if (!document) {
+		g_printerr ("Error loading %s: %s\n", file_arguments[0], error->message);
+		return EXIT_FAILURE;
+	}
+
+	n_pages = ev_document_get_n_pages (document);
+	if (n_pages < n_pages_max)
+		g_printerr ("%s has only %d pages\n", file_arguments[0], n_pages);
+	n_pages = MIN (n_pages, n_pages_max);
+
+	for (j = 0; j < G_N_ELEMENTS (scales); j++)
+		times[j] = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	for (i = 0; i < n_pages; i++) {
+		for (j = 0; j < G_N_ELEMENTS (scales); j++) {
+			gint64 time;
+
+			time = bench_render_page (document, i, scales[j]);
+			g_array_append_val (times[j], time);
+		}
+	}
+	bench_print_times ("interleaved", times);
+
+	for (j = 0; j < G_N_ELEMENTS (scales); j++) {
+		for (i = 0; i < n_pages; i++) {
+			gint64 time;
+
+			time = bench_render_page (document, i, scales[j]);
+			g_array_append_val (times[j], time);
+		}
+	}
+	bench_print_times ("a scale at a time", times);
+
+	for (j = 0; j < G_N_ELEMENTS (scales); j++)
+		g_array_unref (times[j]);
+	g_object_unref (document);
+	ev_shutdown ();
+
+	return EXIT_SUCCESS;
+}
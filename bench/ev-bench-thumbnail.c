@@ -0,0 +1,150 @@
+/* ev-bench-render.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Loads every document of a corpus and renders a thumbnail of its first
+ * page, like the thumbnailer, with a full load and with only the first
+ * page loaded, and reports the files thumbnailed per second and the
+ * time taken per file for each of them.
+ *
+ *   ev-bench-thumbnail [--runs N] [--size S] FILE...
+ */
+
+#include <config.h>
+
+#include <stdlib.h>
+
+#include <evince-document.h>
+
+#include "ev-bench-utils.h"
+
+static gint n_runs = 3;
+static gint thumbnail_size = 256;
+static const gchar **file_arguments;
+
+static const GOptionEntry options[] = {
+	{ "runs", 'n', 0, G_OPTION_ARG_INT, &n_runs, "Number of times the corpus is thumbnailed", "N" },
+	{ "size", 's', 0, G_OPTION_ARG_INT, &thumbnail_size, "Size of the thumbnails", "S" },
+	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "FILE..." },
+	{ NULL }
+};
+
+/* Loads the document at @uri and renders the thumbnail of its first
+ * page, returns the time it took in microseconds, or -1 on error */
+static gint64
+bench_thumbnail_document (const gchar         *uri,
+			  EvDocumentLoadFlags  flags)
+{
+	EvDocument      *document;
+	EvPage          *page;
+	EvRenderContext *rc;
+	cairo_surface_t *surface;
+	GError          *error = NULL;
+	gdouble          width, height;
+	gint64           started;
+
+	started = g_get_monotonic_time ();
+
+	document = ev_document_factory_get_document_full (uri, flags, &error);
+	if (!document) {
+		g_printerr ("Error loading %s: %s\n", uri, error->message);
+		g_error_free (error);
+		return -1;
+	}
+
+	/* Same as evince_thumbnail_pngenc_get(), without the encoding */
+	ev_document_get_page_size (document, 0, &width, &height);
+	ev_document_lock (document);
+	page = ev_document_get_page (document, 0);
+	rc = ev_render_context_new (page, 0, thumbnail_size / MAX (height, width));
+	surface = ev_document_get_thumbnail_surface (document, rc);
+	ev_document_unlock (document);
+	g_clear_pointer (&surface, cairo_surface_destroy);
+	g_object_unref (rc);
+	g_object_unref (page);
+	g_object_unref (document);
+
+	return g_get_monotonic_time () - started;
+}
+
+int
+main (int argc, char **argv)
+{
+	static const gchar *load_names[] = { "full load", "first page" };
+	static const EvDocumentLoadFlags load_flags[] = {
+		EV_DOCUMENT_LOAD_FLAG_NO_CACHE,
+		EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE
+	};
+	GOptionContext *context;
+	GError         *error = NULL;
+	gchar         **uris;
+	guint           n_files, i, j;
+
+	context = g_option_context_new ("- benchmark thumbnailing documents");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error) ||
+	    !file_arguments || n_runs < 1 || thumbnail_size < 1) {
+		g_printerr ("%s\n", error ? error->message : "A file is needed");
+		return EXIT_FAILURE;
+	}
+	g_option_context_free (context);
+
+	if (!ev_init ())
+		return EXIT_FAILURE;
+
+	n_files = g_strv_length ((gchar **) file_arguments);
+	uris = g_new0 (gchar *, n_files + 1);
+	for (i = 0; i < n_files; i++)
+		uris[i] = ev_bench_get_uri (file_arguments[i]);
+
+	for (i = 0; i < G_N_ELEMENTS (load_flags); i++) {
+		GArray *times;
+		gint64  total = 0;
+		gint    run, n_failed = 0;
+
+		times = g_array_new (FALSE, FALSE, sizeof (gint64));
+		for (run = 0; run < n_runs; run++) {
+			for (j = 0; j < n_files; j++) {
+				gint64 time;
+
+				time = bench_thumbnail_document (uris[j], load_flags[i]);
+				if (time < 0) {
+					n_failed++;
+					continue;
+				}
+				g_array_append_val (times, time);
+				total += time;
+			}
+		}
+
+		if (times->len > 0) {
+			g_print ("%s: %u files, %d failed, %.2f s, %.1f files/s, "
+				 "per file p50 %.2f ms max %.2f ms\n",
+				 load_names[i], times->len, n_failed,
+				 total / (gdouble) G_USEC_PER_SEC,
+				 times->len / (total / (gdouble) G_USEC_PER_SEC),
+				 ev_bench_percentile (times, 50) / 1000.,
+				 ev_bench_percentile (times, 100) / 1000.);
+		}
+		g_array_unref (times);
+	}
+
+	g_strfreev (uris);
+	ev_shutdown ();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+/* ev-bench-utils.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <gio/gio.h>
+
+#include "ev-bench-utils.h"
+
+/* Returns the URI of @arg, a path or an URI */
+gchar *
+ev_bench_get_uri (const gchar *arg)
+{
+	GFile *file;
+	gchar *uri;
+
+	file = g_file_new_for_commandline_arg (arg);
+	uri = g_file_get_uri (file);
+	g_object_unref (file);
+
+	return uri;
+}
+
+static gint
+compare_samples (gconstpointer a,
+		 gconstpointer b)
+{
+	gint64 sample_a = *(const gint64 *) a;
+	gint64 sample_b = *(const gint64 *) b;
+
+	return sample_a < sample_b ? -1 : sample_a > sample_b;
+}
+
+/* Returns the @percent percentile of @samples, an array of gint64 that
+ * gets sorted */
+gdouble
+ev_bench_percentile (GArray *samples,
+		     guint   percent)
+{
+	guint index;
+
+	if (samples->len == 0)
+		return 0;
+
+	g_array_sort (samples, compare_samples);
+	index = MIN (samples->len - 1, (samples->len * percent) / 100);
+
+	return g_array_index (samples, gint64, index);
+}
@@ -24,10 +24,12 @@
 #include <libdocument/ev-async-renderer.h>
 #include <libdocument/ev-attachment.h>
 #include <libdocument/ev-backends-manager.h>
+#include <libdocument/ev-byte-source.h>
 #include <libdocument/ev-document-annotations.h>
 #include <libdocument/ev-document-attachments.h>
 #include <libdocument/ev-document-factory.h>
 #include <libdocument/ev-document-find.h>
+#include <libdocument/ev-document-fingerprint.h>
 #include <libdocument/ev-document-fonts.h>
 #include <libdocument/ev-document-forms.h>
 #include <libdocument/ev-document-images.h>
@@ -36,6 +38,7 @@
 #include <libdocument/ev-document-links.h>
 #include <libdocument/ev-document-media.h>
 #include <libdocument/ev-document-misc.h>
+#include <libdocument/ev-document-parallel-render.h>
 #include <libdocument/ev-document-print.h>
 #include <libdocument/ev-document-security.h>
 #include <libdocument/ev-document-text.h>
@@ -22,6 +22,7 @@
 
 #include <libview/ev-job-scheduler.h>
 #include <libview/ev-jobs.h>
+#include <libview/ev-page-text.h>
 #include <libview/ev-document-model.h>
 #include <libview/ev-print-operation.h>
 #include <libview/ev-view.h>
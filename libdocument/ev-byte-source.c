@@ -0,0 +1,799 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ev-byte-source.h"
+#include "ev-file-helpers.h"
+
+/* Stream sources are read in chunks of this size */
+#define CHUNK_SIZE 65536
+
+/* Chunks of seekable streams are dropped, the least recently used
+ * first, when there are more than this many of them. Streams that
+ * cannot seek can't be read again: the first MAX_CHUNKS chunks are
+ * kept in memory, and the rest is also written to a spill file, from
+ * which the chunks dropped are read again.
+ */
+#define MAX_CHUNKS 1024 /* 64MB */
+
+typedef struct {
+	gint64  index;
+	GBytes *bytes;
+	GList  *link;
+} EvByteSourceChunk;
+
+struct _EvByteSourcePrivate {
+	/* The whole contents, when they are in memory */
+	GBytes       *bytes;
+
+	/* Protected by mutex */
+	GMutex        mutex;
+	GInputStream *stream;
+	gboolean      seekable;
+	goffset       stream_start;
+	goffset       stream_offset;
+	goffset       size;
+	GHashTable   *chunks;
+	GQueue        lru;
+	gint          spill_fd;
+	goffset       spill_start;
+	gboolean      spill_failed;
+
+	/* Modification time of files, to notice when they are rewritten */
+	gboolean      check_changes;
+	guint64       mtime;
+	guint32       mtime_usec;
+	gboolean      changed;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (EvByteSource, ev_byte_source, G_TYPE_OBJECT)
+
+static void
+ev_byte_source_chunk_free (EvByteSourceChunk *chunk)
+{
+	g_bytes_unref (chunk->bytes);
+	g_free (chunk);
+}
+
+static void
+ev_byte_source_finalize (GObject *object)
+{
+	EvByteSource *source = EV_BYTE_SOURCE (object);
+
+	g_clear_pointer (&source->priv->bytes, g_bytes_unref);
+	g_clear_object (&source->priv->stream);
+	if (source->priv->spill_fd != -1)
+		close (source->priv->spill_fd);
+	g_hash_table_destroy (source->priv->chunks);
+	g_queue_clear (&source->priv->lru);
+	g_mutex_clear (&source->priv->mutex);
+
+	(* G_OBJECT_CLASS (ev_byte_source_parent_class)->finalize) (object);
+}
+
+static void
+ev_byte_source_class_init (EvByteSourceClass *klass)
+{
+	GObjectClass *g_object_class = G_OBJECT_CLASS (klass);
+
+	g_object_class->finalize = ev_byte_source_finalize;
+}
+
+static void
+ev_byte_source_init (EvByteSource *source)
+{
+	source->priv = ev_byte_source_get_instance_private (source);
+	source->priv->size = -1;
+	source->priv->spill_fd = -1;
+	source->priv->chunks = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+						      NULL,
+						      (GDestroyNotify) ev_byte_source_chunk_free);
+	g_mutex_init (&source->priv->mutex);
+}
+
+/**
+ * ev_byte_source_new_for_uri:
+ * @uri: the URI of a file
+ * @cancellable: (nullable): a #GCancellable
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Creates a byte source for the file at @uri. Files are read on demand,
+ * and the parts read recently are kept in memory. Files that cannot
+ * seek, like some remote ones, are written to a temporary file past
+ * 64 MiB, see ev_byte_source_new_for_stream(). Local files are not
+ * mapped in memory: they can be rewritten in place while they are
+ * open, and accessing the mapping of a truncated file crashes, where
+ * reading it just fails. Reading parts of the file that are not in
+ * memory fails too once the file is modified, so that the contents of
+ * different versions are not mixed, see ev_byte_source_is_changed().
+ *
+ * Returns: (transfer full) (nullable): a new #EvByteSource, or %NULL
+ *
+ * Since: 44.0
+ */
+EvByteSource *
+ev_byte_source_new_for_uri (const gchar   *uri,
+			    GCancellable  *cancellable,
+			    GError       **error)
+{
+	EvByteSource     *source;
+	GFile            *file;
+	GFileInputStream *stream;
+	GFileInfo        *info;
+	goffset           size = -1;
+
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	file = g_file_new_for_uri (uri);
+	stream = g_file_read (file, cancellable, error);
+	g_object_unref (file);
+	if (!stream)
+		return NULL;
+
+	info = g_file_input_stream_query_info (stream,
+					       G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+					       G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+					       G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+					       cancellable, NULL);
+	if (info && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_SIZE))
+		size = g_file_info_get_size (info);
+
+	source = ev_byte_source_new_for_stream (G_INPUT_STREAM (stream), size);
+	g_object_unref (stream);
+
+	if (info && size != -1 && source->priv->seekable &&
+	    g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+		source->priv->check_changes = TRUE;
+		source->priv->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+		source->priv->mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	}
+	g_clear_object (&info);
+
+	return source;
+}
+
+/**
+ * ev_byte_source_new_for_bytes:
+ * @bytes: a #GBytes
+ *
+ * Returns: (transfer full): a new #EvByteSource for the contents of @bytes
+ *
+ * Since: 44.0
+ */
+EvByteSource *
+ev_byte_source_new_for_bytes (GBytes *bytes)
+{
+	EvByteSource *source;
+
+	g_return_val_if_fail (bytes != NULL, NULL);
+
+	source = g_object_new (EV_TYPE_BYTE_SOURCE, NULL);
+	source->priv->bytes = g_bytes_ref (bytes);
+	source->priv->size = g_bytes_get_size (bytes);
+
+	return source;
+}
+
+/**
+ * ev_byte_source_new_for_stream:
+ * @stream: a #GInputStream positioned at the beginning of the contents
+ * @size: the size of the contents, or -1 if it is not known
+ *
+ * Creates a byte source that reads @stream on demand. If @stream is a
+ * #GSeekable that can seek, the parts of it that have not been used
+ * recently are dropped from memory and read again when needed. Past
+ * 64 MiB, the contents of other streams go to a temporary file too, so
+ * that they are not all kept in memory.
+ *
+ * Returns: (transfer full): a new #EvByteSource
+ *
+ * Since: 44.0
+ */
+EvByteSource *
+ev_byte_source_new_for_stream (GInputStream *stream,
+			       goffset       size)
+{
+	EvByteSource *source;
+
+	g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+
+	source = g_object_new (EV_TYPE_BYTE_SOURCE, NULL);
+	source->priv->stream = g_object_ref (stream);
+	source->priv->seekable = G_IS_SEEKABLE (stream) &&
+		g_seekable_can_seek (G_SEEKABLE (stream));
+	source->priv->stream_start = source->priv->seekable ?
+		g_seekable_tell (G_SEEKABLE (stream)) : 0;
+	source->priv->size = size;
+
+	return source;
+}
+
+/* Called with the mutex held. Adds a chunk read from the stream or
+ * from the spill file, @droppable chunks can be read again later.
+ */
+static EvByteSourceChunk *
+ev_byte_source_add_chunk (EvByteSource *source,
+			  gint64        index,
+			  guint8       *data,
+			  gsize         size,
+			  gboolean      droppable)
+{
+	EvByteSourcePrivate *priv = source->priv;
+	EvByteSourceChunk   *chunk;
+
+	chunk = g_new0 (EvByteSourceChunk, 1);
+	chunk->index = index;
+	chunk->bytes = g_bytes_new_take (data, size);
+	g_hash_table_insert (priv->chunks, &chunk->index, chunk);
+
+	if (droppable) {
+		g_queue_push_head (&priv->lru, chunk);
+		chunk->link = priv->lru.head;
+
+		while (priv->lru.length > MAX_CHUNKS) {
+			EvByteSourceChunk *old_chunk = g_queue_pop_tail (&priv->lru);
+
+			g_hash_table_remove (priv->chunks, &old_chunk->index);
+		}
+	}
+
+	return chunk;
+}
+
+/* Called with the mutex held. Once MAX_CHUNKS chunks of a stream that
+ * cannot seek are in memory, the next ones are written to a spill file,
+ * unlinked right away. Returns %FALSE if there is no spill file.
+ */
+static gboolean
+ev_byte_source_spill (EvByteSource *source,
+		      goffset       offset,
+		      const guint8 *data,
+		      gsize         size)
+{
+	EvByteSourcePrivate *priv = source->priv;
+	gsize                written = 0;
+
+	if (priv->spill_fd == -1) {
+		gchar *filename;
+
+		if (priv->spill_failed || g_hash_table_size (priv->chunks) < MAX_CHUNKS)
+			return FALSE;
+
+		priv->spill_fd = ev_mkstemp ("source.XXXXXX", &filename, NULL);
+		if (priv->spill_fd == -1) {
+			priv->spill_failed = TRUE;
+			return FALSE;
+		}
+
+		ev_tmp_filename_unlink (filename);
+		g_free (filename);
+		priv->spill_start = offset;
+	}
+
+	while (written < size) {
+		ssize_t n;
+
+		n = pwrite (priv->spill_fd, data + written, size - written,
+			    offset - priv->spill_start + written);
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+
+			g_debug ("Could not write to the spill file: %s", g_strerror (errno));
+			return FALSE;
+		}
+		written += n;
+	}
+
+	return TRUE;
+}
+
+/* Called with the mutex held. Reads again a chunk of a stream that
+ * cannot seek, dropped from memory after it was spilled.
+ */
+static GBytes *
+ev_byte_source_read_spilled_chunk (EvByteSource  *source,
+				   gint64         index,
+				   GError       **error)
+{
+	EvByteSourcePrivate *priv = source->priv;
+	goffset              offset = index * CHUNK_SIZE;
+	gsize                size, n_read = 0;
+	guint8              *data;
+
+	size = MIN (CHUNK_SIZE, priv->stream_offset - offset);
+	data = g_malloc (size);
+	while (n_read < size) {
+		ssize_t n;
+
+		n = pread (priv->spill_fd, data + n_read, size - n_read,
+			   offset - priv->spill_start + n_read);
+		if (n == -1 && errno == EINTR)
+			continue;
+
+		if (n <= 0) {
+			int errsv = errno;
+
+			g_set_error (error, G_IO_ERROR,
+				     n == 0 ? G_IO_ERROR_FAILED : g_io_error_from_errno (errsv),
+				     "Could not read the spill file: %s",
+				     n == 0 ? "unexpected end of file" : g_strerror (errsv));
+			g_free (data);
+			return NULL;
+		}
+		n_read += n;
+	}
+
+	return ev_byte_source_add_chunk (source, index, data, size, TRUE)->bytes;
+}
+
+/* Called with the mutex held, after reading from the stream of a file.
+ * Returns %FALSE if the file was modified since the source was created:
+ * what was just read may belong to the new version.
+ */
+static gboolean
+ev_byte_source_check_unchanged (EvByteSource  *source,
+				GCancellable  *cancellable,
+				GError       **error)
+{
+	EvByteSourcePrivate *priv = source->priv;
+	GFileInfo           *info;
+
+	if (!priv->changed) {
+		info = g_file_input_stream_query_info (G_FILE_INPUT_STREAM (priv->stream),
+						       G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+						       G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+						       G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+						       cancellable, NULL);
+		if (info) {
+			priv->changed =
+				g_file_info_get_size (info) != priv->size ||
+				g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) != priv->mtime ||
+				g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC) != priv->mtime_usec;
+			g_object_unref (info);
+		}
+	}
+
+	if (priv->changed) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     "The file was modified since it was opened");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Called with the mutex held. Reads the chunk at @index from the
+ * stream, and the chunks before it when the stream cannot seek.
+ * Returns %NULL past the end of the contents.
+ */
+static GBytes *
+ev_byte_source_get_chunk (EvByteSource  *source,
+			  gint64         index,
+			  GCancellable  *cancellable,
+			  GError       **error)
+{
+	EvByteSourcePrivate *priv = source->priv;
+	EvByteSourceChunk   *chunk;
+	goffset              offset = index * CHUNK_SIZE;
+
+	chunk = g_hash_table_lookup (priv->chunks, &index);
+	if (chunk) {
+		if (chunk->link) {
+			g_queue_unlink (&priv->lru, chunk->link);
+			g_queue_push_head_link (&priv->lru, chunk->link);
+		}
+
+		return chunk->bytes;
+	}
+
+	if (priv->size != -1 && offset >= priv->size)
+		return NULL;
+
+	if (priv->stream_offset != offset) {
+		if (priv->seekable) {
+			if (!g_seekable_seek (G_SEEKABLE (priv->stream),
+					      priv->stream_start + offset,
+					      G_SEEK_SET, cancellable, error))
+				return NULL;
+			priv->stream_offset = offset;
+		} else if (priv->stream_offset > offset) {
+			if (priv->spill_fd != -1 && offset >= priv->spill_start)
+				return ev_byte_source_read_spilled_chunk (source, index, error);
+
+			/* The chunk was read already, so it must be past the end */
+			return NULL;
+		}
+	}
+
+	while (priv->stream_offset <= offset) {
+		guint8  *data;
+		gsize    n_read = 0;
+		gboolean droppable;
+
+		data = g_malloc (CHUNK_SIZE);
+		if (!g_input_stream_read_all (priv->stream, data, CHUNK_SIZE, &n_read,
+					      cancellable, error)) {
+			g_free (data);
+			return NULL;
+		}
+
+		if (priv->check_changes &&
+		    !ev_byte_source_check_unchanged (source, cancellable, error)) {
+			g_free (data);
+			return NULL;
+		}
+
+		if (n_read < CHUNK_SIZE)
+			priv->size = priv->stream_offset + n_read;
+
+		if (n_read == 0) {
+			g_free (data);
+			return NULL;
+		}
+
+		droppable = priv->seekable ||
+			ev_byte_source_spill (source, priv->stream_offset, data, n_read);
+		chunk = ev_byte_source_add_chunk (source,
+						  priv->stream_offset / CHUNK_SIZE,
+						  g_realloc (data, n_read), n_read,
+						  droppable);
+		priv->stream_offset += n_read;
+	}
+
+	return chunk->bytes;
+}
+
+/**
+ * ev_byte_source_get_size:
+ * @source: an #EvByteSource
+ *
+ * Returns: the size of the contents of @source, or -1 if it is not
+ *   known yet
+ *
+ * Since: 44.0
+ */
+goffset
+ev_byte_source_get_size (EvByteSource *source)
+{
+	goffset size;
+
+	g_return_val_if_fail (EV_IS_BYTE_SOURCE (source), -1);
+
+	g_mutex_lock (&source->priv->mutex);
+	size = source->priv->size;
+	g_mutex_unlock (&source->priv->mutex);
+
+	return size;
+}
+
+/**
+ * ev_byte_source_is_changed:
+ * @source: an #EvByteSource
+ *
+ * Returns whether the file @source reads from was found modified when
+ * reading it. Parts of the contents read before are still those of the
+ * version of the file @source was created for, the other parts can't be
+ * read anymore.
+ *
+ * Returns: %TRUE if the file of @source was modified since it was opened
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_byte_source_is_changed (EvByteSource *source)
+{
+	gboolean changed;
+
+	g_return_val_if_fail (EV_IS_BYTE_SOURCE (source), FALSE);
+
+	g_mutex_lock (&source->priv->mutex);
+	changed = source->priv->changed;
+	g_mutex_unlock (&source->priv->mutex);
+
+	return changed;
+}
+
+/**
+ * ev_byte_source_get_bytes:
+ * @source: an #EvByteSource
+ *
+ * Returns the contents of @source when they are in memory, like the
+ * contents of mapped files. This never reads from the source, use
+ * ev_byte_source_read() to read sources for which this returns %NULL.
+ *
+ * Returns: (transfer none) (nullable): the contents of @source, or %NULL
+ *
+ * Since: 44.0
+ */
+GBytes *
+ev_byte_source_get_bytes (EvByteSource *source)
+{
+	g_return_val_if_fail (EV_IS_BYTE_SOURCE (source), NULL);
+
+	return source->priv->bytes;
+}
+
+/**
+ * ev_byte_source_read:
+ * @source: an #EvByteSource
+ * @offset: the offset to read from
+ * @buffer: (array length=count) (element-type guint8) (out caller-allocates):
+ *   a buffer to read data into
+ * @count: the number of bytes to read
+ * @cancellable: (nullable): a #GCancellable
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Reads up to @count bytes of the contents of @source from @offset. This
+ * can be called from any thread.
+ *
+ * Returns: the number of bytes read, which is less than @count only at
+ *   the end of the contents, or -1 on error
+ *
+ * Since: 44.0
+ */
+gssize
+ev_byte_source_read (EvByteSource  *source,
+		     goffset        offset,
+		     void          *buffer,
+		     gsize          count,
+		     GCancellable  *cancellable,
+		     GError       **error)
+{
+	EvByteSourcePrivate *priv;
+	gsize                n_read = 0;
+
+	g_return_val_if_fail (EV_IS_BYTE_SOURCE (source), -1);
+	g_return_val_if_fail (offset >= 0, -1);
+
+	priv = source->priv;
+
+	if (priv->bytes) {
+		gsize         size;
+		const guint8 *data = g_bytes_get_data (priv->bytes, &size);
+
+		if ((gsize) offset >= size)
+			return 0;
+
+		n_read = MIN (count, size - offset);
+		memcpy (buffer, data + offset, n_read);
+
+		return n_read;
+	}
+
+	g_mutex_lock (&priv->mutex);
+	while (n_read < count) {
+		GBytes       *bytes;
+		GError       *err = NULL;
+		const guint8 *data;
+		gsize         size, chunk_offset, n;
+
+		bytes = ev_byte_source_get_chunk (source, offset / CHUNK_SIZE, cancellable, &err);
+		if (!bytes) {
+			if (err) {
+				g_mutex_unlock (&priv->mutex);
+				g_propagate_error (error, err);
+				return -1;
+			}
+			break;
+		}
+
+		data = g_bytes_get_data (bytes, &size);
+		chunk_offset = offset % CHUNK_SIZE;
+		if (chunk_offset >= size)
+			break;
+
+		n = MIN (count - n_read, size - chunk_offset);
+		memcpy ((guint8 *) buffer + n_read, data + chunk_offset, n);
+		n_read += n;
+		offset += n;
+	}
+	g_mutex_unlock (&priv->mutex);
+
+	return n_read;
+}
+
+/* Stream to read a byte source, it can seek even if the source
+ * is a stream that cannot.
+ */
+#define EV_TYPE_BYTE_SOURCE_STREAM (ev_byte_source_stream_get_type ())
+G_DECLARE_FINAL_TYPE (EvByteSourceStream, ev_byte_source_stream, EV, BYTE_SOURCE_STREAM, GInputStream)
+
+struct _EvByteSourceStream {
+	GInputStream  parent_instance;
+
+	EvByteSource *source;
+	goffset       offset;
+};
+
+static void ev_byte_source_stream_seekable_iface_init (GSeekableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (EvByteSourceStream, ev_byte_source_stream, G_TYPE_INPUT_STREAM,
+			 G_IMPLEMENT_INTERFACE (G_TYPE_SEEKABLE,
+						ev_byte_source_stream_seekable_iface_init))
+
+static void
+ev_byte_source_stream_finalize (GObject *object)
+{
+	EvByteSourceStream *stream = EV_BYTE_SOURCE_STREAM (object);
+
+	g_object_unref (stream->source);
+
+	G_OBJECT_CLASS (ev_byte_source_stream_parent_class)->finalize (object);
+}
+
+static gssize
+ev_byte_source_stream_read (GInputStream  *input_stream,
+			    void          *buffer,
+			    gsize          count,
+			    GCancellable  *cancellable,
+			    GError       **error)
+{
+	EvByteSourceStream *stream = EV_BYTE_SOURCE_STREAM (input_stream);
+	gssize              n_read;
+
+	n_read = ev_byte_source_read (stream->source, stream->offset,
+				      buffer, count, cancellable, error);
+	if (n_read > 0)
+		stream->offset += n_read;
+
+	return n_read;
+}
+
+static void
+ev_byte_source_stream_class_init (EvByteSourceStreamClass *klass)
+{
+	GObjectClass      *g_object_class = G_OBJECT_CLASS (klass);
+	GInputStreamClass *input_stream_class = G_INPUT_STREAM_CLASS (klass);
+
+	g_object_class->finalize = ev_byte_source_stream_finalize;
+	input_stream_class->read_fn = ev_byte_source_stream_read;
+}
+
+static void
+ev_byte_source_stream_init (EvByteSourceStream *stream)
+{
+}
+
+static goffset
+ev_byte_source_stream_tell (GSeekable *seekable)
+{
+	return EV_BYTE_SOURCE_STREAM (seekable)->offset;
+}
+
+static gboolean
+ev_byte_source_stream_can_seek (GSeekable *seekable)
+{
+	return TRUE;
+}
+
+static gboolean
+ev_byte_source_stream_seek (GSeekable     *seekable,
+			    goffset        offset,
+			    GSeekType      type,
+			    GCancellable  *cancellable,
+			    GError       **error)
+{
+	EvByteSourceStream *stream = EV_BYTE_SOURCE_STREAM (seekable);
+	goffset             new_offset;
+
+	switch (type) {
+	case G_SEEK_CUR:
+		new_offset = stream->offset + offset;
+		break;
+	case G_SEEK_SET:
+		new_offset = offset;
+		break;
+	case G_SEEK_END: {
+		goffset size = ev_byte_source_get_size (stream->source);
+
+		/* Read up to the end to know the size */
+		if (size == -1) {
+			guint8 *buffer = g_malloc (CHUNK_SIZE);
+			gssize  n_read;
+
+			size = stream->offset;
+			do {
+				n_read = ev_byte_source_read (stream->source, size,
+							      buffer, CHUNK_SIZE,
+							      cancellable, error);
+				if (n_read > 0)
+					size += n_read;
+			} while (n_read > 0);
+			g_free (buffer);
+
+			if (n_read < 0)
+				return FALSE;
+		}
+
+		new_offset = size + offset;
+		break;
+	}
+	default:
+		g_assert_not_reached ();
+	}
+
+	if (new_offset < 0) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+				     "Invalid seek request");
+		return FALSE;
+	}
+
+	stream->offset = new_offset;
+
+	return TRUE;
+}
+
+static gboolean
+ev_byte_source_stream_can_truncate (GSeekable *seekable)
+{
+	return FALSE;
+}
+
+static gboolean
+ev_byte_source_stream_truncate (GSeekable     *seekable,
+				goffset        offset,
+				GCancellable  *cancellable,
+				GError       **error)
+{
+	g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			     "Cannot truncate EvByteSourceStream");
+	return FALSE;
+}
+
+static void
+ev_byte_source_stream_seekable_iface_init (GSeekableIface *iface)
+{
+	iface->tell = ev_byte_source_stream_tell;
+	iface->can_seek = ev_byte_source_stream_can_seek;
+	iface->seek = ev_byte_source_stream_seek;
+	iface->can_truncate = ev_byte_source_stream_can_truncate;
+	iface->truncate_fn = ev_byte_source_stream_truncate;
+}
+
+/**
+ * ev_byte_source_get_stream:
+ * @source: an #EvByteSource
+ *
+ * Creates a stream reading the contents of @source from the beginning.
+ * The stream can seek, and several streams of the same source can be
+ * used at the same time.
+ *
+ * Returns: (transfer full): a new seekable #GInputStream
+ *
+ * Since: 44.0
+ */
+GInputStream *
+ev_byte_source_get_stream (EvByteSource *source)
+{
+	EvByteSourceStream *stream;
+
+	g_return_val_if_fail (EV_IS_BYTE_SOURCE (source), NULL);
+
+	if (source->priv->bytes)
+		return g_memory_input_stream_new_from_bytes (source->priv->bytes);
+
+	stream = g_object_new (EV_TYPE_BYTE_SOURCE_STREAM, NULL);
+	stream->source = g_object_ref (source);
+
+	return G_INPUT_STREAM (stream);
+}
@@ -0,0 +1,79 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#if !defined (__EV_EVINCE_DOCUMENT_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-document.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "ev-macros.h"
+
+G_BEGIN_DECLS
+
+typedef struct _EvByteSource        EvByteSource;
+typedef struct _EvByteSourceClass   EvByteSourceClass;
+typedef struct _EvByteSourcePrivate EvByteSourcePrivate;
+
+#define EV_TYPE_BYTE_SOURCE              (ev_byte_source_get_type())
+#define EV_BYTE_SOURCE(object)           (G_TYPE_CHECK_INSTANCE_CAST((object), EV_TYPE_BYTE_SOURCE, EvByteSource))
+#define EV_BYTE_SOURCE_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST((klass), EV_TYPE_BYTE_SOURCE, EvByteSourceClass))
+#define EV_IS_BYTE_SOURCE(object)        (G_TYPE_CHECK_INSTANCE_TYPE((object), EV_TYPE_BYTE_SOURCE))
+#define EV_IS_BYTE_SOURCE_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE((klass), EV_TYPE_BYTE_SOURCE))
+#define EV_BYTE_SOURCE_GET_CLASS(object) (G_TYPE_INSTANCE_GET_CLASS((object), EV_TYPE_BYTE_SOURCE, EvByteSourceClass))
+
+struct _EvByteSource {
+	GObject base_instance;
+
+	EvByteSourcePrivate *priv;
+};
+
+struct _EvByteSourceClass {
+	GObjectClass base_class;
+};
+
+EV_PUBLIC
+GType         ev_byte_source_get_type        (void) G_GNUC_CONST;
+EV_PUBLIC
+EvByteSource *ev_byte_source_new_for_uri     (const gchar   *uri,
+					      GCancellable  *cancellable,
+					      GError       **error);
+EV_PUBLIC
+EvByteSource *ev_byte_source_new_for_bytes   (GBytes        *bytes);
+EV_PUBLIC
+EvByteSource *ev_byte_source_new_for_stream  (GInputStream  *stream,
+					      goffset        size);
+EV_PUBLIC
+goffset       ev_byte_source_get_size        (EvByteSource  *source);
+EV_PUBLIC
+gboolean      ev_byte_source_is_changed      (EvByteSource  *source);
+EV_PUBLIC
+GBytes       *ev_byte_source_get_bytes       (EvByteSource  *source);
+EV_PUBLIC
+gssize        ev_byte_source_read            (EvByteSource  *source,
+					      goffset        offset,
+					      void          *buffer,
+					      gsize          count,
+					      GCancellable  *cancellable,
+					      GError       **error);
+EV_PUBLIC
+GInputStream *ev_byte_source_get_stream      (EvByteSource  *source);
+
+G_END_DECLS
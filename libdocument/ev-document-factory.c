@@ -44,6 +44,9 @@ static GList *ev_backends_list = NULL;
 static GHashTable *ev_module_hash = NULL;
 static gchar *ev_backends_dir = NULL;
 
+/* Documents can be created from several threads at once */
+static GMutex ev_module_mutex;
+
 static EvDocument* ev_document_factory_new_document_for_mime_type (const char *mime_type,
                                                                    GError **error);
 
@@ -110,6 +113,8 @@ ev_document_factory_new_document_for_mime_type (const gchar *mime_type,
                 return NULL;
         }
 
+        g_mutex_lock (&ev_module_mutex);
+
         if (ev_module_hash != NULL) {
                 module = g_hash_table_lookup (ev_module_hash, info->module_name);
         }
@@ -135,12 +140,15 @@ ev_document_factory_new_document_for_mime_type (const gchar *mime_type,
                 g_set_error (error, EV_DOCUMENT_ERROR, EV_DOCUMENT_ERROR_INVALID,
                              "Failed to load backend for '%s': %s",
                              mime_type, err ? err : "unknown error");
+                g_mutex_unlock (&ev_module_mutex);
                 return NULL;
         }
 
         document = EV_DOCUMENT (_ev_module_new_object (EV_MODULE (module)));
         g_type_module_unuse (module);
 
+        g_mutex_unlock (&ev_module_mutex);
+
         g_object_set_data_full (G_OBJECT (document), BACKEND_DATA_KEY,
                                 _ev_backend_info_ref (info),
                                 (GDestroyNotify) _ev_backend_info_unref);
@@ -210,16 +218,6 @@ new_document_for_uri (const char        *uri,
         return document;
 }
 
-static void
-free_uncompressed_uri (gchar *uri_unc)
-{
-	if (!uri_unc)
-		return;
-
-	ev_tmp_uri_unlink (uri_unc);
-	g_free (uri_unc);
-}
-
 /*
  * _ev_document_factory_init:
  *
@@ -300,7 +298,6 @@ ev_document_factory_get_document_full (const char           *uri,
 	EvDocument *document;
 	int result;
 	EvCompressionType compression;
-	gchar *uri_unc = NULL;
 	GError *err = NULL;
 
 	g_return_val_if_fail (uri != NULL, NULL);
@@ -309,20 +306,8 @@ ev_document_factory_get_document_full (const char           *uri,
 	g_assert (document != NULL || err != NULL);
 
 	if (document != NULL) {
-		uri_unc = ev_file_uncompress (uri, compression, &err);
-		if (uri_unc) {
-			g_object_set_data_full (G_OBJECT (document),
-						"uri-uncompressed",
-						uri_unc,
-						(GDestroyNotify) free_uncompressed_uri);
-		} else if (err != NULL) {
-			/* Error uncompressing file */
-			g_object_unref (document);
-			g_propagate_error (error, err);
-			return NULL;
-		}
-
-		result = ev_document_load_full (document, uri_unc ? uri_unc : uri, flags, &err);
+		result = ev_document_load_compressed (document, uri, compression,
+						      flags, NULL, &err);
 
 		if (result == FALSE || err) {
 			if (err &&
@@ -342,7 +327,6 @@ ev_document_factory_get_document_full (const char           *uri,
 
 	/* Try again with slow mime detection */
 	g_clear_error (&err);
-	uri_unc = NULL;
 
 	document = new_document_for_uri (uri, FALSE, &compression, &err);
 	if (document == NULL) {
@@ -351,22 +335,8 @@ ev_document_factory_get_document_full (const char           *uri,
 		return NULL;
 	}
 
-	uri_unc = ev_file_uncompress (uri, compression, &err);
-	if (uri_unc) {
-		g_object_set_data_full (G_OBJECT (document),
-					"uri-uncompressed",
-					uri_unc,
-					(GDestroyNotify) free_uncompressed_uri);
-	} else if (err != NULL) {
-		/* Error uncompressing file */
-		g_propagate_error (error, err);
-
-		g_object_unref (document);
-		return NULL;
-	}
-
-	result = ev_document_load_full (document, uri_unc ? uri_unc : uri,
-					EV_DOCUMENT_LOAD_FLAG_NONE, &err);
+	result = ev_document_load_compressed (document, uri, compression,
+					      flags, NULL, &err);
 	if (result == FALSE) {
 		if (err == NULL) {
 			/* FIXME: this really should not happen; the backend should
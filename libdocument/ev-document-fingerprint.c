@@ -0,0 +1,52 @@
+/* ev-document-fingerprint.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "ev-document.h"
+#include "ev-document-fingerprint.h"
+
+G_DEFINE_INTERFACE (EvDocumentFingerprint, ev_document_fingerprint, 0)
+
+static void
+ev_document_fingerprint_default_init (EvDocumentFingerprintInterface *klass)
+{
+}
+
+/**
+ * ev_document_fingerprint_get_page_fingerprint:
+ * @document_fingerprint: an #EvDocumentFingerprint
+ * @page: an #EvPage
+ *
+ * Computes a string identifying the contents of @page, so that pages of
+ * two versions of a document that render the same have the same
+ * fingerprint. It must be called with the document locked.
+ *
+ * Returns: (transfer full) (nullable): the fingerprint of @page, or %NULL
+ *   if it could not be computed
+ *
+ * Since: 44.0
+ */
+gchar *
+ev_document_fingerprint_get_page_fingerprint (EvDocumentFingerprint *document_fingerprint,
+					      EvPage                *page)
+{
+	EvDocumentFingerprintInterface *iface = EV_DOCUMENT_FINGERPRINT_GET_IFACE (document_fingerprint);
+
+	return iface->get_page_fingerprint (document_fingerprint, page);
+}
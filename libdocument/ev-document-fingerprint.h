@@ -0,0 +1,58 @@
+/* ev-document-fingerprint.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#if !defined (__EV_EVINCE_DOCUMENT_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-document.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+
+#include "ev-macros.h"
+#include "ev-page.h"
+
+G_BEGIN_DECLS
+
+#define EV_TYPE_DOCUMENT_FINGERPRINT	          (ev_document_fingerprint_get_type ())
+#define EV_DOCUMENT_FINGERPRINT(o)		  (G_TYPE_CHECK_INSTANCE_CAST ((o), EV_TYPE_DOCUMENT_FINGERPRINT, EvDocumentFingerprint))
+#define EV_DOCUMENT_FINGERPRINT_IFACE(k)	  (G_TYPE_CHECK_CLASS_CAST((k), EV_TYPE_DOCUMENT_FINGERPRINT, EvDocumentFingerprintInterface))
+#define EV_IS_DOCUMENT_FINGERPRINT(o)	          (G_TYPE_CHECK_INSTANCE_TYPE ((o), EV_TYPE_DOCUMENT_FINGERPRINT))
+#define EV_IS_DOCUMENT_FINGERPRINT_IFACE(k)	  (G_TYPE_CHECK_CLASS_TYPE ((k), EV_TYPE_DOCUMENT_FINGERPRINT))
+#define EV_DOCUMENT_FINGERPRINT_GET_IFACE(inst)   (G_TYPE_INSTANCE_GET_INTERFACE ((inst), EV_TYPE_DOCUMENT_FINGERPRINT, EvDocumentFingerprintInterface))
+
+typedef struct _EvDocumentFingerprint          EvDocumentFingerprint;
+typedef struct _EvDocumentFingerprintInterface EvDocumentFingerprintInterface;
+
+struct _EvDocumentFingerprintInterface
+{
+	GTypeInterface base_iface;
+
+	/* Methods  */
+	gchar * (* get_page_fingerprint) (EvDocumentFingerprint *document_fingerprint,
+					  EvPage                *page);
+};
+
+EV_PUBLIC
+GType  ev_document_fingerprint_get_type             (void) G_GNUC_CONST;
+
+EV_PUBLIC
+gchar *ev_document_fingerprint_get_page_fingerprint (EvDocumentFingerprint *document_fingerprint,
+						     EvPage                *page);
+
+G_END_DECLS
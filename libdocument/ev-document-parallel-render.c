@@ -0,0 +1,112 @@
+/* ev-document-parallel-render.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "ev-document.h"
+#include "ev-document-parallel-render.h"
+
+G_DEFINE_INTERFACE (EvDocumentParallelRender, ev_document_parallel_render, 0)
+
+static void
+ev_document_parallel_render_default_init (EvDocumentParallelRenderInterface *klass)
+{
+}
+
+/**
+ * ev_document_parallel_render_sync:
+ * @document_parallel_render: an #EvDocumentParallelRender
+ *
+ * Brings the render state of @document_parallel_render up to date with
+ * the document (forms, annotations, layers...). It must be called with
+ * the document locked, right before ev_document_parallel_render_render_page().
+ *
+ * Returns: %TRUE if pages can be rendered in parallel, %FALSE if they
+ *   have to be rendered with ev_document_render() instead
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_parallel_render_sync (EvDocumentParallelRender *document_parallel_render)
+{
+	EvDocumentParallelRenderInterface *iface = EV_DOCUMENT_PARALLEL_RENDER_GET_IFACE (document_parallel_render);
+
+	return iface->sync (document_parallel_render);
+}
+
+/**
+ * ev_document_parallel_render_render_page:
+ * @document_parallel_render: an #EvDocumentParallelRender
+ * @rc: an #EvRenderContext
+ *
+ * Renders the page of @rc like ev_document_render() does, but without
+ * the document lock held. It can be called from several threads at
+ * the same time.
+ *
+ * Returns: (transfer full) (nullable): a #cairo_surface_t, or %NULL if the
+ *   page could not be rendered in parallel and ev_document_render() has to
+ *   be used instead
+ *
+ * Since: 44.0
+ */
+cairo_surface_t *
+ev_document_parallel_render_render_page (EvDocumentParallelRender *document_parallel_render,
+					 EvRenderContext          *rc)
+{
+	EvDocumentParallelRenderInterface *iface = EV_DOCUMENT_PARALLEL_RENDER_GET_IFACE (document_parallel_render);
+
+	return iface->render_page (document_parallel_render, rc);
+}
+
+/**
+ * ev_document_parallel_render_find_text:
+ * @document_parallel_render: an #EvDocumentParallelRender
+ * @page: the index of the page to search
+ * @text: text to find
+ * @options: a set of #EvFindOptions
+ * @matches: (out) (transfer full) (element-type EvFindRectangle): return
+ *   location for the list of results
+ *
+ * Searches @page like ev_document_find_find_text_extended() does, but
+ * without the document lock held. It can be called from several threads
+ * at the same time, after ev_document_parallel_render_sync(). Searches
+ * run in the background, so implementations should not wait for the
+ * resources used to render pages, but return %FALSE instead.
+ *
+ * Returns: %TRUE if the page was searched, %FALSE if it has to be searched
+ *   with ev_document_find_find_text_extended() instead
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_parallel_render_find_text (EvDocumentParallelRender *document_parallel_render,
+				       gint                      page,
+				       const gchar              *text,
+				       EvFindOptions             options,
+				       GList                   **matches)
+{
+	EvDocumentParallelRenderInterface *iface = EV_DOCUMENT_PARALLEL_RENDER_GET_IFACE (document_parallel_render);
+
+	g_return_val_if_fail (matches != NULL, FALSE);
+
+	*matches = NULL;
+	if (!iface->find_text)
+		return FALSE;
+
+	return iface->find_text (document_parallel_render, page, text, options, matches);
+}
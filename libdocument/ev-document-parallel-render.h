@@ -0,0 +1,74 @@
+/* ev-document-parallel-render.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#if !defined (__EV_EVINCE_DOCUMENT_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-document.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+#include <cairo.h>
+
+#include "ev-macros.h"
+#include "ev-render-context.h"
+#include "ev-document-find.h"
+
+G_BEGIN_DECLS
+
+#define EV_TYPE_DOCUMENT_PARALLEL_RENDER	     (ev_document_parallel_render_get_type ())
+#define EV_DOCUMENT_PARALLEL_RENDER(o)		     (G_TYPE_CHECK_INSTANCE_CAST ((o), EV_TYPE_DOCUMENT_PARALLEL_RENDER, EvDocumentParallelRender))
+#define EV_DOCUMENT_PARALLEL_RENDER_IFACE(k)	     (G_TYPE_CHECK_CLASS_CAST((k), EV_TYPE_DOCUMENT_PARALLEL_RENDER, EvDocumentParallelRenderInterface))
+#define EV_IS_DOCUMENT_PARALLEL_RENDER(o)	     (G_TYPE_CHECK_INSTANCE_TYPE ((o), EV_TYPE_DOCUMENT_PARALLEL_RENDER))
+#define EV_IS_DOCUMENT_PARALLEL_RENDER_IFACE(k)	     (G_TYPE_CHECK_CLASS_TYPE ((k), EV_TYPE_DOCUMENT_PARALLEL_RENDER))
+#define EV_DOCUMENT_PARALLEL_RENDER_GET_IFACE(inst)  (G_TYPE_INSTANCE_GET_INTERFACE ((inst), EV_TYPE_DOCUMENT_PARALLEL_RENDER, EvDocumentParallelRenderInterface))
+
+typedef struct _EvDocumentParallelRender          EvDocumentParallelRender;
+typedef struct _EvDocumentParallelRenderInterface EvDocumentParallelRenderInterface;
+
+struct _EvDocumentParallelRenderInterface
+{
+	GTypeInterface base_iface;
+
+	/* Methods  */
+	gboolean          (* sync)        (EvDocumentParallelRender *document_parallel_render);
+	cairo_surface_t * (* render_page) (EvDocumentParallelRender *document_parallel_render,
+					   EvRenderContext          *rc);
+	gboolean          (* find_text)   (EvDocumentParallelRender *document_parallel_render,
+					   gint                      page,
+					   const gchar              *text,
+					   EvFindOptions             options,
+					   GList                   **matches);
+};
+
+EV_PUBLIC
+GType            ev_document_parallel_render_get_type    (void) G_GNUC_CONST;
+
+EV_PUBLIC
+gboolean         ev_document_parallel_render_sync        (EvDocumentParallelRender *document_parallel_render);
+EV_PUBLIC
+cairo_surface_t *ev_document_parallel_render_render_page (EvDocumentParallelRender *document_parallel_render,
+							  EvRenderContext          *rc);
+EV_PUBLIC
+gboolean         ev_document_parallel_render_find_text   (EvDocumentParallelRender *document_parallel_render,
+							  gint                      page,
+							  const gchar              *text,
+							  EvFindOptions             options,
+							  GList                   **matches);
+
+G_END_DECLS
@@ -26,9 +26,12 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <errno.h>
+#include <glib/gstdio.h>
 
 #include "ev-document.h"
 #include "ev-document-misc.h"
+#include "ev-file-helpers.h"
+#include "ev-byte-source.h"
 #include "synctex_parser.h"
 
 enum {
@@ -36,6 +39,11 @@ enum {
 	PROP_MODIFIED
 };
 
+#define EV_DOCUMENT_CACHE_FILE_VERSION 1
+#define EV_DOCUMENT_CACHE_FILE_FORMAT  "(usub(dd)a(dd)as)"
+#define EV_DOCUMENT_CACHE_MAX_AGE      (90 * G_TIME_SPAN_DAY)
+#define EV_DOCUMENT_CACHE_MAX_SIZE     (16 * 1024 * 1024)
+
 typedef struct _EvPageSize
 {
 	gdouble width;
@@ -51,6 +59,11 @@ struct _EvDocumentPrivate
 	gint            n_pages;
 	gboolean        modified;
 
+	/* The sizes and labels of the pages below are filled from the
+	 * main thread while jobs read them, they are protected by
+	 * cache_lock once the document is loaded.
+	 */
+	GRWLock         cache_lock;
 	gboolean        uniform;
 	gdouble         uniform_width;
 	gdouble         uniform_height;
@@ -62,12 +75,44 @@ struct _EvDocumentPrivate
 	gint            max_label;
 
 	gchar         **page_labels;
+	gboolean        custom_page_labels;
 	EvPageSize     *page_sizes;
 	EvDocumentInfo *info;
 
+	/* Lazy cache, see ev_document_fill_cache(). cached_pages is
+	 * only used from the main thread once the document is loaded.
+	 */
+	gboolean        cache_complete;
+	gint            n_cached_pages;
+	gboolean       *cached_pages;
+	GMutex          cache_mutex;
+	GList          *cache_batches; /* protected by cache_mutex */
+
+	/* The cache is saved to this file when the document is loaded
+	 * from an URI, to be restored the next time it is loaded.
+	 */
+	gchar          *cache_filename;
+	gchar          *cache_key;
+
+	EvDocumentLoadFlags load_flags;
+
 	synctex_scanner_p synctex_scanner;
+
+	GMutex          mutex;
 };
 
+typedef struct {
+	gint        first_page;
+	gint        n_pages;
+	EvPageSize *sizes;
+	gchar     **labels;
+} EvDocumentCacheBatch;
+
+typedef struct {
+	gchar    *filename;
+	GVariant *variant;
+} EvDocumentCache;
+
 static guint64         _ev_document_get_size_gfile  (GFile      *file);
 static guint64         _ev_document_get_size        (const char *uri);
 static gint            _ev_document_get_n_pages     (EvDocument *document);
@@ -80,7 +125,10 @@ static gchar          *_ev_document_get_page_label  (EvDocument *document,
 static EvDocumentInfo *_ev_document_get_info        (EvDocument *document);
 static gboolean        _ev_document_support_synctex (EvDocument *document);
 
-static GMutex ev_doc_mutex;
+/* Every document lock holds this in read mode, so that the global
+ * ev_document_doc_mutex_lock() can still exclude all of them.
+ */
+static GRWLock ev_doc_rw_lock;
 static GMutex ev_fc_mutex;
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (EvDocument, ev_document, G_TYPE_OBJECT)
@@ -95,6 +143,18 @@ ev_document_error_quark (void)
   return q;
 }
 
+static void
+ev_document_cache_batch_free (EvDocumentCacheBatch *batch)
+{
+	gint i;
+
+	for (i = 0; i < batch->n_pages; i++)
+		g_free (batch->labels[i]);
+	g_free (batch->labels);
+	g_free (batch->sizes);
+	g_free (batch);
+}
+
 static EvPage *
 ev_document_impl_get_page (EvDocument *document,
 			   gint        index)
@@ -124,6 +184,13 @@ ev_document_finalize (GObject *object)
 	}
 
 	g_clear_pointer (&document->priv->page_labels, g_strfreev);
+	g_clear_pointer (&document->priv->cached_pages, g_free);
+	g_list_free_full (document->priv->cache_batches, (GDestroyNotify) ev_document_cache_batch_free);
+	document->priv->cache_batches = NULL;
+	g_mutex_clear (&document->priv->cache_mutex);
+	g_rw_lock_clear (&document->priv->cache_lock);
+	g_clear_pointer (&document->priv->cache_filename, g_free);
+	g_clear_pointer (&document->priv->cache_key, g_free);
 
 	if (document->priv->info) {
 		ev_document_info_free (document->priv->info);
@@ -135,6 +202,8 @@ ev_document_finalize (GObject *object)
 		document->priv->synctex_scanner = NULL;
 	}
 
+	g_mutex_clear (&document->priv->mutex);
+
 	G_OBJECT_CLASS (ev_document_parent_class)->finalize (object);
 }
 
@@ -178,6 +247,10 @@ ev_document_init (EvDocument *document)
 {
 	document->priv = ev_document_get_instance_private (document);
 
+	g_mutex_init (&document->priv->mutex);
+	g_mutex_init (&document->priv->cache_mutex);
+	g_rw_lock_init (&document->priv->cache_lock);
+
 	/* Assume all pages are the same size until proven otherwise */
 	document->priv->uniform = TRUE;
 }
@@ -245,22 +318,114 @@ ev_document_set_modified (EvDocument *document,
 	}
 }
 
+/**
+ * ev_document_lock:
+ * @document: an #EvDocument
+ *
+ * Locks @document. Backends are not thread-safe, so the lock must be
+ * held around any call into the backend made outside of the document
+ * loading. Different documents can be used at the same time from
+ * different threads.
+ *
+ * The lock is not recursive and must not be nested: a thread holding the
+ * lock of a document must neither lock it again nor lock another
+ * document, and must not call functions that do so, such as
+ * ev_document_get_page_size() before the document cache is loaded.
+ * Every document lock also holds the lock taken by the deprecated
+ * ev_document_doc_mutex_lock() in shared mode, so a nested lock would
+ * deadlock as soon as another thread waits in ev_document_doc_mutex_lock().
+ *
+ * When rendering with a backend that is not thread-safe (see
+ * ev_document_is_render_thread_safe()), take the fontconfig mutex after
+ * the document lock.
+ *
+ * Since: 44.0
+ */
+void
+ev_document_lock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	g_rw_lock_reader_lock (&ev_doc_rw_lock);
+	g_mutex_lock (&document->priv->mutex);
+}
+
+/**
+ * ev_document_unlock:
+ * @document: an #EvDocument
+ *
+ * Unlocks @document, previously locked with ev_document_lock().
+ *
+ * Since: 44.0
+ */
+void
+ev_document_unlock (EvDocument *document)
+{
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	g_mutex_unlock (&document->priv->mutex);
+	g_rw_lock_reader_unlock (&ev_doc_rw_lock);
+}
+
+/**
+ * ev_document_trylock:
+ * @document: an #EvDocument
+ *
+ * Tries to lock @document without blocking.
+ *
+ * Returns: %TRUE if @document was locked
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_trylock (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	if (!g_rw_lock_reader_trylock (&ev_doc_rw_lock))
+		return FALSE;
+
+	if (!g_mutex_trylock (&document->priv->mutex)) {
+		g_rw_lock_reader_unlock (&ev_doc_rw_lock);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * ev_document_doc_mutex_lock:
+ *
+ * Locks all the documents at once.
+ *
+ * Deprecated: 44.0: Use ev_document_lock() instead.
+ */
 void
 ev_document_doc_mutex_lock (void)
 {
-	g_mutex_lock (&ev_doc_mutex);
+	g_rw_lock_writer_lock (&ev_doc_rw_lock);
 }
 
+/**
+ * ev_document_doc_mutex_unlock:
+ *
+ * Deprecated: 44.0: Use ev_document_unlock() instead.
+ */
 void
 ev_document_doc_mutex_unlock (void)
 {
-	g_mutex_unlock (&ev_doc_mutex);
+	g_rw_lock_writer_unlock (&ev_doc_rw_lock);
 }
 
+/**
+ * ev_document_doc_mutex_trylock:
+ *
+ * Deprecated: 44.0: Use ev_document_trylock() instead.
+ */
 gboolean
 ev_document_doc_mutex_trylock (void)
 {
-	return g_mutex_trylock (&ev_doc_mutex);
+	return g_rw_lock_writer_trylock (&ev_doc_rw_lock);
 }
 
 void
@@ -281,89 +446,566 @@ ev_document_fc_mutex_trylock (void)
 	return g_mutex_trylock (&ev_fc_mutex);
 }
 
+/**
+ * ev_document_is_render_thread_safe:
+ * @document: an #EvDocument
+ *
+ * Whether the backend of @document can render pages while other
+ * documents are being rendered, that is, without holding the fontconfig
+ * mutex (see ev_document_fc_mutex_lock()) around ev_document_render()
+ * and ev_document_get_thumbnail(). Backends using fontconfig or other
+ * global state without locking it themselves are not.
+ *
+ * Returns: %TRUE if rendering does not need the fontconfig mutex
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_is_render_thread_safe (EvDocument *document)
+{
+	EvDocumentClass *klass;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	klass = EV_DOCUMENT_GET_CLASS (document);
+
+	return klass->is_render_thread_safe ? klass->is_render_thread_safe (document) : FALSE;
+}
+
+/* Adds the size and the label of a page to the cache, taking the ownership
+ * of @page_label. Pages can be added in any order. Called with cache_lock
+ * held for writing.
+ */
+static void
+ev_document_cache_page (EvDocument *document,
+			gint        page_index,
+			gdouble     page_width,
+			gdouble     page_height,
+			gchar      *page_label)
+{
+	EvDocumentPrivate *priv = document->priv;
+	EvPageSize        *page_size;
+
+	if (priv->n_cached_pages == 0) {
+		priv->uniform_width = page_width;
+		priv->uniform_height = page_height;
+		priv->max_width = priv->uniform_width;
+		priv->max_height = priv->uniform_height;
+		priv->min_width = priv->uniform_width;
+		priv->min_height = priv->uniform_height;
+	} else if (priv->uniform &&
+		   (priv->uniform_width != page_width ||
+		    priv->uniform_height != page_height)) {
+		/* It's a different page size. Backfill the array, the
+		 * pages not cached yet keep the size of the first one.
+		 */
+		EvPageSize *page_sizes;
+		int j;
+
+		page_sizes = g_new0 (EvPageSize, priv->n_pages);
+
+		for (j = 0; j < priv->n_pages; j++) {
+			page_size = &(page_sizes[j]);
+			page_size->width = priv->uniform_width;
+			page_size->height = priv->uniform_height;
+		}
+
+		priv->page_sizes = page_sizes;
+		priv->uniform = FALSE;
+	}
+	if (!priv->uniform) {
+		page_size = &(priv->page_sizes[page_index]);
+
+		page_size->width = page_width;
+		page_size->height = page_height;
+
+		if (page_width > priv->max_width)
+			priv->max_width = page_width;
+		if (page_width < priv->min_width)
+			priv->min_width = page_width;
+
+		if (page_height > priv->max_height)
+			priv->max_height = page_height;
+		if (page_height < priv->min_height)
+			priv->min_height = page_height;
+	}
+
+	priv->n_cached_pages++;
+
+	if (page_label) {
+		if (!priv->page_labels)
+			priv->page_labels = g_new0 (gchar *, priv->n_pages + 1);
+
+		if (!priv->custom_page_labels) {
+			gchar *real_page_label;
+
+			real_page_label = g_strdup_printf ("%d", page_index + 1);
+			priv->custom_page_labels = g_strcmp0 (real_page_label, page_label) != 0;
+			g_free (real_page_label);
+		}
+
+		priv->page_labels[page_index] = page_label;
+		priv->max_label = MAX (priv->max_label,
+				       g_utf8_strlen (page_label, 256));
+	}
+}
+
+static void
+ev_document_get_page_cache_data (EvDocument *document,
+				 gint        page_index,
+				 gdouble    *page_width,
+				 gdouble    *page_height,
+				 gchar     **page_label)
+{
+	EvPage *page = ev_document_get_page (document, page_index);
+
+	*page_width = 0;
+	*page_height = 0;
+	_ev_document_get_page_size (document, page, page_width, page_height);
+	*page_label = _ev_document_get_page_label (document, page);
+	g_object_unref (page);
+}
+
+static void
+ev_document_init_cache_file (EvDocument  *document,
+			     const gchar *uri)
+{
+	EvDocumentPrivate *priv = document->priv;
+	GFile             *file;
+	gchar             *checksum;
+	gchar             *basename;
+
+	g_clear_pointer (&priv->cache_filename, g_free);
+	g_free (priv->cache_key);
+	priv->cache_key = ev_file_get_cache_key (uri);
+	if (!priv->cache_key)
+		return;
+
+	/* Temporary copies of compressed or remote documents get another
+	 * URI every time, their key identifies their contents instead */
+	file = g_file_new_for_uri (uri);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5,
+						  ev_file_is_temp (file) ? priv->cache_key : uri,
+						  -1);
+	g_object_unref (file);
+
+	basename = g_strconcat (checksum, ".cache", NULL);
+	priv->cache_filename = g_build_filename (g_get_user_cache_dir (),
+						 "evince", "document-cache",
+						 basename, NULL);
+	g_free (basename);
+	g_free (checksum);
+}
+
+/* Fills the cache from the file saved the last time the document was
+ * loaded, if the document has not changed since then, instead of asking
+ * the backend for every page.
+ */
+static gboolean
+ev_document_load_cache_file (EvDocument *document)
+{
+	EvDocumentPrivate *priv = document->priv;
+	GMappedFile       *mapped_file;
+	GBytes            *bytes;
+	GVariant          *variant;
+	GVariant          *sizes;
+	GVariant          *labels;
+	const EvPageSize  *page_sizes;
+	const gchar       *key;
+	guint32            version, n_pages;
+	gboolean           uniform;
+	gdouble            uniform_width, uniform_height;
+	gsize              n_page_sizes, n_labels;
+	gboolean           retval = FALSE;
+
+	if (!priv->cache_filename)
+		return FALSE;
+
+	mapped_file = g_mapped_file_new (priv->cache_filename, FALSE, NULL);
+	if (!mapped_file)
+		return FALSE;
+
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	g_mapped_file_unref (mapped_file);
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (EV_DOCUMENT_CACHE_FILE_FORMAT),
+								bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	g_variant_get (variant, "(u&sub(dd)@a(dd)@as)",
+		       &version, &key, &n_pages, &uniform,
+		       &uniform_width, &uniform_height,
+		       &sizes, &labels);
+
+	page_sizes = g_variant_get_fixed_array (sizes, &n_page_sizes, sizeof (EvPageSize));
+	n_labels = g_variant_n_children (labels);
+
+	if (version == EV_DOCUMENT_CACHE_FILE_VERSION &&
+	    strcmp (key, priv->cache_key) == 0 &&
+	    n_pages == (guint32) priv->n_pages &&
+	    (uniform || n_page_sizes == n_pages) &&
+	    (n_labels == 0 || n_labels == n_pages)) {
+		guint32 i;
+
+		g_rw_lock_writer_lock (&priv->cache_lock);
+		for (i = 0; i < n_pages; i++) {
+			gchar *page_label = NULL;
+
+			if (n_labels > 0) {
+				g_variant_get_child (labels, i, "s", &page_label);
+				if (*page_label == '\0')
+					g_clear_pointer (&page_label, g_free);
+			}
+
+			if (uniform) {
+				ev_document_cache_page (document, i,
+							uniform_width, uniform_height,
+							page_label);
+			} else {
+				ev_document_cache_page (document, i,
+							page_sizes[i].width, page_sizes[i].height,
+							page_label);
+			}
+		}
+		g_rw_lock_writer_unlock (&priv->cache_lock);
+		retval = TRUE;
+
+		/* The least recently used files are pruned first */
+		g_utime (priv->cache_filename, NULL);
+	}
+
+	g_variant_unref (sizes);
+	g_variant_unref (labels);
+	g_variant_unref (variant);
+
+	return retval;
+}
+
+static void
+ev_document_write_cache_file (const gchar *filename,
+			      GVariant    *variant)
+{
+	static gsize pruned = 0;
+	gchar       *dirname;
+	GError      *error = NULL;
+
+	dirname = g_path_get_dirname (filename);
+	g_mkdir_with_parents (dirname, 0700);
+
+	if (!g_file_set_contents (filename,
+				  g_variant_get_data (variant),
+				  g_variant_get_size (variant),
+				  &error)) {
+		g_warning ("Failed to save document cache: %s", error->message);
+		g_error_free (error);
+	}
+
+	/* Once per session is enough to keep the directory bounded */
+	if (g_once_init_enter (&pruned)) {
+		ev_file_prune_cache_dir (dirname,
+					 EV_DOCUMENT_CACHE_MAX_SIZE,
+					 EV_DOCUMENT_CACHE_MAX_AGE);
+		g_once_init_leave (&pruned, 1);
+	}
+	g_free (dirname);
+}
+
+static void
+write_cache_file_thread (GTask           *task,
+			 gpointer         source_object,
+			 EvDocumentCache *cache,
+			 GCancellable    *cancellable)
+{
+	ev_document_write_cache_file (cache->filename, cache->variant);
+}
+
+static void
+ev_document_cache_free (EvDocumentCache *cache)
+{
+	g_free (cache->filename);
+	g_variant_unref (cache->variant);
+	g_free (cache);
+}
+
+/* Saves the cache to the cache file, in a thread when @async is %TRUE */
+static void
+ev_document_save_cache_file (EvDocument *document,
+			     gboolean    async)
+{
+	EvDocumentPrivate *priv = document->priv;
+	GVariantBuilder    builder;
+	GVariant          *sizes;
+	GVariant          *variant;
+	gint               i;
+
+	if (!priv->cache_filename)
+		return;
+
+	g_rw_lock_reader_lock (&priv->cache_lock);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_STRING_ARRAY);
+	for (i = 0; priv->custom_page_labels && i < priv->n_pages; i++) {
+		g_variant_builder_add (&builder, "s",
+				       priv->page_labels[i] ? priv->page_labels[i] : "");
+	}
+
+	if (priv->uniform) {
+		sizes = g_variant_new_fixed_array (G_VARIANT_TYPE ("(dd)"), NULL, 0,
+						   sizeof (EvPageSize));
+	} else {
+		sizes = g_variant_new_fixed_array (G_VARIANT_TYPE ("(dd)"),
+						   priv->page_sizes, priv->n_pages,
+						   sizeof (EvPageSize));
+	}
+
+	variant = g_variant_ref_sink (g_variant_new ("(usub(dd)@a(dd)as)",
+						     EV_DOCUMENT_CACHE_FILE_VERSION,
+						     priv->cache_key,
+						     priv->n_pages,
+						     priv->uniform,
+						     priv->uniform_width,
+						     priv->uniform_height,
+						     sizes,
+						     &builder));
+	g_rw_lock_reader_unlock (&priv->cache_lock);
+
+	if (async) {
+		EvDocumentCache *cache;
+		GTask           *task;
+
+		cache = g_new (EvDocumentCache, 1);
+		cache->filename = g_strdup (priv->cache_filename);
+		cache->variant = g_variant_ref (variant);
+
+		task = g_task_new (NULL, NULL, NULL, NULL);
+		g_task_set_task_data (task, cache, (GDestroyNotify) ev_document_cache_free);
+		g_task_run_in_thread (task, (GTaskThreadFunc) write_cache_file_thread);
+		g_object_unref (task);
+	} else {
+		ev_document_write_cache_file (priv->cache_filename, variant);
+	}
+
+	g_variant_unref (variant);
+}
+
 static void
 ev_document_setup_cache (EvDocument *document)
 {
         EvDocumentPrivate *priv = document->priv;
-        gboolean custom_page_labels = FALSE;
         gint i;
 
         /* Cache some info about the document to avoid
          * going to the backends since it requires locks
          */
 	priv->cache_loaded = TRUE;
+	priv->cache_complete = TRUE;
+
+	if (ev_document_load_cache_file (document))
+		return;
 
         for (i = 0; i < priv->n_pages; i++) {
-                EvPage     *page = ev_document_get_page (document, i);
-                gdouble     page_width = 0;
-                gdouble     page_height = 0;
-                EvPageSize *page_size;
-                gchar      *page_label;
-
-                _ev_document_get_page_size (document, page, &page_width, &page_height);
-
-                if (i == 0) {
-                        priv->uniform_width = page_width;
-                        priv->uniform_height = page_height;
-                        priv->max_width = priv->uniform_width;
-                        priv->max_height = priv->uniform_height;
-                        priv->min_width = priv->uniform_width;
-                        priv->min_height = priv->uniform_height;
-                } else if (priv->uniform &&
-                            (priv->uniform_width != page_width ||
-                            priv->uniform_height != page_height)) {
-                        /* It's a different page size.  Backfill the array. */
-                        int j;
-
-                        priv->page_sizes = g_new0 (EvPageSize, priv->n_pages);
-
-                        for (j = 0; j < i; j++) {
-                                page_size = &(priv->page_sizes[j]);
-                                page_size->width = priv->uniform_width;
-                                page_size->height = priv->uniform_height;
-                        }
-                        priv->uniform = FALSE;
-                }
-                if (!priv->uniform) {
-                        page_size = &(priv->page_sizes[i]);
+                gdouble page_width, page_height;
+                gchar  *page_label;
 
-                        page_size->width = page_width;
-                        page_size->height = page_height;
+		ev_document_get_page_cache_data (document, i, &page_width, &page_height, &page_label);
+		g_rw_lock_writer_lock (&priv->cache_lock);
+		ev_document_cache_page (document, i, page_width, page_height, page_label);
+		g_rw_lock_writer_unlock (&priv->cache_lock);
+        }
 
-                        if (page_width > priv->max_width)
-                                priv->max_width = page_width;
-                        if (page_width < priv->min_width)
-                                priv->min_width = page_width;
+	g_rw_lock_writer_lock (&priv->cache_lock);
+	if (!priv->custom_page_labels)
+		g_clear_pointer (&priv->page_labels, g_strfreev);
+	g_rw_lock_writer_unlock (&priv->cache_lock);
 
-                        if (page_height > priv->max_height)
-                                priv->max_height = page_height;
-                        if (page_height < priv->min_height)
-                                priv->min_height = page_height;
-                }
+	ev_document_save_cache_file (document, FALSE);
+}
 
-                page_label = _ev_document_get_page_label (document, page);
-                if (page_label) {
-                        if (!priv->page_labels)
-                                priv->page_labels = g_new0 (gchar *, priv->n_pages + 1);
+/* Only the first page is cached while loading, its size is used for all
+ * the pages until the rest is cached with ev_document_fill_cache().
+ */
+static void
+ev_document_setup_lazy_cache (EvDocument *document)
+{
+	EvDocumentPrivate *priv = document->priv;
 
-                        if (!custom_page_labels) {
-                                gchar *real_page_label;
+	priv->cache_loaded = TRUE;
 
-                                real_page_label = g_strdup_printf ("%d", i + 1);
-                                custom_page_labels = g_strcmp0 (real_page_label, page_label) != 0;
-                                g_free (real_page_label);
-                        }
+	if (ev_document_load_cache_file (document)) {
+		priv->cache_complete = TRUE;
+		return;
+	}
 
-                        priv->page_labels[i] = page_label;
-                        priv->max_label = MAX (priv->max_label,
-                                                g_utf8_strlen (page_label, 256));
-                }
+	if (priv->n_pages > 0) {
+		gdouble page_width, page_height;
+		gchar  *page_label;
 
-                g_object_unref (page);
-        }
+		ev_document_get_page_cache_data (document, 0, &page_width, &page_height, &page_label);
+		g_rw_lock_writer_lock (&priv->cache_lock);
+		ev_document_cache_page (document, 0, page_width, page_height, page_label);
+		g_rw_lock_writer_unlock (&priv->cache_lock);
 
-	if (!custom_page_labels)
-		g_clear_pointer (&priv->page_labels, g_strfreev);
+		priv->cached_pages = g_new0 (gboolean, priv->n_pages);
+		priv->cached_pages[0] = TRUE;
+	}
+
+	priv->cache_complete = priv->n_cached_pages == priv->n_pages;
+	if (priv->cache_complete)
+		g_clear_pointer (&priv->cached_pages, g_free);
+}
+
+/**
+ * ev_document_is_cache_complete:
+ * @document: a #EvDocument
+ *
+ * Returns whether the sizes and labels of all the pages of @document are
+ * known. This is only %FALSE for documents loaded with
+ * %EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE until the cache is filled with
+ * ev_document_fill_cache() and ev_document_commit_cache().
+ *
+ * Returns: %TRUE if the cache of @document is complete
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_is_cache_complete (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), TRUE);
+
+	return !document->priv->cache_loaded || document->priv->cache_complete;
+}
+
+/**
+ * ev_document_fill_cache:
+ * @document: a #EvDocument
+ * @first_page: the index of the first page to cache
+ * @n_pages: the number of pages to cache
+ *
+ * Gets the sizes and labels of the given pages from the backend. They are
+ * not used until ev_document_commit_cache() is called from the main thread.
+ * This must be called with the document locked, and can be called from
+ * any thread.
+ *
+ * Since: 44.0
+ */
+void
+ev_document_fill_cache (EvDocument *document,
+			gint        first_page,
+			gint        n_pages)
+{
+	EvDocumentPrivate    *priv;
+	EvDocumentCacheBatch *batch;
+	gboolean              complete;
+	gint                  i;
+
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	priv = document->priv;
+	g_return_if_fail (first_page >= 0 && n_pages >= 0 && first_page + n_pages <= priv->n_pages);
+
+	g_rw_lock_reader_lock (&priv->cache_lock);
+	complete = priv->cache_complete;
+	g_rw_lock_reader_unlock (&priv->cache_lock);
+	if (complete || n_pages == 0)
+		return;
+
+	batch = g_new0 (EvDocumentCacheBatch, 1);
+	batch->first_page = first_page;
+	batch->n_pages = n_pages;
+	batch->sizes = g_new0 (EvPageSize, n_pages);
+	batch->labels = g_new0 (gchar *, n_pages);
+
+	for (i = 0; i < n_pages; i++) {
+		ev_document_get_page_cache_data (document, first_page + i,
+						 &batch->sizes[i].width,
+						 &batch->sizes[i].height,
+						 &batch->labels[i]);
+	}
+
+	g_mutex_lock (&priv->cache_mutex);
+	priv->cache_batches = g_list_append (priv->cache_batches, batch);
+	g_mutex_unlock (&priv->cache_mutex);
+}
+
+/**
+ * ev_document_commit_cache:
+ * @document: a #EvDocument
+ * @first_page: (out) (optional): return location for the first changed page
+ * @n_pages: (out) (optional): return location for the number of pages
+ *   from @first_page that may have changed
+ *
+ * Adds the pages fetched by ev_document_fill_cache() to the cache of
+ * @document. This must be called from the main thread.
+ *
+ * Returns: %TRUE if any page was added to the cache
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_commit_cache (EvDocument *document,
+			  gint       *first_page,
+			  gint       *n_pages)
+{
+	EvDocumentPrivate *priv;
+	GList             *batches, *l;
+	gint               first = G_MAXINT;
+	gint               last = -1;
+	gboolean           complete = FALSE;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	priv = document->priv;
+
+	g_mutex_lock (&priv->cache_mutex);
+	batches = g_steal_pointer (&priv->cache_batches);
+	g_mutex_unlock (&priv->cache_mutex);
+
+	/* All the batches are published at once, readers see either
+	 * none or all of them.
+	 */
+	g_rw_lock_writer_lock (&priv->cache_lock);
+	for (l = batches; l; l = g_list_next (l)) {
+		EvDocumentCacheBatch *batch = l->data;
+		gint                  i;
+
+		for (i = 0; i < batch->n_pages && !priv->cache_complete; i++) {
+			gint page = batch->first_page + i;
+
+			if (priv->cached_pages[page])
+				continue;
+
+			ev_document_cache_page (document, page,
+						batch->sizes[i].width,
+						batch->sizes[i].height,
+						g_steal_pointer (&batch->labels[i]));
+			priv->cached_pages[page] = TRUE;
+			first = MIN (first, page);
+			last = MAX (last, page);
+
+			/* Labels are kept even if they are not custom, they
+			 * may be in use by other threads.
+			 */
+			if (priv->n_cached_pages == priv->n_pages) {
+				priv->cache_complete = TRUE;
+				g_clear_pointer (&priv->cached_pages, g_free);
+				complete = TRUE;
+			}
+		}
+	}
+	g_rw_lock_writer_unlock (&priv->cache_lock);
+
+	if (complete)
+		ev_document_save_cache_file (document, TRUE);
+
+	g_list_free_full (batches, (GDestroyNotify) ev_document_cache_batch_free);
+
+	if (last == -1)
+		return FALSE;
+
+	if (first_page)
+		*first_page = first;
+	if (n_pages)
+		*n_pages = last - first + 1;
+
+	return TRUE;
 }
 
 static void
@@ -384,6 +1026,44 @@ ev_document_initialize_synctex (EvDocument  *document,
 	}
 }
 
+/* Stores the flags @document is being loaded with, for the backend to
+ * query them, and returns them with the ones implied by the others.
+ */
+static EvDocumentLoadFlags
+ev_document_set_load_flags (EvDocument         *document,
+			    EvDocumentLoadFlags flags)
+{
+	/* The cache is only useful for documents with all their pages shown */
+	if (flags & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE) {
+		flags |= EV_DOCUMENT_LOAD_FLAG_NO_CACHE;
+		flags &= ~EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE;
+	}
+
+	document->priv->load_flags = flags;
+
+	return flags;
+}
+
+/**
+ * ev_document_get_load_flags:
+ * @document: a #EvDocument
+ *
+ * Returns the flags @document was loaded with. Backends can call this
+ * from their load functions to skip the work that is not needed for the
+ * flags, e.g. with %EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE.
+ *
+ * Returns: flags from #EvDocumentLoadFlags
+ *
+ * Since: 44.0
+ */
+EvDocumentLoadFlags
+ev_document_get_load_flags (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), EV_DOCUMENT_LOAD_FLAG_NONE);
+
+	return document->priv->load_flags;
+}
+
 /**
  * ev_document_load_full:
  * @document: a #EvDocument
@@ -392,6 +1072,11 @@ ev_document_initialize_synctex (EvDocument  *document,
  * @error: a #GError location to store an error, or %NULL
  *
  * Loads @document from @uri.
+ * With %EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE, only what is needed to render
+ * the first page is loaded, e.g. for a thumbnail: the document
+ * information, the cache of page sizes and labels, and the synctex data
+ * are not. Backends that would have to scan the whole file to count the
+ * pages, like tiff, report a single page.
  * 
  * On failure, %FALSE is returned and @error is filled in.
  * If the document is encrypted, EV_DEFINE_ERROR_ENCRYPTED is returned.
@@ -412,6 +1097,7 @@ ev_document_load_full (EvDocument           *document,
 	gboolean retval;
 	GError *err = NULL;
 
+	flags = ev_document_set_load_flags (document, flags);
 	retval = klass->load (document, uri, &err);
 	if (!retval) {
 		if (err) {
@@ -427,11 +1113,18 @@ ev_document_load_full (EvDocument           *document,
 					     "Internal error in backend");
 		}
 	} else {
-		document->priv->info = _ev_document_get_info (document);
 		document->priv->n_pages = _ev_document_get_n_pages (document);
+		document->priv->uri = g_strdup (uri);
+		if (flags & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE)
+			return retval;
+
+		document->priv->info = _ev_document_get_info (document);
 		if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
+			ev_document_init_cache_file (document, uri);
+		if (flags & EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE)
+			ev_document_setup_lazy_cache (document);
+		else if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
 			ev_document_setup_cache (document);
-		document->priv->uri = g_strdup (uri);
 		document->priv->file_size = _ev_document_get_size (uri);
 		ev_document_initialize_synctex (document, uri);
         }
@@ -466,6 +1159,58 @@ ev_document_load (EvDocument  *document,
 				      EV_DOCUMENT_LOAD_FLAG_NONE, error);
 }
 
+/* Loads the document from @stream; @uri, if not %NULL, is the file the
+ * contents of @stream come from.
+ */
+static gboolean
+ev_document_load_stream_for_uri (EvDocument         *document,
+				 GInputStream       *stream,
+				 const gchar        *uri,
+				 EvDocumentLoadFlags flags,
+				 GCancellable       *cancellable,
+				 GError            **error)
+{
+        EvDocumentClass *klass;
+
+        klass = EV_DOCUMENT_GET_CLASS (document);
+        if (!klass->load_stream) {
+                g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                                     "Backend does not support loading from stream");
+                return FALSE;
+        }
+
+        flags = ev_document_set_load_flags (document, flags);
+        if (!klass->load_stream (document, stream, flags, cancellable, error))
+                return FALSE;
+
+	document->priv->n_pages = _ev_document_get_n_pages (document);
+	if (flags & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE) {
+		if (uri) {
+			g_free (document->priv->uri);
+			document->priv->uri = g_strdup (uri);
+		}
+		return TRUE;
+	}
+
+	document->priv->info = _ev_document_get_info (document);
+
+	if (uri && !(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
+		ev_document_init_cache_file (document, uri);
+        if (flags & EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE)
+                ev_document_setup_lazy_cache (document);
+        else if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
+                ev_document_setup_cache (document);
+
+	if (uri) {
+		g_free (document->priv->uri);
+		document->priv->uri = g_strdup (uri);
+		document->priv->file_size = _ev_document_get_size (uri);
+		ev_document_initialize_synctex (document, uri);
+	}
+
+        return TRUE;
+}
+
 /**
  * ev_document_load_stream:
  * @document: a #EvDocument
@@ -488,30 +1233,109 @@ ev_document_load_stream (EvDocument         *document,
                          GCancellable       *cancellable,
                          GError            **error)
 {
-        EvDocumentClass *klass;
-
         g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
         g_return_val_if_fail (G_IS_INPUT_STREAM (stream), FALSE);
         g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
         g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-        klass = EV_DOCUMENT_GET_CLASS (document);
-        if (!klass->load_stream) {
-                g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
-                                     "Backend does not support loading from stream");
-                return FALSE;
-        }
+        return ev_document_load_stream_for_uri (document, stream, NULL, flags,
+                                                cancellable, error);
+}
 
-        if (!klass->load_stream (document, stream, flags, cancellable, error))
-                return FALSE;
+static void
+free_uncompressed_uri (gchar *uri_unc)
+{
+	if (!uri_unc)
+		return;
 
-	document->priv->info = _ev_document_get_info (document);
-	document->priv->n_pages = _ev_document_get_n_pages (document);
+	ev_tmp_uri_unlink (uri_unc);
+	g_free (uri_unc);
+}
 
-        if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
-                ev_document_setup_cache (document);
+/**
+ * ev_document_load_compressed:
+ * @document: a #EvDocument
+ * @uri: the URI of the compressed document
+ * @compression: the compression type of the document
+ * @flags: flags from #EvDocumentLoadFlags
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: (allow-none): a #GError location to store an error, or %NULL
+ *
+ * Loads @document from the file at @uri compressed with @compression.
+ * If the backend can load documents from streams, the file is decompressed
+ * while the backend reads it, and the decompressed contents are kept in
+ * memory up to 64 MiB, then in a temporary file, see
+ * ev_byte_source_new_for_stream(). Otherwise, as for the PostScript and
+ * DVI backends, it is decompressed to a temporary file first, which is
+ * removed when @document is finalized.
+ * If @compression is %EV_COMPRESSION_NONE, this is the same as
+ * ev_document_load_full().
+ * See ev_document_load() for more information.
+ *
+ * Returns: %TRUE on success, or %FALSE on failure.
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_load_compressed (EvDocument         *document,
+			     const char         *uri,
+			     EvCompressionType   compression,
+			     EvDocumentLoadFlags flags,
+			     GCancellable       *cancellable,
+			     GError            **error)
+{
+	EvDocumentClass *klass;
+	const gchar     *uri_unc;
+	GInputStream    *stream;
+	GInputStream    *source_stream;
+	EvByteSource    *source;
+	gboolean         retval;
 
-        return TRUE;
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+	g_return_val_if_fail (uri != NULL, FALSE);
+
+	g_object_set_data (G_OBJECT (document), "compression",
+			   GINT_TO_POINTER (compression));
+
+	if (compression == EV_COMPRESSION_NONE)
+		return ev_document_load_full (document, uri, flags, error);
+
+	klass = EV_DOCUMENT_GET_CLASS (document);
+	uri_unc = g_object_get_data (G_OBJECT (document), "uri-uncompressed");
+	if (uri_unc || !klass->load_stream) {
+		if (!uri_unc) {
+			gchar *tmp_uri;
+
+			tmp_uri = ev_file_uncompress (uri, compression, error);
+			if (!tmp_uri)
+				return FALSE;
+
+			g_object_set_data_full (G_OBJECT (document),
+						"uri-uncompressed",
+						tmp_uri,
+						(GDestroyNotify) free_uncompressed_uri);
+			uri_unc = tmp_uri;
+		}
+
+		return ev_document_load_full (document, uri_unc, flags, error);
+	}
+
+	stream = ev_file_uncompress_stream (uri, compression, cancellable, error);
+	if (!stream)
+		return FALSE;
+
+	/* Decompressed streams can't seek, the byte source keeps what has
+	 * been read so that the backend can go back to it.
+	 */
+	source = ev_byte_source_new_for_stream (stream, -1);
+	source_stream = ev_byte_source_get_stream (source);
+	retval = ev_document_load_stream_for_uri (document, source_stream, uri,
+						  flags, cancellable, error);
+	g_object_unref (source_stream);
+	g_object_unref (source);
+	g_object_unref (stream);
+
+	return retval;
 }
 
 /**
@@ -550,13 +1374,21 @@ ev_document_load_gfile (EvDocument         *document,
                 return FALSE;
         }
 
+        flags = ev_document_set_load_flags (document, flags);
         if (!klass->load_gfile (document, file, flags, cancellable, error))
                 return FALSE;
 
-	document->priv->info = _ev_document_get_info (document);
 	document->priv->n_pages = _ev_document_get_n_pages (document);
+	if (flags & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE) {
+		document->priv->uri = g_file_get_uri (file);
+		return TRUE;
+	}
+
+	document->priv->info = _ev_document_get_info (document);
 
-        if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
+        if (flags & EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE)
+                ev_document_setup_lazy_cache (document);
+        else if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
                 ev_document_setup_cache (document);
 
 	document->priv->uri = g_file_get_uri (file);
@@ -640,13 +1472,19 @@ ev_document_load_fd (EvDocument         *document,
                 return FALSE;
         }
 
+        flags = ev_document_set_load_flags (document, flags);
         if (!klass->load_fd (document, fd, flags, cancellable, error))
                 return FALSE;
 
-        document->priv->info = _ev_document_get_info (document);
         document->priv->n_pages = _ev_document_get_n_pages (document);
+        if (flags & EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE)
+                return TRUE;
 
-        if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
+        document->priv->info = _ev_document_get_info (document);
+
+        if (flags & EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE)
+                ev_document_setup_lazy_cache (document);
+        else if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
                 ev_document_setup_cache (document);
 
         return TRUE;
@@ -881,6 +1719,7 @@ ev_document_get_page_size (EvDocument *document,
 	priv = document->priv;
 
 	if (priv->cache_loaded) {
+		g_rw_lock_reader_lock (&priv->cache_lock);
 		if (width)
 			*width = priv->uniform ?
 				priv->uniform_width :
@@ -889,14 +1728,15 @@ ev_document_get_page_size (EvDocument *document,
 			*height = priv->uniform ?
 				priv->uniform_height :
 				priv->page_sizes[page_index].height;
+		g_rw_lock_reader_unlock (&priv->cache_lock);
 	} else {
 		EvPage *page;
 
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		page = ev_document_get_page (document, page_index);
 		_ev_document_get_page_size (document, page, width, height);
 		g_object_unref (page);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 }
 
@@ -914,25 +1754,30 @@ gchar *
 ev_document_get_page_label (EvDocument *document,
 			    gint        page_index)
 {
+	gchar *page_label;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
 	g_return_val_if_fail (page_index >= 0 || page_index < document->priv->n_pages, NULL);
 
 	if (!document->priv->cache_loaded) {
 		EvPage *page;
-		gchar *page_label;
 
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		page = ev_document_get_page (document, page_index);
 		page_label = _ev_document_get_page_label (document, page);
 		g_object_unref (page);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 
 		return page_label ? page_label : g_strdup_printf ("%d", page_index + 1);
 	}
 
-	return (document->priv->page_labels && document->priv->page_labels[page_index]) ?
+	g_rw_lock_reader_lock (&document->priv->cache_lock);
+	page_label = (document->priv->page_labels && document->priv->page_labels[page_index]) ?
 		g_strdup (document->priv->page_labels[page_index]) :
 		g_strdup_printf ("%d", page_index + 1);
+	g_rw_lock_reader_unlock (&document->priv->cache_lock);
+
+	return page_label;
 }
 
 static EvDocumentInfo *
@@ -947,9 +1792,10 @@ _ev_document_get_info (EvDocument *document)
  * ev_document_get_info:
  * @document: a #EvDocument
  *
- * Returns the #EvDocumentInfo for the document.
+ * Returns the #EvDocumentInfo for the document. There is no information
+ * for documents loaded with %EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE.
  *
- * Returns: (transfer none): a #EvDocumentInfo
+ * Returns: (transfer none) (nullable): a #EvDocumentInfo
  */
 EvDocumentInfo *
 ev_document_get_info (EvDocument *document)
@@ -982,6 +1828,30 @@ ev_document_render (EvDocument      *document,
 	return klass->render (document, rc);
 }
 
+/**
+ * ev_document_supports_render_area:
+ * @document: an #EvDocument
+ *
+ * Whether the backend of @document renders only the area of the page set
+ * with ev_render_context_set_area(). Other backends render the whole page,
+ * so rendering a page in several areas costs as many full renders.
+ *
+ * Returns: %TRUE if render areas are honoured
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_document_supports_render_area (EvDocument *document)
+{
+	EvDocumentClass *klass;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	klass = EV_DOCUMENT_GET_CLASS (document);
+
+	return klass->supports_render_area ? klass->supports_render_area (document) : FALSE;
+}
+
 static GdkPixbuf *
 _ev_document_get_thumbnail (EvDocument      *document,
 			    EvRenderContext *rc)
@@ -1047,11 +1917,36 @@ ev_document_get_uri (EvDocument *document)
 	return document->priv->uri;
 }
 
+/**
+ * ev_document_get_cache_key:
+ * @document: a #EvDocument
+ *
+ * Returns the key identifying the contents of the file @document was
+ * loaded from, as returned by ev_file_get_cache_key() while loading it.
+ * Data derived from @document can be saved along with the key and reused
+ * while the key does not change. There is no key for documents loaded
+ * with %EV_DOCUMENT_LOAD_FLAG_NO_CACHE or not loaded from an URI.
+ *
+ * Returns: (nullable): the cache key of @document, or %NULL
+ *
+ * Since: 44.0
+ */
+const gchar *
+ev_document_get_cache_key (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
+
+	return document->priv->cache_key;
+}
+
 const gchar *
 ev_document_get_title (EvDocument *document)
 {
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
 
+	if (!document->priv->info)
+		return NULL;
+
 	return (document->priv->info->fields_mask & EV_DOCUMENT_INFO_TITLE) ?
 		document->priv->info->title : NULL;
 }
@@ -1059,15 +1954,21 @@ ev_document_get_title (EvDocument *document)
 gboolean
 ev_document_is_page_size_uniform (EvDocument *document)
 {
+	gboolean uniform;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), TRUE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return document->priv->uniform;
+	g_rw_lock_reader_lock (&document->priv->cache_lock);
+	uniform = document->priv->uniform;
+	g_rw_lock_reader_unlock (&document->priv->cache_lock);
+
+	return uniform;
 }
 
 void
@@ -1078,15 +1979,17 @@ ev_document_get_max_page_size (EvDocument *document,
 	g_return_if_fail (EV_IS_DOCUMENT (document));
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
+	g_rw_lock_reader_lock (&document->priv->cache_lock);
 	if (width)
 		*width = document->priv->max_width;
 	if (height)
 		*height = document->priv->max_height;
+	g_rw_lock_reader_unlock (&document->priv->cache_lock);
 }
 
 void
@@ -1097,29 +2000,37 @@ ev_document_get_min_page_size (EvDocument *document,
 	g_return_if_fail (EV_IS_DOCUMENT (document));
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
+	g_rw_lock_reader_lock (&document->priv->cache_lock);
 	if (width)
 		*width = document->priv->min_width;
 	if (height)
 		*height = document->priv->min_height;
+	g_rw_lock_reader_unlock (&document->priv->cache_lock);
 }
 
 gboolean
 ev_document_check_dimensions (EvDocument *document)
 {
+	gboolean retval;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return (document->priv->max_width > 0 && document->priv->max_height > 0);
+	g_rw_lock_reader_lock (&document->priv->cache_lock);
+	retval = (document->priv->max_width > 0 && document->priv->max_height > 0);
+	g_rw_lock_reader_unlock (&document->priv->cache_lock);
+
+	return retval;
 }
 
 guint64
@@ -1133,29 +2044,41 @@ ev_document_get_size (EvDocument *document)
 gint
 ev_document_get_max_label_len (EvDocument *document)
 {
+	gint max_label;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), -1);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return document->priv->max_label;
+	g_rw_lock_reader_lock (&document->priv->cache_lock);
+	max_label = document->priv->max_label;
+	g_rw_lock_reader_unlock (&document->priv->cache_lock);
+
+	return max_label;
 }
 
 gboolean
 ev_document_has_text_page_labels (EvDocument *document)
 {
+	gboolean custom_page_labels;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
-	return document->priv->page_labels != NULL;
+	g_rw_lock_reader_lock (&document->priv->cache_lock);
+	custom_page_labels = document->priv->custom_page_labels;
+	g_rw_lock_reader_unlock (&document->priv->cache_lock);
+
+	return custom_page_labels;
 }
 
 gboolean
@@ -1173,16 +2096,19 @@ ev_document_find_page_by_label (EvDocument  *document,
 	g_return_val_if_fail (page_index != NULL, FALSE);
 
 	if (!document->priv->cache_loaded) {
-		g_mutex_lock (&ev_doc_mutex);
+		ev_document_lock (document);
 		ev_document_setup_cache (document);
-		g_mutex_unlock (&ev_doc_mutex);
+		ev_document_unlock (document);
 	}
 
+	g_rw_lock_reader_lock (&priv->cache_lock);
+
         /* First, look for a literal label match */
 	for (i = 0; priv->page_labels && i < priv->n_pages; i ++) {
 		if (priv->page_labels[i] != NULL &&
 		    ! strcmp (page_label, priv->page_labels[i])) {
 			*page_index = i;
+			g_rw_lock_reader_unlock (&priv->cache_lock);
 			return TRUE;
 		}
 	}
@@ -1192,10 +2118,13 @@ ev_document_find_page_by_label (EvDocument  *document,
 		if (priv->page_labels[i] != NULL &&
 		    ! strcasecmp (page_label, priv->page_labels[i])) {
 			*page_index = i;
+			g_rw_lock_reader_unlock (&priv->cache_lock);
 			return TRUE;
 		}
 	}
 
+	g_rw_lock_reader_unlock (&priv->cache_lock);
+
 	/* Next, parse the label, and see if the number fits */
 	value = strtol (page_label, &endptr, 10);
 	if (endptr[0] == '\0') {
@@ -31,6 +31,7 @@
 
 #include "ev-macros.h"
 #include "ev-document-info.h"
+#include "ev-file-helpers.h"
 #include "ev-page.h"
 #include "ev-render-context.h"
 
@@ -52,8 +53,10 @@ typedef struct _EvDocumentPrivate EvDocumentPrivate;
 #define EV_DOC_MUTEX_UNLOCK (ev_document_doc_mutex_unlock ())
 
 typedef enum /*< flags >*/ {
-        EV_DOCUMENT_LOAD_FLAG_NONE = 0,
-        EV_DOCUMENT_LOAD_FLAG_NO_CACHE
+        EV_DOCUMENT_LOAD_FLAG_NONE       = 0,
+        EV_DOCUMENT_LOAD_FLAG_NO_CACHE   = 1 << 0,
+        EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE = 1 << 1,
+        EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE = 1 << 2
 } EvDocumentLoadFlags;
 
 typedef enum
@@ -134,6 +137,8 @@ struct _EvDocumentClass
 						     EvDocumentLoadFlags  flags,
 						     GCancellable        *cancellable,
 						     GError             **error);
+        gboolean          (* is_render_thread_safe) (EvDocument          *document);
+        gboolean          (* supports_render_area)  (EvDocument          *document);
 };
 
 EV_PUBLIC
@@ -141,11 +146,22 @@ GType            ev_document_get_type             (void) G_GNUC_CONST;
 EV_PUBLIC
 GQuark           ev_document_error_quark          (void);
 
-/* Document mutex */
+/* Document lock */
+EV_PUBLIC
+void             ev_document_lock                 (EvDocument      *document);
+EV_PUBLIC
+void             ev_document_unlock               (EvDocument      *document);
+EV_PUBLIC
+gboolean         ev_document_trylock              (EvDocument      *document);
+
+/* Global document mutex, locks all documents */
+EV_DEPRECATED_FOR(ev_document_lock)
 EV_PUBLIC
 void             ev_document_doc_mutex_lock       (void);
+EV_DEPRECATED_FOR(ev_document_unlock)
 EV_PUBLIC
 void             ev_document_doc_mutex_unlock     (void);
+EV_DEPRECATED_FOR(ev_document_trylock)
 EV_PUBLIC
 gboolean         ev_document_doc_mutex_trylock    (void);
 
@@ -156,6 +172,8 @@ EV_PUBLIC
 void             ev_document_fc_mutex_unlock      (void);
 EV_PUBLIC
 gboolean         ev_document_fc_mutex_trylock     (void);
+EV_PUBLIC
+gboolean         ev_document_is_render_thread_safe (EvDocument    *document);
 
 EV_PUBLIC
 EvDocumentInfo  *ev_document_get_info             (EvDocument      *document);
@@ -183,6 +201,13 @@ gboolean         ev_document_load_stream          (EvDocument         *document,
                                                    GCancellable       *cancellable,
                                                    GError            **error);
 EV_PUBLIC
+gboolean         ev_document_load_compressed      (EvDocument         *document,
+						   const char         *uri,
+						   EvCompressionType   compression,
+						   EvDocumentLoadFlags flags,
+						   GCancellable       *cancellable,
+						   GError            **error);
+EV_PUBLIC
 gboolean         ev_document_load_gfile           (EvDocument         *document,
                                                    GFile              *file,
                                                    EvDocumentLoadFlags flags,
@@ -195,6 +220,8 @@ gboolean         ev_document_load_fd              (EvDocument         *document,
                                                    GCancellable       *cancellable,
                                                    GError            **error);
 EV_PUBLIC
+EvDocumentLoadFlags ev_document_get_load_flags    (EvDocument      *document);
+EV_PUBLIC
 gboolean         ev_document_save                 (EvDocument      *document,
 						   const char      *uri,
 						   GError         **error);
@@ -215,6 +242,8 @@ EV_PUBLIC
 cairo_surface_t *ev_document_render               (EvDocument      *document,
 						   EvRenderContext *rc);
 EV_PUBLIC
+gboolean         ev_document_supports_render_area (EvDocument      *document);
+EV_PUBLIC
 GdkPixbuf       *ev_document_get_thumbnail        (EvDocument      *document,
 						   EvRenderContext *rc);
 EV_PUBLIC
@@ -225,6 +254,8 @@ guint64          ev_document_get_size             (EvDocument      *document);
 EV_PUBLIC
 const gchar     *ev_document_get_uri              (EvDocument      *document);
 EV_PUBLIC
+const gchar     *ev_document_get_cache_key        (EvDocument      *document);
+EV_PUBLIC
 const gchar     *ev_document_get_title            (EvDocument      *document);
 EV_PUBLIC
 gboolean         ev_document_is_page_size_uniform (EvDocument      *document);
@@ -243,6 +274,16 @@ gint             ev_document_get_max_label_len    (EvDocument      *document);
 EV_PUBLIC
 gboolean         ev_document_has_text_page_labels (EvDocument      *document);
 EV_PUBLIC
+gboolean         ev_document_is_cache_complete    (EvDocument      *document);
+EV_PUBLIC
+void             ev_document_fill_cache           (EvDocument      *document,
+						   gint             first_page,
+						   gint             n_pages);
+EV_PUBLIC
+gboolean         ev_document_commit_cache         (EvDocument      *document,
+						   gint            *first_page,
+						   gint            *n_pages);
+EV_PUBLIC
 gboolean         ev_document_find_page_by_label   (EvDocument      *document,
 						   const gchar     *page_label,
 						   gint            *page_index);
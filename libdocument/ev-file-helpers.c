@@ -93,7 +93,10 @@ _ev_dir_ensure_exists (const gchar *dir,
 static const char *
 _ev_tmp_dir (GError **error)
 {
+        /* Temp files can be created from several threads at once */
+        static GMutex tmp_dir_mutex;
 
+        g_mutex_lock (&tmp_dir_mutex);
         if (tmp_dir == NULL) {
                 gchar *dirname;
                 const gchar *prgname;
@@ -103,6 +106,7 @@ _ev_tmp_dir (GError **error)
                 tmp_dir = g_build_filename (g_get_tmp_dir (), dirname, NULL);
                 g_free (dirname);
         }
+        g_mutex_unlock (&tmp_dir_mutex);
 
         if (!_ev_dir_ensure_exists (tmp_dir, 0700, error))
                 return NULL;
@@ -577,6 +581,179 @@ ev_file_get_mime_type_from_fd (int      fd,
         return mime_type;
 }
 
+/* The beginning of the file is part of the key, so that a file
+ * rewritten with the same size and modification time is noticed
+ */
+#define CACHE_KEY_CONTENTS_SIZE 65536
+
+/**
+ * ev_file_get_cache_key:
+ * @uri: the URI of a file
+ *
+ * Returns a string identifying the current contents of the file at @uri,
+ * made of its URI, size, modification time and a checksum of its first
+ * bytes. Data derived from the file and saved in the user cache dir can
+ * be saved along with the key, and is still valid while the key of the
+ * file does not change. This does file I/O.
+ *
+ * Temporary files, like the copies of compressed or remote documents,
+ * get another name every time, so their key is made of their size and
+ * a checksum of their first and last bytes only.
+ *
+ * Returns: (transfer full) (nullable): a newly allocated string, or %NULL
+ *   if the file cannot be read
+ *
+ * Since: 44.0
+ */
+gchar *
+ev_file_get_cache_key (const gchar *uri)
+{
+	GFile            *file;
+	GFileInfo        *info;
+	GFileInputStream *stream;
+	gchar            *checksum = NULL;
+	gchar            *tail_checksum = NULL;
+	gboolean          is_temp;
+	gchar            *key;
+
+	g_return_val_if_fail (uri != NULL, NULL);
+
+	file = g_file_new_for_uri (uri);
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if (!info) {
+		g_object_unref (file);
+		return NULL;
+	}
+
+	is_temp = ev_file_is_temp (file);
+
+	stream = g_file_read (file, NULL, NULL);
+	if (stream) {
+		guchar *buffer = g_malloc (CACHE_KEY_CONTENTS_SIZE);
+		gsize   n_read = 0;
+
+		if (g_input_stream_read_all (G_INPUT_STREAM (stream), buffer,
+					     CACHE_KEY_CONTENTS_SIZE, &n_read, NULL, NULL))
+			checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer, n_read);
+
+		if (is_temp &&
+		    g_file_info_get_size (info) > CACHE_KEY_CONTENTS_SIZE &&
+		    g_seekable_seek (G_SEEKABLE (stream), -CACHE_KEY_CONTENTS_SIZE,
+				     G_SEEK_END, NULL, NULL) &&
+		    g_input_stream_read_all (G_INPUT_STREAM (stream), buffer,
+					     CACHE_KEY_CONTENTS_SIZE, &n_read, NULL, NULL))
+			tail_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buffer, n_read);
+		g_free (buffer);
+		g_object_unref (stream);
+	}
+
+	if (is_temp) {
+		key = g_strdup_printf ("%" G_GOFFSET_FORMAT " %s %s",
+				       g_file_info_get_size (info),
+				       checksum ? checksum : "",
+				       tail_checksum ? tail_checksum : "");
+	} else {
+		key = g_strdup_printf ("%s %" G_GOFFSET_FORMAT " %" G_GUINT64_FORMAT ".%06u %s",
+				       uri,
+				       g_file_info_get_size (info),
+				       g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+				       g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC),
+				       checksum ? checksum : "");
+	}
+	g_free (checksum);
+	g_free (tail_checksum);
+	g_object_unref (info);
+	g_object_unref (file);
+
+	return key;
+}
+
+typedef struct {
+	gchar  *filename;
+	goffset size;
+	gint64  mtime;
+} CacheFile;
+
+static gint
+cache_file_compare_mtime (gconstpointer a,
+			  gconstpointer b)
+{
+	const CacheFile *file_a = a;
+	const CacheFile *file_b = b;
+
+	if (file_a->mtime != file_b->mtime)
+		return file_a->mtime < file_b->mtime ? -1 : 1;
+	return 0;
+}
+
+/**
+ * ev_file_prune_cache_dir:
+ * @path: the path of a directory in the user cache dir
+ * @max_size: the maximum total size of the files in @path, in bytes
+ * @max_age: the maximum time since the files in @path were last modified
+ *
+ * Deletes the files in @path that were last modified more than @max_age
+ * ago and then, while the rest is larger than @max_size, the least
+ * recently modified ones. Caches can update the modification time of a
+ * file when they use it, so that it is kept longer. This does file I/O.
+ *
+ * Since: 44.0
+ */
+void
+ev_file_prune_cache_dir (const gchar *path,
+			 goffset      max_size,
+			 GTimeSpan    max_age)
+{
+	GDir        *dir;
+	GArray      *files;
+	const gchar *name;
+	goffset      total_size = 0;
+	gint64       now;
+	guint        i;
+
+	g_return_if_fail (path != NULL);
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir)
+		return;
+
+	files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+	while ((name = g_dir_read_name (dir))) {
+		CacheFile file;
+		GStatBuf  buf;
+
+		file.filename = g_build_filename (path, name, NULL);
+		if (g_stat (file.filename, &buf) != 0 || !S_ISREG (buf.st_mode)) {
+			g_free (file.filename);
+			continue;
+		}
+
+		file.size = buf.st_size;
+		file.mtime = buf.st_mtime;
+		total_size += file.size;
+		g_array_append_val (files, file);
+	}
+	g_dir_close (dir);
+
+	g_array_sort (files, cache_file_compare_mtime);
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+	for (i = 0; i < files->len; i++) {
+		CacheFile *file = &g_array_index (files, CacheFile, i);
+
+		if ((total_size > max_size ||
+		     now - file->mtime > max_age / G_USEC_PER_SEC) &&
+		    g_unlink (file->filename) == 0)
+			total_size -= file->size;
+		g_free (file->filename);
+	}
+	g_array_free (files, TRUE);
+}
+
 /* Compressed files support */
 
 static const char *compressor_cmds[] = {
@@ -703,6 +880,232 @@ compression_run (const gchar       *uri,
 	return uri_dst;
 }
 
+/* Stream reading the output of a decompression command. The exit status
+ * of the command is checked at the end of the output, so that truncated
+ * or corrupted files are reported as read errors instead of being taken
+ * for shorter documents.
+ */
+#define EV_TYPE_SUBPROCESS_INPUT_STREAM (ev_subprocess_input_stream_get_type ())
+G_DECLARE_FINAL_TYPE (EvSubprocessInputStream, ev_subprocess_input_stream, EV, SUBPROCESS_INPUT_STREAM, GFilterInputStream)
+
+struct _EvSubprocessInputStream {
+	GFilterInputStream parent_instance;
+
+	GSubprocess *subprocess;
+	gchar       *command;
+	gboolean     exited;
+};
+
+G_DEFINE_TYPE (EvSubprocessInputStream, ev_subprocess_input_stream, G_TYPE_FILTER_INPUT_STREAM)
+
+static void
+ev_subprocess_input_stream_finalize (GObject *object)
+{
+	EvSubprocessInputStream *stream = EV_SUBPROCESS_INPUT_STREAM (object);
+
+	g_object_unref (stream->subprocess);
+	g_free (stream->command);
+
+	G_OBJECT_CLASS (ev_subprocess_input_stream_parent_class)->finalize (object);
+}
+
+static gssize
+ev_subprocess_input_stream_read (GInputStream  *input_stream,
+				 void          *buffer,
+				 gsize          count,
+				 GCancellable  *cancellable,
+				 GError       **error)
+{
+	EvSubprocessInputStream *stream = EV_SUBPROCESS_INPUT_STREAM (input_stream);
+	gssize                   n_read;
+
+	n_read = g_input_stream_read (g_filter_input_stream_get_base_stream (G_FILTER_INPUT_STREAM (stream)),
+				      buffer, count, cancellable, error);
+	if (n_read != 0 || stream->exited)
+		return n_read;
+
+	stream->exited = TRUE;
+	if (!g_subprocess_wait_check (stream->subprocess, cancellable, error)) {
+		g_prefix_error (error, "Failed to decompress with \"%s\": ", stream->command);
+		return -1;
+	}
+
+	return 0;
+}
+
+static gboolean
+ev_subprocess_input_stream_close (GInputStream  *input_stream,
+				  GCancellable  *cancellable,
+				  GError       **error)
+{
+	EvSubprocessInputStream *stream = EV_SUBPROCESS_INPUT_STREAM (input_stream);
+
+	/* Don't leave the command running when the output is not read
+	 * to the end */
+	if (!stream->exited) {
+		g_subprocess_force_exit (stream->subprocess);
+		stream->exited = TRUE;
+	}
+
+	return G_INPUT_STREAM_CLASS (ev_subprocess_input_stream_parent_class)->close_fn (input_stream,
+											 cancellable,
+											 error);
+}
+
+static void
+ev_subprocess_input_stream_class_init (EvSubprocessInputStreamClass *klass)
+{
+	GObjectClass      *g_object_class = G_OBJECT_CLASS (klass);
+	GInputStreamClass *input_stream_class = G_INPUT_STREAM_CLASS (klass);
+
+	g_object_class->finalize = ev_subprocess_input_stream_finalize;
+	input_stream_class->read_fn = ev_subprocess_input_stream_read;
+	input_stream_class->close_fn = ev_subprocess_input_stream_close;
+}
+
+static void
+ev_subprocess_input_stream_init (EvSubprocessInputStream *stream)
+{
+}
+
+static GInputStream *
+ev_subprocess_input_stream_new (GSubprocess *subprocess,
+				const gchar *command)
+{
+	EvSubprocessInputStream *stream;
+
+	stream = g_object_new (EV_TYPE_SUBPROCESS_INPUT_STREAM,
+			       "base-stream", g_subprocess_get_stdout_pipe (subprocess),
+			       NULL);
+	stream->subprocess = g_object_ref (subprocess);
+	stream->command = g_strdup (command);
+
+	return G_INPUT_STREAM (stream);
+}
+
+/**
+ * ev_file_uncompress_stream:
+ * @uri: a file URI
+ * @type: the compression type
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Opens a stream with the decompressed contents of the file at @uri.
+ *
+ * Gzip files are decompressed in process while the stream is read.
+ * Bzip2 and xz files are decompressed by the bzip2 and xz commands,
+ * whose output is read directly, without writing it to a temporary
+ * file first; their memory use is the one of those commands.
+ * Reading the end of the stream fails if the command failed.
+ *
+ * Returns: (transfer full): a new #GInputStream, or %NULL on error
+ *
+ * Since: 44.0
+ */
+GInputStream *
+ev_file_uncompress_stream (const gchar       *uri,
+			   EvCompressionType  type,
+			   GCancellable      *cancellable,
+			   GError           **error)
+{
+	GInputStream *stream;
+	GSubprocess  *subprocess;
+	gchar        *filename;
+	gchar        *cmd;
+
+	g_return_val_if_fail (uri != NULL, NULL);
+	g_return_val_if_fail (type != EV_COMPRESSION_NONE, NULL);
+
+	if (type == EV_COMPRESSION_GZIP) {
+		GFile             *file;
+		GFileInputStream  *file_stream;
+		GZlibDecompressor *decompressor;
+
+		file = g_file_new_for_uri (uri);
+		file_stream = g_file_read (file, cancellable, error);
+		g_object_unref (file);
+		if (!file_stream)
+			return NULL;
+
+		decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+		stream = g_converter_input_stream_new (G_INPUT_STREAM (file_stream),
+						       G_CONVERTER (decompressor));
+		g_object_unref (decompressor);
+		g_object_unref (file_stream);
+
+		return stream;
+	}
+
+	cmd = g_find_program_in_path (compressor_cmds[type]);
+	if (!cmd) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+			     "Failed to find the \"%s\" command in the search path.",
+			     compressor_cmds[type]);
+		return NULL;
+	}
+
+	filename = g_filename_from_uri (uri, NULL, error);
+	if (!filename) {
+		g_free (cmd);
+		return NULL;
+	}
+
+	subprocess = g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE |
+				       G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+				       error,
+				       cmd, "-cd", filename, NULL);
+	g_free (cmd);
+	g_free (filename);
+	if (!subprocess)
+		return NULL;
+
+	stream = ev_subprocess_input_stream_new (subprocess, compressor_cmds[type]);
+	g_object_unref (subprocess);
+
+	return stream;
+}
+
+static gchar *
+uncompress_to_tmp_file (const gchar       *uri,
+			EvCompressionType  type,
+			GError           **error)
+{
+	GInputStream      *stream;
+	GFileOutputStream *output;
+	GFile             *file;
+	gchar             *uri_dst = NULL;
+
+	if (type == EV_COMPRESSION_NONE)
+		return NULL;
+
+	stream = ev_file_uncompress_stream (uri, type, NULL, error);
+	if (!stream)
+		return NULL;
+
+	file = ev_mkstemp_file ("comp.XXXXXX", error);
+	if (!file) {
+		g_object_unref (stream);
+		return NULL;
+	}
+
+	output = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, error);
+	if (output &&
+	    g_output_stream_splice (G_OUTPUT_STREAM (output), stream,
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+				    G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+				    NULL, error) != -1) {
+		uri_dst = g_file_get_uri (file);
+	} else {
+		g_file_delete (file, NULL, NULL);
+	}
+
+	g_clear_object (&output);
+	g_object_unref (stream);
+	g_object_unref (file);
+
+	return uri_dst;
+}
+
 /**
  * ev_file_uncompress:
  * @uri: a file URI
@@ -728,7 +1131,7 @@ ev_file_uncompress (const gchar       *uri,
 {
 	g_return_val_if_fail (uri != NULL, NULL);
 
-	return compression_run (uri, type, FALSE, error);
+	return uncompress_to_tmp_file (uri, type, error);
 }
 
 /**
@@ -78,6 +78,18 @@ gchar       *ev_file_get_mime_type_from_fd (int           fd,
                                             GError      **error);
 
 EV_PUBLIC
+gchar       *ev_file_get_cache_key    (const gchar       *uri);
+EV_PUBLIC
+void         ev_file_prune_cache_dir  (const gchar       *path,
+				       goffset            max_size,
+				       GTimeSpan          max_age);
+
+EV_PUBLIC
+GInputStream *ev_file_uncompress_stream (const gchar       *uri,
+					 EvCompressionType  type,
+					 GCancellable      *cancellable,
+					 GError           **error);
+EV_PUBLIC
 gchar       *ev_file_uncompress       (const gchar       *uri,
 				       EvCompressionType  type,
 				       GError           **error);
@@ -113,6 +113,72 @@ ev_render_context_set_target_size (EvRenderContext *rc,
 	rc->target_height = target_height;
 }
 
+/**
+ * ev_render_context_set_area:
+ * @rc: an #EvRenderContext
+ * @x: x coordinate of the area
+ * @y: y coordinate of the area
+ * @width: width of the area, or 0 to render the whole page
+ * @height: height of the area, or 0 to render the whole page
+ *
+ * Restricts rendering to the given area of the page. Coordinates are in
+ * pixels of the rendered page, after scale and rotation have been applied.
+ * Backends honouring the area return a surface of @width x @height; other
+ * backends render the whole page, see ev_document_supports_render_area().
+ *
+ * Since: 44.0
+ */
+void
+ev_render_context_set_area (EvRenderContext *rc,
+			    int              x,
+			    int              y,
+			    int              width,
+			    int              height)
+{
+	g_return_if_fail (rc != NULL);
+
+	rc->area_x = x;
+	rc->area_y = y;
+	rc->area_width = width;
+	rc->area_height = height;
+}
+
+/**
+ * ev_render_context_get_area:
+ * @rc: an #EvRenderContext
+ * @x: (out) (optional): return location for the x coordinate
+ * @y: (out) (optional): return location for the y coordinate
+ * @width: (out) (optional): return location for the width
+ * @height: (out) (optional): return location for the height
+ *
+ * Returns: %TRUE if only an area of the page has to be rendered
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_render_context_get_area (EvRenderContext *rc,
+			    int             *x,
+			    int             *y,
+			    int             *width,
+			    int             *height)
+{
+	g_return_val_if_fail (rc != NULL, FALSE);
+
+	if (rc->area_width <= 0 || rc->area_height <= 0)
+		return FALSE;
+
+	if (x)
+		*x = rc->area_x;
+	if (y)
+		*y = rc->area_y;
+	if (width)
+		*width = rc->area_width;
+	if (height)
+		*height = rc->area_height;
+
+	return TRUE;
+}
+
 void
 ev_render_context_compute_scaled_size (EvRenderContext *rc,
 				       double		width_points,
@@ -52,6 +52,15 @@ struct _EvRenderContext
 	gdouble scale;
 	gint	target_width;
 	gint	target_height;
+
+	/* Area of the page to render, in transformed target size
+	 * coordinates. The whole page is rendered when area_width or
+	 * area_height are 0.
+	 */
+	gint	area_x;
+	gint	area_y;
+	gint	area_width;
+	gint	area_height;
 };
 
 
@@ -75,6 +84,18 @@ void             ev_render_context_set_target_size (EvRenderContext *rc,
                                                     int              target_width,
                                                     int              target_height);
 EV_PUBLIC
+void             ev_render_context_set_area        (EvRenderContext *rc,
+                                                    int              x,
+                                                    int              y,
+                                                    int              width,
+                                                    int              height);
+EV_PUBLIC
+gboolean         ev_render_context_get_area        (EvRenderContext *rc,
+                                                    int             *x,
+                                                    int             *y,
+                                                    int             *width,
+                                                    int             *height);
+EV_PUBLIC
 void             ev_render_context_compute_scaled_size      (EvRenderContext *rc,
                                                              double           width_points,
                                                              double           height_points,
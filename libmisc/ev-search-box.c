@@ -118,8 +118,8 @@ find_job_finished_cb (EvJobFind   *job,
 /**
  * find_bar_check_refresh_rate:
  *
- * Check whether the current page should trigger an status update in the
- * find bar given its document size and the rate page.
+ * Check whether the number of searched pages should trigger an status
+ * update in the find bar given its document size and the rate page.
  *
  * For documents with less pages than page_rate, it will return TRUE for
  * every page.  For documents with more pages, it will return TRUE every
@@ -130,13 +130,14 @@ find_job_finished_cb (EvJobFind   *job,
  */
 static inline gboolean
 find_check_refresh_rate (EvJobFind *job,
+                         guint      pages_searched,
                          gint       page_rate)
 {
         /* Always update if this is the last page of the search */
-        if ((job->current_page + 1) % job->n_pages == job->start_page)
+        if ((gint) pages_searched >= job->n_pages)
                 return TRUE;
 
-        return ((job->current_page % (gint)((job->n_pages / page_rate) + 1)) == 0);
+        return ((pages_searched % (guint)((job->n_pages / page_rate) + 1)) == 0);
 }
 
 static void
@@ -151,9 +152,12 @@ find_job_updated_cb (EvJobFind   *job,
         /* Adjust the status update when searching for a term according
          * to the document size in pages. For documents smaller (or equal)
          * than 100 pages, it will be updated in every page. A value of
-         * 100 is enough to update the find bar every 1%.
+         * 100 is enough to update the find bar every 1%. Pages with
+         * matches are always reported, so that the first ones show
+         * up as soon as they are found.
          */
-        if (find_check_refresh_rate (job, FIND_PAGE_RATE_REFRESH)) {
+        if (job->pages[page] ||
+            find_check_refresh_rate (job, priv->pages_searched, FIND_PAGE_RATE_REFRESH)) {
                 gboolean has_results = ev_job_find_has_results (job);
 
                 ev_search_box_update_progress (box);
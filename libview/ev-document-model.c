@@ -21,6 +21,9 @@
 #include "config.h"
 
 #include "ev-document-model.h"
+#include "ev-jobs.h"
+#include "ev-job-scheduler.h"
+#include "ev-reload-cache.h"
 #include "ev-view-type-builtins.h"
 #include "ev-view-marshal.h"
 
@@ -45,6 +48,8 @@ struct _EvDocumentModel
 
 	gdouble max_scale;
 	gdouble min_scale;
+
+	EvJob *page_sizes_job;
 };
 
 enum {
@@ -68,6 +73,7 @@ enum {
 enum
 {
 	PAGE_CHANGED,
+	PAGE_SIZES_CHANGED,
 	N_SIGNALS
 };
 
@@ -78,11 +84,24 @@ G_DEFINE_TYPE (EvDocumentModel, ev_document_model, G_TYPE_OBJECT)
 #define DEFAULT_MIN_SCALE 0.25
 #define DEFAULT_MAX_SCALE 5.0
 
+static void
+ev_document_model_clear_page_sizes_job (EvDocumentModel *model)
+{
+	if (!model->page_sizes_job)
+		return;
+
+	g_signal_handlers_disconnect_by_data (model->page_sizes_job, model);
+	ev_job_page_sizes_release (EV_JOB_PAGE_SIZES (model->page_sizes_job));
+	g_clear_object (&model->page_sizes_job);
+}
+
 static void
 ev_document_model_finalize (GObject *object)
 {
 	EvDocumentModel *model = EV_DOCUMENT_MODEL (object);
 
+	ev_document_model_clear_page_sizes_job (model);
+
 	if (model->document) {
 		g_object_unref (model->document);
 		model->document = NULL;
@@ -338,6 +357,28 @@ ev_document_model_class_init (EvDocumentModelClass *klass)
 			      ev_view_marshal_VOID__INT_INT,
 			      G_TYPE_NONE, 2,
 			      G_TYPE_INT, G_TYPE_INT);
+
+	/**
+	 * EvDocumentModel::page-sizes-changed:
+	 * @model: the #EvDocumentModel
+	 * @first_page: the first page whose size may have changed
+	 * @n_pages: the number of pages whose size may have changed
+	 *
+	 * Emitted when the sizes of pages of a document loaded with
+	 * %EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE become known. Until then,
+	 * the pages have the size of the first page.
+	 *
+	 * Since: 44.0
+	 */
+	signals [PAGE_SIZES_CHANGED] =
+		g_signal_new ("page-sizes-changed",
+			      EV_TYPE_DOCUMENT_MODEL,
+			      G_SIGNAL_RUN_LAST,
+			      0,
+			      NULL, NULL,
+			      ev_view_marshal_VOID__INT_INT,
+			      G_TYPE_NONE, 2,
+			      G_TYPE_INT, G_TYPE_INT);
 }
 
 static void
@@ -366,6 +407,45 @@ ev_document_model_new_with_document (EvDocument *document)
 	return g_object_new (EV_TYPE_DOCUMENT_MODEL, "document", document, NULL);
 }
 
+static void
+page_sizes_job_updated_cb (EvJobPageSizes  *job,
+			   gint             first_page,
+			   gint             n_pages,
+			   EvDocumentModel *model)
+{
+	g_signal_emit (model, signals[PAGE_SIZES_CHANGED], 0, first_page, n_pages);
+}
+
+static void
+page_sizes_job_finished_cb (EvJob           *job,
+			    EvDocumentModel *model)
+{
+	ev_document_model_clear_page_sizes_job (model);
+}
+
+/* The sizes of the pages of documents loaded with a lazy cache are
+ * fetched by a job shared by all the users of the document.
+ */
+static void
+ev_document_model_setup_page_sizes_job (EvDocumentModel *model)
+{
+	EvJob *job;
+
+	ev_document_model_clear_page_sizes_job (model);
+
+	job = ev_job_page_sizes_get_for_document (model->document, model->page);
+	if (!job)
+		return;
+
+	model->page_sizes_job = g_object_ref (job);
+	g_signal_connect_object (job, "updated",
+				 G_CALLBACK (page_sizes_job_updated_cb),
+				 model, 0);
+	g_signal_connect_object (job, "finished",
+				 G_CALLBACK (page_sizes_job_finished_cb),
+				 model, 0);
+}
+
 void
 ev_document_model_set_document (EvDocumentModel *model,
 				EvDocument      *document)
@@ -376,14 +456,20 @@ ev_document_model_set_document (EvDocumentModel *model,
 	if (document == model->document)
 		return;
 
-	if (model->document)
+	if (model->document) {
+		/* Renderings of the pages that did not change are kept
+		 * when the document is reloaded */
+		ev_reload_cache_set_previous (document, model->document);
 		g_object_unref (model->document);
+	}
 	model->document = g_object_ref (document);
 
 	model->n_pages = ev_document_get_n_pages (document);
 	ev_document_model_set_page (model, CLAMP (model->page, 0,
 						  model->n_pages - 1));
 
+	ev_document_model_setup_page_sizes_job (model);
+
 	g_object_notify (G_OBJECT (model), "document");
 }
 
@@ -24,32 +24,36 @@
 typedef struct _EvSchedulerJob {
 	EvJob         *job;
 	EvJobPriority  priority;
+	EvJobAffinity  affinity;
 	GSList        *job_link;
+	gint64         queued_time;
 } EvSchedulerJob;
 
 G_LOCK_DEFINE_STATIC(job_list);
 static GSList *job_list = NULL;
 
-static EvJob *running_job = NULL;
-
 static gpointer ev_job_thread_proxy               (gpointer        data);
 static void     ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 						   GCancellable   *cancellable);
 
-/* EvJobQueue */
-static GQueue queue_urgent = G_QUEUE_INIT;
-static GQueue queue_high = G_QUEUE_INIT;
-static GQueue queue_low = G_QUEUE_INIT;
-static GQueue queue_none = G_QUEUE_INIT;
+/* Upper bound for the automatically sized worker pool. Access to a
+ * document is still serialized, so more threads than this would
+ * only add contention.
+ */
+#define EV_JOB_SCHEDULER_MAX_AUTO_THREADS 8
+
+/* EvJobQueue: one queue per affinity and priority. Jobs with
+ * EV_JOB_AFFINITY_SERIAL are only picked by the serial lane worker.
+ */
+static GQueue job_queue[EV_JOB_N_AFFINITIES][EV_JOB_N_PRIORITIES];
 static GCond job_queue_cond;
 static GMutex job_queue_mutex;
 
-static GQueue *job_queue[EV_JOB_N_PRIORITIES] = {
-	&queue_urgent,
-	&queue_high,
-	&queue_low,
-	&queue_none
-};
+/* Protected by job_queue_mutex */
+static guint   n_workers = 0;
+static guint   n_workers_wanted = 0;
+static guint   n_background_running = 0;
+static GSList *running_jobs = NULL;
 
 static void
 ev_job_queue_push (EvSchedulerJob *job,
@@ -59,22 +63,52 @@ ev_job_queue_push (EvSchedulerJob *job,
 	
 	g_mutex_lock (&job_queue_mutex);
 
-	g_queue_push_tail (job_queue[priority], job);
+	job->queued_time = g_get_monotonic_time ();
+	g_queue_push_tail (&job_queue[job->affinity][priority], job);
 	g_cond_broadcast (&job_queue_cond);
 	
 	g_mutex_unlock (&job_queue_mutex);
 }
 
+/* Low priority and idle jobs can never occupy every worker, so that
+ * there is always a thread left to pick up urgent and high priority
+ * jobs (the visible pages and thumbnails) as soon as they are queued.
+ */
+static gboolean
+ev_job_queue_can_run_background_unlocked (void)
+{
+	if (n_workers <= 1)
+		return TRUE;
+
+	return n_background_running < n_workers - 1;
+}
+
 static EvSchedulerJob *
-ev_job_queue_get_next_unlocked (void)
+ev_job_queue_get_next_unlocked (gboolean serial_lane)
 {
 	gint i;
 	EvSchedulerJob *job = NULL;
-	
-	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES; i++) {
-		job = (EvSchedulerJob *) g_queue_pop_head (job_queue[i]);
-		if (job)
+
+	/* The serial lane runs its own jobs first, at every priority, so
+	 * that they never wait behind jobs any other worker could run */
+	if (serial_lane) {
+		for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES && !job; i++) {
+			if (i >= EV_JOB_PRIORITY_LOW && !ev_job_queue_can_run_background_unlocked ())
+				break;
+
+			job = (EvSchedulerJob *) g_queue_pop_head (&job_queue[EV_JOB_AFFINITY_SERIAL][i]);
+		}
+	}
+
+	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES && !job; i++) {
+		if (i >= EV_JOB_PRIORITY_LOW && !ev_job_queue_can_run_background_unlocked ())
+			break;
+
+		/* Long background renders are left to the other workers */
+		if (i >= EV_JOB_PRIORITY_LOW && serial_lane && n_workers > 1)
 			break;
+
+		job = (EvSchedulerJob *) g_queue_pop_head (&job_queue[EV_JOB_AFFINITY_ANY][i]);
 	}
 
 	ev_debug_message (DEBUG_JOBS, "%s", job ? EV_GET_TYPE_NAME (job->job) : "No jobs in queue");
@@ -82,10 +116,50 @@ ev_job_queue_get_next_unlocked (void)
 	return job;
 }
 
+static guint
+ev_job_scheduler_get_default_n_threads (void)
+{
+	const gchar *env;
+	guint        n_threads;
+
+	env = g_getenv ("EV_JOB_THREADS");
+	if (env != NULL) {
+		n_threads = (guint) g_ascii_strtoull (env, NULL, 10);
+		if (n_threads > 0)
+			return n_threads;
+	}
+
+	n_threads = g_get_num_processors ();
+
+	return CLAMP (n_threads, 1, EV_JOB_SCHEDULER_MAX_AUTO_THREADS);
+}
+
+/* Must be called with job_queue_mutex held */
+static void
+ev_job_scheduler_spawn_workers_unlocked (void)
+{
+	while (n_workers < n_workers_wanted) {
+		gboolean serial_lane = (n_workers == 0);
+		GThread *thread;
+
+		thread = g_thread_new (serial_lane ? "EvJobScheduler" : "EvJobWorker",
+				       ev_job_thread_proxy,
+				       GINT_TO_POINTER (serial_lane));
+		g_thread_unref (thread);
+		n_workers++;
+	}
+}
+
 static gpointer
 ev_job_scheduler_init (gpointer data)
 {
-	g_thread_new ("EvJobScheduler", ev_job_thread_proxy, NULL);
+	g_mutex_lock (&job_queue_mutex);
+	if (n_workers_wanted == 0)
+		n_workers_wanted = ev_job_scheduler_get_default_n_threads ();
+	ev_job_scheduler_spawn_workers_unlocked ();
+	g_mutex_unlock (&job_queue_mutex);
+
+	ev_debug_message (DEBUG_JOBS, "Started %u worker threads", n_workers_wanted);
 
 	return NULL;
 }
@@ -159,9 +233,9 @@ ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 	 * If the job is currently running, it will be
 	 * destroyed as soon as it finishes. 
 	 */
-	list = g_queue_find (job_queue[job->priority], job);
+	list = g_queue_find (&job_queue[job->affinity][job->priority], job);
 	if (list) {
-		g_queue_delete_link (job_queue[job->priority], list);
+		g_queue_delete_link (&job_queue[job->affinity][job->priority], list);
 		g_mutex_unlock (&job_queue_mutex);
 		ev_scheduler_job_destroy (job);
 	} else {
@@ -176,16 +250,20 @@ ev_job_thread (EvJob *job)
 
 	ev_debug_message (DEBUG_JOBS, "%s", EV_GET_TYPE_NAME (job));
 
+	g_mutex_lock (&job_queue_mutex);
+	running_jobs = g_slist_prepend (running_jobs, job);
+	g_mutex_unlock (&job_queue_mutex);
+
 	do {
 		if (g_cancellable_is_cancelled (job->cancellable))
 			result = FALSE;
-		else {
-                        g_atomic_pointer_set (&running_job, job);
+		else
 			result = ev_job_run (job);
-                }
 	} while (result);
 
-        g_atomic_pointer_set (&running_job, NULL);
+	g_mutex_lock (&job_queue_mutex);
+	running_jobs = g_slist_remove (running_jobs, job);
+	g_mutex_unlock (&job_queue_mutex);
 }
 
 static gboolean
@@ -202,39 +280,91 @@ ev_job_idle (EvJob *job)
 static gpointer
 ev_job_thread_proxy (gpointer data)
 {
+	gboolean serial_lane = GPOINTER_TO_INT (data);
+
+	g_mutex_lock (&job_queue_mutex);
+
 	while (TRUE) {
 		EvSchedulerJob *job;
+		gboolean        background;
 
-		g_mutex_lock (&job_queue_mutex);
-		job = ev_job_queue_get_next_unlocked ();
+		/* The serial lane is never retired, jobs with
+		 * EV_JOB_AFFINITY_SERIAL depend on it.
+		 */
+		if (!serial_lane && n_workers > n_workers_wanted) {
+			n_workers--;
+			break;
+		}
+
+		job = ev_job_queue_get_next_unlocked (serial_lane);
 		if (!job) {
 			g_cond_wait (&job_queue_cond, &job_queue_mutex);
-			g_mutex_unlock (&job_queue_mutex);
 			continue;
 		}
+
+		background = job->priority >= EV_JOB_PRIORITY_LOW;
+		if (background)
+			n_background_running++;
 		g_mutex_unlock (&job_queue_mutex);
-		
+
+		ev_debug_message (DEBUG_JOBS, "%s waited %" G_GINT64_FORMAT " us in queue",
+				  EV_GET_TYPE_NAME (job->job),
+				  g_get_monotonic_time () - job->queued_time);
+
 		ev_job_thread (job->job);
 		ev_scheduler_job_destroy (job);
+
+		g_mutex_lock (&job_queue_mutex);
+		if (background) {
+			n_background_running--;
+			/* A background slot is free again */
+			g_cond_broadcast (&job_queue_cond);
+		}
 	}
 
+	g_mutex_unlock (&job_queue_mutex);
+
 	return NULL;
 }
 
 void
 ev_job_scheduler_push_job (EvJob         *job,
 			   EvJobPriority  priority)
+{
+	ev_job_scheduler_push_job_with_affinity (job, priority, EV_JOB_AFFINITY_ANY);
+}
+
+/**
+ * ev_job_scheduler_push_job_with_affinity:
+ * @job: an #EvJob
+ * @priority: the #EvJobPriority of @job
+ * @affinity: the #EvJobAffinity of @job
+ *
+ * Like ev_job_scheduler_push_job(), but jobs pushed with
+ * %EV_JOB_AFFINITY_SERIAL are always run in the same thread,
+ * one after the other, in priority order. This is meant for
+ * backends that are not thread-safe or keep thread-local state.
+ *
+ * Since: 44.0
+ */
+void
+ev_job_scheduler_push_job_with_affinity (EvJob         *job,
+					 EvJobPriority  priority,
+					 EvJobAffinity  affinity)
 {
 	static GOnce once_init = G_ONCE_INIT;
 	EvSchedulerJob *s_job;
 
+	g_return_if_fail (affinity < EV_JOB_N_AFFINITIES);
+
 	g_once (&once_init, ev_job_scheduler_init, NULL);
 
-	ev_debug_message (DEBUG_JOBS, "%s priority %d", EV_GET_TYPE_NAME (job), priority);
+	ev_debug_message (DEBUG_JOBS, "%s priority %d affinity %d", EV_GET_TYPE_NAME (job), priority, affinity);
 
 	s_job = g_new0 (EvSchedulerJob, 1);
 	s_job->job = g_object_ref (job);
 	s_job->priority = priority;
+	s_job->affinity = affinity;
 
 	ev_scheduler_job_list_add (s_job);
 	
@@ -294,12 +424,13 @@ ev_job_scheduler_update_job (EvJob         *job,
 	
 		g_mutex_lock (&job_queue_mutex);
 		
-		list = g_queue_find (job_queue[s_job->priority], s_job);
+		list = g_queue_find (&job_queue[s_job->affinity][s_job->priority], s_job);
 		if (list) {
 			ev_debug_message (DEBUG_JOBS, "Moving job %s from priority %d to %d",
 					  EV_GET_TYPE_NAME (job), s_job->priority, priority);
-			g_queue_delete_link (job_queue[s_job->priority], list);
-			g_queue_push_tail (job_queue[priority], s_job);
+			g_queue_delete_link (&job_queue[s_job->affinity][s_job->priority], list);
+			s_job->priority = priority;
+			g_queue_push_tail (&job_queue[s_job->affinity][priority], s_job);
 			g_cond_broadcast (&job_queue_cond);
 		}
 		
@@ -310,12 +441,94 @@ ev_job_scheduler_update_job (EvJob         *job,
 /**
  * ev_job_scheduler_get_running_thread_job:
  *
- * Returns: (transfer none): an #EvJob
+ * Since jobs can run in several threads at the same time, this
+ * returns the most recently started of the running thread jobs.
+ * Use ev_job_scheduler_is_job_running() to check for a given job.
+ *
+ * Returns: (transfer none) (nullable): an #EvJob
  */
 EvJob *
 ev_job_scheduler_get_running_thread_job (void)
 {
-        return g_atomic_pointer_get (&running_job);
+	EvJob *job;
+
+	g_mutex_lock (&job_queue_mutex);
+	job = running_jobs ? running_jobs->data : NULL;
+	g_mutex_unlock (&job_queue_mutex);
+
+	return job;
+}
+
+/**
+ * ev_job_scheduler_is_job_running:
+ * @job: an #EvJob
+ *
+ * Returns: %TRUE if @job is currently being run by one of the
+ *   scheduler threads
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_job_scheduler_is_job_running (EvJob *job)
+{
+	gboolean retval;
+
+	g_mutex_lock (&job_queue_mutex);
+	retval = g_slist_find (running_jobs, job) != NULL;
+	g_mutex_unlock (&job_queue_mutex);
+
+	return retval;
+}
+
+/**
+ * ev_job_scheduler_set_n_threads:
+ * @n_threads: the number of worker threads, or 0 to pick one from
+ *   the number of processors
+ *
+ * Sets the size of the worker pool used to run %EV_JOB_RUN_THREAD
+ * jobs. The EV_JOB_THREADS environment variable, when set, takes
+ * precedence over the automatic value. Threads are started or retired
+ * lazily, running jobs are never interrupted.
+ *
+ * Since: 44.0
+ */
+void
+ev_job_scheduler_set_n_threads (guint n_threads)
+{
+	if (n_threads == 0 || g_getenv ("EV_JOB_THREADS") != NULL)
+		n_threads = ev_job_scheduler_get_default_n_threads ();
+
+	g_mutex_lock (&job_queue_mutex);
+
+	ev_debug_message (DEBUG_JOBS, "Worker threads: %u -> %u", n_workers_wanted, n_threads);
+
+	n_workers_wanted = n_threads;
+	/* Before the first job is pushed, just remember the value */
+	if (n_workers > 0) {
+		ev_job_scheduler_spawn_workers_unlocked ();
+		g_cond_broadcast (&job_queue_cond);
+	}
+
+	g_mutex_unlock (&job_queue_mutex);
+}
+
+/**
+ * ev_job_scheduler_get_n_threads:
+ *
+ * Returns: the number of worker threads in the pool
+ *
+ * Since: 44.0
+ */
+guint
+ev_job_scheduler_get_n_threads (void)
+{
+	guint n_threads;
+
+	g_mutex_lock (&job_queue_mutex);
+	n_threads = n_workers_wanted;
+	g_mutex_unlock (&job_queue_mutex);
+
+	return n_threads > 0 ? n_threads : ev_job_scheduler_get_default_n_threads ();
 }
 
 /**
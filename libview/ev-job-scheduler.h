@@ -39,14 +39,31 @@ typedef enum {
 	EV_JOB_N_PRIORITIES
 } EvJobPriority;
 
+typedef enum {
+	EV_JOB_AFFINITY_ANY,    /* Run in any worker thread */
+	EV_JOB_AFFINITY_SERIAL, /* Always run in the same thread, one at a time */
+	EV_JOB_N_AFFINITIES
+} EvJobAffinity;
+
 EV_PUBLIC
 void   ev_job_scheduler_push_job               (EvJob        *job,
                                                 EvJobPriority priority);
 EV_PUBLIC
+void   ev_job_scheduler_push_job_with_affinity (EvJob        *job,
+                                                EvJobPriority priority,
+                                                EvJobAffinity affinity);
+EV_PUBLIC
 void   ev_job_scheduler_update_job             (EvJob        *job,
                                                 EvJobPriority priority);
 EV_PUBLIC
 EvJob *ev_job_scheduler_get_running_thread_job (void);
+EV_PUBLIC
+gboolean ev_job_scheduler_is_job_running       (EvJob        *job);
+
+EV_PUBLIC
+void   ev_job_scheduler_set_n_threads          (guint         n_threads);
+EV_PUBLIC
+guint  ev_job_scheduler_get_n_threads          (void);
 
 EV_PUBLIC
 void   ev_job_scheduler_wait                   (void);
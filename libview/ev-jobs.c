@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include "ev-jobs.h"
+#include "ev-job-scheduler.h"
 #include "ev-document-links.h"
 #include "ev-document-images.h"
 #include "ev-document-forms.h"
@@ -37,6 +38,11 @@
 #include "ev-document-attachments.h"
 #include "ev-document-media.h"
 #include "ev-document-text.h"
+#include "ev-document-parallel-render.h"
+#include "ev-search-index.h"
+#include "ev-page-text.h"
+#include "ev-reload-cache.h"
+#include "ev-view-marshal.h"
 #include "ev-debug.h"
 
 #include <errno.h>
@@ -51,6 +57,63 @@ struct _EvJobLoadStreamPrivate
         char *mime_type;
 };
 
+/* Document data holding the EvJobPageSizes of the document */
+#define EV_JOB_PAGE_SIZES_KEY "ev-job-page-sizes"
+/* Sizes of the pages fetched by EvJobPageSizes at a time */
+#define PAGE_SIZES_BATCH 32
+
+/* Pages are searched by up to this many workers of the job scheduler
+ * when the backend can search them without the document lock
+ */
+#define FIND_MAX_THREADS 8
+
+/* The pages up to this far from the start page are searched
+ * first, so that the matches around the current page show up
+ * before the rest of the document has been searched.
+ */
+#define FIND_NEAR_PAGES 5
+
+typedef struct _EvJobFindPrivate EvJobFindPrivate;
+struct _EvJobFindPrivate
+{
+	gboolean parallel;
+	gboolean *candidates;
+	gint n_near;
+	gint next_index;  /* atomic */
+
+	/* Main loop only */
+	gint n_published;
+	gboolean *published;
+
+	/* Protected by mutex */
+	GMutex mutex;
+	GCond cond;
+	GList **results;
+	GList *searched; /* Pages not published yet, last searched first */
+	guint update_idle_id;
+	gint n_helpers_running;
+	gboolean search_done;
+};
+
+/* Searches the pages of an EvJobFind along with it, in another worker
+ * of the job scheduler.
+ */
+typedef struct _EvJobFindPages      EvJobFindPages;
+typedef struct _EvJobFindPagesClass EvJobFindPagesClass;
+
+struct _EvJobFindPages
+{
+	EvJob      parent;
+	EvJobFind *job_find;
+};
+
+struct _EvJobFindPagesClass
+{
+	EvJobClass parent_class;
+};
+
+static GType ev_job_find_pages_get_type (void);
+
 static void ev_job_init                   (EvJob                 *job);
 static void ev_job_class_init             (EvJobClass            *class);
 static void ev_job_links_init             (EvJobLinks            *job);
@@ -71,6 +134,10 @@ static void ev_job_save_init              (EvJobSave             *job);
 static void ev_job_save_class_init        (EvJobSaveClass        *class);
 static void ev_job_find_init              (EvJobFind             *job);
 static void ev_job_find_class_init        (EvJobFindClass        *class);
+static void ev_job_index_init             (EvJobIndex            *job);
+static void ev_job_index_class_init       (EvJobIndexClass       *class);
+static void ev_job_page_sizes_init        (EvJobPageSizes        *job);
+static void ev_job_page_sizes_class_init  (EvJobPageSizesClass   *class);
 static void ev_job_layers_init            (EvJobLayers           *job);
 static void ev_job_layers_class_init      (EvJobLayersClass      *class);
 static void ev_job_export_init            (EvJobExport           *job);
@@ -96,7 +163,13 @@ enum {
 
 static guint job_signals[LAST_SIGNAL] = { 0 };
 static guint job_fonts_signals[FONTS_LAST_SIGNAL] = { 0 };
+enum {
+	PAGE_SIZES_UPDATED,
+	PAGE_SIZES_LAST_SIGNAL
+};
+
 static guint job_find_signals[FIND_LAST_SIGNAL] = { 0 };
+static guint job_page_sizes_signals[PAGE_SIZES_LAST_SIGNAL] = { 0 };
 
 G_DEFINE_ABSTRACT_TYPE (EvJob, ev_job, G_TYPE_OBJECT)
 G_DEFINE_TYPE (EvJobLinks, ev_job_links, EV_TYPE_JOB)
@@ -111,7 +184,10 @@ G_DEFINE_TYPE_WITH_PRIVATE (EvJobLoadStream, ev_job_load_stream, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLoadGFile, ev_job_load_gfile, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLoadFd, ev_job_load_fd, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobSave, ev_job_save, EV_TYPE_JOB)
-G_DEFINE_TYPE (EvJobFind, ev_job_find, EV_TYPE_JOB)
+G_DEFINE_TYPE_WITH_PRIVATE (EvJobFind, ev_job_find, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobFindPages, ev_job_find_pages, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobIndex, ev_job_index, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobPageSizes, ev_job_page_sizes, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLayers, ev_job_layers, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobExport, ev_job_export, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobPrint, ev_job_print, EV_TYPE_JOB)
@@ -391,9 +467,9 @@ ev_job_links_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_links->model = ev_document_links_get_links_model (EV_DOCUMENT_LINKS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	gtk_tree_model_foreach (job_links->model, (GtkTreeModelForeachFunc)fill_page_labels, job);
 
@@ -474,10 +550,10 @@ ev_job_attachments_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_attachments->attachments =
 		ev_document_attachments_get_attachments (EV_DOCUMENT_ATTACHMENTS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	ev_job_succeeded (job);
 
@@ -541,7 +617,7 @@ ev_job_annots_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	for (i = 0; i < ev_document_get_n_pages (job->document); i++) {
 		EvMappingList *mapping_list;
 		EvPage        *page;
@@ -554,7 +630,7 @@ ev_job_annots_run (EvJob *job)
 		if (mapping_list)
 			job_annots->annots = g_list_prepend (job_annots->annots, mapping_list);
 	}
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	job_annots->annots = g_list_reverse (job_annots->annots);
 
@@ -617,6 +693,8 @@ ev_job_render_dispose (GObject *object)
 		job->selection_region = NULL;
 	}
 
+	g_clear_pointer (&job->previous_surface, cairo_surface_destroy);
+
 	(* G_OBJECT_CLASS (ev_job_render_parent_class)->dispose) (object);
 }
 
@@ -626,28 +704,51 @@ ev_job_render_run (EvJob *job)
 	EvJobRender     *job_render = EV_JOB_RENDER (job);
 	EvPage          *ev_page;
 	EvRenderContext *rc;
+	gboolean         fc_locked;
 
 	ev_debug_message (DEBUG_JOBS, "page: %d (%p)", job_render->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
-	
-	ev_document_doc_mutex_lock ();
+
+	if (job_render->previous_surface &&
+	    ev_reload_cache_page_unchanged (job->document, job_render->page))
+		job_render->surface = cairo_surface_reference (job_render->previous_surface);
+
+	ev_document_lock (job->document);
 
 	ev_profiler_start (EV_PROFILE_JOBS, "Rendering page %d", job_render->page);
-		
-	ev_document_fc_mutex_lock ();
 
 	ev_page = ev_document_get_page (job->document, job_render->page);
 	rc = ev_render_context_new (ev_page, job_render->rotation, job_render->scale);
 	ev_render_context_set_target_size (rc,
 					   job_render->target_width, job_render->target_height);
+	ev_render_context_set_area (rc,
+				    job_render->area.x, job_render->area.y,
+				    job_render->area.width, job_render->area.height);
 	g_object_unref (ev_page);
 
-	job_render->surface = ev_document_render (job->document, rc);
+	if (job_render->surface == NULL &&
+	    EV_IS_DOCUMENT_PARALLEL_RENDER (job->document) &&
+	    ev_document_parallel_render_sync (EV_DOCUMENT_PARALLEL_RENDER (job->document))) {
+		/* Let other jobs use the document while the page renders */
+		ev_document_unlock (job->document);
+		job_render->surface =
+			ev_document_parallel_render_render_page (EV_DOCUMENT_PARALLEL_RENDER (job->document),
+								 rc);
+		ev_document_lock (job->document);
+	}
+
+	if (job_render->surface == NULL) {
+		fc_locked = !ev_document_is_render_thread_safe (job->document);
+		if (fc_locked)
+			ev_document_fc_mutex_lock ();
+		job_render->surface = ev_document_render (job->document, rc);
+		if (fc_locked)
+			ev_document_fc_mutex_unlock ();
+	}
 
 	if (job_render->surface == NULL ||
 	    cairo_surface_status (job_render->surface) != CAIRO_STATUS_SUCCESS) {
-		ev_document_fc_mutex_unlock ();
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (job->document);
 		g_object_unref (rc);
 
                 if (job_render->surface != NULL) {
@@ -673,13 +774,33 @@ ev_job_render_run (EvJob *job)
 	 * we return now, so that the thread is finished ASAP
 	 */
 	if (g_cancellable_is_cancelled (job->cancellable)) {
-		ev_document_fc_mutex_unlock ();
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (job->document);
 		g_object_unref (rc);
 
 		return FALSE;
 	}
 
+	/* Backends not supporting areas render the whole page */
+	if (job_render->area.width > 0 && job_render->area.height > 0 &&
+	    (cairo_image_surface_get_width (job_render->surface) != job_render->area.width ||
+	     cairo_image_surface_get_height (job_render->surface) != job_render->area.height)) {
+		cairo_surface_t *area_surface;
+		cairo_t         *cr;
+
+		area_surface = cairo_surface_create_similar_image (job_render->surface,
+								   cairo_image_surface_get_format (job_render->surface),
+								   job_render->area.width,
+								   job_render->area.height);
+		cr = cairo_create (area_surface);
+		cairo_set_source_surface (cr, job_render->surface,
+					  -job_render->area.x, -job_render->area.y);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+
+		cairo_surface_destroy (job_render->surface);
+		job_render->surface = area_surface;
+	}
+
 	if (job_render->include_selection && EV_IS_SELECTION (job->document)) {
 		ev_selection_render_selection (EV_SELECTION (job->document),
 					       rc,
@@ -697,8 +818,7 @@ ev_job_render_run (EvJob *job)
 
 	g_object_unref (rc);
 
-	ev_document_fc_mutex_unlock ();
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 	
 	ev_job_succeeded (job);
 	
@@ -754,6 +874,42 @@ ev_job_render_set_selection_info (EvJobRender     *job,
 	job->base = *base;
 }
 
+/**
+ * ev_job_render_set_area:
+ * @job: an #EvJobRender
+ * @area: the area of the page to render, in pixels of the rendered page
+ *
+ * Renders only @area of the page instead of the whole page. The
+ * resulting surface has the size of @area.
+ *
+ * Since: 44.0
+ */
+void
+ev_job_render_set_area (EvJobRender                 *job,
+			const cairo_rectangle_int_t *area)
+{
+	job->area = *area;
+}
+
+/**
+ * ev_job_render_set_previous_surface:
+ * @job: an #EvJobRender
+ * @surface: the rendering of the page in the previous version of the document
+ *
+ * Sets the rendering of the page of @job in the version of the document
+ * it was reloaded from. It's used instead of rendering the page again
+ * if the page did not change.
+ *
+ * Since: 44.0
+ */
+void
+ev_job_render_set_previous_surface (EvJobRender     *job,
+				    cairo_surface_t *surface)
+{
+	g_clear_pointer (&job->previous_surface, cairo_surface_destroy);
+	job->previous_surface = surface ? cairo_surface_reference (surface) : NULL;
+}
+
 /* EvJobPageData */
 static void
 ev_job_page_data_init (EvJobPageData *job)
@@ -761,6 +917,16 @@ ev_job_page_data_init (EvJobPageData *job)
 	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
 }
 
+static void
+ev_job_page_data_dispose (GObject *object)
+{
+	EvJobPageData *job = EV_JOB_PAGE_DATA (object);
+
+	g_clear_pointer (&job->page_text, ev_page_text_unref);
+
+	(* G_OBJECT_CLASS (ev_job_page_data_parent_class)->dispose) (object);
+}
+
 static gboolean
 ev_job_page_data_run (EvJob *job)
 {
@@ -770,31 +936,30 @@ ev_job_page_data_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, "page: %d (%p)", job_pd->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_document_doc_mutex_lock ();
+	/* The text is shared with the other users of the page, so
+	 * it is only extracted once per document.
+	 */
+	if (job_pd->flags & (EV_PAGE_DATA_INCLUDE_TEXT |
+			     EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT |
+			     EV_PAGE_DATA_INCLUDE_TEXT_ATTRS |
+			     EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS)) {
+		job_pd->page_text = ev_page_text_get (job->document, job_pd->page, job_pd->flags);
+		if (job_pd->page_text) {
+			job_pd->text = job_pd->page_text->text;
+			job_pd->text_layout = job_pd->page_text->layout;
+			job_pd->text_layout_length = job_pd->page_text->n_layout;
+			job_pd->text_attrs = job_pd->page_text->attrs;
+			job_pd->text_log_attrs = job_pd->page_text->log_attrs;
+			job_pd->text_log_attrs_length = job_pd->page_text->n_log_attrs;
+		}
+	}
+
+	ev_document_lock (job->document);
 	ev_page = ev_document_get_page (job->document, job_pd->page);
 
 	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING) && EV_IS_DOCUMENT_TEXT (job->document))
 		job_pd->text_mapping =
 			ev_document_text_get_text_mapping (EV_DOCUMENT_TEXT (job->document), ev_page);
-	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT) && EV_IS_DOCUMENT_TEXT (job->document))
-		job_pd->text =
-			ev_document_text_get_text (EV_DOCUMENT_TEXT (job->document), ev_page);
-	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) && EV_IS_DOCUMENT_TEXT (job->document))
-		ev_document_text_get_text_layout (EV_DOCUMENT_TEXT (job->document),
-						  ev_page,
-						  &(job_pd->text_layout),
-						  &(job_pd->text_layout_length));
-	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS) && EV_IS_DOCUMENT_TEXT (job->document))
-		job_pd ->text_attrs =
-			ev_document_text_get_text_attrs (EV_DOCUMENT_TEXT (job->document),
-							 ev_page);
-        if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) && job_pd->text) {
-                job_pd->text_log_attrs_length = g_utf8_strlen (job_pd->text, -1);
-                job_pd->text_log_attrs = g_new0 (PangoLogAttr, job_pd->text_log_attrs_length + 1);
-
-                /* FIXME: We need API to get the language of the document */
-                pango_get_log_attrs (job_pd->text, -1, -1, NULL, job_pd->text_log_attrs, job_pd->text_log_attrs_length + 1);
-        }
 	if ((job_pd->flags & EV_PAGE_DATA_INCLUDE_LINKS) && EV_IS_DOCUMENT_LINKS (job->document))
 		job_pd->link_mapping =
 			ev_document_links_get_links (EV_DOCUMENT_LINKS (job->document), ev_page);
@@ -815,7 +980,7 @@ ev_job_page_data_run (EvJob *job)
                         ev_document_media_get_media_mapping (EV_DOCUMENT_MEDIA (job->document),
                                                              ev_page);
 	g_object_unref (ev_page);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	ev_job_succeeded (job);
 
@@ -825,9 +990,11 @@ ev_job_page_data_run (EvJob *job)
 static void
 ev_job_page_data_class_init (EvJobPageDataClass *class)
 {
-	EvJobClass *job_class = EV_JOB_CLASS (class);
+	EvJobClass   *job_class = EV_JOB_CLASS (class);
+	GObjectClass *gobject_class = G_OBJECT_CLASS (class);
 
 	job_class->run = ev_job_page_data_run;
+	gobject_class->dispose = ev_job_page_data_dispose;
 }
 
 EvJob *
@@ -874,6 +1041,8 @@ ev_job_thumbnail_dispose (GObject *object)
 		job->thumbnail_surface = NULL;
 	}
 
+	g_clear_pointer (&job->previous_surface, cairo_surface_destroy);
+
 	(* G_OBJECT_CLASS (ev_job_thumbnail_parent_class)->dispose) (object);
 }
 
@@ -884,11 +1053,21 @@ ev_job_thumbnail_run (EvJob *job)
 	EvRenderContext *rc;
 	GdkPixbuf       *pixbuf = NULL;
 	EvPage          *page;
+	gboolean         fc_locked;
 
 	ev_debug_message (DEBUG_JOBS, "%d (%p)", job_thumb->page, job);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+	if (job_thumb->format == EV_JOB_THUMBNAIL_SURFACE &&
+	    job_thumb->previous_surface &&
+	    ev_reload_cache_page_known_unchanged (job->document, job_thumb->page)) {
+		job_thumb->thumbnail_surface = cairo_surface_reference (job_thumb->previous_surface);
+		ev_job_succeeded (job);
+
+		return FALSE;
+	}
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 
 	page = ev_document_get_page (job->document, job_thumb->page);
 	rc = ev_render_context_new (page, job_thumb->rotation, job_thumb->scale);
@@ -896,12 +1075,17 @@ ev_job_thumbnail_run (EvJob *job)
 					   job_thumb->target_width, job_thumb->target_height);
 	g_object_unref (page);
 
+	fc_locked = !ev_document_is_render_thread_safe (job->document);
+	if (fc_locked)
+		ev_document_fc_mutex_lock ();
         if (job_thumb->format == EV_JOB_THUMBNAIL_PIXBUF)
                 pixbuf = ev_document_get_thumbnail (job->document, rc);
         else
                 job_thumb->thumbnail_surface = ev_document_get_thumbnail_surface (job->document, rc);
+	if (fc_locked)
+		ev_document_fc_mutex_unlock ();
 	g_object_unref (rc);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
         /* EV_JOB_THUMBNAIL_SURFACE is not compatible with has_frame = TRUE */
         if (job_thumb->format == EV_JOB_THUMBNAIL_PIXBUF && pixbuf) {
@@ -917,9 +1101,10 @@ ev_job_thumbnail_run (EvJob *job)
 			       EV_DOCUMENT_ERROR_INVALID,
 			       _("Failed to create thumbnail for page %d"),
 			       job_thumb->page);
-	} else {
-		ev_job_succeeded (job);
+		return FALSE;
 	}
+
+	ev_job_succeeded (job);
 	
 	return FALSE;
 }
@@ -1004,6 +1189,26 @@ ev_job_thumbnail_set_output_format (EvJobThumbnail      *job,
         job->format = format;
 }
 
+/**
+ * ev_job_thumbnail_set_previous_surface:
+ * @job: a #EvJobThumbnail
+ * @surface: the thumbnail of the page in the previous version of the document
+ *
+ * Sets the thumbnail of the page of @job in the version of the document
+ * it was reloaded from. If the page did not change, @surface is used as
+ * the thumbnail_surface of @job instead of rendering the page again. It's
+ * only used with %EV_JOB_THUMBNAIL_SURFACE.
+ *
+ * Since: 44.0
+ */
+void
+ev_job_thumbnail_set_previous_surface (EvJobThumbnail  *job,
+                                       cairo_surface_t *surface)
+{
+	g_clear_pointer (&job->previous_surface, cairo_surface_destroy);
+	job->previous_surface = surface ? cairo_surface_reference (surface) : NULL;
+}
+
 /* EvJobFonts */
 static void
 ev_job_fonts_init (EvJobFonts *job)
@@ -1020,11 +1225,13 @@ ev_job_fonts_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	
 	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
+	if (!ev_document_trylock (job->document))
 		return TRUE;
 	
-	if (!ev_document_fc_mutex_trylock ())
+	if (!ev_document_fc_mutex_trylock ()) {
+		ev_document_unlock (job->document);
 		return TRUE;
+	}
 
 #ifdef EV_ENABLE_DEBUG
 	/* We use the #ifdef in this case because of the if */
@@ -1037,7 +1244,7 @@ ev_job_fonts_run (EvJob *job)
 		       ev_document_fonts_get_progress (fonts));
 
 	ev_document_fc_mutex_unlock ();
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	if (job_fonts->scan_completed)
 		ev_job_succeeded (job);
@@ -1119,7 +1326,7 @@ ev_job_load_run (EvJob *job)
 	   because, e.g., a password is required - if so, just reload rather than
 	   creating a new instance */
 	if (job->document) {
-		const gchar *uncompressed_uri;
+		EvCompressionType compression;
 
 		if (job_load->password) {
 			ev_document_security_set_password (EV_DOCUMENT_SECURITY (job->document),
@@ -1130,14 +1337,18 @@ ev_job_load_run (EvJob *job)
 		job->finished = FALSE;
 		g_clear_error (&job->error);
 
-		uncompressed_uri = g_object_get_data (G_OBJECT (job->document),
-						      "uri-uncompressed");
-		ev_document_load (job->document,
-				  uncompressed_uri ? uncompressed_uri : job_load->uri,
-				  &error);
+		compression = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (job->document),
+								  "compression"));
+		ev_document_load_compressed (job->document,
+					     job_load->uri,
+					     compression,
+					     job_load->flags,
+					     NULL,
+					     &error);
 	} else {
-		job->document = ev_document_factory_get_document (job_load->uri,
-								  &error);
+		job->document = ev_document_factory_get_document_full (job_load->uri,
+								       job_load->flags,
+								       &error);
 	}
 
 	ev_document_fc_mutex_unlock ();
@@ -1195,6 +1406,22 @@ ev_job_load_set_password (EvJobLoad *job, const gchar *password)
 	job->password = password ? g_strdup (password) : NULL;
 }
 
+/**
+ * ev_job_load_set_load_flags:
+ * @job: an #EvJobLoad
+ * @flags: flags from #EvDocumentLoadFlags
+ *
+ * Since: 44.0
+ */
+void
+ev_job_load_set_load_flags (EvJobLoad          *job,
+			    EvDocumentLoadFlags flags)
+{
+	g_return_if_fail (EV_IS_JOB_LOAD (job));
+
+	job->flags = flags;
+}
+
 /* EvJobLoadStream */
 
 /**
@@ -1822,7 +2049,7 @@ ev_job_save_run (EvJob *job)
 	}
 	close (fd);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 
 	/* Save document to temp filename */
 	local_uri = g_filename_to_uri (tmp_filename, NULL, &error);
@@ -1830,7 +2057,7 @@ ev_job_save_run (EvJob *job)
                 ev_document_save (job->document, local_uri, &error);
         }
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
 	if (error) {
 		g_free (local_uri);
@@ -1843,7 +2070,7 @@ ev_job_save_run (EvJob *job)
 	/* If original document was compressed,
 	 * compress it again before saving
 	 */
-	if (g_object_get_data (G_OBJECT (job->document), "uri-uncompressed")) {
+	if (g_object_get_data (G_OBJECT (job->document), "compression")) {
 		EvCompressionType ctype = EV_COMPRESSION_NONE;
 		const gchar      *ext;
 		gchar            *uri_comp;
@@ -1931,13 +2158,18 @@ ev_job_save_new (EvDocument  *document,
 static void
 ev_job_find_init (EvJobFind *job)
 {
-	EV_JOB (job)->run_mode = EV_JOB_RUN_MAIN_LOOP;
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job);
+
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+	g_mutex_init (&priv->mutex);
+	g_cond_init (&priv->cond);
 }
 
 static void
 ev_job_find_dispose (GObject *object)
 {
 	EvJobFind *job = EV_JOB_FIND (object);
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job);
 
 	ev_debug_message (DEBUG_JOBS, NULL);
 
@@ -1951,56 +2183,280 @@ ev_job_find_dispose (GObject *object)
 
 		for (i = 0; i < job->n_pages; i++) {
 			g_list_free_full (job->pages[i], (GDestroyNotify)ev_find_rectangle_free);
+			g_list_free_full (priv->results[i], (GDestroyNotify)ev_find_rectangle_free);
 		}
 
 		g_free (job->pages);
 		job->pages = NULL;
+		g_clear_pointer (&priv->results, g_free);
+		g_clear_pointer (&priv->published, g_free);
 	}
+
+	g_clear_pointer (&priv->searched, g_list_free);
+	g_clear_pointer (&priv->candidates, g_free);
 	
 	(* G_OBJECT_CLASS (ev_job_find_parent_class)->dispose) (object);
 }
 
+static void
+ev_job_find_finalize (GObject *object)
+{
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (EV_JOB_FIND (object));
+
+	g_mutex_clear (&priv->mutex);
+	g_cond_clear (&priv->cond);
+
+	(* G_OBJECT_CLASS (ev_job_find_parent_class)->finalize) (object);
+}
+
+/* Pages are searched in this order: the pages around the start page,
+ * alternating forward and backward, and then the rest of the document
+ * going forward.
+ */
+static gint
+ev_job_find_get_page_for_index (EvJobFind *job,
+				gint       index)
+{
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job);
+	gint              offset;
+
+	if (index < priv->n_near)
+		offset = (index % 2) ? (index + 1) / 2 : -index / 2;
+	else
+		offset = index - priv->n_near / 2;
+
+	return (job->start_page + offset + job->n_pages) % job->n_pages;
+}
+
+/* Pages are published as soon as they have been searched, whatever
+ * their position, so the first matches do not wait for the pages
+ * before them to be searched.
+ */
+static gboolean
+ev_job_find_update_idle (EvJobFind *job)
+{
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job);
+	GList            *pages;
+	GList            *l;
+
+	g_mutex_lock (&priv->mutex);
+	priv->update_idle_id = 0;
+	pages = g_list_reverse (g_steal_pointer (&priv->searched));
+	for (l = pages; l; l = g_list_next (l)) {
+		gint page = GPOINTER_TO_INT (l->data);
+
+		job->pages[page] = priv->results[page];
+		priv->results[page] = NULL;
+		priv->published[page] = TRUE;
+		priv->n_published++;
+	}
+	g_mutex_unlock (&priv->mutex);
+
+	for (l = pages; l; l = g_list_next (l)) {
+		gint page = GPOINTER_TO_INT (l->data);
+
+		if (!job->has_results)
+			job->has_results = (job->pages[page] != NULL);
+
+		job->current_page = (page + 1) % job->n_pages;
+
+		if (!EV_JOB (job)->cancelled)
+			g_signal_emit (job, job_find_signals[FIND_UPDATED], 0, page);
+	}
+	g_list_free (pages);
+
+	return FALSE;
+}
+
+static gpointer
+ev_job_find_search_pages (EvJobFind *job)
+{
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job);
+	EvDocument       *document = EV_JOB (job)->document;
+
+	while (!g_cancellable_is_cancelled (EV_JOB (job)->cancellable)) {
+		GList *matches = NULL;
+		gint   index, page;
+
+		index = g_atomic_int_add (&priv->next_index, 1);
+		if (index >= job->n_pages)
+			break;
+
+		page = ev_job_find_get_page_for_index (job, index);
+
+		if (priv->candidates && !priv->candidates[page]) {
+			/* The search index knows there is no match */
+		} else if (!priv->parallel ||
+			   !ev_document_parallel_render_find_text (EV_DOCUMENT_PARALLEL_RENDER (document),
+								   page, job->text, job->options,
+								   &matches)) {
+			EvPage *ev_page;
+
+			ev_document_lock (document);
+			ev_page = ev_document_get_page (document, page);
+			matches = ev_document_find_find_text_extended (EV_DOCUMENT_FIND (document),
+								       ev_page, job->text,
+								       job->options);
+			g_object_unref (ev_page);
+			ev_document_unlock (document);
+		}
+
+		/* Results are handed to the main loop in batches: the idle
+		 * picks up every page searched since it was scheduled. The
+		 * pages around the start page are published with a higher
+		 * priority, the rest of the search goes in the background.
+		 */
+		g_mutex_lock (&priv->mutex);
+		priv->results[page] = matches;
+		priv->searched = g_list_prepend (priv->searched, GINT_TO_POINTER (page));
+		if (priv->update_idle_id == 0) {
+			priv->update_idle_id =
+				g_idle_add_full (index < priv->n_near ?
+						 G_PRIORITY_DEFAULT : G_PRIORITY_DEFAULT_IDLE,
+						 (GSourceFunc)ev_job_find_update_idle,
+						 g_object_ref (job),
+						 (GDestroyNotify)g_object_unref);
+		}
+		g_mutex_unlock (&priv->mutex);
+	}
+
+	return NULL;
+}
+
+/* EvJobFindPages */
+static void
+ev_job_find_pages_init (EvJobFindPages *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static void
+ev_job_find_pages_dispose (GObject *object)
+{
+	EvJobFindPages *job = (EvJobFindPages *) object;
+
+	g_clear_object (&job->job_find);
+
+	(* G_OBJECT_CLASS (ev_job_find_pages_parent_class)->dispose) (object);
+}
+
+static gboolean
+ev_job_find_pages_run (EvJob *job)
+{
+	EvJobFind        *job_find = ((EvJobFindPages *) job)->job_find;
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job_find);
+
+	/* The find job waits for the helpers that started searching
+	 * before finishing, the ones that start later have nothing left
+	 * to do.
+	 */
+	g_mutex_lock (&priv->mutex);
+	if (priv->search_done) {
+		g_mutex_unlock (&priv->mutex);
+		ev_job_succeeded (job);
+		return FALSE;
+	}
+	priv->n_helpers_running++;
+	g_mutex_unlock (&priv->mutex);
+
+	ev_job_find_search_pages (job_find);
+
+	g_mutex_lock (&priv->mutex);
+	priv->n_helpers_running--;
+	g_cond_signal (&priv->cond);
+	g_mutex_unlock (&priv->mutex);
+
+	ev_job_succeeded (job);
+
+	return FALSE;
+}
+
+static void
+ev_job_find_pages_class_init (EvJobFindPagesClass *class)
+{
+	GObjectClass *oclass = G_OBJECT_CLASS (class);
+	EvJobClass   *job_class = EV_JOB_CLASS (class);
+
+	oclass->dispose = ev_job_find_pages_dispose;
+	job_class->run = ev_job_find_pages_run;
+}
+
+static EvJob *
+ev_job_find_pages_new (EvJobFind *job_find)
+{
+	EvJobFindPages *job;
+
+	job = g_object_new (ev_job_find_pages_get_type (), NULL);
+	EV_JOB (job)->document = g_object_ref (EV_JOB (job_find)->document);
+	job->job_find = g_object_ref (job_find);
+
+	return EV_JOB (job);
+}
+
 static gboolean
 ev_job_find_run (EvJob *job)
 {
-	EvJobFind      *job_find = EV_JOB_FIND (job);
-	EvDocumentFind *find = EV_DOCUMENT_FIND (job->document);
-	EvPage         *ev_page;
-	GList          *matches;
+	EvJobFind        *job_find = EV_JOB_FIND (job);
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job_find);
+	gint              n_helpers = 0;
+	gint              i;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	
-	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
-		return TRUE;
-	
-#ifdef EV_ENABLE_DEBUG
-	/* We use the #ifdef in this case because of the if */
-	if (job_find->current_page == job_find->start_page)
-		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
-#endif
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
-	ev_page = ev_document_get_page (job->document, job_find->current_page);
-	matches = ev_document_find_find_text_extended (find, ev_page, job_find->text,
-                                                       job_find->options);
-	g_object_unref (ev_page);
-	
-	ev_document_doc_mutex_unlock ();
+	/* Searching is only worth splitting across workers when the
+	 * backend does not need the document lock for it.
+	 */
+	if (EV_IS_DOCUMENT_PARALLEL_RENDER (job->document)) {
+		ev_document_lock (job->document);
+		priv->parallel = ev_document_parallel_render_sync (EV_DOCUMENT_PARALLEL_RENDER (job->document));
+		ev_document_unlock (job->document);
+	}
 
-	if (!job_find->has_results)
-		job_find->has_results = (matches != NULL);
+	/* Only the pages that the search index can not rule out are
+	 * searched. The index is only there if an EvJobIndex was run.
+	 */
+	if (EV_IS_DOCUMENT_TEXT (job->document)) {
+		EvSearchIndex *index;
 
-	job_find->pages[job_find->current_page] = matches;
-	g_signal_emit (job_find, job_find_signals[FIND_UPDATED], 0, job_find->current_page);
-		       
-	job_find->current_page = (job_find->current_page + 1) % job_find->n_pages;
-	if (job_find->current_page == job_find->start_page) {
-		ev_job_succeeded (job);
+		index = ev_search_index_lookup (job->document);
+		if (index)
+			priv->candidates = ev_search_index_find (index, job_find->text);
+	}
 
-		return FALSE;
+	/* The helpers are idle priority jobs of the scheduler, so they
+	 * only run on the workers left over by rendering: the scheduler
+	 * keeps a worker for urgent and high priority jobs, and this job
+	 * already takes one of the others.
+	 */
+	if (priv->parallel) {
+		n_helpers = (gint) ev_job_scheduler_get_n_threads () - 2;
+		n_helpers = CLAMP (n_helpers, 0, MIN (FIND_MAX_THREADS, job_find->n_pages) - 1);
 	}
 
-	return TRUE;
+	for (i = 0; i < n_helpers; i++) {
+		EvJob *helper;
+
+		helper = ev_job_find_pages_new (job_find);
+		ev_job_scheduler_push_job (helper, EV_JOB_PRIORITY_NONE);
+		g_object_unref (helper);
+	}
+
+	ev_job_find_search_pages (job_find);
+
+	g_mutex_lock (&priv->mutex);
+	priv->search_done = TRUE;
+	while (priv->n_helpers_running > 0)
+		g_cond_wait (&priv->cond, &priv->mutex);
+	g_mutex_unlock (&priv->mutex);
+
+	/* The last batch of results was queued before this, so
+	 * it is emitted before the finished signal.
+	 */
+	if (!g_cancellable_is_cancelled (job->cancellable))
+		ev_job_succeeded (job);
+
+	return FALSE;
 }
 
 static void
@@ -2011,6 +2467,7 @@ ev_job_find_class_init (EvJobFindClass *class)
 	
 	job_class->run = ev_job_find_run;
 	gobject_class->dispose = ev_job_find_dispose;
+	gobject_class->finalize = ev_job_find_finalize;
 	
 	job_find_signals[FIND_UPDATED] =
 		g_signal_new ("updated",
@@ -2031,16 +2488,21 @@ ev_job_find_new (EvDocument  *document,
 		 gboolean     case_sensitive)
 {
 	EvJobFind *job;
+	EvJobFindPrivate *priv;
 	
 	ev_debug_message (DEBUG_JOBS, NULL);
 	
 	job = g_object_new (EV_TYPE_JOB_FIND, NULL);
+	priv = ev_job_find_get_instance_private (job);
 
 	EV_JOB (job)->document = g_object_ref (document);
 	job->start_page = start_page;
 	job->current_page = start_page;
 	job->n_pages = n_pages;
 	job->pages = g_new0 (GList *, n_pages);
+	priv->results = g_new0 (GList *, n_pages);
+	priv->published = g_new0 (gboolean, n_pages);
+	priv->n_near = MIN (2 * FIND_NEAR_PAGES + 1, n_pages - (n_pages + 1) % 2);
 	job->text = g_strdup (text);
         /* Keep for compatibility */
 	job->case_sensitive = case_sensitive;
@@ -2116,20 +2578,36 @@ ev_job_find_get_n_main_results (EvJobFind *job,
 gdouble
 ev_job_find_get_progress (EvJobFind *job)
 {
-	gint pages_done;
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job);
 
 	if (ev_job_is_finished (EV_JOB (job)))
 		return 1.0;
-	
-	if (job->current_page > job->start_page) {
-		pages_done = job->current_page - job->start_page + 1;
-	} else if (job->current_page == job->start_page) {
-		pages_done = job->n_pages;
-	} else {
-		pages_done = job->n_pages - job->start_page + job->current_page;
-	}
 
-	return pages_done / (gdouble) job->n_pages;
+	return priv->n_published / (gdouble) job->n_pages;
+}
+
+/**
+ * ev_job_find_is_page_searched:
+ * @job: an #EvJobFind
+ * @page: a page index
+ *
+ * Pages are not searched in order, this can be used to know whether
+ * the results of @page are already known.
+ *
+ * Returns: %TRUE if the results of @page are available
+ *
+ * Since: 44.0
+ */
+gboolean
+ev_job_find_is_page_searched (EvJobFind *job,
+			      gint       page)
+{
+	EvJobFindPrivate *priv = ev_job_find_get_instance_private (job);
+
+	g_return_val_if_fail (EV_IS_JOB_FIND (job), FALSE);
+	g_return_val_if_fail (page >= 0 && page < job->n_pages, FALSE);
+
+	return priv->published[page];
 }
 
 gboolean
@@ -2150,6 +2628,304 @@ ev_job_find_get_results (EvJobFind *job)
 	return job->pages;
 }
 
+/* EvJobIndex */
+static void
+ev_job_index_init (EvJobIndex *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static gboolean
+ev_job_index_run (EvJob *job)
+{
+	EvSearchIndex *index;
+	gint           n_pages, i;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+	index = ev_search_index_get (job->document);
+	if (!index) {
+		ev_job_succeeded (job);
+		return FALSE;
+	}
+
+	n_pages = ev_document_get_n_pages (job->document);
+	for (i = 0; i < n_pages; i++) {
+		EvPage *page;
+		gchar  *text;
+
+		if (g_cancellable_is_cancelled (job->cancellable))
+			break;
+
+		if (ev_search_index_has_page (index, i))
+			continue;
+
+		ev_document_lock (job->document);
+		page = ev_document_get_page (job->document, i);
+		text = ev_document_text_get_text (EV_DOCUMENT_TEXT (job->document), page);
+		g_object_unref (page);
+		ev_document_unlock (job->document);
+
+		if (text)
+			ev_search_index_add_page (index, i, text);
+		g_free (text);
+	}
+
+	/* Pages indexed before the job was cancelled are saved too,
+	 * the next job goes on from there.
+	 */
+	ev_search_index_save (index);
+
+	if (!g_cancellable_is_cancelled (job->cancellable))
+		ev_job_succeeded (job);
+
+	return FALSE;
+}
+
+static void
+ev_job_index_class_init (EvJobIndexClass *class)
+{
+	EvJobClass *job_class = EV_JOB_CLASS (class);
+
+	job_class->run = ev_job_index_run;
+}
+
+/**
+ * ev_job_index_new:
+ * @document: an #EvDocument
+ *
+ * Creates a job that indexes the text of the pages of @document in the
+ * background and saves the index in the user cache dir. Searches done
+ * with #EvJobFind use the index to skip the pages that cannot match.
+ *
+ * Returns: (transfer full): a new #EvJobIndex
+ *
+ * Since: 44.0
+ */
+EvJob *
+ev_job_index_new (EvDocument *document)
+{
+	EvJob *job;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = g_object_new (EV_TYPE_JOB_INDEX, NULL);
+	job->document = g_object_ref (document);
+
+	return job;
+}
+
+/* EvJobPageSizes */
+static void
+ev_job_page_sizes_init (EvJobPageSizes *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static gboolean
+ev_job_page_sizes_commit_idle (EvJob *job)
+{
+	gint first_page, n_pages;
+
+	/* Batches filled from now on need another commit */
+	g_atomic_int_set (&EV_JOB_PAGE_SIZES (job)->commit_pending, FALSE);
+
+	if (ev_document_commit_cache (job->document, &first_page, &n_pages) &&
+	    !g_cancellable_is_cancelled (job->cancellable)) {
+		g_signal_emit (job, job_page_sizes_signals[PAGE_SIZES_UPDATED], 0,
+			       first_page, n_pages);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+ev_job_page_sizes_fill (EvJob *job,
+			gint   first_page,
+			gint   last_page)
+{
+	gint i;
+
+	for (i = first_page; i < last_page; i += PAGE_SIZES_BATCH) {
+		if (g_cancellable_is_cancelled (job->cancellable))
+			return;
+
+		ev_document_lock (job->document);
+		ev_document_fill_cache (job->document, i,
+					MIN (PAGE_SIZES_BATCH, last_page - i));
+		ev_document_unlock (job->document);
+
+		/* The batches filled before the main loop gets to it are
+		 * committed at once, and the views relayout once for them.
+		 */
+		if (g_atomic_int_compare_and_exchange (&EV_JOB_PAGE_SIZES (job)->commit_pending, FALSE, TRUE)) {
+			g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+					 (GSourceFunc) ev_job_page_sizes_commit_idle,
+					 g_object_ref (job),
+					 (GDestroyNotify) g_object_unref);
+		}
+	}
+}
+
+static gboolean
+ev_job_page_sizes_run (EvJob *job)
+{
+	EvJobPageSizes *job_sizes = EV_JOB_PAGE_SIZES (job);
+	gint            n_pages;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+	/* The pages from the start page on are the ones most likely
+	 * to be shown first.
+	 */
+	n_pages = ev_document_get_n_pages (job->document);
+	ev_job_page_sizes_fill (job, job_sizes->start_page, n_pages);
+	ev_job_page_sizes_fill (job, 0, job_sizes->start_page);
+
+	if (!g_cancellable_is_cancelled (job->cancellable))
+		ev_job_succeeded (job);
+
+	return FALSE;
+}
+
+static void
+ev_job_page_sizes_class_init (EvJobPageSizesClass *class)
+{
+	EvJobClass *job_class = EV_JOB_CLASS (class);
+
+	job_class->run = ev_job_page_sizes_run;
+
+	/**
+	 * EvJobPageSizes::updated:
+	 * @job: the #EvJobPageSizes
+	 * @first_page: the first page whose size may have changed
+	 * @n_pages: the number of pages whose size may have changed
+	 *
+	 * Emitted in the main thread when the sizes of some pages have
+	 * been added to the cache of the document.
+	 *
+	 * Since: 44.0
+	 */
+	job_page_sizes_signals[PAGE_SIZES_UPDATED] =
+		g_signal_new ("updated",
+			      EV_TYPE_JOB_PAGE_SIZES,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EvJobPageSizesClass, updated),
+			      NULL, NULL,
+			      ev_view_marshal_VOID__INT_INT,
+			      G_TYPE_NONE,
+			      2, G_TYPE_INT, G_TYPE_INT);
+}
+
+/**
+ * ev_job_page_sizes_new:
+ * @document: an #EvDocument loaded with %EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE
+ * @start_page: the page to start from
+ *
+ * Creates a job that fills the cache of page sizes and labels of
+ * @document in the background, starting from @start_page.
+ *
+ * Returns: (transfer full): a new #EvJobPageSizes
+ *
+ * Since: 44.0
+ */
+EvJob *
+ev_job_page_sizes_new (EvDocument *document,
+		       gint        start_page)
+{
+	EvJobPageSizes *job;
+
+	ev_debug_message (DEBUG_JOBS, "%d", start_page);
+
+	job = g_object_new (EV_TYPE_JOB_PAGE_SIZES, NULL);
+	EV_JOB (job)->document = g_object_ref (document);
+	job->start_page = CLAMP (start_page, 0, MAX (ev_document_get_n_pages (document) - 1, 0));
+
+	return EV_JOB (job);
+}
+
+static void
+page_sizes_job_finished_cb (EvJob *job)
+{
+	g_object_set_data (G_OBJECT (job->document), EV_JOB_PAGE_SIZES_KEY, NULL);
+}
+
+/**
+ * ev_job_page_sizes_get_for_document:
+ * @document: an #EvDocument
+ * @start_page: the page to start from if the job is created
+ *
+ * Gets the job filling the cache of page sizes of @document, which is
+ * shared by all its users, and schedules it if it is not running yet.
+ * Connect to #EvJobPageSizes::updated to follow the sizes of the pages
+ * while they become known. Every call must be balanced by a call to
+ * ev_job_page_sizes_release() once the job is not needed anymore.
+ *
+ * Returns: (transfer none) (nullable): the #EvJobPageSizes of @document,
+ *   or %NULL if the sizes of all the pages are known
+ *
+ * Since: 44.0
+ */
+EvJob *
+ev_job_page_sizes_get_for_document (EvDocument *document,
+				    gint        start_page)
+{
+	EvJob *job;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
+
+	if (ev_document_is_cache_complete (document))
+		return NULL;
+
+	job = g_object_get_data (G_OBJECT (document), EV_JOB_PAGE_SIZES_KEY);
+	if (job) {
+		EV_JOB_PAGE_SIZES (job)->n_users++;
+		return job;
+	}
+
+	job = ev_job_page_sizes_new (document, start_page);
+	g_object_set_data_full (G_OBJECT (document),
+				EV_JOB_PAGE_SIZES_KEY,
+				job,
+				(GDestroyNotify) g_object_unref);
+	g_signal_connect (job, "finished",
+			  G_CALLBACK (page_sizes_job_finished_cb),
+			  NULL);
+	EV_JOB_PAGE_SIZES (job)->n_users = 1;
+	ev_job_scheduler_push_job (job, EV_JOB_PRIORITY_LOW);
+
+	return job;
+}
+
+/**
+ * ev_job_page_sizes_release:
+ * @job: an #EvJobPageSizes returned by ev_job_page_sizes_get_for_document()
+ *
+ * Releases a use of @job. When it has no users left and it is still
+ * running, it is cancelled, so that it does not keep the document alive
+ * and a worker busy once the document is closed. The pages whose size
+ * is known stay in the cache of the document.
+ *
+ * Since: 44.0
+ */
+void
+ev_job_page_sizes_release (EvJobPageSizes *job)
+{
+	EvJob *ev_job = EV_JOB (job);
+
+	g_return_if_fail (EV_IS_JOB_PAGE_SIZES (job));
+	g_return_if_fail (job->n_users > 0);
+
+	if (--job->n_users > 0 || ev_job_is_finished (ev_job))
+		return;
+
+	ev_job_cancel (ev_job);
+	if (g_object_get_data (G_OBJECT (ev_job->document), EV_JOB_PAGE_SIZES_KEY) == job)
+		g_object_set_data (G_OBJECT (ev_job->document), EV_JOB_PAGE_SIZES_KEY, NULL);
+}
+
 /* EvJobLayers */
 static void
 ev_job_layers_init (EvJobLayers *job)
@@ -2182,9 +2958,9 @@ ev_job_layers_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	job_layers->model = ev_document_layers_get_layers (EV_DOCUMENT_LAYERS (job->document));
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 	
 	ev_job_succeeded (job);
 	
@@ -2250,7 +3026,7 @@ ev_job_export_run (EvJob *job)
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 	
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 	
 	ev_page = ev_document_get_page (job->document, job_export->page);
 	if (job_export->rc) {
@@ -2266,7 +3042,7 @@ ev_job_export_run (EvJob *job)
 	
 	ev_file_exporter_do_page (EV_FILE_EXPORTER (job->document), job_export->rc);
 	
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 	
 	ev_job_succeeded (job);
 	
@@ -2345,14 +3121,14 @@ ev_job_print_run (EvJob *job)
 	job->finished = FALSE;
 	g_clear_error (&job->error);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (job->document);
 
 	ev_page = ev_document_get_page (job->document, job_print->page);
 	ev_document_print_print_page (EV_DOCUMENT_PRINT (job->document),
 				      ev_page, job_print->cr);
 	g_object_unref (ev_page);
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (job->document);
 
         if (g_cancellable_is_cancelled (job->cancellable))
                 return FALSE;
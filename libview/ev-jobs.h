@@ -74,6 +74,12 @@ typedef struct _EvJobSaveClass EvJobSaveClass;
 typedef struct _EvJobFind EvJobFind;
 typedef struct _EvJobFindClass EvJobFindClass;
 
+typedef struct _EvJobIndex EvJobIndex;
+typedef struct _EvJobIndexClass EvJobIndexClass;
+
+typedef struct _EvJobPageSizes EvJobPageSizes;
+typedef struct _EvJobPageSizesClass EvJobPageSizesClass;
+
 typedef struct _EvJobLayers EvJobLayers;
 typedef struct _EvJobLayersClass EvJobLayersClass;
 
@@ -182,6 +188,20 @@ typedef struct _EvJobPrintClass EvJobPrintClass;
 #define EV_IS_JOB_FIND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_FIND))
 #define EV_JOB_FIND_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_FIND, EvJobFindClass))
 
+#define EV_TYPE_JOB_INDEX            (ev_job_index_get_type())
+#define EV_JOB_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_INDEX, EvJobIndex))
+#define EV_IS_JOB_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_INDEX))
+#define EV_JOB_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_INDEX, EvJobIndexClass))
+#define EV_IS_JOB_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_INDEX))
+#define EV_JOB_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_INDEX, EvJobIndexClass))
+
+#define EV_TYPE_JOB_PAGE_SIZES            (ev_job_page_sizes_get_type())
+#define EV_JOB_PAGE_SIZES(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_PAGE_SIZES, EvJobPageSizes))
+#define EV_IS_JOB_PAGE_SIZES(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_PAGE_SIZES))
+#define EV_JOB_PAGE_SIZES_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_PAGE_SIZES, EvJobPageSizesClass))
+#define EV_IS_JOB_PAGE_SIZES_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_PAGE_SIZES))
+#define EV_JOB_PAGE_SIZES_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_PAGE_SIZES, EvJobPageSizesClass))
+
 #define EV_TYPE_JOB_LAYERS            (ev_job_layers_get_type())
 #define EV_JOB_LAYERS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_LAYERS, EvJobLayers))
 #define EV_IS_JOB_LAYERS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_LAYERS))
@@ -294,6 +314,13 @@ struct _EvJobRender
 	EvSelectionStyle selection_style;
 	GdkColor base;
 	GdkColor text;
+
+	/* Area of the page to render, the whole page when empty */
+	cairo_rectangle_int_t area;
+
+	/* Rendering of the page in the version of the document it was
+	 * reloaded from, used instead if the page did not change */
+	cairo_surface_t *previous_surface;
 };
 
 struct _EvJobRenderClass
@@ -329,12 +356,15 @@ struct _EvJobPageData
 	EvMappingList  *annot_mapping;
         EvMappingList  *media_mapping;
 	cairo_region_t *text_mapping;
+
+	/* The text fields point into page_text, which owns them */
 	gchar *text;
 	EvRectangle *text_layout;
 	guint text_layout_length;
         PangoAttrList *text_attrs;
         PangoLogAttr *text_log_attrs;
         gulong text_log_attrs_length;
+	struct _EvPageText *page_text;
 };
 
 struct _EvJobPageDataClass
@@ -362,6 +392,10 @@ struct _EvJobThumbnail
 
         EvJobThumbnailFormat format;
         cairo_surface_t *thumbnail_surface;
+
+	/* Thumbnail of the page in the version of the document it was
+	 * reloaded from, used instead if the page did not change */
+	cairo_surface_t *previous_surface;
 };
 
 struct _EvJobThumbnailClass
@@ -390,6 +424,7 @@ struct _EvJobLoad
 
 	gchar *uri;
 	gchar *password;
+	EvDocumentLoadFlags flags;
 };
 
 struct _EvJobLoadClass
@@ -476,6 +511,35 @@ struct _EvJobFindClass
 			   gint       page);
 };
 
+struct _EvJobIndex
+{
+	EvJob parent;
+};
+
+struct _EvJobIndexClass
+{
+	EvJobClass parent_class;
+};
+
+struct _EvJobPageSizes
+{
+	EvJob parent;
+
+	gint start_page;
+	gint commit_pending; /* atomic */
+	gint n_users;
+};
+
+struct _EvJobPageSizesClass
+{
+	EvJobClass parent_class;
+
+	/* Signals */
+	void (* updated)  (EvJobPageSizes *job,
+			   gint            first_page,
+			   gint            n_pages);
+};
+
 struct _EvJobLayers
 {
 	EvJob parent;
@@ -578,6 +642,12 @@ void     ev_job_render_set_selection_info (EvJobRender     *job,
 					   EvSelectionStyle selection_style,
 					   GdkColor        *text,
 					   GdkColor        *base);
+EV_PUBLIC
+void     ev_job_render_set_area           (EvJobRender     *job,
+					   const cairo_rectangle_int_t *area);
+EV_PUBLIC
+void     ev_job_render_set_previous_surface (EvJobRender     *job,
+					     cairo_surface_t *surface);
 /* EvJobPageData */
 EV_PUBLIC
 GType           ev_job_page_data_get_type (void) G_GNUC_CONST;
@@ -606,6 +676,9 @@ void            ev_job_thumbnail_set_has_frame (EvJobThumbnail  *job,
 EV_PUBLIC
 void            ev_job_thumbnail_set_output_format (EvJobThumbnail      *job,
                                                     EvJobThumbnailFormat format);
+EV_PUBLIC
+void            ev_job_thumbnail_set_previous_surface (EvJobThumbnail  *job,
+                                                       cairo_surface_t *surface);
 /* EvJobFonts */
 EV_PUBLIC
 GType 		ev_job_fonts_get_type 	  (void) G_GNUC_CONST;
@@ -623,6 +696,9 @@ void            ev_job_load_set_uri       (EvJobLoad       *load,
 EV_PUBLIC
 void            ev_job_load_set_password  (EvJobLoad       *job,
 					   const gchar     *password);
+EV_PUBLIC
+void            ev_job_load_set_load_flags (EvJobLoad      *job,
+					    EvDocumentLoadFlags flags);
 
 /* EvJobLoadStream */
 EV_PUBLIC
@@ -722,10 +798,31 @@ gint            ev_job_find_get_n_main_results (EvJobFind  *job,
 EV_PUBLIC
 gdouble         ev_job_find_get_progress  (EvJobFind       *job);
 EV_PUBLIC
+gboolean        ev_job_find_is_page_searched (EvJobFind    *job,
+					      gint          page);
+EV_PUBLIC
 gboolean        ev_job_find_has_results   (EvJobFind       *job);
 EV_PUBLIC
 GList         **ev_job_find_get_results   (EvJobFind       *job);
 
+/* EvJobIndex */
+EV_PUBLIC
+GType           ev_job_index_get_type     (void) G_GNUC_CONST;
+EV_PUBLIC
+EvJob          *ev_job_index_new          (EvDocument      *document);
+
+/* EvJobPageSizes */
+EV_PUBLIC
+GType           ev_job_page_sizes_get_type (void) G_GNUC_CONST;
+EV_PUBLIC
+EvJob          *ev_job_page_sizes_new      (EvDocument     *document,
+					    gint            start_page);
+EV_PUBLIC
+EvJob          *ev_job_page_sizes_get_for_document (EvDocument *document,
+						    gint        start_page);
+EV_PUBLIC
+void            ev_job_page_sizes_release  (EvJobPageSizes *job);
+
 /* EvJobLayers */
 EV_PUBLIC
 GType           ev_job_layers_get_type    (void) G_GNUC_CONST;
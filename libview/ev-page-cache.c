@@ -31,6 +31,7 @@
 #include "ev-document-media.h"
 #include "ev-document-text.h"
 #include "ev-page-cache.h"
+#include "ev-page-text.h"
 
 enum {
   PAGE_CACHED,
@@ -51,12 +52,7 @@ typedef struct _EvPageCacheData {
 	EvMappingList     *annot_mapping;
         EvMappingList     *media_mapping;
 	cairo_region_t    *text_mapping;
-	EvRectangle       *text_layout;
-	guint              text_layout_length;
-	gchar             *text;
-	PangoAttrList     *text_attrs;
-        PangoLogAttr      *text_log_attrs;
-        gulong             text_log_attrs_length;
+	EvPageText        *page_text;
 } EvPageCacheData;
 
 struct _EvPageCache {
@@ -85,6 +81,12 @@ struct _EvPageCacheClass {
 	EV_PAGE_DATA_INCLUDE_ANNOTS       | \
         EV_PAGE_DATA_INCLUDE_MEDIA)
 
+#define EV_PAGE_DATA_TEXT_FLAGS (            \
+	EV_PAGE_DATA_INCLUDE_TEXT           | \
+	EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT    | \
+	EV_PAGE_DATA_INCLUDE_TEXT_ATTRS     | \
+	EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS)
+
 #define PRE_CACHE_SIZE 1
 
 static void job_page_data_finished_cb (EvJob       *job,
@@ -132,27 +134,10 @@ ev_page_cache_data_free (EvPageCacheData *data)
 		data->text_mapping = NULL;
 	}
 
-	if (data->text_layout) {
-		g_free (data->text_layout);
-		data->text_layout = NULL;
-		data->text_layout_length = 0;
-	}
-
-	if (data->text) {
-		g_free (data->text);
-		data->text = NULL;
-	}
-
-	if (data->text_attrs) {
-		pango_attr_list_unref (data->text_attrs);
-		data->text_attrs = NULL;
+	if (data->page_text) {
+		ev_page_text_unref (data->page_text);
+		data->page_text = NULL;
 	}
-
-        if (data->text_log_attrs) {
-                g_free (data->text_log_attrs);
-                data->text_log_attrs = NULL;
-                data->text_log_attrs_length = 0;
-        }
 }
 
 static void
@@ -260,29 +245,33 @@ ev_page_cache_get_flags_for_data (EvPageCache     *cache,
 	}
 
 	if (cache->flags & EV_PAGE_DATA_INCLUDE_TEXT) {
-		flags = (data->text) ?
+		flags = (data->page_text && data->page_text->text) ?
 			flags & ~EV_PAGE_DATA_INCLUDE_TEXT :
 			flags | EV_PAGE_DATA_INCLUDE_TEXT;
 	}
 
 	if (cache->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
-		flags = (data->text_layout_length > 0) ?
+		flags = (data->page_text && data->page_text->n_layout > 0) ?
 			flags & ~EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT :
 			flags | EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT;
 	}
 
         if (cache->flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS) {
-                flags = (data->text_attrs) ?
+                flags = (data->page_text && data->page_text->attrs) ?
                         flags & ~EV_PAGE_DATA_INCLUDE_TEXT_ATTRS :
                         flags | EV_PAGE_DATA_INCLUDE_TEXT_ATTRS;
         }
 
         if (cache->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) {
-                flags = (data->text_log_attrs) ?
+                flags = (data->page_text && data->page_text->log_attrs) ?
                         flags & ~EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS :
                         flags | EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS;
         }
 
+	/* All the text parts are replaced by the page text of the job */
+	if (flags & EV_PAGE_DATA_TEXT_FLAGS)
+		flags |= cache->flags & EV_PAGE_DATA_TEXT_FLAGS;
+
 	return flags;
 }
 
@@ -323,18 +312,13 @@ job_page_data_finished_cb (EvJob       *job,
                 data->media_mapping = job_data->media_mapping;
 	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING)
 		data->text_mapping = job_data->text_mapping;
-	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
-		data->text_layout = job_data->text_layout;
-		data->text_layout_length = job_data->text_layout_length;
+	if (job_data->page_text) {
+		/* The shared text of the page, with the parts that were
+		 * already cached and the ones fetched by the job.
+		 */
+		g_clear_pointer (&data->page_text, ev_page_text_unref);
+		data->page_text = g_steal_pointer (&job_data->page_text);
 	}
-	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT)
-		data->text = job_data->text;
-	if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS)
-		data->text_attrs = job_data->text_attrs;
-        if (job_data->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) {
-                data->text_log_attrs = job_data->text_log_attrs;
-                data->text_log_attrs_length = job_data->text_log_attrs_length;
-        }
 
 	data->done = TRUE;
 	data->dirty = FALSE;
@@ -464,21 +448,8 @@ ev_page_cache_mark_dirty (EvPageCache       *cache,
 	if (flags & EV_PAGE_DATA_INCLUDE_TEXT_MAPPING)
                 g_clear_pointer (&data->text_mapping, cairo_region_destroy);
 
-	if (flags & EV_PAGE_DATA_INCLUDE_TEXT)
-                g_clear_pointer (&data->text, g_free);
-
-	if (flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) {
-                g_clear_pointer (&data->text_layout, g_free);
-                data->text_layout_length = 0;
-        }
-
-        if (flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS)
-                g_clear_pointer (&data->text_attrs, pango_attr_list_unref);
-
-        if (flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) {
-                g_clear_pointer (&data->text_log_attrs, g_free);
-                data->text_log_attrs_length = 0;
-        }
+	if (flags & EV_PAGE_DATA_TEXT_FLAGS)
+                g_clear_pointer (&data->page_text, ev_page_text_unref);
 
 	/* Update the current range */
 	ev_page_cache_set_page_range (cache, cache->start_page, cache->end_page);
@@ -629,13 +600,10 @@ ev_page_cache_get_text (EvPageCache *cache,
 		return NULL;
 
 	data = &cache->page_list[page];
-	if (data->done)
-		return data->text;
-
-	if (data->job)
+	if (!data->done && data->job)
 		return EV_JOB_PAGE_DATA (data->job)->text;
 
-	return data->text;
+	return data->page_text ? data->page_text->text : NULL;
 }
 
 gboolean
@@ -654,8 +622,8 @@ ev_page_cache_get_text_layout (EvPageCache  *cache,
 
 	data = &cache->page_list[page];
 	if (data->done)	{
-		*areas = data->text_layout;
-		*n_areas = data->text_layout_length;
+		*areas = data->page_text ? data->page_text->layout : NULL;
+		*n_areas = data->page_text ? data->page_text->n_layout : 0;
 
 		return TRUE;
 	}
@@ -692,13 +660,10 @@ ev_page_cache_get_text_attrs (EvPageCache    *cache,
 	    return NULL;
 
 	data = &cache->page_list[page];
-	if (data->done)
-		return data->text_attrs;
-
-	if (data->job)
+	if (!data->done && data->job)
 		return EV_JOB_PAGE_DATA(data->job)->text_attrs;
 
-	return data->text_attrs;
+	return data->page_text ? data->page_text->attrs : NULL;
 }
 
 /**
@@ -730,8 +695,8 @@ ev_page_cache_get_text_log_attrs (EvPageCache   *cache,
 
         data = &cache->page_list[page];
         if (data->done) {
-                *log_attrs = data->text_log_attrs;
-                *n_attrs = data->text_log_attrs_length;
+                *log_attrs = data->page_text ? data->page_text->log_attrs : NULL;
+                *n_attrs = data->page_text ? data->page_text->n_log_attrs : 0;
 
                 return TRUE;
         }
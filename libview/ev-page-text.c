@@ -0,0 +1,334 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "ev-page-text.h"
+#include "ev-document-text.h"
+#include "ev-debug.h"
+
+#define EV_PAGE_TEXT_STORE_KEY "ev-page-text-store"
+#define DEFAULT_MAX_SIZE 33554432 /* 32MB */
+
+/* Rough size of the attributes of a page, they are not counted */
+#define ATTRS_SIZE 4096
+
+#define EV_PAGE_TEXT_FLAGS (                  \
+	EV_PAGE_DATA_INCLUDE_TEXT           | \
+	EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT    | \
+	EV_PAGE_DATA_INCLUDE_TEXT_ATTRS     | \
+	EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS)
+
+typedef struct _EvPageTextStore EvPageTextStore;
+
+typedef struct {
+	EvPageText         page_text;
+	gint               ref_count;
+
+	/* Protected by store_mutex */
+	EvJobPageDataFlags flags;
+	gsize              size;
+	EvPageTextStore   *store;
+	gint               page;
+	GList             *link;
+} EvPageTextEntry;
+
+/* Pages of a document, attached to it so that they are dropped
+ * when the document is finalized.
+ */
+struct _EvPageTextStore {
+	GHashTable *pages;
+};
+
+/* All the entries of all the stores are in the LRU queue, the most
+ * recently used first, and are dropped from the tail when the size
+ * of the text goes over max_size. Entries still referenced elsewhere
+ * stay alive until they are unreffed.
+ */
+static GMutex store_mutex;
+static GQueue lru = G_QUEUE_INIT;
+static gsize  store_size = 0;
+static gsize  max_size = DEFAULT_MAX_SIZE;
+
+G_DEFINE_BOXED_TYPE (EvPageText, ev_page_text, ev_page_text_ref, ev_page_text_unref)
+
+static void
+ev_page_text_entry_free (EvPageTextEntry *entry)
+{
+	g_free (entry->page_text.text);
+	g_free (entry->page_text.layout);
+	g_clear_pointer (&entry->page_text.attrs, pango_attr_list_unref);
+	g_free (entry->page_text.log_attrs);
+	g_free (entry);
+}
+
+/**
+ * ev_page_text_ref:
+ * @page_text: an #EvPageText
+ *
+ * Returns: (transfer full): @page_text
+ *
+ * Since: 44.0
+ */
+EvPageText *
+ev_page_text_ref (EvPageText *page_text)
+{
+	EvPageTextEntry *entry = (EvPageTextEntry *) page_text;
+
+	g_return_val_if_fail (page_text != NULL, NULL);
+
+	g_atomic_int_inc (&entry->ref_count);
+
+	return page_text;
+}
+
+/**
+ * ev_page_text_unref:
+ * @page_text: an #EvPageText
+ *
+ * Since: 44.0
+ */
+void
+ev_page_text_unref (EvPageText *page_text)
+{
+	EvPageTextEntry *entry = (EvPageTextEntry *) page_text;
+
+	g_return_if_fail (page_text != NULL);
+
+	if (g_atomic_int_dec_and_test (&entry->ref_count))
+		ev_page_text_entry_free (entry);
+}
+
+/* Called with store_mutex held */
+static void
+ev_page_text_remove_entry (EvPageTextEntry *entry)
+{
+	g_queue_delete_link (&lru, entry->link);
+	entry->link = NULL;
+	store_size -= entry->size;
+	entry->store = NULL;
+	ev_page_text_unref (&entry->page_text);
+}
+
+static void
+ev_page_text_store_free (EvPageTextStore *store)
+{
+	GHashTableIter iter;
+	gpointer       value;
+
+	g_mutex_lock (&store_mutex);
+	g_hash_table_iter_init (&iter, store->pages);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		ev_page_text_remove_entry (value);
+	g_mutex_unlock (&store_mutex);
+
+	g_hash_table_destroy (store->pages);
+	g_free (store);
+}
+
+/* Called with store_mutex held */
+static void
+ev_page_text_trim (void)
+{
+	while (store_size > max_size && lru.tail) {
+		EvPageTextEntry *entry = lru.tail->data;
+
+		g_hash_table_remove (entry->store->pages, GINT_TO_POINTER (entry->page));
+		ev_page_text_remove_entry (entry);
+	}
+}
+
+static gsize
+ev_page_text_entry_get_size (EvPageTextEntry *entry)
+{
+	EvPageText *page_text = &entry->page_text;
+	gsize       size = sizeof (EvPageTextEntry);
+
+	if (page_text->text)
+		size += strlen (page_text->text) + 1;
+	size += page_text->n_layout * sizeof (EvRectangle);
+	if (page_text->attrs)
+		size += ATTRS_SIZE;
+	size += (page_text->n_log_attrs + 1) * sizeof (PangoLogAttr);
+
+	return size;
+}
+
+/* Called with store_mutex held */
+static EvPageTextEntry *
+ev_page_text_lookup_entry (EvDocument *document,
+			   gint        page)
+{
+	EvPageTextStore *store;
+	EvPageTextEntry *entry;
+
+	store = g_object_get_data (G_OBJECT (document), EV_PAGE_TEXT_STORE_KEY);
+	if (!store) {
+		store = g_new0 (EvPageTextStore, 1);
+		store->pages = g_hash_table_new (NULL, NULL);
+		g_object_set_data_full (G_OBJECT (document),
+					EV_PAGE_TEXT_STORE_KEY,
+					store,
+					(GDestroyNotify) ev_page_text_store_free);
+	}
+
+	entry = g_hash_table_lookup (store->pages, GINT_TO_POINTER (page));
+	if (entry) {
+		g_queue_unlink (&lru, entry->link);
+		g_queue_push_head_link (&lru, entry->link);
+
+		return entry;
+	}
+
+	entry = g_new0 (EvPageTextEntry, 1);
+	entry->ref_count = 1;
+	entry->store = store;
+	entry->page = page;
+	entry->size = ev_page_text_entry_get_size (entry);
+	g_queue_push_head (&lru, entry);
+	entry->link = lru.head;
+	store_size += entry->size;
+	g_hash_table_insert (store->pages, GINT_TO_POINTER (page), entry);
+
+	return entry;
+}
+
+/**
+ * ev_page_text_get:
+ * @document: an #EvDocument
+ * @page: the index of the page
+ * @flags: the parts of the text to get: #EV_PAGE_DATA_INCLUDE_TEXT,
+ *   #EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT, #EV_PAGE_DATA_INCLUDE_TEXT_ATTRS
+ *   and #EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS
+ *
+ * Returns the text of @page. The parts in @flags that were not fetched
+ * yet for the page are fetched from the document, which is locked while
+ * doing so. This can be called from any thread, but it must not be
+ * called with the document locked.
+ *
+ * Returns: (transfer full) (nullable): the #EvPageText of @page, or %NULL
+ *   if @document has no text
+ *
+ * Since: 44.0
+ */
+EvPageText *
+ev_page_text_get (EvDocument         *document,
+		  gint                page,
+		  EvJobPageDataFlags  flags)
+{
+	EvPageTextEntry   *entry;
+	EvJobPageDataFlags missing;
+	gchar             *text = NULL;
+	EvRectangle       *layout = NULL;
+	guint              n_layout = 0;
+	PangoAttrList     *attrs = NULL;
+	PangoLogAttr      *log_attrs = NULL;
+	gulong             n_log_attrs = 0;
+	const gchar       *page_text;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
+	g_return_val_if_fail (page >= 0 && page < ev_document_get_n_pages (document), NULL);
+
+	if (!EV_IS_DOCUMENT_TEXT (document))
+		return NULL;
+
+	flags &= EV_PAGE_TEXT_FLAGS;
+	if (flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS)
+		flags |= EV_PAGE_DATA_INCLUDE_TEXT;
+
+	g_mutex_lock (&store_mutex);
+	entry = ev_page_text_lookup_entry (document, page);
+	ev_page_text_ref (&entry->page_text);
+	missing = flags & ~entry->flags;
+	page_text = entry->page_text.text;
+	g_mutex_unlock (&store_mutex);
+
+	if (!missing)
+		return &entry->page_text;
+
+	ev_debug_message (DEBUG_JOBS, "page: %d flags: %d", page, missing);
+
+	if (missing & (EV_PAGE_DATA_INCLUDE_TEXT |
+		       EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT |
+		       EV_PAGE_DATA_INCLUDE_TEXT_ATTRS)) {
+		EvDocumentText *document_text = EV_DOCUMENT_TEXT (document);
+		EvPage         *ev_page;
+
+		ev_document_lock (document);
+		ev_page = ev_document_get_page (document, page);
+		if (missing & EV_PAGE_DATA_INCLUDE_TEXT)
+			text = ev_document_text_get_text (document_text, ev_page);
+		if ((missing & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) &&
+		    !ev_document_text_get_text_layout (document_text, ev_page, &layout, &n_layout)) {
+			layout = NULL;
+			n_layout = 0;
+		}
+		if (missing & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS)
+			attrs = ev_document_text_get_text_attrs (document_text, ev_page);
+		g_object_unref (ev_page);
+		ev_document_unlock (document);
+	}
+
+	if (missing & EV_PAGE_DATA_INCLUDE_TEXT)
+		page_text = text;
+
+	if ((missing & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) && page_text) {
+		n_log_attrs = g_utf8_strlen (page_text, -1);
+		log_attrs = g_new0 (PangoLogAttr, n_log_attrs + 1);
+
+		/* FIXME: We need API to get the language of the document */
+		pango_get_log_attrs (page_text, -1, -1, NULL, log_attrs, n_log_attrs + 1);
+	}
+
+	/* Another thread may have fetched the same parts meanwhile,
+	 * the first ones are kept since they may already be in use.
+	 */
+	g_mutex_lock (&store_mutex);
+	if ((missing & EV_PAGE_DATA_INCLUDE_TEXT) && !(entry->flags & EV_PAGE_DATA_INCLUDE_TEXT)) {
+		entry->page_text.text = g_steal_pointer (&text);
+	}
+	if ((missing & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT) && !(entry->flags & EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT)) {
+		entry->page_text.layout = g_steal_pointer (&layout);
+		entry->page_text.n_layout = n_layout;
+	}
+	if ((missing & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS) && !(entry->flags & EV_PAGE_DATA_INCLUDE_TEXT_ATTRS)) {
+		entry->page_text.attrs = g_steal_pointer (&attrs);
+	}
+	if ((missing & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS) && !(entry->flags & EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS)) {
+		entry->page_text.log_attrs = g_steal_pointer (&log_attrs);
+		entry->page_text.n_log_attrs = n_log_attrs;
+	}
+	entry->flags |= missing;
+
+	if (entry->store) {
+		store_size -= entry->size;
+		entry->size = ev_page_text_entry_get_size (entry);
+		store_size += entry->size;
+		ev_page_text_trim ();
+	}
+	g_mutex_unlock (&store_mutex);
+
+	/* Parts that were already set */
+	g_free (text);
+	g_free (layout);
+	g_clear_pointer (&attrs, pango_attr_list_unref);
+	g_free (log_attrs);
+
+	return &entry->page_text;
+}
@@ -0,0 +1,72 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#if !defined (__EV_EVINCE_VIEW_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-view.h> can be included directly."
+#endif
+
+#include <glib-object.h>
+#include <pango/pango.h>
+
+#include <evince-document.h>
+
+#include "ev-jobs.h"
+
+G_BEGIN_DECLS
+
+#define EV_TYPE_PAGE_TEXT (ev_page_text_get_type ())
+
+typedef struct _EvPageText EvPageText;
+
+/**
+ * EvPageText:
+ * @text: the text of the page, or %NULL
+ * @layout: (array length=n_layout): the area of every character of @text
+ * @n_layout: the number of elements of @layout
+ * @attrs: the text attributes of @text, or %NULL
+ * @log_attrs: (array length=n_log_attrs): the logical attributes of @text
+ * @n_log_attrs: the number of elements of @log_attrs
+ *
+ * The text of a page, shared by all the users of the page. The fields
+ * are read only, and only the parts requested with ev_page_text_get()
+ * are set.
+ *
+ * Since: 44.0
+ */
+struct _EvPageText {
+	gchar         *text;
+	EvRectangle   *layout;
+	guint          n_layout;
+	PangoAttrList *attrs;
+	PangoLogAttr  *log_attrs;
+	gulong         n_log_attrs;
+};
+
+EV_PUBLIC
+GType       ev_page_text_get_type (void) G_GNUC_CONST;
+EV_PUBLIC
+EvPageText *ev_page_text_get      (EvDocument         *document,
+				   gint                page,
+				   EvJobPageDataFlags  flags);
+EV_PUBLIC
+EvPageText *ev_page_text_ref      (EvPageText         *page_text);
+EV_PUBLIC
+void        ev_page_text_unref    (EvPageText         *page_text);
+
+G_END_DECLS
@@ -1,13 +1,22 @@
 #include <config.h>
+#include <math.h>
+#include <string.h>
 #include "ev-pixbuf-cache.h"
 #include "ev-job-scheduler.h"
 #include "ev-view-private.h"
+#include "ev-surface-cache.h"
+#include "ev-reload-cache.h"
+#include "ev-debug.h"
 
 typedef enum {
         SCROLL_DIRECTION_DOWN,
         SCROLL_DIRECTION_UP
 } ScrollDirection;
 
+/* Maximum number of previous scales whose tiles are kept */
+#define MAX_SCALE_GENERATIONS 4
+#define DEFAULT_SCALE_GENERATIONS 1
+
 typedef struct _CacheJobInfo
 {
 	EvJob *job;
@@ -19,6 +28,11 @@ typedef struct _CacheJobInfo
 	/* Data we get from rendering */
 	cairo_surface_t *surface;
 
+	/* Low resolution rendering of the page, drawn until surface
+	 * is ready. */
+	EvJob           *preview_job;
+	cairo_surface_t *preview_surface;
+
 	/* Device scale factor of target widget */
 	int device_scale;
 
@@ -38,6 +52,32 @@ typedef struct _CacheJobInfo
 	EvRectangle     selection_region_points;
 } CacheJobInfo;
 
+/* Pages too big to be cached as a single surface are rendered in tiles,
+ * only the tiles intersecting the visible area are rendered.
+ */
+typedef struct _CacheTileKey
+{
+	gint page;
+	gint scale_bucket;
+	gint rotation;
+	gint tile_x;
+	gint tile_y;
+} CacheTileKey;
+
+typedef struct _CacheTile
+{
+	CacheTileKey   key;
+	EvPixbufCache *pixbuf_cache;
+	EvJob         *job;
+
+	cairo_surface_t *surface;
+	int              device_scale;
+	guint            n_failures;
+
+	/* Link in the tiles LRU queue */
+	GList           *link;
+} CacheTile;
+
 struct _EvPixbufCache
 {
 	GObject parent;
@@ -60,9 +100,36 @@ struct _EvPixbufCache
 	int preload_cache_size;
 	guint job_list_len;
 
+	/* Pages actually preloaded in the scroll direction and in the
+	 * opposite one, at most preload_cache_size each. */
+	gint preload_ahead;
+	gint preload_behind;
+
+	/* Vertical scroll velocity in pixels per second, positive when
+	 * scrolling down */
+	gdouble scroll_velocity;
+
+	/* Pages that were already rendered, or not, when they became visible */
+	guint preload_hits;
+	guint preload_misses;
+
 	CacheJobInfo *prev_job;
 	CacheJobInfo *job_list;
 	CacheJobInfo *next_job;
+
+	/* Tiles of pages bigger than max_size / TILED_PAGE_SIZE_DIVISOR,
+	 * sharing the max_size budget with the page surfaces. Most
+	 * recently used tiles are at the head of tiles_lru.
+	 */
+	GHashTable *tiles;
+	GQueue      tiles_lru;
+	gsize       tiles_size;
+
+	/* Scale buckets of the tiles kept, the current one first. Tiles
+	 * of previous scales are drawn until the current ones are ready.
+	 */
+	guint scale_generations;
+	gint  scale_history[MAX_SCALE_GENERATIONS + 1];
 };
 
 struct _EvPixbufCacheClass
@@ -87,8 +154,12 @@ static void          ev_pixbuf_cache_finalize   (GObject            *object);
 static void          ev_pixbuf_cache_dispose    (GObject            *object);
 static void          job_finished_cb            (EvJob              *job,
 						 EvPixbufCache      *pixbuf_cache);
+static void          preview_job_finished_cb    (EvJob              *job,
+						 EvPixbufCache      *pixbuf_cache);
 static CacheJobInfo *find_job_cache             (EvPixbufCache      *pixbuf_cache,
 						 int                 page);
+static void          ev_pixbuf_cache_trim       (EvPixbufCache      *pixbuf_cache,
+						 CacheTile          *keep);
 static gboolean      new_selection_surface_needed(EvPixbufCache      *pixbuf_cache,
 						  CacheJobInfo       *job_info,
 						  gint                page,
@@ -105,13 +176,87 @@ static gboolean      new_selection_surface_needed(EvPixbufCache      *pixbuf_cac
 
 #define MAX_PRELOADED_PAGES 3
 
+/* When scrolling fast, pages expected to become visible within
+ * PRELOAD_LOOKAHEAD_TIME seconds are preloaded too, up to
+ * MAX_PREDICTED_PAGES, and only one page is kept behind. */
+#define MAX_PREDICTED_PAGES 12
+#define PRELOAD_LOOKAHEAD_TIME 0.5
+
+/* Size of the tiles in widget pixels */
+#define TILE_SIZE 256
+#define TILED_PAGE_SIZE_DIVISOR 4
+/* Times a tile that failed to render is queued again */
+#define MAX_TILE_RETRIES 2
+
+/* Previews are rendered at a quarter of the scale, and never bigger
+ * than PREVIEW_MAX_PIXELS */
+#define PREVIEW_SCALE_DIVISOR 4
+#define PREVIEW_MAX_PIXELS (1024 * 1024)
+
 G_DEFINE_TYPE (EvPixbufCache, ev_pixbuf_cache, G_TYPE_OBJECT)
 
+static guint
+cache_tile_key_hash (gconstpointer data)
+{
+	const CacheTileKey *key = data;
+
+	return (((key->page * 31 + key->scale_bucket) * 31 + key->rotation) * 31 +
+		key->tile_x) * 31 + key->tile_y;
+}
+
+static gboolean
+cache_tile_key_equal (gconstpointer a,
+		      gconstpointer b)
+{
+	const CacheTileKey *key_a = a;
+	const CacheTileKey *key_b = b;
+
+	return key_a->page == key_b->page &&
+		key_a->scale_bucket == key_b->scale_bucket &&
+		key_a->rotation == key_b->rotation &&
+		key_a->tile_x == key_b->tile_x &&
+		key_a->tile_y == key_b->tile_y;
+}
+
+static gsize
+cache_tile_get_size (CacheTile *tile)
+{
+	if (!tile->surface)
+		return 0;
+
+	return cairo_image_surface_get_height (tile->surface) *
+		cairo_image_surface_get_stride (tile->surface);
+}
+
+static void
+cache_tile_free (CacheTile *tile)
+{
+	EvPixbufCache *pixbuf_cache = tile->pixbuf_cache;
+
+	if (tile->job) {
+		g_signal_handlers_disconnect_by_data (tile->job, tile);
+		ev_job_cancel (tile->job);
+		g_object_unref (tile->job);
+	}
+
+	pixbuf_cache->tiles_size -= cache_tile_get_size (tile);
+	g_queue_delete_link (&pixbuf_cache->tiles_lru, tile->link);
+	g_clear_pointer (&tile->surface, cairo_surface_destroy);
+
+	g_free (tile);
+}
+
 static void
 ev_pixbuf_cache_init (EvPixbufCache *pixbuf_cache)
 {
 	pixbuf_cache->start_page = -1;
 	pixbuf_cache->end_page = -1;
+	pixbuf_cache->scale_generations = DEFAULT_SCALE_GENERATIONS;
+
+	pixbuf_cache->tiles = g_hash_table_new_full (cache_tile_key_hash,
+						     cache_tile_key_equal,
+						     NULL,
+						     (GDestroyNotify) cache_tile_free);
 }
 
 static void
@@ -159,6 +304,7 @@ ev_pixbuf_cache_finalize (GObject *object)
 	}
 
 	g_object_unref (pixbuf_cache->model);
+	g_hash_table_destroy (pixbuf_cache->tiles);
 
 	G_OBJECT_CLASS (ev_pixbuf_cache_parent_class)->finalize (object);
 }
@@ -175,6 +321,31 @@ end_job (CacheJobInfo *job_info,
 	job_info->job = NULL;
 }
 
+static void
+end_preview_job (CacheJobInfo *job_info,
+		 gpointer      data)
+{
+	g_signal_handlers_disconnect_by_func (job_info->preview_job,
+					      G_CALLBACK (preview_job_finished_cb),
+					      data);
+	ev_job_cancel (job_info->preview_job);
+	g_object_unref (job_info->preview_job);
+	job_info->preview_job = NULL;
+}
+
+static void
+clear_preview (CacheJobInfo *job_info,
+	       gpointer      data)
+{
+	if (job_info->preview_job)
+		end_preview_job (job_info, data);
+
+	if (job_info->preview_surface) {
+		cairo_surface_destroy (job_info->preview_surface);
+		job_info->preview_surface = NULL;
+	}
+}
+
 static void
 dispose_cache_job_info (CacheJobInfo *job_info,
 			gpointer      data)
@@ -184,6 +355,7 @@ dispose_cache_job_info (CacheJobInfo *job_info,
 
 	if (job_info->job)
 		end_job (job_info, data);
+	clear_preview (job_info, data);
 
 	if (job_info->surface) {
 		cairo_surface_destroy (job_info->surface);
@@ -222,6 +394,8 @@ ev_pixbuf_cache_dispose (GObject *object)
 		dispose_cache_job_info (pixbuf_cache->job_list + i, pixbuf_cache);
 	}
 
+	g_hash_table_remove_all (pixbuf_cache->tiles);
+
 	G_OBJECT_CLASS (ev_pixbuf_cache_parent_class)->dispose (object);
 }
 
@@ -276,6 +450,34 @@ set_device_scale_on_surface (cairo_surface_t *surface,
 #endif
 }
 
+/* Surfaces of the surface cache are shared with other views, they are
+ * copied before being modified */
+static cairo_surface_t *
+copy_surface (cairo_surface_t *surface)
+{
+	cairo_surface_t *copy;
+	guchar          *src, *dst;
+	gint             src_stride, dst_stride;
+	gint             height, y;
+
+	height = cairo_image_surface_get_height (surface);
+	copy = cairo_surface_create_similar_image (surface,
+						   cairo_image_surface_get_format (surface),
+						   cairo_image_surface_get_width (surface),
+						   height);
+
+	cairo_surface_flush (surface);
+	src = cairo_image_surface_get_data (surface);
+	src_stride = cairo_image_surface_get_stride (surface);
+	dst = cairo_image_surface_get_data (copy);
+	dst_stride = cairo_image_surface_get_stride (copy);
+	for (y = 0; y < height; y++)
+		memcpy (dst + y * dst_stride, src + y * src_stride, MIN (src_stride, dst_stride));
+	cairo_surface_mark_dirty (copy);
+
+	return copy;
+}
+
 static void
 copy_job_to_job_info (EvJobRender   *job_render,
 		      CacheJobInfo  *job_info,
@@ -284,11 +486,18 @@ copy_job_to_job_info (EvJobRender   *job_render,
 	if (job_info->surface) {
 		cairo_surface_destroy (job_info->surface);
 	}
-	job_info->surface = cairo_surface_reference (job_render->surface);
+	/* The previous surface of a reloaded page comes from the surface cache */
+	if (job_render->surface == job_render->previous_surface)
+		job_info->surface = copy_surface (job_render->surface);
+	else
+		job_info->surface = cairo_surface_reference (job_render->surface);
 	set_device_scale_on_surface (job_info->surface, job_info->device_scale);
 	if (pixbuf_cache->inverted_colors) {
 		ev_document_misc_invert_surface (job_info->surface);
 	}
+	ev_surface_cache_add (pixbuf_cache->document, job_render->page,
+			      job_render->rotation, pixbuf_cache->inverted_colors,
+			      job_info->surface);
 
 	job_info->points_set = FALSE;
 	if (job_render->include_selection) {
@@ -317,6 +526,7 @@ copy_job_to_job_info (EvJobRender   *job_render,
 
 	if (job_info->job)
 		end_job (job_info, pixbuf_cache);
+	clear_preview (job_info, pixbuf_cache);
 
 	job_info->page_ready = TRUE;
 }
@@ -344,9 +554,36 @@ job_finished_cb (EvJob         *job,
 	}
 
 	copy_job_to_job_info (job_render, job_info, pixbuf_cache);
+	ev_pixbuf_cache_trim (pixbuf_cache, NULL);
 	g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, job_info->region);
 }
 
+static void
+preview_job_finished_cb (EvJob         *job,
+			 EvPixbufCache *pixbuf_cache)
+{
+	CacheJobInfo *job_info;
+	EvJobRender  *job_render = EV_JOB_RENDER (job);
+
+	job_info = find_job_cache (pixbuf_cache, job_render->page);
+	if (!job_info || job_info->preview_job != job)
+		return;
+
+	if (ev_job_is_failed (job)) {
+		end_preview_job (job_info, pixbuf_cache);
+		return;
+	}
+
+	if (job_info->preview_surface)
+		cairo_surface_destroy (job_info->preview_surface);
+	job_info->preview_surface = cairo_surface_reference (job_render->surface);
+	if (pixbuf_cache->inverted_colors)
+		ev_document_misc_invert_surface (job_info->preview_surface);
+	end_preview_job (job_info, pixbuf_cache);
+
+	g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, NULL);
+}
+
 /* This checks a job to see if the job would generate the right sized pixbuf
  * given a scale.  If it won't, it removes the job and clears it to NULL.
  */
@@ -430,12 +667,39 @@ move_one_job (CacheJobInfo  *job_info,
 	job_info->job = NULL;
 	job_info->region = NULL;
 	job_info->surface = NULL;
+	job_info->preview_job = NULL;
+	job_info->preview_surface = NULL;
 
 	if (new_priority != priority && target_page->job) {
 		ev_job_scheduler_update_job (target_page->job, new_priority);
 	}
 }
 
+static gboolean
+page_is_tiled (EvPixbufCache *pixbuf_cache,
+	       gint           page_index,
+	       gdouble        scale,
+	       gint           rotation)
+{
+	gint  width, height;
+	gint  device_scale = get_device_scale (pixbuf_cache);
+	gsize size;
+
+	/* Caching disabled, there's no budget to split the page in. Backends
+	 * rendering whole pages would render the page once per tile. */
+	if (pixbuf_cache->max_size == 0 ||
+	    !ev_document_supports_render_area (pixbuf_cache->document))
+		return FALSE;
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page_index, scale, rotation,
+					       &width, &height);
+	size = (gsize) height * device_scale *
+		cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width * device_scale);
+
+	return size > pixbuf_cache->max_size / TILED_PAGE_SIZE_DIVISOR;
+}
+
 static gsize
 ev_pixbuf_cache_get_page_size (EvPixbufCache *pixbuf_cache,
 			       gint           page_index,
@@ -444,12 +708,131 @@ ev_pixbuf_cache_get_page_size (EvPixbufCache *pixbuf_cache,
 {
 	gint width, height;
 
+	/* Tiles are counted when rendered, see ev_pixbuf_cache_get_preload_size() */
+	if (page_is_tiled (pixbuf_cache, page_index, scale, rotation))
+		return 0;
+
 	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
 					       page_index, scale, rotation,
 					       &width, &height);
 	return height * cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
 }
 
+/* Number of pages to preload in the scroll direction, according
+ * to the scroll velocity */
+static gint
+ev_pixbuf_cache_get_predicted_pages (EvPixbufCache *pixbuf_cache,
+				     gint           page,
+				     gdouble        scale,
+				     gint           rotation)
+{
+	gint    width, height;
+	gdouble n_pages;
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, scale, rotation,
+					       &width, &height);
+	if (height <= 0)
+		return MAX_PRELOADED_PAGES;
+
+	n_pages = ceil (fabs (pixbuf_cache->scroll_velocity) * PRELOAD_LOOKAHEAD_TIME / height);
+
+	return CLAMP ((gint) n_pages, MAX_PRELOADED_PAGES, MAX_PREDICTED_PAGES);
+}
+
+static gint
+get_scale_bucket (gdouble scale,
+		  gint    device_scale)
+{
+	return (gint) (scale * device_scale * 1000 + 0.5);
+}
+
+static gsize
+cache_job_info_get_size (CacheJobInfo *job_info)
+{
+	gsize size = 0;
+
+	if (job_info->surface)
+		size += cairo_image_surface_get_height (job_info->surface) *
+			cairo_image_surface_get_stride (job_info->surface);
+	if (job_info->preview_surface)
+		size += cairo_image_surface_get_height (job_info->preview_surface) *
+			cairo_image_surface_get_stride (job_info->preview_surface);
+
+	return size;
+}
+
+/* Size of the page surfaces currently held */
+static gsize
+ev_pixbuf_cache_get_surfaces_size (EvPixbufCache *pixbuf_cache)
+{
+	gsize size = 0;
+	gint  i;
+
+	if (!pixbuf_cache->job_list)
+		return 0;
+
+	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++)
+		size += cache_job_info_get_size (pixbuf_cache->job_list + i);
+
+	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
+		size += cache_job_info_get_size (pixbuf_cache->prev_job + i);
+		size += cache_job_info_get_size (pixbuf_cache->next_job + i);
+	}
+
+	return size;
+}
+
+/* Whether the surface of @job_info was rendered for the current scale
+ * and rotation */
+static gboolean
+cache_job_info_surface_is_current (EvPixbufCache *pixbuf_cache,
+				   CacheJobInfo  *job_info,
+				   gint           page,
+				   gdouble        scale,
+				   gint           rotation)
+{
+	gint device_scale = get_device_scale (pixbuf_cache);
+	gint width, height;
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, scale, rotation,
+					       &width, &height);
+
+	return job_info->device_scale == device_scale &&
+		cairo_image_surface_get_width (job_info->surface) == width * device_scale &&
+		cairo_image_surface_get_height (job_info->surface) == height * device_scale;
+}
+
+/* Size of the page surfaces kept from previous scales, drawn until the
+ * pages render again */
+static gsize
+ev_pixbuf_cache_get_stale_size (EvPixbufCache *pixbuf_cache,
+				gdouble        scale,
+				gint           rotation)
+{
+	gsize size = 0;
+	gint  page;
+
+	if (!pixbuf_cache->job_list)
+		return 0;
+
+	for (page = MAX (0, pixbuf_cache->start_page - pixbuf_cache->preload_cache_size);
+	     page <= pixbuf_cache->end_page + pixbuf_cache->preload_cache_size &&
+		     page < ev_document_get_n_pages (pixbuf_cache->document);
+	     page++) {
+		CacheJobInfo *job_info = find_job_cache (pixbuf_cache, page);
+
+		if (job_info->surface &&
+		    !cache_job_info_surface_is_current (pixbuf_cache, job_info,
+							page, scale, rotation))
+			size += cairo_image_surface_get_height (job_info->surface) *
+				cairo_image_surface_get_stride (job_info->surface);
+	}
+
+	return size;
+}
+
 static gint
 ev_pixbuf_cache_get_preload_size (EvPixbufCache *pixbuf_cache,
 				  gint           start_page,
@@ -457,52 +840,74 @@ ev_pixbuf_cache_get_preload_size (EvPixbufCache *pixbuf_cache,
 				  gdouble        scale,
 				  gint           rotation)
 {
-	gsize range_size = 0;
-	gint  new_preload_cache_size = 0;
-	gint  i;
-	guint n_pages = ev_document_get_n_pages (pixbuf_cache->document);
-
-	/* Get the size of the current range */
+	gsize    range_size = 0;
+	gint     wanted_ahead, wanted_behind;
+	gint     ahead = 0, behind = 0;
+	gint     step_ahead, first_ahead, first_behind;
+	gint     i;
+	gint     n_pages = ev_document_get_n_pages (pixbuf_cache->document);
+	gboolean down = pixbuf_cache->scroll_direction == SCROLL_DIRECTION_DOWN;
+
+	pixbuf_cache->preload_ahead = 0;
+	pixbuf_cache->preload_behind = 0;
+
+	/* Get the size of the current range, tiles and surfaces of
+	 * previous scales included */
+	range_size = pixbuf_cache->tiles_size +
+		ev_pixbuf_cache_get_stale_size (pixbuf_cache, scale, rotation);
 	for (i = start_page; i <= end_page; i++) {
 		range_size += ev_pixbuf_cache_get_page_size (pixbuf_cache, i, scale, rotation);
 	}
 
 	if (range_size >= pixbuf_cache->max_size)
-		return new_preload_cache_size;
+		return 0;
+
+	wanted_ahead = ev_pixbuf_cache_get_predicted_pages (pixbuf_cache,
+							    down ? end_page : start_page,
+							    scale, rotation);
+	wanted_behind = wanted_ahead > MAX_PRELOADED_PAGES ? 1 : MAX_PRELOADED_PAGES;
 
-	i = 1;
-	while (((start_page - i > 0) || (end_page + i < n_pages)) &&
-	       new_preload_cache_size < MAX_PRELOADED_PAGES) {
+	step_ahead = down ? 1 : -1;
+	first_ahead = down ? end_page + 1 : start_page - 1;
+	first_behind = down ? start_page - 1 : end_page + 1;
+
+	/* Alternate between both directions, the scroll direction first,
+	 * until the budget is used up */
+	while (ahead < wanted_ahead || behind < wanted_behind) {
+		gint     page;
 		gsize    page_size;
 		gboolean updated = FALSE;
 
-		if (end_page + i < n_pages) {
-			page_size = ev_pixbuf_cache_get_page_size (pixbuf_cache, end_page + i,
+		page = first_ahead + ahead * step_ahead;
+		if (ahead < wanted_ahead && page >= 0 && page < n_pages) {
+			page_size = ev_pixbuf_cache_get_page_size (pixbuf_cache, page,
 								   scale, rotation);
-			if (page_size + range_size <= pixbuf_cache->max_size) {
-				range_size += page_size;
-				new_preload_cache_size++;
-				updated = TRUE;
-			} else {
+			if (page_size + range_size > pixbuf_cache->max_size)
 				break;
-			}
+			range_size += page_size;
+			ahead++;
+			updated = TRUE;
 		}
 
-		if (start_page - i > 0) {
-			page_size = ev_pixbuf_cache_get_page_size (pixbuf_cache, start_page - i,
+		page = first_behind - behind * step_ahead;
+		if (behind < wanted_behind && page >= 0 && page < n_pages) {
+			page_size = ev_pixbuf_cache_get_page_size (pixbuf_cache, page,
 								   scale, rotation);
-			if (page_size + range_size <= pixbuf_cache->max_size) {
-				range_size += page_size;
-				if (!updated)
-					new_preload_cache_size++;
-			} else {
+			if (page_size + range_size > pixbuf_cache->max_size)
 				break;
-			}
+			range_size += page_size;
+			behind++;
+			updated = TRUE;
 		}
-		i++;
+
+		if (!updated)
+			break;
 	}
 
-	return new_preload_cache_size;
+	pixbuf_cache->preload_ahead = ahead;
+	pixbuf_cache->preload_behind = behind;
+
+	return MAX (ahead, behind);
 }
 
 static void
@@ -694,6 +1099,22 @@ add_job (EvPixbufCache  *pixbuf_cache,
 					   width * job_info->device_scale,
                                            height * job_info->device_scale);
 
+	/* The page may not have changed since the document was reloaded */
+	if (!pixbuf_cache->inverted_colors) {
+		cairo_surface_t *previous_surface;
+
+		previous_surface = ev_reload_cache_take_surface (pixbuf_cache->document,
+								 page, rotation,
+								 width * job_info->device_scale,
+								 height * job_info->device_scale,
+								 job_info->device_scale);
+		if (previous_surface) {
+			ev_job_render_set_previous_surface (EV_JOB_RENDER (job_info->job),
+							    previous_surface);
+			cairo_surface_destroy (previous_surface);
+		}
+	}
+
 	if (new_selection_surface_needed (pixbuf_cache, job_info, page, scale)) {
 		GdkColor text, base;
 
@@ -710,6 +1131,43 @@ add_job (EvPixbufCache  *pixbuf_cache,
 	ev_job_scheduler_push_job (job_info->job, priority);
 }
 
+/* Schedules a cheap low resolution rendering of the page, so that there's
+ * something to draw while the full resolution one renders.
+ */
+static void
+add_preview_job (EvPixbufCache *pixbuf_cache,
+		 CacheJobInfo  *job_info,
+		 gint           page,
+		 gint           rotation,
+		 gfloat         scale)
+{
+	gdouble preview_scale = scale / PREVIEW_SCALE_DIVISOR;
+	gint    width, height;
+
+	if (job_info->preview_job || job_info->preview_surface)
+		return;
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, preview_scale, rotation,
+					       &width, &height);
+	if ((gdouble) width * height > PREVIEW_MAX_PIXELS) {
+		preview_scale *= sqrt ((gdouble) PREVIEW_MAX_PIXELS / ((gdouble) width * height));
+		_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+						       page, preview_scale, rotation,
+						       &width, &height);
+	}
+	if (width <= 0 || height <= 0)
+		return;
+
+	job_info->preview_job = ev_job_render_new (pixbuf_cache->document,
+						   page, rotation, preview_scale,
+						   width, height);
+	g_signal_connect (job_info->preview_job, "finished",
+			  G_CALLBACK (preview_job_finished_cb),
+			  pixbuf_cache);
+	ev_job_scheduler_push_job (job_info->preview_job, EV_JOB_PRIORITY_URGENT);
+}
+
 static void
 add_job_if_needed (EvPixbufCache *pixbuf_cache,
 		   CacheJobInfo  *job_info,
@@ -720,6 +1178,24 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 {
 	gint device_scale = get_device_scale (pixbuf_cache);
 	gint width, height;
+	cairo_surface_t *surface;
+
+	if (page_is_tiled (pixbuf_cache, page, scale, rotation)) {
+		/* The page is drawn from tiles, rendered on demand. The
+		 * surface of the previous scale is kept as preview. */
+		if (job_info->job)
+			end_job (job_info, pixbuf_cache);
+		if (job_info->surface) {
+			clear_preview (job_info, pixbuf_cache);
+			job_info->preview_surface = job_info->surface;
+			job_info->surface = NULL;
+		}
+		job_info->page_ready = FALSE;
+
+		if (priority == EV_JOB_PRIORITY_URGENT)
+			add_preview_job (pixbuf_cache, job_info, page, rotation, scale);
+		return;
+	}
 
 	if (job_info->job)
 		return;
@@ -734,8 +1210,23 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 	    cairo_image_surface_get_height (job_info->surface) == height * device_scale)
 		return;
 
-	/* Free old surfaces for non visible pages */
-	if (priority == EV_JOB_PRIORITY_LOW) {
+	/* The page might have been rendered already by another view */
+	surface = ev_surface_cache_lookup (pixbuf_cache->document, page, rotation,
+					   width * device_scale, height * device_scale,
+					   device_scale, pixbuf_cache->inverted_colors);
+	if (surface) {
+		if (job_info->surface)
+			cairo_surface_destroy (job_info->surface);
+		job_info->surface = surface;
+		job_info->device_scale = device_scale;
+		clear_preview (job_info, pixbuf_cache);
+		job_info->page_ready = TRUE;
+		return;
+	}
+
+	/* Free old surfaces for non visible pages, unless previous
+	 * scales are kept to be drawn while the page renders again */
+	if (priority == EV_JOB_PRIORITY_LOW && pixbuf_cache->scale_generations == 0) {
 		if (job_info->surface) {
 			cairo_surface_destroy (job_info->surface);
 			job_info->surface = NULL;
@@ -747,11 +1238,32 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 		}
 	}
 
+	/* Visible pages with nothing to draw get a preview first */
+	if (priority == EV_JOB_PRIORITY_URGENT && !job_info->surface)
+		add_preview_job (pixbuf_cache, job_info, page, rotation, scale);
+
 	add_job (pixbuf_cache, job_info, NULL,
 		 width, height, page, rotation, scale,
 		 priority);
 }
 
+/* Stops the jobs of pages of the preload window that are no longer
+ * preloaded, because the scroll direction reversed or slowed down */
+static void
+clear_speculative_job_info (CacheJobInfo  *job_info,
+			    EvPixbufCache *pixbuf_cache)
+{
+	if (job_info->job)
+		end_job (job_info, pixbuf_cache);
+	clear_preview (job_info, pixbuf_cache);
+
+	if (job_info->surface) {
+		cairo_surface_destroy (job_info->surface);
+		job_info->surface = NULL;
+	}
+	job_info->page_ready = FALSE;
+}
+
 static void
 add_prev_jobs_if_needed (EvPixbufCache *pixbuf_cache,
                          gint           rotation,
@@ -760,11 +1272,20 @@ add_prev_jobs_if_needed (EvPixbufCache *pixbuf_cache,
         CacheJobInfo *job_info;
         int page;
         int i;
+        int n_preload;
+
+        n_preload = pixbuf_cache->scroll_direction == SCROLL_DIRECTION_UP ?
+                pixbuf_cache->preload_ahead : pixbuf_cache->preload_behind;
 
         for (i = pixbuf_cache->preload_cache_size - 1; i >= FIRST_VISIBLE_PREV(pixbuf_cache); i--) {
                 job_info = (pixbuf_cache->prev_job + i);
                 page = pixbuf_cache->start_page - pixbuf_cache->preload_cache_size + i;
 
+                if (i < pixbuf_cache->preload_cache_size - n_preload) {
+                        clear_speculative_job_info (job_info, pixbuf_cache);
+                        continue;
+                }
+
                 add_job_if_needed (pixbuf_cache, job_info,
                                    page, rotation, scale,
                                    EV_JOB_PRIORITY_LOW);
@@ -779,11 +1300,20 @@ add_next_jobs_if_needed (EvPixbufCache *pixbuf_cache,
         CacheJobInfo *job_info;
         int page;
         int i;
+        int n_preload;
+
+        n_preload = pixbuf_cache->scroll_direction == SCROLL_DIRECTION_DOWN ?
+                pixbuf_cache->preload_ahead : pixbuf_cache->preload_behind;
 
         for (i = 0; i < VISIBLE_NEXT_LEN(pixbuf_cache); i++) {
                 job_info = (pixbuf_cache->next_job + i);
                 page = pixbuf_cache->end_page + 1 + i;
 
+                if (i >= n_preload) {
+                        clear_speculative_job_info (job_info, pixbuf_cache);
+                        continue;
+                }
+
                 add_job_if_needed (pixbuf_cache, job_info,
                                    page, rotation, scale,
                                    EV_JOB_PRIORITY_LOW);
@@ -837,6 +1367,362 @@ ev_pixbuf_cache_get_scroll_direction (EvPixbufCache *pixbuf_cache,
         return pixbuf_cache->scroll_direction;
 }
 
+static gboolean
+tile_is_obsolete (gpointer key,
+		  gpointer value,
+		  gpointer user_data)
+{
+	CacheTile     *tile = value;
+	CacheTileKey  *current = user_data;
+	EvPixbufCache *pixbuf_cache = tile->pixbuf_cache;
+	guint          i;
+
+	if (tile->key.rotation != current->rotation ||
+	    tile->key.page < pixbuf_cache->start_page ||
+	    tile->key.page > pixbuf_cache->end_page)
+		return TRUE;
+
+	if (tile->key.scale_bucket == current->scale_bucket)
+		return FALSE;
+
+	/* Tiles of previous scales are only useful if already rendered */
+	if (!tile->surface)
+		return TRUE;
+
+	for (i = 1; i <= pixbuf_cache->scale_generations; i++) {
+		if (tile->key.scale_bucket == pixbuf_cache->scale_history[i])
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Drops the tiles of pages that are no longer visible, rendered for
+ * another rotation, or for a scale older than the kept generations.
+ */
+static void
+ev_pixbuf_cache_purge_tiles (EvPixbufCache *pixbuf_cache,
+			     gdouble        scale,
+			     gint           rotation)
+{
+	CacheTileKey current;
+
+	current.scale_bucket = get_scale_bucket (scale, get_device_scale (pixbuf_cache));
+	current.rotation = rotation;
+
+	if (pixbuf_cache->scale_history[0] != current.scale_bucket) {
+		memmove (pixbuf_cache->scale_history + 1, pixbuf_cache->scale_history,
+			 MAX_SCALE_GENERATIONS * sizeof (gint));
+		pixbuf_cache->scale_history[0] = current.scale_bucket;
+	}
+
+	if (g_hash_table_size (pixbuf_cache->tiles) == 0)
+		return;
+
+	g_hash_table_foreach_remove (pixbuf_cache->tiles, tile_is_obsolete, &current);
+}
+
+/* Evicts what is kept from previous scales, then the least recently used
+ * tiles, until the page surfaces and the tiles fit in max_size. Surfaces
+ * of visible pages are kept, they are drawn until the pages render again,
+ * and so are the tiles of visible pages at the current scale: evicting
+ * them would only queue them again, forever if they don't all fit.
+ */
+static void
+ev_pixbuf_cache_trim (EvPixbufCache *pixbuf_cache,
+		      CacheTile     *keep)
+{
+	gdouble scale = ev_document_model_get_scale (pixbuf_cache->model);
+	gint    rotation = ev_document_model_get_rotation (pixbuf_cache->model);
+	gint    bucket = get_scale_bucket (scale, get_device_scale (pixbuf_cache));
+	gint    n_pages = ev_document_get_n_pages (pixbuf_cache->document);
+	gsize   surfaces_size = ev_pixbuf_cache_get_surfaces_size (pixbuf_cache);
+	GList  *link;
+	gint    i;
+
+	/* Tiles of previous scales, oldest first */
+	link = pixbuf_cache->tiles_lru.tail;
+	while (link && surfaces_size + pixbuf_cache->tiles_size > pixbuf_cache->max_size) {
+		CacheTile *tile = link->data;
+
+		link = link->prev;
+		if (tile == keep || tile->key.scale_bucket == bucket || !tile->surface)
+			continue;
+
+		g_hash_table_remove (pixbuf_cache->tiles, &tile->key);
+	}
+
+	/* Surfaces of previous scales of preloaded pages, farthest first */
+	for (i = 0;
+	     i < pixbuf_cache->preload_cache_size &&
+		     surfaces_size + pixbuf_cache->tiles_size > pixbuf_cache->max_size;
+	     i++) {
+		gint pages[2];
+		gint j;
+
+		pages[0] = pixbuf_cache->start_page - pixbuf_cache->preload_cache_size + i;
+		pages[1] = pixbuf_cache->end_page + pixbuf_cache->preload_cache_size - i;
+
+		for (j = 0; j < 2; j++) {
+			CacheJobInfo *job_info;
+
+			if (pages[j] < 0 || pages[j] >= n_pages)
+				continue;
+
+			job_info = find_job_cache (pixbuf_cache, pages[j]);
+			if (!job_info->surface ||
+			    cache_job_info_surface_is_current (pixbuf_cache, job_info,
+							       pages[j], scale, rotation))
+				continue;
+
+			surfaces_size -= cairo_image_surface_get_height (job_info->surface) *
+				cairo_image_surface_get_stride (job_info->surface);
+			cairo_surface_destroy (job_info->surface);
+			job_info->surface = NULL;
+			job_info->page_ready = FALSE;
+		}
+	}
+
+	/* The least recently used tiles */
+	link = pixbuf_cache->tiles_lru.tail;
+	while (link && surfaces_size + pixbuf_cache->tiles_size > pixbuf_cache->max_size) {
+		CacheTile *tile = link->data;
+
+		link = link->prev;
+		if (tile == keep || !tile->surface)
+			continue;
+
+		if (tile->key.scale_bucket == bucket &&
+		    tile->key.rotation == rotation &&
+		    tile->key.page >= pixbuf_cache->start_page &&
+		    tile->key.page <= pixbuf_cache->end_page)
+			continue;
+
+		g_hash_table_remove (pixbuf_cache->tiles, &tile->key);
+	}
+}
+
+static void
+tile_job_finished_cb (EvJob     *job,
+		      CacheTile *tile)
+{
+	EvPixbufCache *pixbuf_cache = tile->pixbuf_cache;
+	EvJobRender   *job_render = EV_JOB_RENDER (job);
+
+	g_signal_handlers_disconnect_by_data (job, tile);
+	tile->job = NULL;
+
+	if (ev_job_is_failed (job)) {
+		g_object_unref (job);
+
+		/* Redraw, so that it's queued again */
+		if (tile->n_failures++ < MAX_TILE_RETRIES)
+			g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, NULL);
+		return;
+	}
+
+	pixbuf_cache->tiles_size -= cache_tile_get_size (tile);
+	if (tile->surface)
+		cairo_surface_destroy (tile->surface);
+	tile->surface = cairo_surface_reference (job_render->surface);
+	set_device_scale_on_surface (tile->surface, tile->device_scale);
+	if (pixbuf_cache->inverted_colors)
+		ev_document_misc_invert_surface (tile->surface);
+	pixbuf_cache->tiles_size += cache_tile_get_size (tile);
+	g_object_unref (job);
+
+	ev_pixbuf_cache_trim (pixbuf_cache, tile);
+
+	g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, NULL);
+}
+
+static void
+add_tile_job (EvPixbufCache *pixbuf_cache,
+	      CacheTile     *tile,
+	      gdouble        scale)
+{
+	cairo_rectangle_int_t area;
+	gint                  width, height;
+
+	if (tile->job) {
+		g_signal_handlers_disconnect_by_data (tile->job, tile);
+		ev_job_cancel (tile->job);
+		g_object_unref (tile->job);
+	}
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       tile->key.page, scale, tile->key.rotation,
+					       &width, &height);
+
+	area.x = tile->key.tile_x * TILE_SIZE;
+	area.y = tile->key.tile_y * TILE_SIZE;
+	area.width = MIN (TILE_SIZE, width - area.x);
+	area.height = MIN (TILE_SIZE, height - area.y);
+
+	area.x *= tile->device_scale;
+	area.y *= tile->device_scale;
+	area.width *= tile->device_scale;
+	area.height *= tile->device_scale;
+
+	tile->job = ev_job_render_new (pixbuf_cache->document,
+				       tile->key.page, tile->key.rotation,
+				       scale * tile->device_scale,
+				       width * tile->device_scale,
+				       height * tile->device_scale);
+	ev_job_render_set_area (EV_JOB_RENDER (tile->job), &area);
+	g_signal_connect (tile->job, "finished",
+			  G_CALLBACK (tile_job_finished_cb),
+			  tile);
+	ev_job_scheduler_push_job (tile->job, EV_JOB_PRIORITY_URGENT);
+}
+
+/**
+ * ev_pixbuf_cache_page_is_tiled:
+ * @pixbuf_cache: an #EvPixbufCache
+ * @page: a page index
+ *
+ * Returns: %TRUE if @page is drawn from tiles returned by
+ *   ev_pixbuf_cache_get_tile_surface() instead of a single surface
+ */
+gboolean
+ev_pixbuf_cache_page_is_tiled (EvPixbufCache *pixbuf_cache,
+			       gint           page)
+{
+	return page_is_tiled (pixbuf_cache, page,
+			      ev_document_model_get_scale (pixbuf_cache->model),
+			      ev_document_model_get_rotation (pixbuf_cache->model));
+}
+
+gint
+ev_pixbuf_cache_get_tile_size (EvPixbufCache *pixbuf_cache)
+{
+	return TILE_SIZE;
+}
+
+/**
+ * ev_pixbuf_cache_get_tile_surface:
+ * @pixbuf_cache: an #EvPixbufCache
+ * @page: a page index
+ * @tile_x: column of the tile
+ * @tile_y: row of the tile
+ *
+ * Returns the surface of the tile of @page at @tile_x, @tile_y, for
+ * the current scale and rotation. Tiles not rendered yet are queued,
+ * in the order they are requested, and %NULL is returned.
+ *
+ * Returns: (transfer none) (nullable): the tile surface
+ */
+cairo_surface_t *
+ev_pixbuf_cache_get_tile_surface (EvPixbufCache *pixbuf_cache,
+				  gint           page,
+				  gint           tile_x,
+				  gint           tile_y)
+{
+	CacheTile    *tile;
+	CacheTileKey  key;
+	gdouble       scale = ev_document_model_get_scale (pixbuf_cache->model);
+	gint          device_scale = get_device_scale (pixbuf_cache);
+
+	key.page = page;
+	key.scale_bucket = get_scale_bucket (scale, device_scale);
+	key.rotation = ev_document_model_get_rotation (pixbuf_cache->model);
+	key.tile_x = tile_x;
+	key.tile_y = tile_y;
+
+	tile = g_hash_table_lookup (pixbuf_cache->tiles, &key);
+	if (!tile) {
+		tile = g_new0 (CacheTile, 1);
+		tile->key = key;
+		tile->pixbuf_cache = pixbuf_cache;
+		tile->device_scale = device_scale;
+		g_queue_push_head (&pixbuf_cache->tiles_lru, tile);
+		tile->link = pixbuf_cache->tiles_lru.head;
+		g_hash_table_insert (pixbuf_cache->tiles, &tile->key, tile);
+
+		add_tile_job (pixbuf_cache, tile, scale);
+
+		return NULL;
+	}
+
+	g_queue_unlink (&pixbuf_cache->tiles_lru, tile->link);
+	g_queue_push_head_link (&pixbuf_cache->tiles_lru, tile->link);
+
+	/* We don't need to wait for the idle to handle the callback */
+	if (tile->job && ev_job_is_finished (tile->job))
+		tile_job_finished_cb (tile->job, tile);
+
+	/* The rendering failed, try again a few times */
+	if (!tile->surface && !tile->job &&
+	    tile->n_failures > 0 && tile->n_failures <= MAX_TILE_RETRIES)
+		add_tile_job (pixbuf_cache, tile, scale);
+
+	return tile->surface;
+}
+
+/**
+ * ev_pixbuf_cache_foreach_stale_tile:
+ * @pixbuf_cache: an #EvPixbufCache
+ * @page: a page index
+ * @func: function called for every tile
+ * @user_data: data for @func
+ *
+ * Calls @func for the tiles of @page rendered at a previous scale, oldest
+ * first, with the area they cover in the page at the current scale.
+ */
+void
+ev_pixbuf_cache_foreach_stale_tile (EvPixbufCache        *pixbuf_cache,
+				    gint                  page,
+				    EvPixbufCacheTileFunc func,
+				    gpointer              user_data)
+{
+	GList  *l;
+	gint    current_bucket;
+	gint    rotation;
+
+	if (g_queue_is_empty (&pixbuf_cache->tiles_lru))
+		return;
+
+	current_bucket = get_scale_bucket (ev_document_model_get_scale (pixbuf_cache->model),
+					   get_device_scale (pixbuf_cache));
+	rotation = ev_document_model_get_rotation (pixbuf_cache->model);
+
+	/* The least recently used tiles are the oldest ones */
+	for (l = pixbuf_cache->tiles_lru.tail; l; l = l->prev) {
+		CacheTile   *tile = l->data;
+		GdkRectangle area;
+		gdouble      ratio;
+		gint         x, y, width, height;
+
+		if (tile->key.page != page ||
+		    tile->key.rotation != rotation ||
+		    tile->key.scale_bucket == current_bucket ||
+		    !tile->surface)
+			continue;
+
+		/* Both buckets include the device scale, and so do surface sizes */
+		ratio = (gdouble) current_bucket / tile->key.scale_bucket;
+		x = tile->key.tile_x * TILE_SIZE * tile->device_scale;
+		y = tile->key.tile_y * TILE_SIZE * tile->device_scale;
+		width = cairo_image_surface_get_width (tile->surface);
+		height = cairo_image_surface_get_height (tile->surface);
+
+		/* Round the edges, not the sizes, so that neighbours don't leave gaps */
+		area.x = floor (x * ratio / get_device_scale (pixbuf_cache));
+		area.y = floor (y * ratio / get_device_scale (pixbuf_cache));
+		area.width = floor ((x + width) * ratio / get_device_scale (pixbuf_cache)) - area.x;
+		area.height = floor ((y + height) * ratio / get_device_scale (pixbuf_cache)) - area.y;
+
+		func (tile->surface, &area, user_data);
+	}
+}
+
+void
+ev_pixbuf_cache_set_scale_generations (EvPixbufCache *pixbuf_cache,
+				       guint          scale_generations)
+{
+	pixbuf_cache->scale_generations = MIN (scale_generations, MAX_SCALE_GENERATIONS);
+}
+
 void
 ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 				gint            start_page,
@@ -845,6 +1731,9 @@ ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 {
 	gdouble scale = ev_document_model_get_scale (pixbuf_cache->model);
 	gint    rotation = ev_document_model_get_rotation (pixbuf_cache->model);
+	gint    old_start_page = pixbuf_cache->start_page;
+	gint    old_end_page = pixbuf_cache->end_page;
+	gint    i;
 
 	g_return_if_fail (EV_IS_PIXBUF_CACHE (pixbuf_cache));
 
@@ -853,11 +1742,35 @@ ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 	g_return_if_fail (end_page >= start_page);
 
         pixbuf_cache->scroll_direction = ev_pixbuf_cache_get_scroll_direction (pixbuf_cache, start_page, end_page);
+        if (pixbuf_cache->scroll_velocity > 0)
+                pixbuf_cache->scroll_direction = SCROLL_DIRECTION_DOWN;
+        else if (pixbuf_cache->scroll_velocity < 0)
+                pixbuf_cache->scroll_direction = SCROLL_DIRECTION_UP;
 
 	/* First, resize the page_range as needed.  We cull old pages
 	 * mercilessly. */
 	ev_pixbuf_cache_update_range (pixbuf_cache, start_page, end_page, rotation, scale);
 
+	/* Check whether the pages that became visible were preloaded */
+	if (old_start_page != -1) {
+		for (i = start_page; i <= end_page; i++) {
+			CacheJobInfo *job_info;
+
+			if (i >= old_start_page && i <= old_end_page)
+				continue;
+
+			job_info = find_job_cache (pixbuf_cache, i);
+			if (job_info->surface ||
+			    (job_info->job && ev_job_is_finished (job_info->job)))
+				pixbuf_cache->preload_hits++;
+			else
+				pixbuf_cache->preload_misses++;
+		}
+		ev_debug_message (DEBUG_JOBS, "preload hits: %u misses: %u",
+				  pixbuf_cache->preload_hits,
+				  pixbuf_cache->preload_misses);
+	}
+
 	/* Then, we update the current jobs to see if any of them are the wrong
 	 * size, we remove them if we need to. */
 	ev_pixbuf_cache_clear_job_sizes (pixbuf_cache, scale);
@@ -868,13 +1781,66 @@ ev_pixbuf_cache_set_page_range (EvPixbufCache  *pixbuf_cache,
 	/* Finally, we add the new jobs for all the sizes that don't have a
 	 * pixbuf */
 	ev_pixbuf_cache_add_jobs_if_needed (pixbuf_cache, rotation, scale);
+
+	ev_pixbuf_cache_purge_tiles (pixbuf_cache, scale, rotation);
+	ev_pixbuf_cache_trim (pixbuf_cache, NULL);
+}
+
+void
+ev_pixbuf_cache_set_scroll_velocity (EvPixbufCache *pixbuf_cache,
+				     gdouble        velocity)
+{
+	pixbuf_cache->scroll_velocity = velocity;
+}
+
+void
+ev_pixbuf_cache_get_preload_stats (EvPixbufCache *pixbuf_cache,
+				   guint         *hits,
+				   guint         *misses)
+{
+	if (hits)
+		*hits = pixbuf_cache->preload_hits;
+	if (misses)
+		*misses = pixbuf_cache->preload_misses;
+}
+
+/* Replaces the surface of @job_info by an inverted copy, the surface may
+ * be shared with other views through the surface cache */
+static void
+invert_job_info (EvPixbufCache *pixbuf_cache,
+		 CacheJobInfo  *job_info,
+		 gint           page)
+{
+	if (job_info == NULL)
+		return;
+
+	if (job_info->surface) {
+		cairo_surface_t *surface;
+
+		surface = copy_surface (job_info->surface);
+		set_device_scale_on_surface (surface, job_info->device_scale);
+		ev_document_misc_invert_surface (surface);
+		cairo_surface_destroy (job_info->surface);
+		job_info->surface = surface;
+
+		if (job_info->page_ready)
+			ev_surface_cache_add (pixbuf_cache->document, page,
+					      ev_document_model_get_rotation (pixbuf_cache->model),
+					      pixbuf_cache->inverted_colors,
+					      job_info->surface);
+	}
+
+	/* Previews are private */
+	if (job_info->preview_surface)
+		ev_document_misc_invert_surface (job_info->preview_surface);
 }
 
 void
 ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 				     gboolean       inverted_colors)
 {
-	gint i;
+	GList *l;
+	gint   i;
 
 	if (pixbuf_cache->inverted_colors == inverted_colors)
 		return;
@@ -882,23 +1848,22 @@ ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 	pixbuf_cache->inverted_colors = inverted_colors;
 
 	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
-		CacheJobInfo *job_info;
-
-		job_info = pixbuf_cache->prev_job + i;
-		if (job_info && job_info->surface)
-			ev_document_misc_invert_surface (job_info->surface);
-
-		job_info = pixbuf_cache->next_job + i;
-		if (job_info && job_info->surface)
-			ev_document_misc_invert_surface (job_info->surface);
+		invert_job_info (pixbuf_cache, pixbuf_cache->prev_job + i,
+				 pixbuf_cache->start_page - pixbuf_cache->preload_cache_size + i);
+		invert_job_info (pixbuf_cache, pixbuf_cache->next_job + i,
+				 pixbuf_cache->end_page + 1 + i);
 	}
 
-	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++) {
-		CacheJobInfo *job_info;
+	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++)
+		invert_job_info (pixbuf_cache, pixbuf_cache->job_list + i,
+				 pixbuf_cache->start_page + i);
 
-		job_info = pixbuf_cache->job_list + i;
-		if (job_info && job_info->surface)
-			ev_document_misc_invert_surface (job_info->surface);
+	/* Tiles are private too */
+	for (l = pixbuf_cache->tiles_lru.head; l; l = l->next) {
+		CacheTile *tile = l->data;
+
+		if (tile->surface)
+			ev_document_misc_invert_surface (tile->surface);
 	}
 }
 
@@ -922,6 +1887,10 @@ ev_pixbuf_cache_get_surface (EvPixbufCache *pixbuf_cache,
 		g_signal_emit (pixbuf_cache, signals[JOB_FINISHED], 0, job_info->region);
 	}
 
+	/* Until the page is rendered, draw its preview if we have one */
+	if (!job_info->surface)
+		return job_info->preview_surface;
+
 	return job_info->surface;
 }
 
@@ -982,6 +1951,8 @@ ev_pixbuf_cache_clear (EvPixbufCache *pixbuf_cache)
 {
 	int i;
 
+	g_hash_table_remove_all (pixbuf_cache->tiles);
+
 	if (!pixbuf_cache->job_list)
 		return;
 
@@ -1077,7 +2048,7 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 		gint width, height;
 
 		/* we need to get a new selection pixbuf */
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (pixbuf_cache->document);
 		if (job_info->selection_points.x1 < 0) {
 			g_assert (job_info->selection == NULL);
 			old_points = NULL;
@@ -1107,7 +2078,7 @@ ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 		job_info->selection_points = job_info->target_points;
 		job_info->selection_scale = scale * job_info->device_scale;
 		g_object_unref (rc);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (pixbuf_cache->document);
 	}
 	return job_info->selection;
 }
@@ -1150,7 +2121,7 @@ ev_pixbuf_cache_get_selection_region (EvPixbufCache *pixbuf_cache,
 		EvPage *ev_page;
 		gint width, height;
 
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (pixbuf_cache->document);
 		ev_page = ev_document_get_page (pixbuf_cache->document, page);
 
 		_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
@@ -1170,7 +2141,7 @@ ev_pixbuf_cache_get_selection_region (EvPixbufCache *pixbuf_cache,
 		job_info->selection_region_points = job_info->target_points;
 		job_info->selection_region_scale = scale;
 		g_object_unref (rc);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (pixbuf_cache->document);
 	}
 	return job_info->selection_region && !cairo_region_is_empty(job_info->selection_region) ?
                 job_info->selection_region : NULL;
@@ -1368,6 +2339,22 @@ ev_pixbuf_cache_reload_page (EvPixbufCache  *pixbuf_cache,
 	CacheJobInfo *job_info;
         gint width, height;
 
+	ev_surface_cache_remove_page (pixbuf_cache->document, page);
+
+	if (page_is_tiled (pixbuf_cache, page, scale, rotation)) {
+		GList *l;
+
+		/* Keep the old tiles until the new ones are rendered */
+		for (l = pixbuf_cache->tiles_lru.head; l; l = l->next) {
+			CacheTile *tile = l->data;
+
+			if (tile->key.page == page &&
+			    tile->key.scale_bucket == get_scale_bucket (scale, tile->device_scale))
+				add_tile_job (pixbuf_cache, tile, scale);
+		}
+		return;
+	}
+
 	job_info = find_job_cache (pixbuf_cache, page);
 	if (job_info == NULL)
 		return;
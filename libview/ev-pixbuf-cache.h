@@ -55,6 +55,10 @@ struct _EvViewSelection {
 typedef struct _EvPixbufCache       EvPixbufCache;
 typedef struct _EvPixbufCacheClass  EvPixbufCacheClass;
 
+typedef void (* EvPixbufCacheTileFunc) (cairo_surface_t    *surface,
+					const GdkRectangle *area,
+					gpointer            user_data);
+
 GType          ev_pixbuf_cache_get_type             (void) G_GNUC_CONST;
 EvPixbufCache *ev_pixbuf_cache_new                  (GtkWidget     *view,
 						     EvDocumentModel *model,
@@ -76,6 +80,25 @@ void           ev_pixbuf_cache_reload_page 	    (EvPixbufCache  *pixbuf_cache,
 						     gdouble         scale);
 void           ev_pixbuf_cache_set_inverted_colors  (EvPixbufCache *pixbuf_cache,
 						     gboolean       inverted_colors);
+void           ev_pixbuf_cache_set_scroll_velocity  (EvPixbufCache *pixbuf_cache,
+						     gdouble        velocity);
+void           ev_pixbuf_cache_get_preload_stats    (EvPixbufCache *pixbuf_cache,
+						     guint         *hits,
+						     guint         *misses);
+/* Tiles */
+gboolean       ev_pixbuf_cache_page_is_tiled        (EvPixbufCache *pixbuf_cache,
+						     gint           page);
+gint           ev_pixbuf_cache_get_tile_size        (EvPixbufCache *pixbuf_cache);
+cairo_surface_t *ev_pixbuf_cache_get_tile_surface   (EvPixbufCache *pixbuf_cache,
+						     gint           page,
+						     gint           tile_x,
+						     gint           tile_y);
+void           ev_pixbuf_cache_foreach_stale_tile   (EvPixbufCache *pixbuf_cache,
+						     gint           page,
+						     EvPixbufCacheTileFunc func,
+						     gpointer       user_data);
+void           ev_pixbuf_cache_set_scale_generations (EvPixbufCache *pixbuf_cache,
+						      guint          scale_generations);
 /* Selection */
 cairo_surface_t *ev_pixbuf_cache_get_selection_surface (EvPixbufCache   *pixbuf_cache,
 							gint             page,
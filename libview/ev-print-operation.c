@@ -754,7 +754,7 @@ export_print_inc_page (EvPrintOperationExport *export)
 				    (export->page_count - 1) % export->pages_per_sheet != 0) {
 
 					EvPrintOperation *op = EV_PRINT_OPERATION (export);
-					ev_document_doc_mutex_lock ();
+					ev_document_lock (op->document);
 
 					/* keep track of all blanks but only actualise those
 					 * which are in the current odd / even sheet set */
@@ -765,7 +765,7 @@ export_print_inc_page (EvPrintOperationExport *export)
 						(export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1) ) {
 						ev_file_exporter_end_page (EV_FILE_EXPORTER (op->document));
 					}
-					ev_document_doc_mutex_unlock ();
+					ev_document_unlock (op->document);
 					export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
 				}
 
@@ -888,9 +888,9 @@ export_job_finished (EvJobExport            *job,
 	   ( export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0 ) ||
 	   ( export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1 ) ) ) ) {
 
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (op->document);
 		ev_file_exporter_end_page (EV_FILE_EXPORTER (op->document));
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (op->document);
 	}
 
 	/* Reschedule */
@@ -969,9 +969,9 @@ export_print_page (EvPrintOperationExport *export)
 	if (export->collated == export->collated_copies) {
 		export->collated = 0;
 		if (!export_print_inc_page (export)) {
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (op->document);
 			ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (op->document);
 
 			update_progress (export);
 			export_print_done (export);
@@ -994,9 +994,9 @@ export_print_page (EvPrintOperationExport *export)
 				export->collated = 0;
 
 				if (!export_print_inc_page (export)) {
-					ev_document_doc_mutex_lock ();
+					ev_document_lock (op->document);
 					ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
-					ev_document_doc_mutex_unlock ();
+					ev_document_unlock (op->document);
 
 					update_progress (export);
 
@@ -1015,9 +1015,9 @@ export_print_page (EvPrintOperationExport *export)
 	    (export->page_set == GTK_PAGE_SET_ALL ||
 	    (export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0) ||
 	    (export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1)))) {
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (op->document);
 		ev_file_exporter_begin_page (EV_FILE_EXPORTER (op->document));
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (op->document);
 	}
 
 	if (!export->job_export) {
@@ -1046,9 +1046,9 @@ ev_print_operation_export_begin (EvPrintOperationExport *export)
 	if (!export->temp_file)
 		return; /* cancelled */
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (op->document);
 	ev_file_exporter_begin (EV_FILE_EXPORTER (op->document), &export->fc);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (op->document);
 
 	export->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
 					   (GSourceFunc)export_print_page,
@@ -2302,6 +2302,7 @@ struct _EvPrintOperationPrint {
 	gint               n_pages_to_print;
 	gint               total;
 	EvJob             *job_print;
+	EvJob             *page_sizes_job;
 	gchar             *job_name;
 
         /* Page handling tab */
@@ -2453,6 +2454,26 @@ ev_print_operation_print_begin_print (EvPrintOperationPrint *print,
 	g_signal_emit (op, signals[BEGIN_PRINT], 0);
 }
 
+/* Pages are printed with their own size, which is only known once the
+ * page sizes job of documents loaded with a lazy cache has finished */
+static gboolean
+ev_print_operation_print_paginate (EvPrintOperationPrint *print,
+				   GtkPrintContext       *context)
+{
+	EvPrintOperation *op = EV_PRINT_OPERATION (print);
+
+	if (ev_document_is_cache_complete (op->document))
+		return TRUE;
+
+	if (!print->page_sizes_job) {
+		print->page_sizes_job = ev_job_page_sizes_get_for_document (op->document, 0);
+		if (print->page_sizes_job)
+			g_object_ref (print->page_sizes_job);
+	}
+
+	return FALSE;
+}
+
 static void
 ev_print_operation_print_done (EvPrintOperationPrint  *print,
 			       GtkPrintOperationResult result)
@@ -2492,7 +2513,7 @@ print_job_finished (EvJobPrint            *job,
 static gboolean
 draw_page_finish_idle (EvPrintOperationPrint *print)
 {
-        if (ev_job_scheduler_get_running_thread_job () == print->job_print)
+        if (ev_job_scheduler_is_job_running (print->job_print))
                 return TRUE;
 
         gtk_print_operation_draw_page_finish (print->op);
@@ -2509,7 +2530,7 @@ print_job_cancelled (EvJobPrint            *job,
          * print operation. If the job is still
          * running, wait until it finishes.
          */
-        if (ev_job_scheduler_get_running_thread_job () == print->job_print)
+        if (ev_job_scheduler_is_job_running (print->job_print))
                 g_idle_add ((GSourceFunc)draw_page_finish_idle, print);
         else
                 gtk_print_operation_draw_page_finish (print->op);
@@ -2802,6 +2823,11 @@ ev_print_operation_print_finalize (GObject *object)
 		print->job_name = NULL;
 	}
 
+	if (print->page_sizes_job) {
+		ev_job_page_sizes_release (EV_JOB_PAGE_SIZES (print->page_sizes_job));
+		g_clear_object (&print->page_sizes_job);
+	}
+
 	if (print->job_print) {
 		if (!ev_job_is_finished (print->job_print))
 			ev_job_cancel (print->job_print);
@@ -2831,6 +2857,9 @@ ev_print_operation_print_init (EvPrintOperationPrint *print)
 	g_signal_connect_swapped (print->op, "begin_print",
 				  G_CALLBACK (ev_print_operation_print_begin_print),
 				  print);
+	g_signal_connect_swapped (print->op, "paginate",
+				  G_CALLBACK (ev_print_operation_print_paginate),
+				  print);
 	g_signal_connect_swapped (print->op, "done",
 				  G_CALLBACK (ev_print_operation_print_done),
 				  print);
@@ -0,0 +1,435 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "ev-reload-cache.h"
+#include "ev-surface-cache.h"
+#include "ev-debug.h"
+
+#define EV_RELOAD_CACHE_KEY "ev-reload-cache"
+
+/* Seconds the renderings of the previous version of a document are kept
+ * once the fingerprints of their pages are known, for the views to take
+ * them when they render the pages of the new version.
+ */
+#define PREVIOUS_KEEP_TIME 5
+
+typedef struct {
+	/* Protected by cache_mutex */
+	gint        n_pages;
+	gchar     **fingerprints;
+	gint        n_previous_pages;
+	gchar     **previous_fingerprints;
+	/* Pages of the previous version whose fingerprint is being computed */
+	gboolean   *previous_pending;
+
+	/* The previous version of the document, kept while its renderings
+	 * in the surface cache may be used, only used from the main thread
+	 */
+	EvDocument *previous;
+	guint       release_id;
+} EvReloadCache;
+
+typedef struct {
+	EvDocument *previous;
+	GArray     *pages;
+} EvReloadTaskData;
+
+static GMutex cache_mutex;
+
+static void
+ev_reload_cache_free_fingerprints (gchar **fingerprints,
+				   gint    n_pages)
+{
+	gint i;
+
+	if (!fingerprints)
+		return;
+
+	for (i = 0; i < n_pages; i++)
+		g_free (fingerprints[i]);
+	g_free (fingerprints);
+}
+
+static void
+ev_reload_cache_free (EvReloadCache *cache)
+{
+	if (cache->release_id > 0)
+		g_source_remove (cache->release_id);
+	g_clear_object (&cache->previous);
+	ev_reload_cache_free_fingerprints (cache->fingerprints, cache->n_pages);
+	ev_reload_cache_free_fingerprints (cache->previous_fingerprints,
+					   cache->n_previous_pages);
+	g_free (cache->previous_pending);
+	g_free (cache);
+}
+
+/* Called with cache_mutex held */
+static EvReloadCache *
+ev_reload_cache_get (EvDocument *document,
+		     gboolean    create)
+{
+	EvReloadCache *cache;
+
+	cache = g_object_get_data (G_OBJECT (document), EV_RELOAD_CACHE_KEY);
+	if (cache || !create)
+		return cache;
+
+	cache = g_new0 (EvReloadCache, 1);
+	cache->n_pages = ev_document_get_n_pages (document);
+	cache->fingerprints = g_new0 (gchar *, cache->n_pages);
+	g_object_set_data_full (G_OBJECT (document), EV_RELOAD_CACHE_KEY,
+				cache, (GDestroyNotify) ev_reload_cache_free);
+
+	return cache;
+}
+
+static gchar *
+ev_reload_cache_compute_fingerprint (EvDocument *document,
+				     gint        page)
+{
+	EvPage *ev_page;
+	gchar  *fingerprint;
+
+	ev_document_lock (document);
+	ev_page = ev_document_get_page (document, page);
+	fingerprint = ev_document_fingerprint_get_page_fingerprint (EV_DOCUMENT_FINGERPRINT (document),
+								     ev_page);
+	g_object_unref (ev_page);
+	ev_document_unlock (document);
+
+	return fingerprint;
+}
+
+static gchar *
+ev_reload_cache_get_fingerprint (EvDocument    *document,
+				 EvReloadCache *cache,
+				 gint           page)
+{
+	gchar *fingerprint;
+
+	g_mutex_lock (&cache_mutex);
+	fingerprint = g_strdup (cache->fingerprints[page]);
+	g_mutex_unlock (&cache_mutex);
+
+	if (fingerprint)
+		return fingerprint;
+
+	fingerprint = ev_reload_cache_compute_fingerprint (document, page);
+	if (!fingerprint)
+		return NULL;
+
+	g_mutex_lock (&cache_mutex);
+	if (!cache->fingerprints[page])
+		cache->fingerprints[page] = g_strdup (fingerprint);
+	g_mutex_unlock (&cache_mutex);
+
+	return fingerprint;
+}
+
+/**
+ * ev_reload_cache_page_unchanged:
+ * @document: an #EvDocument
+ * @page: the index of the page
+ *
+ * Compares the fingerprint of @page with the one of the same page in the
+ * version of @document it was reloaded from. It's called from the threads
+ * of the jobs rendering @page, without the document locked, for pages with
+ * a rendering returned by ev_reload_cache_take_surface(). It doesn't wait
+ * for the fingerprint of the previous version when it's still being
+ * computed: the job renders the page instead.
+ *
+ * Returns: %TRUE if @page is known not to have changed since the previous
+ *   version
+ */
+gboolean
+ev_reload_cache_page_unchanged (EvDocument *document,
+				gint        page)
+{
+	EvReloadCache *cache;
+	gchar         *previous = NULL;
+	gchar         *fingerprint;
+	gboolean       unchanged;
+
+	if (!EV_IS_DOCUMENT_FINGERPRINT (document))
+		return FALSE;
+
+	g_mutex_lock (&cache_mutex);
+	cache = ev_reload_cache_get (document, FALSE);
+	if (cache && page < cache->n_pages && page < cache->n_previous_pages &&
+	    !cache->previous_pending[page])
+		previous = g_strdup (cache->previous_fingerprints[page]);
+	g_mutex_unlock (&cache_mutex);
+
+	if (!previous)
+		return FALSE;
+
+	fingerprint = ev_reload_cache_get_fingerprint (document, cache, page);
+	unchanged = g_strcmp0 (fingerprint, previous) == 0;
+	g_free (fingerprint);
+	g_free (previous);
+
+	ev_debug_message (DEBUG_JOBS, "page %d %s since the previous version",
+			  page, unchanged ? "unchanged" : "changed");
+
+	return unchanged;
+}
+
+/**
+ * ev_reload_cache_page_known_unchanged:
+ * @document: an #EvDocument
+ * @page: the index of the page
+ *
+ * Like ev_reload_cache_page_unchanged(), but the fingerprint of @page is
+ * not computed: it's for renderings cheaper than a fingerprint, like
+ * thumbnails, which are only kept for the pages already compared.
+ *
+ * Returns: %TRUE if @page is known not to have changed since the
+ *   previous version
+ */
+gboolean
+ev_reload_cache_page_known_unchanged (EvDocument *document,
+				      gint        page)
+{
+	EvReloadCache *cache;
+	gboolean       unchanged = FALSE;
+
+	g_mutex_lock (&cache_mutex);
+	cache = ev_reload_cache_get (document, FALSE);
+	if (cache && page < cache->n_pages && page < cache->n_previous_pages &&
+	    cache->fingerprints[page] && cache->previous_fingerprints[page])
+		unchanged = strcmp (cache->fingerprints[page], cache->previous_fingerprints[page]) == 0;
+	g_mutex_unlock (&cache_mutex);
+
+	return unchanged;
+}
+
+static void
+ev_reload_task_data_free (EvReloadTaskData *data)
+{
+	g_object_unref (data->previous);
+	g_array_unref (data->pages);
+	g_free (data);
+}
+
+static void
+collect_previous_page (gint             page,
+		       gint             rotation,
+		       gboolean         inverted_colors,
+		       cairo_surface_t *surface,
+		       gpointer         user_data)
+{
+	GArray *pages = user_data;
+	guint   i;
+
+	/* Inverted renderings are modified in place when the colors change */
+	if (inverted_colors)
+		return;
+
+	for (i = 0; i < pages->len; i++) {
+		if (g_array_index (pages, gint, i) == page)
+			return;
+	}
+	g_array_append_val (pages, page);
+}
+
+static void
+compute_previous_fingerprints (GTask        *task,
+			       gpointer      source_object,
+			       gpointer      task_data,
+			       GCancellable *cancellable)
+{
+	EvDocument       *document = source_object;
+	EvReloadTaskData *data = task_data;
+	EvReloadCache    *cache;
+	guint             i;
+
+	g_mutex_lock (&cache_mutex);
+	cache = ev_reload_cache_get (document, FALSE);
+	g_mutex_unlock (&cache_mutex);
+
+	/* The most recently used renderings first */
+	for (i = 0; i < data->pages->len; i++) {
+		gint   page = g_array_index (data->pages, gint, i);
+		gchar *fingerprint;
+
+		fingerprint = ev_reload_cache_compute_fingerprint (data->previous, page);
+
+		g_mutex_lock (&cache_mutex);
+		cache->previous_fingerprints[page] = fingerprint;
+		cache->previous_pending[page] = FALSE;
+		g_mutex_unlock (&cache_mutex);
+	}
+
+	g_task_return_boolean (task, TRUE);
+}
+
+static gboolean
+release_previous (EvDocument *document)
+{
+	EvReloadCache *cache;
+
+	g_mutex_lock (&cache_mutex);
+	cache = ev_reload_cache_get (document, FALSE);
+	g_mutex_unlock (&cache_mutex);
+
+	/* The renderings left are dropped with the document */
+	cache->release_id = 0;
+	g_clear_object (&cache->previous);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+previous_fingerprints_computed (EvDocument   *document,
+				GAsyncResult *result,
+				gpointer      user_data)
+{
+	EvReloadCache *cache;
+
+	g_mutex_lock (&cache_mutex);
+	cache = ev_reload_cache_get (document, FALSE);
+	g_mutex_unlock (&cache_mutex);
+
+	cache->release_id = g_timeout_add_seconds (PREVIOUS_KEEP_TIME,
+						   (GSourceFunc) release_previous,
+						   document);
+}
+
+/**
+ * ev_reload_cache_set_previous:
+ * @document: an #EvDocument
+ * @previous: the #EvDocument @document replaces
+ *
+ * If @document is a new version of @previous, @previous is kept for a
+ * while with its renderings in the surface cache, which still count in
+ * its budget, and the fingerprints of their pages are computed in a
+ * thread, to be compared with the pages of @document. Nothing is computed
+ * for documents that are not reloaded. It must be called from the main
+ * thread, before the renderings of @previous are dropped.
+ */
+void
+ev_reload_cache_set_previous (EvDocument *document,
+			      EvDocument *previous)
+{
+	EvReloadCache    *cache;
+	EvReloadTaskData *data;
+	GTask            *task;
+	GArray           *pages;
+	const gchar      *uri, *previous_uri;
+	guint             i;
+
+	if (!EV_IS_DOCUMENT_FINGERPRINT (document) ||
+	    G_OBJECT_TYPE (document) != G_OBJECT_TYPE (previous))
+		return;
+
+	uri = ev_document_get_uri (document);
+	previous_uri = ev_document_get_uri (previous);
+	if (!uri || g_strcmp0 (uri, previous_uri) != 0)
+		return;
+
+	pages = g_array_new (FALSE, FALSE, sizeof (gint));
+	ev_surface_cache_foreach (previous, collect_previous_page, pages);
+	if (pages->len == 0) {
+		g_array_unref (pages);
+		return;
+	}
+
+	g_mutex_lock (&cache_mutex);
+	cache = ev_reload_cache_get (document, TRUE);
+	if (cache->previous_fingerprints) {
+		g_mutex_unlock (&cache_mutex);
+		g_array_unref (pages);
+		return;
+	}
+
+	cache->n_previous_pages = ev_document_get_n_pages (previous);
+	cache->previous_fingerprints = g_new0 (gchar *, cache->n_previous_pages);
+	cache->previous_pending = g_new0 (gboolean, cache->n_previous_pages);
+	for (i = 0; i < pages->len; i++)
+		cache->previous_pending[g_array_index (pages, gint, i)] = TRUE;
+	cache->previous = g_object_ref (previous);
+	g_mutex_unlock (&cache_mutex);
+
+	data = g_new0 (EvReloadTaskData, 1);
+	data->previous = g_object_ref (previous);
+	data->pages = pages;
+
+	task = g_task_new (document, NULL,
+			   (GAsyncReadyCallback) previous_fingerprints_computed,
+			   NULL);
+	g_task_set_task_data (task, data, (GDestroyNotify) ev_reload_task_data_free);
+	g_task_run_in_thread (task, compute_previous_fingerprints);
+	g_object_unref (task);
+}
+
+/**
+ * ev_reload_cache_take_surface:
+ * @document: an #EvDocument
+ * @page: the index of the page
+ * @rotation: the rotation of the rendering
+ * @width: the width of the rendering in pixels
+ * @height: the height of the rendering in pixels
+ * @device_scale: the device scale of the rendering
+ *
+ * Looks for a rendering, without inverted colors, of @page in the previous
+ * version of @document. The renderings of @page in the previous version
+ * are removed from the surface cache, the one returned is to be used by
+ * a job rendering @page if ev_reload_cache_page_unchanged() returns %TRUE.
+ * It must be called from the main thread.
+ *
+ * Returns: (transfer full) (nullable): the rendering of @page in the
+ *   previous version of @document, or %NULL
+ */
+cairo_surface_t *
+ev_reload_cache_take_surface (EvDocument *document,
+			      gint        page,
+			      gint        rotation,
+			      gint        width,
+			      gint        height,
+			      gint        device_scale)
+{
+	EvReloadCache   *cache;
+	cairo_surface_t *surface = NULL;
+	gboolean         changed;
+
+	g_mutex_lock (&cache_mutex);
+	cache = ev_reload_cache_get (document, FALSE);
+	if (!cache || !cache->previous || page >= cache->n_previous_pages) {
+		g_mutex_unlock (&cache_mutex);
+		return NULL;
+	}
+
+	/* Renderings of pages already known to have changed are dropped */
+	changed = !cache->previous_pending[page] && !cache->previous_fingerprints[page];
+	if (!changed && page < cache->n_pages && cache->fingerprints[page] &&
+	    cache->previous_fingerprints[page])
+		changed = g_strcmp0 (cache->fingerprints[page], cache->previous_fingerprints[page]) != 0;
+	g_mutex_unlock (&cache_mutex);
+
+	if (!changed)
+		surface = ev_surface_cache_lookup (cache->previous, page, rotation,
+						   width, height, device_scale, FALSE);
+
+	/* The new rendering is added to the surface cache for @document */
+	ev_surface_cache_remove_page (cache->previous, page);
+
+	return surface;
+}
@@ -0,0 +1,51 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Fingerprints of the pages of documents, so that the renderings of the
+ * pages that did not change are kept when a document is reloaded. They
+ * are only computed once a document is reloaded: those of the pages of
+ * the previous version with renderings in the surface cache, in a
+ * thread, and those of the same pages in the new version, by the jobs
+ * rendering them, which compare both.
+ */
+
+#pragma once
+
+#if !defined (EVINCE_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <cairo.h>
+
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+gboolean         ev_reload_cache_page_unchanged   (EvDocument *document,
+						   gint        page);
+gboolean         ev_reload_cache_page_known_unchanged (EvDocument *document,
+						       gint        page);
+void             ev_reload_cache_set_previous     (EvDocument *document,
+						   EvDocument *previous);
+cairo_surface_t *ev_reload_cache_take_surface     (EvDocument *document,
+						   gint        page,
+						   gint        rotation,
+						   gint        width,
+						   gint        height,
+						   gint        device_scale);
+
+G_END_DECLS
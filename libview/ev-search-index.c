@@ -0,0 +1,476 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "ev-search-index.h"
+#include "ev-debug.h"
+
+#define EV_SEARCH_INDEX_DATA_KEY "ev-search-index"
+#define EV_SEARCH_INDEX_VERSION  1
+#define EV_SEARCH_INDEX_FORMAT   "(usaya(uau))"
+
+/* The indexes of the documents not opened for this long, and then the
+ * oldest ones beyond this size, are removed from the cache.
+ */
+#define EV_SEARCH_INDEX_MAX_AGE  (90 * G_TIME_SPAN_DAY)
+#define EV_SEARCH_INDEX_MAX_SIZE (64 * 1024 * 1024)
+
+/* The index maps every trigram of the words of the document to the
+ * pages containing it. A page may contain a string if it contains all
+ * of its trigrams.
+ */
+struct _EvSearchIndex {
+	GMutex      mutex;
+
+	gchar      *filename;
+	gchar      *key;
+	gint        n_pages;
+	guint8     *indexed;
+	GHashTable *postings;
+	gboolean    dirty;
+};
+
+static GMutex index_mutex;
+
+static guint32
+make_trigram (gunichar a,
+	      gunichar b,
+	      gunichar c)
+{
+	return (a * 65599u + b) * 65599u + c;
+}
+
+/* Returns the set of trigrams of the words of @text. Case and diacritics
+ * are dropped, like the case insensitive search of the backends does, and
+ * a hyphen at the end of a line joins the words around it, since matches
+ * can span them. The index can then only have more candidate pages than
+ * the backend search finds.
+ */
+static GHashTable *
+get_trigrams (const gchar *text)
+{
+	GHashTable  *trigrams;
+	gunichar     window[2];
+	gint         n_window = 0;
+	const gchar *p;
+
+	trigrams = g_hash_table_new (NULL, NULL);
+
+	for (p = text; p && *p; p = g_utf8_next_char (p)) {
+		gunichar c = g_utf8_get_char (p);
+		gunichar decomposition[G_UNICHAR_MAX_DECOMPOSITION_LENGTH];
+		gsize    len, i;
+
+		if (c == '-' && n_window > 0) {
+			const gchar *q = g_utf8_next_char (p);
+			gboolean     line_break = FALSE;
+
+			while (*q && g_unichar_isspace (g_utf8_get_char (q))) {
+				if (*q == '\n')
+					line_break = TRUE;
+				q = g_utf8_next_char (q);
+			}
+
+			if (line_break) {
+				p = g_utf8_prev_char (q);
+				continue;
+			}
+		}
+
+		len = g_unichar_fully_decompose (c, TRUE, decomposition,
+						 G_N_ELEMENTS (decomposition));
+		for (i = 0; i < len; i++) {
+			gunichar d = decomposition[i];
+
+			if (g_unichar_ismark (d))
+				continue;
+
+			if (!g_unichar_isalnum (d)) {
+				n_window = 0;
+				continue;
+			}
+
+			d = g_unichar_tolower (d);
+			if (n_window < 2) {
+				window[n_window++] = d;
+				continue;
+			}
+
+			g_hash_table_add (trigrams,
+					  GUINT_TO_POINTER (make_trigram (window[0], window[1], d)));
+			window[0] = window[1];
+			window[1] = d;
+		}
+	}
+
+	return trigrams;
+}
+
+static void
+ev_search_index_load (EvSearchIndex *index)
+{
+	GMappedFile  *mapped_file;
+	GBytes       *bytes;
+	GVariant     *variant;
+	GVariant     *indexed;
+	GVariant     *postings;
+	GVariant     *pages;
+	GVariantIter  iter;
+	const gchar  *key;
+	const guint8 *flags;
+	guint32       version, trigram;
+	gsize         n_flags;
+
+	mapped_file = g_mapped_file_new (index->filename, FALSE, NULL);
+	if (!mapped_file)
+		return;
+
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	g_mapped_file_unref (mapped_file);
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (EV_SEARCH_INDEX_FORMAT),
+								bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	g_variant_get (variant, "(u&s@ay@a(uau))", &version, &key, &indexed, &postings);
+
+	flags = g_variant_get_fixed_array (indexed, &n_flags, sizeof (guint8));
+	if (version != EV_SEARCH_INDEX_VERSION || strcmp (key, index->key) != 0 ||
+	    n_flags != (gsize) index->n_pages) {
+		ev_debug_message (DEBUG_JOBS, "discarding outdated search index %s", index->filename);
+		goto out;
+	}
+
+	memcpy (index->indexed, flags, n_flags);
+
+	/* The index was used, keep it longer when pruning the cache */
+	g_utime (index->filename, NULL);
+
+	g_variant_iter_init (&iter, postings);
+	while (g_variant_iter_next (&iter, "(u@au)", &trigram, &pages)) {
+		const guint32 *page_list;
+		GArray        *array;
+		gsize          n_page_list, i;
+
+		page_list = g_variant_get_fixed_array (pages, &n_page_list, sizeof (guint32));
+		array = g_array_sized_new (FALSE, FALSE, sizeof (guint), n_page_list);
+		for (i = 0; i < n_page_list; i++) {
+			guint page = page_list[i];
+
+			if (page < (guint) index->n_pages)
+				g_array_append_val (array, page);
+		}
+		g_hash_table_insert (index->postings, GUINT_TO_POINTER (trigram), array);
+		g_variant_unref (pages);
+	}
+out:
+	g_variant_unref (indexed);
+	g_variant_unref (postings);
+	g_variant_unref (variant);
+}
+
+static EvSearchIndex *
+ev_search_index_new (EvDocument *document)
+{
+	EvSearchIndex *index;
+	const gchar   *uri;
+	GFile         *file;
+	gchar         *key;
+	gchar         *dirname;
+	gchar         *basename;
+	gchar         *checksum;
+
+	uri = ev_document_get_uri (document);
+	if (!uri || !EV_IS_DOCUMENT_TEXT (document))
+		return NULL;
+
+	/* The text of documents protected by a password is not saved */
+	if (EV_IS_DOCUMENT_SECURITY (document) &&
+	    ev_document_security_has_document_security (EV_DOCUMENT_SECURITY (document)))
+		return NULL;
+
+	key = ev_file_get_cache_key (uri);
+	if (!key)
+		return NULL;
+
+	index = g_new0 (EvSearchIndex, 1);
+	g_mutex_init (&index->mutex);
+	index->key = key;
+	index->n_pages = ev_document_get_n_pages (document);
+	index->indexed = g_new0 (guint8, index->n_pages);
+	index->postings = g_hash_table_new_full (NULL, NULL, NULL,
+						 (GDestroyNotify) g_array_unref);
+
+	/* Temporary copies of compressed or remote documents get another
+	 * URI every time, their key identifies their contents instead */
+	file = g_file_new_for_uri (uri);
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5,
+						  ev_file_is_temp (file) ? key : uri,
+						  -1);
+	g_object_unref (file);
+	basename = g_strconcat (checksum, ".index", NULL);
+	dirname = ev_search_index_get_dirname ();
+	index->filename = g_build_filename (dirname, basename, NULL);
+	g_free (dirname);
+	g_free (basename);
+	g_free (checksum);
+
+	ev_search_index_load (index);
+
+	return index;
+}
+
+static void
+ev_search_index_free (EvSearchIndex *index)
+{
+	g_mutex_clear (&index->mutex);
+	g_free (index->filename);
+	g_free (index->key);
+	g_free (index->indexed);
+	g_hash_table_destroy (index->postings);
+	g_free (index);
+}
+
+static gchar *
+ev_search_index_get_dirname (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "evince", "search-index", NULL);
+}
+
+/**
+ * ev_search_index_get:
+ * @document: an #EvDocument
+ *
+ * Returns: (transfer none) (nullable): the search index of @document,
+ *   loaded from the cache if there is one, or %NULL if @document cannot
+ *   be indexed
+ */
+EvSearchIndex *
+ev_search_index_get (EvDocument *document)
+{
+	EvSearchIndex *index;
+
+	g_mutex_lock (&index_mutex);
+	index = g_object_get_data (G_OBJECT (document), EV_SEARCH_INDEX_DATA_KEY);
+	if (!index) {
+		index = ev_search_index_new (document);
+		if (index) {
+			g_object_set_data_full (G_OBJECT (document),
+						EV_SEARCH_INDEX_DATA_KEY,
+						index,
+						(GDestroyNotify) ev_search_index_free);
+		}
+	}
+	g_mutex_unlock (&index_mutex);
+
+	return index;
+}
+
+/**
+ * ev_search_index_lookup:
+ * @document: an #EvDocument
+ *
+ * Returns: (transfer none) (nullable): the search index of @document if
+ *   ev_search_index_get() was called for it already, or %NULL
+ */
+EvSearchIndex *
+ev_search_index_lookup (EvDocument *document)
+{
+	EvSearchIndex *index;
+
+	g_mutex_lock (&index_mutex);
+	index = g_object_get_data (G_OBJECT (document), EV_SEARCH_INDEX_DATA_KEY);
+	g_mutex_unlock (&index_mutex);
+
+	return index;
+}
+
+gboolean
+ev_search_index_has_page (EvSearchIndex *index,
+			  gint           page)
+{
+	gboolean retval;
+
+	g_return_val_if_fail (page >= 0 && page < index->n_pages, FALSE);
+
+	g_mutex_lock (&index->mutex);
+	retval = index->indexed[page];
+	g_mutex_unlock (&index->mutex);
+
+	return retval;
+}
+
+void
+ev_search_index_add_page (EvSearchIndex *index,
+			  gint           page,
+			  const gchar   *text)
+{
+	GHashTable     *trigrams;
+	GHashTableIter  iter;
+	gpointer        trigram;
+	guint           value = page;
+
+	g_return_if_fail (page >= 0 && page < index->n_pages);
+
+	trigrams = get_trigrams (text);
+
+	g_mutex_lock (&index->mutex);
+	if (!index->indexed[page]) {
+		g_hash_table_iter_init (&iter, trigrams);
+		while (g_hash_table_iter_next (&iter, &trigram, NULL)) {
+			GArray *pages;
+
+			pages = g_hash_table_lookup (index->postings, trigram);
+			if (!pages) {
+				pages = g_array_new (FALSE, FALSE, sizeof (guint));
+				g_hash_table_insert (index->postings, trigram, pages);
+			}
+			g_array_append_val (pages, value);
+		}
+		index->indexed[page] = TRUE;
+		index->dirty = TRUE;
+	}
+	g_mutex_unlock (&index->mutex);
+
+	g_hash_table_destroy (trigrams);
+}
+
+/**
+ * ev_search_index_find:
+ * @index: an #EvSearchIndex
+ * @text: the searched text
+ *
+ * Returns: (nullable): a newly allocated array with an element per page
+ *   set to %TRUE when the page has to be searched, or %NULL if the index
+ *   cannot tell, because @text is too short
+ */
+gboolean *
+ev_search_index_find (EvSearchIndex *index,
+		      const gchar   *text)
+{
+	GHashTable     *trigrams;
+	GHashTableIter  iter;
+	gpointer        trigram;
+	guint          *counts;
+	guint           n_trigrams;
+	gboolean       *candidates;
+	gboolean        missing = FALSE;
+	gint            i;
+
+	trigrams = get_trigrams (text);
+	n_trigrams = g_hash_table_size (trigrams);
+	if (n_trigrams == 0) {
+		g_hash_table_destroy (trigrams);
+		return NULL;
+	}
+
+	counts = g_new0 (guint, index->n_pages);
+	candidates = g_new (gboolean, index->n_pages);
+
+	g_mutex_lock (&index->mutex);
+	g_hash_table_iter_init (&iter, trigrams);
+	while (!missing && g_hash_table_iter_next (&iter, &trigram, NULL)) {
+		GArray *pages;
+		guint   j;
+
+		pages = g_hash_table_lookup (index->postings, trigram);
+		if (!pages) {
+			missing = TRUE;
+			break;
+		}
+
+		for (j = 0; j < pages->len; j++)
+			counts[g_array_index (pages, guint, j)]++;
+	}
+
+	for (i = 0; i < index->n_pages; i++)
+		candidates[i] = !index->indexed[i] || (!missing && counts[i] == n_trigrams);
+	g_mutex_unlock (&index->mutex);
+
+	g_free (counts);
+	g_hash_table_destroy (trigrams);
+
+	return candidates;
+}
+
+void
+ev_search_index_save (EvSearchIndex *index)
+{
+	GVariantBuilder  builder;
+	GHashTableIter   iter;
+	gpointer         trigram;
+	gpointer         value;
+	GVariant        *variant;
+	gchar           *dirname;
+	GError          *error = NULL;
+	static gsize     pruned = 0;
+
+	g_mutex_lock (&index->mutex);
+	if (!index->dirty) {
+		g_mutex_unlock (&index->mutex);
+		return;
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(uau)"));
+	g_hash_table_iter_init (&iter, index->postings);
+	while (g_hash_table_iter_next (&iter, &trigram, &value)) {
+		GArray *pages = value;
+
+		g_variant_builder_add (&builder, "(u@au)",
+				       GPOINTER_TO_UINT (trigram),
+				       g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+								  pages->data, pages->len,
+								  sizeof (guint32)));
+	}
+
+	variant = g_variant_ref_sink (g_variant_new ("(us@ay@a(uau))",
+						     EV_SEARCH_INDEX_VERSION,
+						     index->key,
+						     g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+										index->indexed,
+										index->n_pages,
+										sizeof (guint8)),
+						     g_variant_builder_end (&builder)));
+	index->dirty = FALSE;
+	g_mutex_unlock (&index->mutex);
+
+	dirname = ev_search_index_get_dirname ();
+	g_mkdir_with_parents (dirname, 0700);
+
+	if (!g_file_set_contents (index->filename,
+				  g_variant_get_data (variant),
+				  g_variant_get_size (variant),
+				  &error)) {
+		g_warning ("Failed to save search index: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_variant_unref (variant);
+
+	/* Once per session is enough to keep the cache bounded */
+	if (g_once_init_enter (&pruned)) {
+		ev_file_prune_cache_dir (dirname,
+					 EV_SEARCH_INDEX_MAX_SIZE,
+					 EV_SEARCH_INDEX_MAX_AGE);
+		g_once_init_leave (&pruned, 1);
+	}
+	g_free (dirname);
+}
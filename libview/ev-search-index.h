@@ -0,0 +1,48 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Index of the words of the pages of a document, saved in the user
+ * cache dir, used to skip the pages that cannot contain the searched
+ * text. It only knows which pages may match, the matches themselves
+ * still have to be found by the backend. Its functions can do file I/O,
+ * so they should be called from a job thread.
+ */
+
+#pragma once
+
+#if !defined (EVINCE_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EvSearchIndex EvSearchIndex;
+
+EvSearchIndex *ev_search_index_get      (EvDocument    *document);
+EvSearchIndex *ev_search_index_lookup   (EvDocument    *document);
+gboolean       ev_search_index_has_page (EvSearchIndex *index,
+					 gint           page);
+void           ev_search_index_add_page (EvSearchIndex *index,
+					 gint           page,
+					 const gchar   *text);
+gboolean      *ev_search_index_find     (EvSearchIndex *index,
+					 const gchar   *text);
+void           ev_search_index_save     (EvSearchIndex *index);
+
+G_END_DECLS
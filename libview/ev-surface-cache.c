@@ -0,0 +1,373 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "ev-surface-cache.h"
+#include "ev-debug.h"
+
+#define DEFAULT_MAX_SIZE 52428800 /* 50MB */
+
+typedef struct {
+	EvDocument *document;
+	gint        page;
+	gint        rotation;
+	gint        width;
+	gint        height;
+	gint        device_scale;
+	gboolean    inverted_colors;
+} EvSurfaceCacheKey;
+
+typedef struct {
+	EvSurfaceCacheKey key;
+	cairo_surface_t  *surface;
+	gsize             size;
+
+	/* Link in the LRU queue */
+	GList            *link;
+} EvSurfaceCacheEntry;
+
+/* Entries are in the hash table and in the LRU queue, the most recently
+ * used first. documents has the documents a weak reference was added to,
+ * it is only removed when they are finalized: that can happen in a worker
+ * thread, dropping the last reference of a job, while the cache is used
+ * from the main thread. Everything is protected by cache_mutex.
+ */
+static GMutex      cache_mutex;
+static GHashTable *entries = NULL;
+static GQueue      lru = G_QUEUE_INIT;
+static GHashTable *documents = NULL;
+static gsize       cache_size = 0;
+static gsize       max_size = DEFAULT_MAX_SIZE;
+
+static guint
+ev_surface_cache_key_hash (gconstpointer data)
+{
+	const EvSurfaceCacheKey *key = data;
+
+	return (((((g_direct_hash (key->document) * 31 + key->page) * 31 +
+		   key->rotation) * 31 + key->width) * 31 + key->height) * 31 +
+		key->device_scale) * 2 + (key->inverted_colors ? 1 : 0);
+}
+
+static gboolean
+ev_surface_cache_key_equal (gconstpointer a,
+			    gconstpointer b)
+{
+	const EvSurfaceCacheKey *key_a = a;
+	const EvSurfaceCacheKey *key_b = b;
+
+	return key_a->document == key_b->document &&
+		key_a->page == key_b->page &&
+		key_a->rotation == key_b->rotation &&
+		key_a->width == key_b->width &&
+		key_a->height == key_b->height &&
+		key_a->device_scale == key_b->device_scale &&
+		!key_a->inverted_colors == !key_b->inverted_colors;
+}
+
+static void
+ev_surface_cache_entry_free (EvSurfaceCacheEntry *entry)
+{
+	cache_size -= entry->size;
+	g_queue_delete_link (&lru, entry->link);
+	cairo_surface_destroy (entry->surface);
+	g_free (entry);
+}
+
+static void
+ev_surface_cache_ensure (void)
+{
+	if (entries)
+		return;
+
+	entries = g_hash_table_new_full (ev_surface_cache_key_hash,
+					 ev_surface_cache_key_equal,
+					 NULL,
+					 (GDestroyNotify) ev_surface_cache_entry_free);
+	documents = g_hash_table_new (g_direct_hash, g_direct_equal);
+}
+
+static gint
+get_surface_device_scale (cairo_surface_t *surface)
+{
+#ifdef HAVE_HIDPI_SUPPORT
+	gdouble x_scale, y_scale;
+
+	cairo_surface_get_device_scale (surface, &x_scale, &y_scale);
+
+	return (gint) x_scale;
+#else
+	return 1;
+#endif
+}
+
+/* The budget covers the surfaces of the cache and those of the views,
+ * which are in the cache too: entries still referenced by a view cost
+ * nothing more and nothing is freed by dropping them, so only entries
+ * nobody else uses are evicted, least recently used first. Called with
+ * cache_mutex held.
+ */
+static void
+ev_surface_cache_trim (void)
+{
+	GList *link = lru.tail;
+
+	while (cache_size > max_size && link) {
+		EvSurfaceCacheEntry *entry = link->data;
+
+		link = link->prev;
+		if (cairo_surface_get_reference_count (entry->surface) > 1)
+			continue;
+
+		g_hash_table_remove (entries, &entry->key);
+	}
+}
+
+static gboolean
+entry_matches_document (gpointer key,
+			gpointer value,
+			gpointer user_data)
+{
+	EvSurfaceCacheEntry *entry = value;
+
+	return entry->key.document == user_data;
+}
+
+static void
+document_finalized (gpointer  data,
+		    GObject  *document)
+{
+	g_mutex_lock (&cache_mutex);
+	g_hash_table_foreach_remove (entries, entry_matches_document, document);
+	g_hash_table_remove (documents, document);
+	g_mutex_unlock (&cache_mutex);
+}
+
+/**
+ * ev_surface_cache_lookup:
+ * @document: an #EvDocument
+ * @page: the page index
+ * @rotation: the rotation the page was rendered with
+ * @width: the width of the surface in pixels
+ * @height: the height of the surface in pixels
+ * @device_scale: the device scale of the surface
+ * @inverted_colors: whether the page was rendered with inverted colors
+ *
+ * The surface returned is shared with other views, it must not be
+ * modified.
+ *
+ * Returns: (transfer full) (nullable): a rendering of @page, or %NULL
+ */
+cairo_surface_t *
+ev_surface_cache_lookup (EvDocument *document,
+			 gint        page,
+			 gint        rotation,
+			 gint        width,
+			 gint        height,
+			 gint        device_scale,
+			 gboolean    inverted_colors)
+{
+	EvSurfaceCacheEntry *entry;
+	EvSurfaceCacheKey    key;
+	cairo_surface_t     *surface;
+
+	key.document = document;
+	key.page = page;
+	key.rotation = rotation;
+	key.width = width;
+	key.height = height;
+	key.device_scale = device_scale;
+	key.inverted_colors = inverted_colors;
+
+	g_mutex_lock (&cache_mutex);
+
+	entry = entries ? g_hash_table_lookup (entries, &key) : NULL;
+	if (!entry) {
+		g_mutex_unlock (&cache_mutex);
+		return NULL;
+	}
+
+	g_queue_unlink (&lru, entry->link);
+	g_queue_push_head_link (&lru, entry->link);
+	surface = cairo_surface_reference (entry->surface);
+
+	g_mutex_unlock (&cache_mutex);
+
+	ev_debug_message (DEBUG_JOBS, "page %d (%dx%d) found in the surface cache",
+			  page, width, height);
+
+	return surface;
+}
+
+/**
+ * ev_surface_cache_add:
+ * @document: an #EvDocument
+ * @page: the page index
+ * @rotation: the rotation the page was rendered with
+ * @inverted_colors: whether the page was rendered with inverted colors
+ * @surface: an image surface with the rendering of the whole page, with
+ *   its device scale set
+ *
+ * Adds @surface to the cache. Callers must not modify it afterwards, it
+ * is shared with other views: modified copies are added instead.
+ */
+void
+ev_surface_cache_add (EvDocument      *document,
+		      gint             page,
+		      gint             rotation,
+		      gboolean         inverted_colors,
+		      cairo_surface_t *surface)
+{
+	EvSurfaceCacheEntry *entry;
+
+	if (!surface || cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE)
+		return;
+
+	entry = g_new0 (EvSurfaceCacheEntry, 1);
+	entry->key.document = document;
+	entry->key.page = page;
+	entry->key.rotation = rotation;
+	entry->key.width = cairo_image_surface_get_width (surface);
+	entry->key.height = cairo_image_surface_get_height (surface);
+	entry->key.device_scale = get_surface_device_scale (surface);
+	entry->key.inverted_colors = inverted_colors;
+	entry->size = entry->key.height * cairo_image_surface_get_stride (surface);
+
+	g_mutex_lock (&cache_mutex);
+
+	if (entry->size > max_size) {
+		g_mutex_unlock (&cache_mutex);
+		g_free (entry);
+		return;
+	}
+
+	ev_surface_cache_ensure ();
+
+	entry->surface = cairo_surface_reference (surface);
+	g_queue_push_head (&lru, entry);
+	entry->link = lru.head;
+	cache_size += entry->size;
+
+	/* The weak reference is kept until @document is finalized */
+	if (!g_hash_table_contains (documents, document)) {
+		g_object_weak_ref (G_OBJECT (document), document_finalized, NULL);
+		g_hash_table_add (documents, document);
+	}
+
+	/* Replaces any previous rendering with the same key */
+	g_hash_table_replace (entries, &entry->key, entry);
+
+	ev_surface_cache_trim ();
+
+	g_mutex_unlock (&cache_mutex);
+}
+
+static gboolean
+entry_matches_page (gpointer key,
+		    gpointer value,
+		    gpointer user_data)
+{
+	EvSurfaceCacheEntry *entry = value;
+	EvSurfaceCacheKey   *page_key = user_data;
+
+	return entry->key.document == page_key->document &&
+		entry->key.page == page_key->page;
+}
+
+/**
+ * ev_surface_cache_remove_page:
+ * @document: an #EvDocument
+ * @page: the page index
+ *
+ * Removes the renderings of @page, because its contents changed.
+ */
+void
+ev_surface_cache_remove_page (EvDocument *document,
+			      gint        page)
+{
+	EvSurfaceCacheKey key;
+
+	key.document = document;
+	key.page = page;
+
+	g_mutex_lock (&cache_mutex);
+	if (entries)
+		g_hash_table_foreach_remove (entries, entry_matches_page, &key);
+	g_mutex_unlock (&cache_mutex);
+}
+
+/**
+ * ev_surface_cache_remove_document:
+ * @document: an #EvDocument
+ *
+ * Removes all the renderings of pages of @document.
+ */
+void
+ev_surface_cache_remove_document (EvDocument *document)
+{
+	g_mutex_lock (&cache_mutex);
+	if (entries)
+		g_hash_table_foreach_remove (entries, entry_matches_document, document);
+	g_mutex_unlock (&cache_mutex);
+}
+
+/**
+ * ev_surface_cache_foreach:
+ * @document: an #EvDocument
+ * @func: the function to call for every rendering
+ * @user_data: user data to pass to @func
+ *
+ * Calls @func for every rendering of a page of @document in the cache,
+ * the most recently used first. @func is called with the cache locked,
+ * it must not use the cache.
+ */
+void
+ev_surface_cache_foreach (EvDocument        *document,
+			  EvSurfaceCacheFunc func,
+			  gpointer           user_data)
+{
+	GList *l;
+
+	g_mutex_lock (&cache_mutex);
+	for (l = lru.head; l; l = l->next) {
+		EvSurfaceCacheEntry *entry = l->data;
+
+		if (entry->key.document != document)
+			continue;
+
+		func (entry->key.page, entry->key.rotation,
+		      entry->key.inverted_colors, entry->surface, user_data);
+	}
+	g_mutex_unlock (&cache_mutex);
+}
+
+/**
+ * ev_surface_cache_set_max_size:
+ * @size: the maximum size in bytes of the cached surfaces
+ *
+ * Sets the budget shared by all the views, 0 disables the cache.
+ */
+void
+ev_surface_cache_set_max_size (gsize size)
+{
+	g_mutex_lock (&cache_mutex);
+	max_size = size;
+	if (entries)
+		ev_surface_cache_trim ();
+	g_mutex_unlock (&cache_mutex);
+}
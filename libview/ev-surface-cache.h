@@ -0,0 +1,62 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Process wide cache of rendered pages, shared by all the views of a
+ * document, so that a page already rendered by one of them is not
+ * rendered again by another one. Its budget includes the pages the views
+ * hold. It must be used from the main thread.
+ */
+
+#pragma once
+
+#if !defined (EVINCE_COMPILATION)
+#error "This is a private header."
+#endif
+
+#include <cairo.h>
+
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+typedef void (* EvSurfaceCacheFunc) (gint             page,
+				     gint             rotation,
+				     gboolean         inverted_colors,
+				     cairo_surface_t *surface,
+				     gpointer         user_data);
+
+cairo_surface_t *ev_surface_cache_lookup          (EvDocument      *document,
+						   gint             page,
+						   gint             rotation,
+						   gint             width,
+						   gint             height,
+						   gint             device_scale,
+						   gboolean         inverted_colors);
+void             ev_surface_cache_add             (EvDocument      *document,
+						   gint             page,
+						   gint             rotation,
+						   gboolean         inverted_colors,
+						   cairo_surface_t *surface);
+void             ev_surface_cache_remove_page     (EvDocument      *document,
+						   gint             page);
+void             ev_surface_cache_remove_document (EvDocument      *document);
+void             ev_surface_cache_foreach         (EvDocument      *document,
+						   EvSurfaceCacheFunc func,
+						   gpointer         user_data);
+void             ev_surface_cache_set_max_size    (gsize            max_size);
+
+G_END_DECLS
@@ -30,6 +30,7 @@
 #include "ev-transition-animation.h"
 #include "ev-view-cursor.h"
 #include "ev-page-cache.h"
+#include "ev-surface-cache.h"
 #ifdef GDK_WINDOWING_WAYLAND
 #include <gdk/gdkwayland.h>
 #endif
@@ -90,6 +91,8 @@ struct _EvViewPresentation
 	/* Links */
 	EvPageCache           *page_cache;
 
+	EvJob                 *page_sizes_job;
+
 	EvJob *prev_job;
 	EvJob *curr_job;
 	EvJob *next_job;
@@ -282,23 +285,12 @@ static cairo_surface_t *
 get_surface_from_job (EvViewPresentation *pview,
                       EvJob              *job)
 {
-        cairo_surface_t *surface;
-
         if (!job)
                 return NULL;
 
-        surface = EV_JOB_RENDER(job)->surface;
-        if (!surface)
-                return NULL;
-
-#ifdef HAVE_HIDPI_SUPPORT
-        {
-                int scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (pview));
-                cairo_surface_set_device_scale (surface, scale_factor, scale_factor);
-        }
-#endif
-
-        return surface;
+        /* The device scale is set when the job finishes, cached
+         * surfaces have it already */
+        return EV_JOB_RENDER(job)->surface;
 }
 
 static void
@@ -356,6 +348,15 @@ job_finished_cb (EvJob              *job,
 
 	if (pview->inverted_colors)
 		ev_document_misc_invert_surface (job_render->surface);
+#ifdef HAVE_HIDPI_SUPPORT
+	{
+		int scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (pview));
+		cairo_surface_set_device_scale (job_render->surface, scale_factor, scale_factor);
+	}
+#endif
+	ev_surface_cache_add (pview->document, job_render->page,
+			      job_render->rotation, pview->inverted_colors,
+			      job_render->surface);
 
 	if (job != pview->curr_job)
 		return;
@@ -376,20 +377,33 @@ ev_view_presentation_schedule_new_job (EvViewPresentation *pview,
 {
 	EvJob *job;
         int    view_width, view_height;
+	int    device_scale = 1;
 
 	if (page < 0 || page >= ev_document_get_n_pages (pview->document))
 		return NULL;
 
         ev_view_presentation_get_view_size (pview, page, &view_width, &view_height);
 #ifdef HAVE_HIDPI_SUPPORT
-	{
-		gint device_scale = gtk_widget_get_scale_factor (GTK_WIDGET (pview));
-		view_width *= device_scale;
-		view_height *= device_scale;
-	}
+	device_scale = gtk_widget_get_scale_factor (GTK_WIDGET (pview));
+	view_width *= device_scale;
+	view_height *= device_scale;
 #endif
         job = ev_job_render_new (pview->document, page, pview->rotation, 0.,
                                  view_width, view_height);
+
+	/* Nothing to render if the page is cached already, usually
+	 * by the view that started the presentation */
+	EV_JOB_RENDER (job)->surface =
+		ev_surface_cache_lookup (pview->document, page, pview->rotation,
+					 view_width, view_height, device_scale,
+					 pview->inverted_colors);
+	if (EV_JOB_RENDER (job)->surface) {
+		/* Finish it as if it had run, so that it can be updated
+		 * and cancelled like the other jobs */
+		ev_job_succeeded (job);
+		return job;
+	}
+
 	g_signal_connect (job, "finished",
 			  G_CALLBACK (job_finished_cb),
 			  pview);
@@ -988,6 +1002,12 @@ ev_view_presentation_dispose (GObject *object)
 	ev_view_presentation_hide_cursor_timeout_stop (pview);
         ev_view_presentation_reset_jobs (pview);
 
+	if (pview->page_sizes_job) {
+		g_signal_handlers_disconnect_by_data (pview->page_sizes_job, pview);
+		ev_job_page_sizes_release (EV_JOB_PAGE_SIZES (pview->page_sizes_job));
+		g_clear_object (&pview->page_sizes_job);
+	}
+
 	if (pview->current_surface) {
 		cairo_surface_destroy (pview->current_surface);
 		pview->current_surface = NULL;
@@ -1462,6 +1482,26 @@ ev_view_presentation_notify_scale_factor (EvViewPresentation *pview)
         ev_view_presentation_update_current_page (pview, pview->current_page);
 }
 
+/* Pages are rendered with the size of the first page until their
+ * own size is known */
+static void
+ev_view_presentation_page_sizes_updated_cb (EvJobPageSizes     *job,
+					    gint                first_page,
+					    gint                n_pages,
+					    EvViewPresentation *pview)
+{
+	if (!gtk_widget_get_realized (GTK_WIDGET (pview)))
+		return;
+
+	if ((gint)pview->current_page + 1 < first_page ||
+	    (gint)pview->current_page - 1 >= first_page + n_pages)
+		return;
+
+	ev_view_presentation_reset_jobs (pview);
+	ev_view_presentation_update_current_page (pview, pview->current_page);
+	gtk_widget_queue_draw (GTK_WIDGET (pview));
+}
+
 static GObject *
 ev_view_presentation_constructor (GType                  type,
 				  guint                  n_construct_properties,
@@ -1484,6 +1524,14 @@ ev_view_presentation_constructor (GType                  type,
         g_signal_connect (object, "notify::scale-factor",
                           G_CALLBACK (ev_view_presentation_notify_scale_factor), NULL);
 
+	pview->page_sizes_job = ev_job_page_sizes_get_for_document (pview->document, pview->current_page);
+	if (pview->page_sizes_job) {
+		g_object_ref (pview->page_sizes_job);
+		g_signal_connect_object (pview->page_sizes_job, "updated",
+					 G_CALLBACK (ev_view_presentation_page_sizes_updated_cb),
+					 pview, 0);
+	}
+
 	return object;
 }
 
@@ -109,6 +109,7 @@ typedef enum {
 typedef struct _EvHeightToPageCache {
 	gint rotation;
 	gboolean dual_even_left;
+	gboolean dirty; /* page sizes changed since it was built */
 	gdouble *height_to_page;
 	gdouble *dual_height_to_page;
 } EvHeightToPageCache;
@@ -161,6 +162,10 @@ struct _EvView {
 	EvDocumentModel *model;
 	EvPixbufCache *pixbuf_cache;
 	gsize pixbuf_cache_size;
+	guint pixbuf_cache_scale_generations;
+	gdouble scroll_velocity;
+	gint64 scroll_velocity_time;
+	guint scroll_velocity_timeout_id;
 	EvPageCache *page_cache;
 	EvHeightToPageCache *height_to_page_cache;
 	EvViewCursor cursor;
@@ -37,6 +37,7 @@
 #include "ev-document-misc.h"
 #include "ev-form-field-private.h"
 #include "ev-pixbuf-cache.h"
+#include "ev-surface-cache.h"
 #include "ev-page-cache.h"
 #include "ev-view-marshal.h"
 #include "ev-document-annotations.h"
@@ -113,6 +114,10 @@ typedef struct {
 #define SCROLL_PAGE_THRESHOLD 0.7
 
 #define DEFAULT_PIXBUF_CACHE_SIZE 52428800 /* 50MB */
+#define DEFAULT_PIXBUF_CACHE_SCALE_GENERATIONS 1
+
+/* Seconds without scrolling after which the scroll velocity is reset */
+#define SCROLL_VELOCITY_TIMEOUT 0.25
 
 #define EV_STYLE_CLASS_DOCUMENT_PAGE "document-page"
 #define EV_STYLE_CLASS_INVERTED      "inverted"
@@ -372,6 +377,7 @@ ev_view_build_height_to_page_cache (EvView		*view,
 
 	cache->rotation = view->rotation;
 	cache->dual_even_left = view->dual_even_left;
+	cache->dirty = FALSE;
 	cache->height_to_page = g_new0 (gdouble, n_pages + 1);
 	cache->dual_height_to_page = g_new0 (gdouble, n_pages + 2);
 
@@ -491,7 +497,8 @@ ev_view_get_height_to_page (EvView *view,
 		return;
 
 	cache = view->height_to_page_cache;
-	if (cache->rotation != view->rotation ||
+	if (cache->dirty ||
+	    cache->rotation != view->rotation ||
 	    cache->dual_even_left != view->dual_even_left) {
 		ev_view_build_height_to_page_cache (view, cache);
 	}
@@ -737,6 +744,42 @@ ev_view_set_adjustment_values (EvView         *view,
 	}
 }
 
+/* Returns the first page of the row containing @y, or of the row
+ * right above it when @y falls in the spacing between two rows. The
+ * y offsets come from the height to page cache, which holds the
+ * prefix sums of the page heights, so they grow with the page index
+ * and a binary search is enough to find the row.
+ */
+static gint
+ev_view_get_first_page_at_y (EvView    *view,
+			     GtkBorder *border,
+			     gint       y)
+{
+	gint low, high, mid;
+	gint offset, prev_offset;
+
+	low = 0;
+	high = ev_document_get_n_pages (view->document) - 1;
+	while (low < high) {
+		mid = low + (high - low + 1) / 2;
+		get_page_y_offset (view, mid, &offset, border);
+		if (offset <= y)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+
+	/* Both pages of a row in dual mode share the same offset */
+	if (low > 0 && is_dual_page (view, NULL)) {
+		get_page_y_offset (view, low, &offset, border);
+		get_page_y_offset (view, low - 1, &prev_offset, border);
+		if (prev_offset == offset)
+			low--;
+	}
+
+	return low;
+}
+
 static void
 view_update_range_and_current_page (EvView *view)
 {
@@ -755,7 +798,8 @@ view_update_range_and_current_page (EvView *view)
 		gint area_max = -1, area;
 		gint best_current_page = -1;
 		gint n_pages;
-		int i, j = 0;
+		gint first;
+		int i;
 
 		if (!(view->vadjustment && view->hadjustment))
 			return;
@@ -767,10 +811,17 @@ view_update_range_and_current_page (EvView *view)
 
 		n_pages = ev_document_get_n_pages (view->document);
 		compute_border (view, &border);
-		for (i = 0; i < n_pages; i++) {
+		first = ev_view_get_first_page_at_y (view, &border, current_area.y);
+		for (i = first; i < n_pages; i++) {
 
 			ev_view_get_page_extents_for_border (view, i, &border, &page_area);
 
+			/* Pages are laid out top to bottom, so nothing
+			 * after this one can be visible.
+			 */
+			if (page_area.y >= current_area.y + current_area.height)
+				break;
+
 			if (gdk_rectangle_intersect (&current_area, &page_area, &unused)) {
 				area = unused.width * unused.height;
 
@@ -786,16 +837,6 @@ view_update_range_and_current_page (EvView *view)
 				}
 
 				view->end_page = i;
-				j = 0;
-			} else if (found && view->current_page <= view->end_page) {
-				if (is_dual_page (view, NULL) && j < 1) {
-					/* In dual mode  we stop searching
-					 * after two consecutive non-visible pages.
-					 */
-					j++;
-					continue;
-				}
-				break;
 			}
 		}
 
@@ -857,7 +898,9 @@ view_update_range_and_current_page (EvView *view)
 						   view->start_page,
 						   view->end_page);
 
-	if (ev_pixbuf_cache_get_surface (view->pixbuf_cache, view->current_page))
+	/* Tiles are requested when drawing */
+	if (ev_pixbuf_cache_get_surface (view->pixbuf_cache, view->current_page) ||
+	    ev_pixbuf_cache_page_is_tiled (view->pixbuf_cache, view->current_page))
 	    gtk_widget_queue_draw (GTK_WIDGET (view));
 }
 
@@ -973,11 +1016,11 @@ compute_scroll_increment (EvView        *view,
 		doc_rect.x1 = doc_rect.x2 = rect.x + 0.5;
 		doc_rect.y1 = doc_rect.y2 = rect.y + 0.5;
 
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (view->document);
 		sel_region = ev_selection_get_selection_region (EV_SELECTION (view->document),
 								rc, EV_SELECTION_STYLE_LINE,
 								&doc_rect);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (view->document);
 
 		g_object_unref (rc);
 
@@ -3389,10 +3432,10 @@ ev_view_annotation_save_contents (EvView       *view,
 	if (!view->document)
 		return;
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 	ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 						 annot, EV_ANNOTATIONS_SAVE_CONTENTS);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 	g_signal_emit (view, signals[SIGNAL_ANNOT_CHANGED], 0, annot);
 }
 
@@ -3721,7 +3764,7 @@ ev_view_create_annotation_real (EvView *view,
 	GdkRectangle    view_rect;
 	cairo_region_t *region;
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 	page = ev_document_get_page (view->document, annot_page);
         switch (view->adding_annot_info.type) {
         case EV_ANNOTATION_TYPE_TEXT:
@@ -3741,7 +3784,7 @@ ev_view_create_annotation_real (EvView *view,
 	case EV_ANNOTATION_TYPE_ATTACHMENT:
 		/* TODO */
 		g_object_unref (page);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (view->document);
 		return;
 	default:
 		g_assert_not_reached ();
@@ -3769,7 +3812,7 @@ ev_view_create_annotation_real (EvView *view,
 						annot, &doc_rect);
 	/* Re-fetch area as eg. adding Text Markup annots updates area for its bounding box */
 	ev_annotation_get_area (annot, &doc_rect);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 
 	/* If the page didn't have annots, mark the cache as dirty */
 	if (!ev_page_cache_get_annot_mapping (view->page_cache, annot_page))
@@ -3908,10 +3951,10 @@ ev_view_cancel_add_annotation (EvView *view)
 
 	if (view->adding_annot_info.annot && view->pressed_button == GDK_BUTTON_PRIMARY) {
 		annot_page = ev_annotation_get_page_index (view->adding_annot_info.annot);
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (view->document);
 		ev_document_annotations_remove_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 							   view->adding_annot_info.annot);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (view->document);
 		ev_page_cache_mark_dirty (view->page_cache, annot_page, EV_PAGE_DATA_INCLUDE_ANNOTS);
 		view->adding_annot_info.annot = NULL;
 		view->pressed_button = -1;
@@ -3944,10 +3987,10 @@ ev_view_remove_annotation (EvView       *view,
 
         _ev_view_set_focused_element (view, NULL, -1);
 
-        ev_document_doc_mutex_lock ();
+        ev_document_lock (view->document);
         ev_document_annotations_remove_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
                                                    annot);
-        ev_document_doc_mutex_unlock ();
+        ev_document_unlock (view->document);
 
         ev_page_cache_mark_dirty (view->page_cache, page, EV_PAGE_DATA_INCLUDE_ANNOTS);
 
@@ -5845,10 +5888,10 @@ ev_view_drag_data_get (GtkWidget        *widget,
 			if (view->image_dnd_info.image) {
 				GdkPixbuf *pixbuf;
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (view->document),
 								       view->image_dnd_info.image);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 				
 				gtk_selection_data_set_pixbuf (selection_data, pixbuf);
 				g_object_unref (pixbuf);
@@ -5860,10 +5903,10 @@ ev_view_drag_data_get (GtkWidget        *widget,
 				const gchar *tmp_uri;
 				gchar       *uris[2];
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (view->document),
 								       view->image_dnd_info.image);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 				
 				tmp_uri = ev_image_save_tmp (view->image_dnd_info.image, pixbuf);
 				g_object_unref (pixbuf);
@@ -6137,13 +6180,13 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 
 			/* Take the mutex before set_area, because the notify signal
 			 * updates the mappings in the backend */
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			if (ev_annotation_set_area (view->adding_annot_info.annot, &rect)) {
 				ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									 view->adding_annot_info.annot,
 									 EV_ANNOTATIONS_SAVE_AREA);
 			}
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 
 			/* FIXME: reload only annotation area */
@@ -6201,13 +6244,13 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 
 			/* Take the mutex before set_area, because the notify signal
 			 * updates the mappings in the backend */
-			ev_document_doc_mutex_lock ();
+			ev_document_lock (view->document);
 			if (ev_annotation_set_area (view->moving_annot_info.annot, &rect)) {
 				ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									 view->moving_annot_info.annot,
 									 EV_ANNOTATIONS_SAVE_AREA);
 			}
-			ev_document_doc_mutex_unlock ();
+			ev_document_unlock (view->document);
 
 			/* FIXME: reload only annotation area */
 			ev_view_reload_page (view, annot_page, NULL);
@@ -6473,10 +6516,10 @@ ev_view_button_release_event (GtkWidget      *widget,
 				/* Do not create empty annots */
 				annot_added = FALSE;
 
-				ev_document_doc_mutex_lock ();
+				ev_document_lock (view->document);
 				ev_document_annotations_remove_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 									   view->adding_annot_info.annot);
-				ev_document_doc_mutex_unlock ();
+				ev_document_unlock (view->document);
 
 				ev_page_cache_mark_dirty (view->page_cache,
 							  ev_annotation_get_page_index (view->adding_annot_info.annot),
@@ -6489,11 +6532,11 @@ ev_view_button_release_event (GtkWidget      *widget,
 
 				if (ev_annotation_markup_set_rectangle (EV_ANNOTATION_MARKUP (view->adding_annot_info.annot),
 									&popup_rect)) {
-					ev_document_doc_mutex_lock ();
+					ev_document_lock (view->document);
 					ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (view->document),
 										 view->adding_annot_info.annot,
 										 EV_ANNOTATIONS_SAVE_POPUP_RECT);
-					ev_document_doc_mutex_unlock ();
+					ev_document_unlock (view->document);
 				}
 			}
 		}
@@ -7545,6 +7588,118 @@ draw_selection_region (cairo_t        *cr,
 	cairo_restore (cr);
 }
 
+typedef struct {
+	cairo_t      *cr;
+	GdkRectangle *real_page_area;
+	GdkRectangle *overlap;
+} DrawStaleTileData;
+
+static void
+draw_stale_tile (cairo_surface_t    *surface,
+		 const GdkRectangle *area,
+		 gpointer            user_data)
+{
+	DrawStaleTileData *data = user_data;
+	GdkRectangle       tile_area = *area;
+
+	tile_area.x += data->real_page_area->x;
+	tile_area.y += data->real_page_area->y;
+	if (!gdk_rectangle_intersect (&tile_area, data->overlap, NULL))
+		return;
+
+	draw_surface (data->cr, surface, tile_area.x, tile_area.y, 0, 0,
+		      tile_area.width, tile_area.height);
+}
+
+/* Draws the tiles of previous scales, transformed to the current one,
+ * below the tiles that are not rendered yet.
+ */
+static void
+draw_page_stale_tiles (EvView       *view,
+		       cairo_t      *cr,
+		       gint          page,
+		       GdkRectangle *real_page_area,
+		       GdkRectangle *overlap)
+{
+	DrawStaleTileData data;
+
+	data.cr = cr;
+	data.real_page_area = real_page_area;
+	data.overlap = overlap;
+	ev_pixbuf_cache_foreach_stale_tile (view->pixbuf_cache, page,
+					    draw_stale_tile, &data);
+}
+
+/* Draws the tiles of @page intersecting @overlap, in rows from top to
+ * bottom so that they are rendered in that order. Returns %FALSE if some
+ * of them are not rendered yet.
+ */
+static gboolean
+draw_page_tiles (EvView       *view,
+		 cairo_t      *cr,
+		 gint          page,
+		 GdkRectangle *real_page_area,
+		 GdkRectangle *overlap)
+{
+	gint              tile_size;
+	gint              width, height;
+	gint              first_x, first_y, last_x, last_y;
+	gint              n_columns;
+	gint              tile_x, tile_y;
+	cairo_surface_t **tiles;
+	gboolean          all_ready = TRUE;
+
+	tile_size = ev_pixbuf_cache_get_tile_size (view->pixbuf_cache);
+	ev_view_get_page_size (view, page, &width, &height);
+
+	first_x = (overlap->x - real_page_area->x) / tile_size;
+	first_y = (overlap->y - real_page_area->y) / tile_size;
+	last_x = (overlap->x + overlap->width - 1 - real_page_area->x) / tile_size;
+	last_y = (overlap->y + overlap->height - 1 - real_page_area->y) / tile_size;
+	n_columns = last_x - first_x + 1;
+
+	tiles = g_new0 (cairo_surface_t *, n_columns * (last_y - first_y + 1));
+	for (tile_y = first_y; tile_y <= last_y; tile_y++) {
+		for (tile_x = first_x; tile_x <= last_x; tile_x++) {
+			cairo_surface_t *tile_surface;
+
+			/* Getting a tile can evict the ones got before it,
+			 * they are kept alive until they are drawn */
+			tile_surface = ev_pixbuf_cache_get_tile_surface (view->pixbuf_cache,
+									 page, tile_x, tile_y);
+			if (!tile_surface)
+				all_ready = FALSE;
+			else
+				cairo_surface_reference (tile_surface);
+			tiles[(tile_y - first_y) * n_columns + tile_x - first_x] = tile_surface;
+		}
+	}
+
+	if (!all_ready)
+		draw_page_stale_tiles (view, cr, page, real_page_area, overlap);
+
+	for (tile_y = first_y; tile_y <= last_y; tile_y++) {
+		for (tile_x = first_x; tile_x <= last_x; tile_x++) {
+			cairo_surface_t *tile_surface;
+
+			tile_surface = tiles[(tile_y - first_y) * n_columns + tile_x - first_x];
+			if (!tile_surface)
+				continue;
+
+			draw_surface (cr, tile_surface,
+				      real_page_area->x + tile_x * tile_size,
+				      real_page_area->y + tile_y * tile_size,
+				      0, 0,
+				      MIN (tile_size, width - tile_x * tile_size),
+				      MIN (tile_size, height - tile_y * tile_size));
+			cairo_surface_destroy (tile_surface);
+		}
+	}
+	g_free (tiles);
+
+	return all_ready;
+}
+
 static void
 draw_one_page (EvView       *view,
 	       gint          page,
@@ -7595,9 +7750,46 @@ draw_one_page (EvView       *view,
 		gint offset_x, offset_y;
 		cairo_region_t *region = NULL;
 
+		if (ev_pixbuf_cache_page_is_tiled (view->pixbuf_cache, page)) {
+			/* Draw the preview, if any, below the missing tiles */
+			page_surface = ev_pixbuf_cache_get_surface (view->pixbuf_cache, page);
+			if (page_surface) {
+				ev_view_get_page_size (view, page, &width, &height);
+				offset_x = overlap.x - real_page_area.x;
+				offset_y = overlap.y - real_page_area.y;
+				draw_surface (cr, page_surface, overlap.x, overlap.y, offset_x, offset_y, width, height);
+			}
+
+			*page_ready = draw_page_tiles (view, cr, page, &real_page_area, &overlap);
+			if (page == current_page)
+				ev_view_set_loading (view, !*page_ready);
+
+			/* Selections are drawn from their region, rendering
+			 * a selection surface of the whole page is what tiles avoid.
+			 */
+			if (!find_selection_for_page (view, page))
+				return;
+
+			region = ev_pixbuf_cache_get_selection_region (view->pixbuf_cache,
+								       page,
+								       view->scale);
+			if (region) {
+				GdkRGBA color;
+
+				_ev_view_get_selection_colors (view, &color, NULL);
+				draw_selection_region (cr, region, &color, real_page_area.x, real_page_area.y,
+						       1., 1.);
+			}
+
+			return;
+		}
+
 		page_surface = ev_pixbuf_cache_get_surface (view->pixbuf_cache, page);
 
 		if (!page_surface) {
+			/* Zooming out of a tiled page */
+			draw_page_stale_tiles (view, cr, page, &real_page_area, &overlap);
+
 			if (page == current_page)
 				ev_view_set_loading (view, TRUE);
 
@@ -7717,6 +7909,11 @@ ev_view_dispose (GObject *object)
 		view->update_cursor_idle_id = 0;
 	}
 
+	if (view->scroll_velocity_timeout_id) {
+		g_source_remove (view->scroll_velocity_timeout_id);
+		view->scroll_velocity_timeout_id = 0;
+	}
+
 	if (view->selection_scroll_id) {
 	    g_source_remove (view->selection_scroll_id);
 	    view->selection_scroll_id = 0;
@@ -8588,6 +8785,7 @@ ev_view_init (EvView *view)
 	view->jump_to_find_result = TRUE;
 	view->highlight_find_results = FALSE;
 	view->pixbuf_cache_size = DEFAULT_PIXBUF_CACHE_SIZE;
+	view->pixbuf_cache_scale_generations = DEFAULT_PIXBUF_CACHE_SCALE_GENERATIONS;
 	view->caret_enabled = FALSE;
 	view->cursor_page = 0;
 	view->allow_links_change_zoom = TRUE;
@@ -8677,6 +8875,56 @@ schedule_scroll_cursor_update (EvView *view)
 		g_idle_add (cursor_scroll_update, view);
 }
 
+/* Scrolling stopped: the preload window shrinks back */
+static gboolean
+scroll_velocity_timeout_cb (EvView *view)
+{
+	view->scroll_velocity_timeout_id = 0;
+	view->scroll_velocity = 0;
+
+	if (view->pixbuf_cache) {
+		ev_pixbuf_cache_set_scroll_velocity (view->pixbuf_cache, 0);
+		if (view->document)
+			view_update_range_and_current_page (view);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Estimates the vertical scroll velocity, so that the pixbuf cache
+ * can preload more pages in the scroll direction when scrolling fast
+ */
+static void
+ev_view_update_scroll_velocity (EvView *view,
+				gint    dy)
+{
+	gint64  now = g_get_monotonic_time ();
+	gdouble elapsed;
+
+	elapsed = (now - view->scroll_velocity_time) / (gdouble) G_USEC_PER_SEC;
+	view->scroll_velocity_time = now;
+
+	if (elapsed > SCROLL_VELOCITY_TIMEOUT) {
+		/* A new scroll gesture */
+		view->scroll_velocity = 0;
+	} else if (elapsed > 0) {
+		/* dy is negative when scrolling down */
+		view->scroll_velocity = (view->scroll_velocity - dy / elapsed) / 2;
+	}
+
+	if (view->pixbuf_cache)
+		ev_pixbuf_cache_set_scroll_velocity (view->pixbuf_cache, view->scroll_velocity);
+
+	if (view->scroll_velocity_timeout_id > 0)
+		g_source_remove (view->scroll_velocity_timeout_id);
+	view->scroll_velocity_timeout_id = 0;
+	if (view->scroll_velocity != 0)
+		view->scroll_velocity_timeout_id =
+			g_timeout_add (SCROLL_VELOCITY_TIMEOUT * 1000,
+				       (GSourceFunc) scroll_velocity_timeout_cb,
+				       view);
+}
+
 static void
 on_adjustment_value_changed (GtkAdjustment *adjustment,
 			     EvView        *view)
@@ -8753,6 +9001,8 @@ on_adjustment_value_changed (GtkAdjustment *adjustment,
 	if (!cursor_updated)
 		schedule_scroll_cursor_update (view);
 
+	ev_view_update_scroll_velocity (view, dy);
+
 	if (view->document)
 		view_update_range_and_current_page (view);
 }
@@ -8774,6 +9024,7 @@ setup_caches (EvView *view)
 
 	view->height_to_page_cache = ev_view_get_height_to_page_cache (view);
 	view->pixbuf_cache = ev_pixbuf_cache_new (GTK_WIDGET (view), view->model, view->pixbuf_cache_size);
+	ev_pixbuf_cache_set_scale_generations (view->pixbuf_cache, view->pixbuf_cache_scale_generations);
 	view->page_cache = ev_page_cache_new (view->document);
 
 	ev_page_cache_set_flags (view->page_cache,
@@ -8825,10 +9076,62 @@ ev_view_set_page_cache_size (EvView *view,
 	view->pixbuf_cache_size = cache_size;
 	if (view->pixbuf_cache)
 		ev_pixbuf_cache_set_max_size (view->pixbuf_cache, cache_size);
+	ev_surface_cache_set_max_size (cache_size);
 
 	view_update_scale_limits (view);
 }
 
+/**
+ * ev_view_set_page_cache_scale_generations:
+ * @view: #EvView instance
+ * @scale_generations: number of previous scales to keep
+ *
+ * Sets how many previous zoom levels of the rendered pages are kept, to
+ * be drawn scaled while pages render at the new zoom level. They are
+ * part of the page cache, so they are evicted first when it's full.
+ * Use 0 to discard them as soon as the zoom level changes.
+ *
+ * Since: 44.0
+ */
+void
+ev_view_set_page_cache_scale_generations (EvView *view,
+					  guint   scale_generations)
+{
+	g_return_if_fail (EV_IS_VIEW (view));
+
+	view->pixbuf_cache_scale_generations = scale_generations;
+	if (view->pixbuf_cache)
+		ev_pixbuf_cache_set_scale_generations (view->pixbuf_cache, scale_generations);
+}
+
+/**
+ * ev_view_get_page_cache_stats:
+ * @view: #EvView instance
+ * @hits: (out) (optional): return location for the number of hits
+ * @misses: (out) (optional): return location for the number of misses
+ *
+ * Gets how many pages were already rendered when they became visible
+ * (@hits), and how many had to be rendered then (@misses), since the
+ * current document was set.
+ *
+ * Since: 44.0
+ */
+void
+ev_view_get_page_cache_stats (EvView *view,
+			      guint  *hits,
+			      guint  *misses)
+{
+	g_return_if_fail (EV_IS_VIEW (view));
+
+	if (hits)
+		*hits = 0;
+	if (misses)
+		*misses = 0;
+
+	if (view->pixbuf_cache)
+		ev_pixbuf_cache_get_preload_stats (view->pixbuf_cache, hits, misses);
+}
+
 /**
  * ev_view_set_loading:
  * @view:
@@ -8939,6 +9242,39 @@ ev_view_document_changed_cb (EvDocumentModel *model,
 	}
 }
 
+static void
+ev_view_page_sizes_changed_cb (EvDocumentModel *model,
+			       gint             first_page,
+			       gint             n_pages,
+			       EvView          *view)
+{
+	if (!view->document || !view->height_to_page_cache)
+		return;
+
+	/* Keep the point shown at the top left of the current page */
+	if (first_page <= view->current_page) {
+		GdkPoint     view_point;
+		GdkRectangle page_area;
+		GtkBorder    border;
+
+		view_point.x = view->scroll_x;
+		view_point.y = view->scroll_y;
+		ev_view_get_page_extents (view, view->current_page, &page_area, &border);
+		_ev_view_transform_view_point_to_doc_point (view, &view_point,
+							    &page_area, &border,
+							    &view->pending_point.x,
+							    &view->pending_point.y);
+		view->pending_scroll = SCROLL_TO_PAGE_POSITION;
+	}
+
+	/* Rebuilt once at the next layout, whatever the number of
+	 * changes until then.
+	 */
+	view->height_to_page_cache->dirty = TRUE;
+	view_update_scale_limits (view);
+	gtk_widget_queue_resize (GTK_WIDGET (view));
+}
+
 static void
 ev_view_rotation_changed_cb (EvDocumentModel *model,
 			     GParamSpec      *pspec,
@@ -9191,6 +9527,9 @@ ev_view_set_model (EvView          *view,
 	g_signal_connect (view->model, "page-changed",
 			  G_CALLBACK (ev_view_page_changed_cb),
 			  view);
+	g_signal_connect (view->model, "page-sizes-changed",
+			  G_CALLBACK (ev_view_page_sizes_changed_cb),
+			  view);
 
 	if (view->accessible)
 		ev_view_accessible_set_model (EV_VIEW_ACCESSIBLE (view->accessible),
@@ -9212,6 +9551,7 @@ ev_view_reload_page (EvView         *view,
 void
 ev_view_reload (EvView *view)
 {
+	ev_surface_cache_remove_document (view->document);
 	ev_pixbuf_cache_clear (view->pixbuf_cache);
 	view_update_range_and_current_page (view);
 }
@@ -9678,6 +10018,30 @@ jump_to_find_page (EvView *view, EvViewFindDirection direction, gint shift)
 		ev_document_model_set_page (view->model, view->find_page);
 }
 
+/* Pages are not searched in order, the first match after find_page is
+ * only known when all the pages up to it have been searched.
+ */
+static gboolean
+find_next_page_is_known (EvView *view)
+{
+	gint n_pages, i;
+
+	if (!view->find_job)
+		return TRUE;
+
+	n_pages = ev_document_get_n_pages (view->document);
+	for (i = 0; i < n_pages; i++) {
+		gint page = (view->find_page + i) % n_pages;
+
+		if (!ev_job_find_is_page_searched (view->find_job, page))
+			return FALSE;
+		if (view->find_pages[page])
+			return TRUE;
+	}
+
+	return TRUE;
+}
+
 static void
 find_job_updated_cb (EvJobFind *job, gint page, EvView *view)
 {
@@ -9722,7 +10086,7 @@ ev_view_find_changed (EvView *view, GList **results, gint page)
 	if (view->find_page == -1)
 		view->find_page = view->current_page;
 
-	if (view->jump_to_find_result == TRUE) {
+	if (view->jump_to_find_result == TRUE && find_next_page_is_known (view)) {
 		jump_to_find_page (view, EV_VIEW_FIND_NEXT, 0);
 		jump_to_find_result (view);
 	}
@@ -10229,7 +10593,7 @@ get_selected_text (EvView *view)
 
 	text = g_string_new (NULL);
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (view->document);
 
 	for (l = view->selection_info.selections; l != NULL; l = l->next) {
 		EvViewSelection *selection = (EvViewSelection *)l->data;
@@ -10245,7 +10609,7 @@ get_selected_text (EvView *view)
 		g_free (tmp);
 	}
 
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (view->document);
 	
 	/* For copying text from the document to the clipboard, we want a normalization
 	 * that preserves 'canonical equivalence' i.e. that text after normalization
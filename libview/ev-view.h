@@ -61,6 +61,13 @@ void            ev_view_reload              (EvView          *view);
 EV_PUBLIC
 void            ev_view_set_page_cache_size (EvView          *view,
 					     gsize            cache_size);
+EV_PUBLIC
+void            ev_view_set_page_cache_scale_generations (EvView *view,
+							  guint   scale_generations);
+EV_PUBLIC
+void            ev_view_get_page_cache_stats (EvView          *view,
+					      guint           *hits,
+					      guint           *misses);
 
 EV_PUBLIC
 void            ev_view_set_allow_links_change_zoom (EvView  *view,
@@ -24,6 +24,7 @@
 #endif
 
 #include "ev-find-sidebar.h"
+#include "ev-page-text.h"
 #include <string.h>
 
 typedef struct {
@@ -36,9 +37,7 @@ typedef struct {
         gint         first_match_page;
 
         EvJobFind *job;
-        gint       job_current_page;
-        gint       current_page;
-        gint       insert_position;
+        GQueue     pending_pages;
 } EvFindSidebarPrivate;
 
 enum {
@@ -70,6 +69,7 @@ ev_find_sidebar_cancel (EvFindSidebar *sidebar)
                 g_source_remove (priv->process_matches_idle_id);
                 priv->process_matches_idle_id = 0;
         }
+        g_queue_clear (&priv->pending_pages);
         g_clear_object (&priv->job);
 }
 
@@ -394,26 +394,25 @@ get_surrounding_text_markup (const gchar  *text,
         return markup;
 }
 
-static gchar *
-get_page_text (EvDocument   *document,
-               EvPage       *page,
-               EvRectangle **areas,
-               guint        *n_areas)
+/* The text is shared with the view and the accessibility support,
+ * so it is only extracted once for every page.
+ */
+static EvPageText *
+get_page_text (EvDocument *document,
+               gint        page)
 {
-        gchar   *text;
-        gboolean success;
-
-        ev_document_doc_mutex_lock ();
-        text = ev_document_text_get_text (EV_DOCUMENT_TEXT (document), page);
-        success = ev_document_text_get_text_layout (EV_DOCUMENT_TEXT (document), page, areas, n_areas);
-        ev_document_doc_mutex_unlock ();
-
-        if (!success) {
-                g_free (text);
+        EvPageText *page_text;
+
+        page_text = ev_page_text_get (document, page,
+                                      EV_PAGE_DATA_INCLUDE_TEXT |
+                                      EV_PAGE_DATA_INCLUDE_TEXT_LAYOUT |
+                                      EV_PAGE_DATA_INCLUDE_TEXT_LOG_ATTRS);
+        if (page_text && (!page_text->text || !page_text->layout)) {
+                ev_page_text_unref (page_text);
                 return NULL;
         }
 
-        return text;
+        return page_text;
 }
 
 static gint
@@ -448,12 +447,53 @@ get_match_offset (EvRectangle *areas,
         return -1;
 }
 
+/* Rows are sorted by page, returns the position of the first row
+ * after the ones of @page.
+ */
+static gint
+get_page_insert_position (GtkTreeModel *model,
+                          gint          page)
+{
+        gint low = 0;
+        gint high = gtk_tree_model_iter_n_children (model, NULL);
+
+        while (low < high) {
+                GtkTreeIter iter;
+                gint        mid = (low + high) / 2;
+                gint        row_page;
+
+                gtk_tree_model_iter_nth_child (model, &iter, NULL, mid);
+                gtk_tree_model_get (model, &iter, PAGE_COLUMN, &row_page, -1);
+                if (row_page <= page + 1)
+                        low = mid + 1;
+                else
+                        high = mid;
+        }
+
+        return low;
+}
+
+static gint
+get_first_match_page (EvJobFind *job,
+                      gint       page)
+{
+        gint i;
+
+        for (i = 0; i < job->n_pages; i++) {
+                gint index = (page + i) % job->n_pages;
+
+                if (job->pages[index])
+                        return index;
+        }
+
+        return -1;
+}
+
 static gboolean
 process_matches_idle (EvFindSidebar *sidebar)
 {
         EvFindSidebarPrivate *priv = GET_PRIVATE (sidebar);
         GtkTreeModel         *model;
-        gint                  current_page;
         EvDocument           *document;
 
         priv->process_matches_idle_id = 0;
@@ -467,38 +507,27 @@ process_matches_idle (EvFindSidebar *sidebar)
         document = EV_JOB (priv->job)->document;
         model = gtk_tree_view_get_model (GTK_TREE_VIEW (priv->tree_view));
 
-        do {
+        while (!g_queue_is_empty (&priv->pending_pages)) {
                 GList        *matches, *l;
-                EvPage       *page;
+                EvPageText   *page_text;
+                gint          current_page;
                 gint          result;
                 gchar        *page_label;
-                gchar        *page_text;
-                EvRectangle  *areas = NULL;
-                guint         n_areas;
-                PangoLogAttr *text_log_attrs;
-                gulong        text_log_attrs_length;
                 gint          offset;
+                gint          position;
 
-                current_page = priv->current_page;
-                priv->current_page = (priv->current_page + 1) % priv->job->n_pages;
+                current_page = GPOINTER_TO_INT (g_queue_pop_head (&priv->pending_pages));
 
                 matches = priv->job->pages[current_page];
                 if (!matches)
                         continue;
 
-                page = ev_document_get_page (document, current_page);
-		page_label = ev_document_get_page_label (document, current_page);
-                page_text = get_page_text (document, page, &areas, &n_areas);
-                g_object_unref (page);
+                page_text = get_page_text (document, current_page);
                 if (!page_text)
                         continue;
 
-                text_log_attrs_length = g_utf8_strlen (page_text, -1);
-                text_log_attrs = g_new0 (PangoLogAttr, text_log_attrs_length + 1);
-                pango_get_log_attrs (page_text, -1, -1, NULL, text_log_attrs, text_log_attrs_length + 1);
-
-                if (priv->first_match_page == -1)
-                        priv->first_match_page = current_page;
+		page_label = ev_document_get_page_label (document, current_page);
+                position = get_page_insert_position (model, current_page);
 
                 offset = 0;
 
@@ -511,7 +540,8 @@ process_matches_idle (EvFindSidebar *sidebar)
                         if (l->prev && ((EvFindRectangle *)l->prev->data)->next_line)
                                 continue; /* Skip as this is second part of a multi-line match */
 
-                        new_offset = get_match_offset (areas, n_areas, match, offset);
+                        new_offset = get_match_offset (page_text->layout, page_text->n_layout,
+                                                       match, offset);
                         if (new_offset == -1) {
                                 g_warning ("No offset found for match \"%s\" at page %d after processing %d results\n",
                                            priv->job->text, current_page, result);
@@ -521,19 +551,13 @@ process_matches_idle (EvFindSidebar *sidebar)
                         }
                         offset = new_offset;
 
-                        if (current_page >= priv->job->start_page) {
-                                gtk_list_store_append (GTK_LIST_STORE (model), &iter);
-                        } else {
-                                gtk_list_store_insert (GTK_LIST_STORE (model), &iter,
-                                                       priv->insert_position);
-                                priv->insert_position++;
-                        }
+                        gtk_list_store_insert (GTK_LIST_STORE (model), &iter, position++);
 
-                        markup = get_surrounding_text_markup (page_text,
+                        markup = get_surrounding_text_markup (page_text->text,
                                                               priv->job->text,
                                                               priv->job->case_sensitive,
-                                                              text_log_attrs,
-                                                              text_log_attrs_length,
+                                                              page_text->log_attrs,
+                                                              page_text->n_log_attrs,
                                                               offset,
                                                               match->next_line,
                                                               match->after_hyphen);
@@ -548,13 +572,14 @@ process_matches_idle (EvFindSidebar *sidebar)
                 }
 
                 g_free (page_label);
-                g_free (page_text);
-                g_free (text_log_attrs);
-                g_free (areas);
-        } while (current_page != priv->job_current_page);
+                ev_page_text_unref (page_text);
+        }
 
-        if (ev_job_is_finished (EV_JOB (priv->job)) && priv->current_page == priv->job->start_page)
-                ev_find_sidebar_highlight_first_match_of_page (sidebar, priv->first_match_page);
+        if (ev_job_is_finished (EV_JOB (priv->job)) && priv->first_match_page == -1) {
+                priv->first_match_page = get_first_match_page (priv->job, priv->job->start_page);
+                if (priv->first_match_page != -1)
+                        ev_find_sidebar_highlight_first_match_of_page (sidebar, priv->first_match_page);
+        }
 
         return FALSE;
 }
@@ -566,7 +591,11 @@ find_job_updated_cb (EvJobFind     *job,
 {
         EvFindSidebarPrivate *priv = GET_PRIVATE (sidebar);
 
-        priv->job_current_page = page;
+        /* Pages are not searched in order, the rows of every page
+         * are inserted in place when they are processed.
+         */
+        if (job->pages[page])
+                g_queue_push_tail (&priv->pending_pages, GINT_TO_POINTER (page));
 }
 
 static void
@@ -593,10 +622,7 @@ ev_find_sidebar_start (EvFindSidebar *sidebar,
         g_signal_connect_object (job, "cancelled",
                                  G_CALLBACK (find_job_cancelled_cb),
                                  sidebar, 0);
-        priv->job_current_page = -1;
         priv->first_match_page = -1;
-        priv->current_page = job->start_page;
-        priv->insert_position = 0;
 }
 
 void
@@ -604,26 +630,12 @@ ev_find_sidebar_restart (EvFindSidebar *sidebar,
                          gint           page)
 {
         EvFindSidebarPrivate *priv = GET_PRIVATE (sidebar);
-        gint                  first_match_page = -1;
-        gint                  i;
+        gint                  first_match_page;
 
         if (!priv->job)
                 return;
 
-        for (i = 0; i < priv->job->n_pages; i++) {
-                int index;
-
-                index = page + i;
-
-                if (index >= priv->job->n_pages)
-                        index -= priv->job->n_pages;
-
-                if (priv->job->pages[index]) {
-                        first_match_page = index;
-                        break;
-                }
-        }
-
+        first_match_page = get_first_match_page (priv->job, page);
         if (first_match_page != -1)
                 ev_find_sidebar_highlight_first_match_of_page (sidebar, first_match_page);
 }
@@ -32,36 +32,32 @@
 #include <glib/gi18n.h>
 #include <gtk/gtk.h>
 
-#include <cairo-gobject.h>
-
 #include "ev-document-misc.h"
 #include "ev-job-scheduler.h"
 #include "ev-sidebar.h"
 #include "ev-sidebar-page.h"
 #include "ev-sidebar-thumbnails.h"
+#include "ev-thumbnails-atlas.h"
+#include "ev-thumbnails-model.h"
 #include "ev-utils.h"
 #include "ev-window.h"
 
 #define THUMBNAIL_WIDTH 100
 
-typedef struct _EvThumbsSize
-{
-	gint width;
-	gint height;
-} EvThumbsSize;
-
+/* Sizes of the pages are only computed when they are not uniform,
+ * the document already caches them */
 typedef struct _EvThumbsSizeCache {
+	EvDocument *document;
 	gboolean uniform;
 	gint uniform_width;
 	gint uniform_height;
-	EvThumbsSize *sizes;
 } EvThumbsSizeCache;
 
 struct _EvSidebarThumbnailsPrivate {
 	GtkWidget *swindow;
 	GtkWidget *icon_view;
 	GtkAdjustment *vadjustment;
-	GtkListStore *list_store;
+	EvThumbnailsModel *thumbnails_model;
 	GHashTable *loading_icons;
 	EvDocument *document;
 	EvDocumentModel *model;
@@ -76,14 +72,17 @@ struct _EvSidebarThumbnailsPrivate {
 					 * for dual mode with !odd_left preference. Issue #30 */
 	/* Visible pages */
 	gint start_page, end_page;
-};
 
-enum {
-	COLUMN_PAGE_STRING,
-	COLUMN_SURFACE,
-	COLUMN_THUMBNAIL_SET,
-	COLUMN_JOB,
-	NUM_COLUMNS
+	/* Thumbnails of the version of the document it was reloaded from,
+	 * indexed by page, kept for the pages that did not change */
+	gchar *uri;
+	GPtrArray *previous_thumbnails;
+
+	/* Thumbnails saved for the next time the document is shown, and
+	 * the pages whose thumbnails are being decoded from it */
+	EvThumbnailsAtlas *atlas;
+	GCancellable *atlas_cancellable;
+	GHashTable *atlas_lookups;
 };
 
 enum {
@@ -136,27 +135,15 @@ static EvThumbsSizeCache *
 ev_thumbnails_size_cache_new (EvDocument *document)
 {
 	EvThumbsSizeCache *cache;
-	gint               i, n_pages;
-	EvThumbsSize      *thumb_size;
 
 	cache = g_new0 (EvThumbsSizeCache, 1);
+	cache->document = document;
 
 	if (ev_document_is_page_size_uniform (document)) {
 		cache->uniform = TRUE;
 		get_thumbnail_size_for_page (document, 0,
 					     &cache->uniform_width,
 					     &cache->uniform_height);
-		return cache;
-	}
-
-	n_pages = ev_document_get_n_pages (document);
-	cache->sizes = g_new0 (EvThumbsSize, n_pages);
-
-	for (i = 0; i < n_pages; i++) {
-		thumb_size = &(cache->sizes[i]);
-		get_thumbnail_size_for_page (document, i,
-					     &thumb_size->width,
-					     &thumb_size->height);
 	}
 
 	return cache;
@@ -175,12 +162,7 @@ ev_thumbnails_size_cache_get_size (EvThumbsSizeCache *cache,
 		w = cache->uniform_width;
 		h = cache->uniform_height;
 	} else {
-		EvThumbsSize *thumb_size;
-
-		thumb_size = &(cache->sizes[page]);
-
-		w = thumb_size->width;
-		h = thumb_size->height;
+		get_thumbnail_size_for_page (cache->document, page, &w, &h);
 	}
 
 	if (rotation == 0 || rotation == 180) {
@@ -192,17 +174,6 @@ ev_thumbnails_size_cache_get_size (EvThumbsSizeCache *cache,
 	}
 }
 
-static void
-ev_thumbnails_size_cache_free (EvThumbsSizeCache *cache)
-{
-	if (cache->sizes) {
-		g_free (cache->sizes);
-		cache->sizes = NULL;
-	}
-
-	g_free (cache);
-}
-
 static EvThumbsSizeCache *
 ev_thumbnails_size_cache_get (EvDocument *document)
 {
@@ -214,7 +185,7 @@ ev_thumbnails_size_cache_get (EvDocument *document)
 		g_object_set_data_full (G_OBJECT (document),
 					EV_THUMBNAILS_SIZE_CACHE_KEY,
 					cache,
-					(GDestroyNotify)ev_thumbnails_size_cache_free);
+					(GDestroyNotify)g_free);
 	}
 
 	return cache;
@@ -262,11 +233,20 @@ ev_sidebar_thumbnails_dispose (GObject *object)
 		sidebar_thumbnails->priv->loading_icons = NULL;
 	}
 	
-	if (sidebar_thumbnails->priv->list_store) {
+	if (sidebar_thumbnails->priv->thumbnails_model) {
 		ev_sidebar_thumbnails_clear_model (sidebar_thumbnails);
-		g_object_unref (sidebar_thumbnails->priv->list_store);
-		sidebar_thumbnails->priv->list_store = NULL;
+		g_object_unref (sidebar_thumbnails->priv->thumbnails_model);
+		sidebar_thumbnails->priv->thumbnails_model = NULL;
+	}
+
+	g_clear_pointer (&sidebar_thumbnails->priv->uri, g_free);
+	g_clear_pointer (&sidebar_thumbnails->priv->previous_thumbnails, g_ptr_array_unref);
+	g_clear_pointer (&sidebar_thumbnails->priv->atlas, ev_thumbnails_atlas_free);
+	if (sidebar_thumbnails->priv->atlas_cancellable) {
+		g_cancellable_cancel (sidebar_thumbnails->priv->atlas_cancellable);
+		g_clear_object (&sidebar_thumbnails->priv->atlas_cancellable);
 	}
+	g_clear_pointer (&sidebar_thumbnails->priv->atlas_lookups, g_hash_table_destroy);
 
 	G_OBJECT_CLASS (ev_sidebar_thumbnails_parent_class)->dispose (object);
 }
@@ -426,16 +406,16 @@ cancel_running_jobs (EvSidebarThumbnails *sidebar_thumbnails,
 	g_assert (start_page <= end_page);
 
 	path = gtk_tree_path_new_from_indices (start_page, -1);
-	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->list_store), &iter, path);
+	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->thumbnails_model), &iter, path);
 	     result && start_page <= end_page;
-	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->list_store), &iter), start_page ++) {
+	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->thumbnails_model), &iter), start_page ++) {
 		EvJobThumbnail *job;
 		gboolean thumbnail_set;
 
-		gtk_tree_model_get (GTK_TREE_MODEL (priv->list_store),
+		gtk_tree_model_get (GTK_TREE_MODEL (priv->thumbnails_model),
 				    &iter,
-				    COLUMN_JOB, &job,
-				    COLUMN_THUMBNAIL_SET, &thumbnail_set,
+				    EV_THUMBNAILS_MODEL_COLUMN_JOB, &job,
+				    EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET, &thumbnail_set,
 				    -1);
 
 		if (thumbnail_set) {
@@ -449,10 +429,7 @@ cancel_running_jobs (EvSidebarThumbnails *sidebar_thumbnails,
 			g_object_unref (job);
 		}
 
-		gtk_list_store_set (priv->list_store, &iter,
-				    COLUMN_JOB, NULL,
-				    COLUMN_THUMBNAIL_SET, FALSE,
-				    -1);
+		ev_thumbnails_model_set_job (priv->thumbnails_model, &iter, NULL);
 	}
 	gtk_tree_path_free (path);
 }
@@ -483,6 +460,127 @@ get_size_for_page (EvSidebarThumbnails *sidebar_thumbnails,
         }
 }
 
+/* Shows @thumbnail, rendered for the page of @iter, with its frame */
+static void
+ev_sidebar_thumbnails_set_thumbnail (EvSidebarThumbnails *sidebar_thumbnails,
+				     GtkTreeIter         *iter,
+				     cairo_surface_t     *thumbnail)
+{
+        GtkWidget                  *widget = GTK_WIDGET (sidebar_thumbnails);
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+        cairo_surface_t            *surface;
+#ifdef HAVE_HIDPI_SUPPORT
+        gint                        device_scale;
+
+        device_scale = gtk_widget_get_scale_factor (widget);
+        cairo_surface_set_device_scale (thumbnail, device_scale, device_scale);
+#endif
+
+        surface = ev_document_misc_render_thumbnail_surface_with_frame (widget,
+                                                                        thumbnail,
+                                                                        -1, -1);
+
+	if (priv->inverted_colors)
+		ev_document_misc_invert_surface (surface);
+	ev_thumbnails_model_set_thumbnail (priv->thumbnails_model, iter, surface);
+        cairo_surface_destroy (surface);
+}
+
+static void
+ev_sidebar_thumbnails_push_job (EvSidebarThumbnails *sidebar_thumbnails,
+				GtkTreeIter         *iter,
+				gint                 page,
+				gint                 thumbnail_width,
+				gint                 thumbnail_height)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+	EvJob *job;
+
+	job = ev_job_thumbnail_new_with_target_size (priv->document,
+						     page, priv->rotation,
+						     thumbnail_width, thumbnail_height);
+	ev_job_thumbnail_set_has_frame (EV_JOB_THUMBNAIL (job), FALSE);
+	ev_job_thumbnail_set_output_format (EV_JOB_THUMBNAIL (job), EV_JOB_THUMBNAIL_SURFACE);
+	if (priv->previous_thumbnails && page >= 0 &&
+	    page < priv->previous_thumbnails->len &&
+	    g_ptr_array_index (priv->previous_thumbnails, page)) {
+		ev_job_thumbnail_set_previous_surface (EV_JOB_THUMBNAIL (job),
+						       g_ptr_array_index (priv->previous_thumbnails, page));
+		g_clear_pointer (&g_ptr_array_index (priv->previous_thumbnails, page),
+				 cairo_surface_destroy);
+	}
+	g_object_set_data_full (G_OBJECT (job), "tree_iter",
+				gtk_tree_iter_copy (iter),
+				(GDestroyNotify) gtk_tree_iter_free);
+	g_signal_connect (job, "finished",
+			  G_CALLBACK (thumbnail_job_completed_callback),
+			  sidebar_thumbnails);
+	ev_thumbnails_model_set_job (priv->thumbnails_model, iter, job);
+	ev_job_scheduler_push_job (EV_JOB (job), EV_JOB_PRIORITY_HIGH);
+
+	/* The queue and the model own a ref to the job now */
+	g_object_unref (job);
+}
+
+static void
+atlas_lookup_cb (GObject             *source_object,
+		 GAsyncResult        *result,
+		 EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+	cairo_surface_t *thumbnail;
+	GtkTreeIter iter;
+	GError *error = NULL;
+	EvJob *job;
+	gboolean thumbnail_set;
+	gint thumbnail_width, thumbnail_height;
+	gint page, row;
+
+	thumbnail = ev_thumbnails_atlas_lookup_finish (result, &page, &error);
+
+	/* The atlas was reset, or the sidebar disposed */
+	if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		g_error_free (error);
+		g_object_unref (sidebar_thumbnails);
+		return;
+	}
+	g_clear_error (&error);
+
+	g_hash_table_remove (priv->atlas_lookups, GINT_TO_POINTER (page));
+
+	row = priv->blank_first_dual_mode ? page + 1 : page;
+	if (!priv->document ||
+	    !gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (priv->thumbnails_model),
+					    &iter, NULL, row)) {
+		g_clear_pointer (&thumbnail, cairo_surface_destroy);
+		g_object_unref (sidebar_thumbnails);
+		return;
+	}
+
+	gtk_tree_model_get (GTK_TREE_MODEL (priv->thumbnails_model), &iter,
+			    EV_THUMBNAILS_MODEL_COLUMN_JOB, &job,
+			    EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET, &thumbnail_set,
+			    -1);
+
+	if (job == NULL && !thumbnail_set) {
+		get_size_for_page (sidebar_thumbnails, page, &thumbnail_width, &thumbnail_height);
+
+		/* Unless the size of the page changed since it was saved */
+		if (thumbnail &&
+		    ABS (cairo_image_surface_get_width (thumbnail) - thumbnail_width) <= 1 &&
+		    ABS (cairo_image_surface_get_height (thumbnail) - thumbnail_height) <= 1) {
+			ev_sidebar_thumbnails_set_thumbnail (sidebar_thumbnails, &iter, thumbnail);
+		} else {
+			ev_sidebar_thumbnails_push_job (sidebar_thumbnails, &iter, page,
+							thumbnail_width, thumbnail_height);
+		}
+	}
+
+	g_clear_object (&job);
+	g_clear_pointer (&thumbnail, cairo_surface_destroy);
+	g_object_unref (sidebar_thumbnails);
+}
+
 static void
 add_range (EvSidebarThumbnails *sidebar_thumbnails,
 	   gint                 start_page,
@@ -500,39 +598,38 @@ add_range (EvSidebarThumbnails *sidebar_thumbnails,
 		page--;
 
 	path = gtk_tree_path_new_from_indices (start_page, -1);
-	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->list_store), &iter, path);
+	for (result = gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->thumbnails_model), &iter, path);
 	     result && page <= end_page;
-	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->list_store), &iter), page ++) {
+	     result = gtk_tree_model_iter_next (GTK_TREE_MODEL (priv->thumbnails_model), &iter), page ++) {
 		EvJob *job;
 		gboolean thumbnail_set;
 
-		gtk_tree_model_get (GTK_TREE_MODEL (priv->list_store), &iter,
-				    COLUMN_JOB, &job,
-				    COLUMN_THUMBNAIL_SET, &thumbnail_set,
+		gtk_tree_model_get (GTK_TREE_MODEL (priv->thumbnails_model), &iter,
+				    EV_THUMBNAILS_MODEL_COLUMN_JOB, &job,
+				    EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET, &thumbnail_set,
 				    -1);
 
 		if (job == NULL && !thumbnail_set) {
 			gint thumbnail_width, thumbnail_height;
-			get_size_for_page (sidebar_thumbnails, page, &thumbnail_width, &thumbnail_height);
 
-			job = ev_job_thumbnail_new_with_target_size (priv->document,
-								     page, priv->rotation,
-								     thumbnail_width, thumbnail_height);
-                        ev_job_thumbnail_set_has_frame (EV_JOB_THUMBNAIL (job), FALSE);
-                        ev_job_thumbnail_set_output_format (EV_JOB_THUMBNAIL (job), EV_JOB_THUMBNAIL_SURFACE);
-			g_object_set_data_full (G_OBJECT (job), "tree_iter",
-						gtk_tree_iter_copy (&iter),
-						(GDestroyNotify) gtk_tree_iter_free);
-			g_signal_connect (job, "finished",
-					  G_CALLBACK (thumbnail_job_completed_callback),
-					  sidebar_thumbnails);
-			gtk_list_store_set (priv->list_store, &iter,
-					    COLUMN_JOB, job,
-					    -1);
-			ev_job_scheduler_push_job (EV_JOB (job), EV_JOB_PRIORITY_HIGH);
-			
-			/* The queue and the list own a ref to the job now */
-			g_object_unref (job);
+			/* Thumbnails saved the last time the document was shown,
+			 * or before the size of the page was known, are decoded
+			 * in a thread */
+			if (priv->atlas && page >= 0 &&
+			    ev_thumbnails_atlas_has_page (priv->atlas, page)) {
+				if (!g_hash_table_contains (priv->atlas_lookups, GINT_TO_POINTER (page))) {
+					g_hash_table_add (priv->atlas_lookups, GINT_TO_POINTER (page));
+					ev_thumbnails_atlas_lookup_async (priv->atlas, page,
+									  priv->atlas_cancellable,
+									  (GAsyncReadyCallback) atlas_lookup_cb,
+									  g_object_ref (sidebar_thumbnails));
+				}
+				continue;
+			}
+
+			get_size_for_page (sidebar_thumbnails, page, &thumbnail_width, &thumbnail_height);
+			ev_sidebar_thumbnails_push_job (sidebar_thumbnails, &iter, page,
+							thumbnail_width, thumbnail_height);
 		} else if (job) {
 			g_object_unref (job);
 		}
@@ -575,6 +672,7 @@ update_visible_range (EvSidebarThumbnails *sidebar_thumbnails,
 	
 	priv->start_page = start_page;
 	priv->end_page = end_page;
+	ev_thumbnails_model_set_visible_range (priv->thumbnails_model, start_page, end_page);
 }
 
 static void
@@ -613,43 +711,71 @@ adjustment_changed_cb (EvSidebarThumbnails *sidebar_thumbnails)
 	gtk_tree_path_free (path2);
 }
 
+static cairo_surface_t *
+ev_sidebar_thumbnails_get_loading_icon_for_page (EvThumbnailsModel   *thumbnails_model,
+						 gint                 page,
+						 EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+	gint width, height;
+
+	ev_thumbnails_size_cache_get_size (priv->size_cache, page,
+					   priv->rotation,
+					   &width, &height);
+
+	return ev_sidebar_thumbnails_get_loading_icon (sidebar_thumbnails, width, height);
+}
+
+/* The icon view is detached from the model while its rows change, it
+ * builds all its items at once when the model is set instead of
+ * inserting them one by one */
+static void
+ev_sidebar_thumbnails_set_model_document (EvSidebarThumbnails *sidebar_thumbnails,
+					  EvDocument          *document)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+
+	if (priv->icon_view)
+		gtk_icon_view_set_model (GTK_ICON_VIEW (priv->icon_view), NULL);
+
+	ev_thumbnails_model_set_document (priv->thumbnails_model, document);
+	if (document)
+		ev_thumbnails_model_set_blank_first (priv->thumbnails_model,
+						     priv->blank_first_dual_mode);
+
+	if (priv->icon_view)
+		gtk_icon_view_set_model (GTK_ICON_VIEW (priv->icon_view),
+					 GTK_TREE_MODEL (priv->thumbnails_model));
+}
+
 static void
 ev_sidebar_thumbnails_fill_model (EvSidebarThumbnails *sidebar_thumbnails)
+{
+	ev_sidebar_thumbnails_set_model_document (sidebar_thumbnails,
+						  sidebar_thumbnails->priv->document);
+}
+
+/* The atlas of the previous document or rotation is saved, and the one
+ * of the current document and rotation is loaded */
+static void
+ev_sidebar_thumbnails_reset_atlas (EvSidebarThumbnails *sidebar_thumbnails)
 {
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
-	GtkTreeIter iter;
-	int i;
-	gint prev_width = -1;
-	gint prev_height = -1;
-
-	for (i = 0; i < sidebar_thumbnails->priv->n_pages; i++) {
-		gchar     *page_label;
-		gchar     *page_string;
-		cairo_surface_t *loading_icon = NULL;
-		gint       width, height;
-
-		page_label = ev_document_get_page_label (priv->document, i);
-		page_string = g_markup_printf_escaped ("<i>%s</i>", page_label);
-		ev_thumbnails_size_cache_get_size (sidebar_thumbnails->priv->size_cache, i,
-						  sidebar_thumbnails->priv->rotation,
-						  &width, &height);
-		if (!loading_icon || (width != prev_width && height != prev_height)) {
-			loading_icon =
-				ev_sidebar_thumbnails_get_loading_icon (sidebar_thumbnails,
-									width, height);
-		}
+	gint device_scale = 1;
 
-		prev_width = width;
-		prev_height = height;
-		
-		gtk_list_store_append (priv->list_store, &iter);
-		gtk_list_store_set (priv->list_store, &iter,
-				    COLUMN_PAGE_STRING, page_string,
-				    COLUMN_SURFACE, loading_icon,
-				    COLUMN_THUMBNAIL_SET, FALSE,
-				    -1);
-		g_free (page_label);
-		g_free (page_string);
+#ifdef HAVE_HIDPI_SUPPORT
+	device_scale = gtk_widget_get_scale_factor (GTK_WIDGET (sidebar_thumbnails));
+#endif
+
+	g_clear_pointer (&priv->atlas, ev_thumbnails_atlas_free);
+	if (priv->atlas_cancellable)
+		g_cancellable_cancel (priv->atlas_cancellable);
+	g_clear_object (&priv->atlas_cancellable);
+	g_hash_table_remove_all (priv->atlas_lookups);
+
+	if (priv->document) {
+		priv->atlas = ev_thumbnails_atlas_new (priv->document, priv->rotation, device_scale);
+		priv->atlas_cancellable = g_cancellable_new ();
 	}
 }
 
@@ -697,7 +823,7 @@ ev_sidebar_init_icon_view (EvSidebarThumbnails *ev_sidebar_thumbnails)
 
 	priv = ev_sidebar_thumbnails->priv;
 
-	priv->icon_view = gtk_icon_view_new_with_model (GTK_TREE_MODEL (priv->list_store));
+	priv->icon_view = gtk_icon_view_new_with_model (GTK_TREE_MODEL (priv->thumbnails_model));
 
         renderer = g_object_new (GTK_TYPE_CELL_RENDERER_PIXBUF,
                                  "xalign", 0.5,
@@ -769,15 +895,15 @@ ev_sidebar_thumbnails_init (EvSidebarThumbnails *ev_sidebar_thumbnails)
 
 	priv = ev_sidebar_thumbnails->priv = ev_sidebar_thumbnails_get_instance_private (ev_sidebar_thumbnails);
 	priv->blank_first_dual_mode = FALSE;
+	priv->atlas_lookups = g_hash_table_new (NULL, NULL);
 
-	priv->list_store = gtk_list_store_new (NUM_COLUMNS,
-					       G_TYPE_STRING,
-					       CAIRO_GOBJECT_TYPE_SURFACE,
-					       G_TYPE_BOOLEAN,
-					       EV_TYPE_JOB_THUMBNAIL);
+	priv->thumbnails_model = ev_thumbnails_model_new ();
+	ev_thumbnails_model_set_loading_icon_func (priv->thumbnails_model,
+						   (EvThumbnailsModelLoadingIconFunc) ev_sidebar_thumbnails_get_loading_icon_for_page,
+						   ev_sidebar_thumbnails);
 
 	signal_id = g_signal_lookup ("row-changed", GTK_TYPE_TREE_MODEL);
-	g_signal_connect (GTK_TREE_MODEL (priv->list_store), "row-changed",
+	g_signal_connect (GTK_TREE_MODEL (priv->thumbnails_model), "row-changed",
 			  G_CALLBACK (ev_sidebar_thumbnails_row_changed),
 			  GUINT_TO_POINTER (signal_id));
 
@@ -860,8 +986,12 @@ ev_sidebar_thumbnails_reload (EvSidebarThumbnails *sidebar_thumbnails)
 
 	model = sidebar_thumbnails->priv->model;
 
+	/* Thumbnails are rendered again with a different size or colors */
+	g_clear_pointer (&sidebar_thumbnails->priv->previous_thumbnails, g_ptr_array_unref);
+
 	ev_sidebar_thumbnails_clear_model (sidebar_thumbnails);
 	ev_sidebar_thumbnails_fill_model (sidebar_thumbnails);
+	ev_sidebar_thumbnails_reset_atlas (sidebar_thumbnails);
 
 	/* Trigger a redraw */
 	sidebar_thumbnails->priv->start_page = -1;
@@ -897,36 +1027,26 @@ static void
 thumbnail_job_completed_callback (EvJobThumbnail      *job,
 				  EvSidebarThumbnails *sidebar_thumbnails)
 {
-        GtkWidget                  *widget = GTK_WIDGET (sidebar_thumbnails);
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
 	GtkTreeIter                *iter;
-        cairo_surface_t            *surface;
-#ifdef HAVE_HIDPI_SUPPORT
-        gint                        device_scale;
-#endif
 
         if (ev_job_is_failed (EV_JOB (job)))
           return;
 
-#ifdef HAVE_HIDPI_SUPPORT
-        device_scale = gtk_widget_get_scale_factor (widget);
-        cairo_surface_set_device_scale (job->thumbnail_surface, device_scale, device_scale);
-#endif
+	iter = (GtkTreeIter *) g_object_get_data (G_OBJECT (job), "tree_iter");
 
-        surface = ev_document_misc_render_thumbnail_surface_with_frame (widget,
-                                                                        job->thumbnail_surface,
-                                                                        -1, -1);
+	/* The page did not change since the document was reloaded, the
+	 * previous thumbnail already has its frame and colors */
+	if (job->previous_surface && job->thumbnail_surface == job->previous_surface) {
+		ev_thumbnails_model_set_thumbnail (priv->thumbnails_model, iter,
+						   job->thumbnail_surface);
+		gtk_widget_queue_draw (priv->icon_view);
+		return;
+	}
 
-	iter = (GtkTreeIter *) g_object_get_data (G_OBJECT (job), "tree_iter");
-	if (priv->inverted_colors)
-		ev_document_misc_invert_surface (surface);
-	gtk_list_store_set (priv->list_store,
-			    iter,
-			    COLUMN_SURFACE, surface,
-			    COLUMN_THUMBNAIL_SET, TRUE,
-			    COLUMN_JOB, NULL,
-			    -1);
-        cairo_surface_destroy (surface);
+	if (priv->atlas)
+		ev_thumbnails_atlas_add (priv->atlas, job->page, job->thumbnail_surface);
+	ev_sidebar_thumbnails_set_thumbnail (sidebar_thumbnails, iter, job->thumbnail_surface);
 
 	gtk_widget_queue_draw (priv->icon_view);
 }
@@ -944,6 +1064,13 @@ ev_sidebar_thumbnails_document_changed_cb (EvDocumentModel     *model,
 		return;
 	}
 
+	/* Keep the thumbnails when the document is reloaded */
+	g_clear_pointer (&priv->previous_thumbnails, g_ptr_array_unref);
+	if (priv->uri && g_strcmp0 (priv->uri, ev_document_get_uri (document)) == 0)
+		priv->previous_thumbnails = ev_thumbnails_model_get_thumbnails (priv->thumbnails_model);
+	g_free (priv->uri);
+	priv->uri = g_strdup (ev_document_get_uri (document));
+
 	priv->size_cache = ev_thumbnails_size_cache_get (document);
 	priv->document = document;
 	priv->n_pages = ev_document_get_n_pages (document);
@@ -960,6 +1087,7 @@ ev_sidebar_thumbnails_document_changed_cb (EvDocumentModel     *model,
 
 	ev_sidebar_thumbnails_clear_model (sidebar_thumbnails);
 	ev_sidebar_thumbnails_fill_model (sidebar_thumbnails);
+	ev_sidebar_thumbnails_reset_atlas (sidebar_thumbnails);
 
 	if (! priv->icon_view) {
 		ev_sidebar_init_icon_view (sidebar_thumbnails);
@@ -988,6 +1116,59 @@ ev_sidebar_thumbnails_document_changed_cb (EvDocumentModel     *model,
 	adjustment_changed_cb (sidebar_thumbnails);
 }
 
+/* Until the sizes of the pages of documents loaded with a lazy cache
+ * are known, all pages have the size of the first one. The thumbnails
+ * of the pages with another size are rendered again.
+ */
+static void
+ev_sidebar_thumbnails_page_sizes_changed_cb (EvDocumentModel     *model,
+					     gint                 first_page,
+					     gint                 n_pages,
+					     EvSidebarThumbnails *sidebar_thumbnails)
+{
+	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
+	gint                        first_width, first_height;
+	gint                        page;
+
+	if (!priv->document || priv->document != ev_document_model_get_document (model))
+		return;
+
+	if (priv->size_cache->uniform && !ev_document_is_page_size_uniform (priv->document))
+		priv->size_cache->uniform = FALSE;
+
+	get_thumbnail_size_for_page (priv->document, 0, &first_width, &first_height);
+
+	for (page = first_page; page < first_page + n_pages; page++) {
+		GtkTreePath *path;
+		GtkTreeIter  iter;
+		EvJob       *job;
+		gint         width, height;
+
+		get_thumbnail_size_for_page (priv->document, page, &width, &height);
+		if (width == first_width && height == first_height)
+			continue;
+
+		path = gtk_tree_path_new_from_indices (page + (priv->blank_first_dual_mode ? 1 : 0), -1);
+		if (gtk_tree_model_get_iter (GTK_TREE_MODEL (priv->thumbnails_model), &iter, path)) {
+			gtk_tree_model_get (GTK_TREE_MODEL (priv->thumbnails_model), &iter,
+					    EV_THUMBNAILS_MODEL_COLUMN_JOB, &job,
+					    -1);
+			if (job) {
+				g_signal_handlers_disconnect_by_func (job, thumbnail_job_completed_callback, sidebar_thumbnails);
+				ev_job_cancel (job);
+				g_object_unref (job);
+			}
+			ev_thumbnails_model_reset_page (priv->thumbnails_model, &iter);
+		}
+		gtk_tree_path_free (path);
+	}
+
+	/* Render the visible pages reset above */
+	priv->start_page = -1;
+	priv->end_page = -1;
+	adjustment_changed_cb (sidebar_thumbnails);
+}
+
 static void
 ev_sidebar_thumbnails_set_model (EvSidebarPage   *sidebar_page,
 				 EvDocumentModel *model)
@@ -1002,6 +1183,9 @@ ev_sidebar_thumbnails_set_model (EvSidebarPage   *sidebar_page,
 	g_signal_connect (model, "notify::document",
 			  G_CALLBACK (ev_sidebar_thumbnails_document_changed_cb),
 			  sidebar_page);
+	g_signal_connect (model, "page-sizes-changed",
+			  G_CALLBACK (ev_sidebar_thumbnails_page_sizes_changed_cb),
+			  sidebar_page);
 }
 
 static gboolean
@@ -1012,7 +1196,7 @@ ev_sidebar_thumbnails_clear_job (GtkTreeModel *model,
 {
 	EvJob *job;
 	
-	gtk_tree_model_get (model, iter, COLUMN_JOB, &job, -1);
+	gtk_tree_model_get (model, iter, EV_THUMBNAILS_MODEL_COLUMN_JOB, &job, -1);
 	
 	if (job != NULL) {
 		ev_job_cancel (job);
@@ -1028,8 +1212,8 @@ ev_sidebar_thumbnails_clear_model (EvSidebarThumbnails *sidebar_thumbnails)
 {
 	EvSidebarThumbnailsPrivate *priv = sidebar_thumbnails->priv;
 	
-	gtk_tree_model_foreach (GTK_TREE_MODEL (priv->list_store), ev_sidebar_thumbnails_clear_job, sidebar_thumbnails);
-	gtk_list_store_clear (priv->list_store);
+	gtk_tree_model_foreach (GTK_TREE_MODEL (priv->thumbnails_model), ev_sidebar_thumbnails_clear_job, sidebar_thumbnails);
+	ev_sidebar_thumbnails_set_model_document (sidebar_thumbnails, NULL);
 }
 
 static gboolean
@@ -1053,26 +1237,6 @@ ev_sidebar_thumbnails_page_iface_init (EvSidebarPageInterface *iface)
 	iface->get_label = ev_sidebar_thumbnails_get_label;
 }
 
-static gboolean
-iter_is_blank_thumbnail (GtkTreeModel *tree_model,
-			 GtkTreeIter  *iter)
-{
-	cairo_surface_t *surface = NULL;
-	EvJob *job = NULL;
-	gboolean thumbnail_set = FALSE;
-
-	gtk_tree_model_get (tree_model, iter,
-			    COLUMN_SURFACE, &surface,
-			    COLUMN_THUMBNAIL_SET, &thumbnail_set,
-			    COLUMN_JOB, &job, -1);
-
-	/* The blank thumbnail item can be distinguished among all
-	 * other items in the GtkIconView as it's the only one which
-	 * has the COLUMN_SURFACE as NULL while COLUMN_THUMBNAIL_SET
-	 * is set to TRUE. */
-	return surface == NULL && job == NULL && thumbnail_set;
-}
-
 /* Returns the total horizontal(left+right) width of thumbnail frames.
  * As it was added in ev_document_misc_render_thumbnail_frame() */
 static gint
@@ -1301,21 +1465,17 @@ check_toggle_blank_first_dual_mode_real (EvSidebarThumbnails *sidebar_thumbnails
 
 	if (should_be_enabled && !priv->blank_first_dual_mode) {
 		/* Do enable it */
-		tree_model = GTK_TREE_MODEL (priv->list_store);
+		tree_model = GTK_TREE_MODEL (priv->thumbnails_model);
 
 		if (!gtk_tree_model_get_iter_first (tree_model, &first))
 			return;
 
 		if (is_two_columns || is_one_column) {
 			priv->blank_first_dual_mode = TRUE;
-			if (iter_is_blank_thumbnail (tree_model, &first))
+			if (ev_thumbnails_model_get_blank_first (priv->thumbnails_model))
 				return; /* extra check */
 
-			gtk_list_store_insert_with_values (priv->list_store, &first, 0,
-							   COLUMN_SURFACE, NULL,
-							   COLUMN_THUMBNAIL_SET, TRUE,
-							   COLUMN_JOB, NULL,
-							   -1);
+			ev_thumbnails_model_set_blank_first (priv->thumbnails_model, TRUE);
 		}
 		if (resize_sidebar && is_one_column) {
 			sidebar = ev_sidebar_thumbnails_get_ev_sidebar (sidebar_thumbnails);
@@ -1326,16 +1486,16 @@ check_toggle_blank_first_dual_mode_real (EvSidebarThumbnails *sidebar_thumbnails
 		}
 	} else if (!should_be_enabled && priv->blank_first_dual_mode) {
 		/* Do disable it */
-		tree_model = GTK_TREE_MODEL (priv->list_store);
+		tree_model = GTK_TREE_MODEL (priv->thumbnails_model);
 
 		if (!gtk_tree_model_get_iter_first (tree_model, &first))
 			return;
 
 		priv->blank_first_dual_mode = FALSE;
-		if (!iter_is_blank_thumbnail (tree_model, &first))
+		if (!ev_thumbnails_model_get_blank_first (priv->thumbnails_model))
 			return; /* extra check */
 
-		gtk_list_store_remove (priv->list_store, &first);
+		ev_thumbnails_model_set_blank_first (priv->thumbnails_model, FALSE);
 
 		if (resize_sidebar && is_two_columns) {
 			sidebar = ev_sidebar_thumbnails_get_ev_sidebar (sidebar_thumbnails);
@@ -0,0 +1,617 @@
+/* ev-thumbnails-atlas.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "ev-thumbnails-atlas.h"
+
+#define EV_THUMBNAILS_ATLAS_VERSION 1
+#define EV_THUMBNAILS_ATLAS_FORMAT  "(usiiaay)"
+#define MAX_ATLAS_SIZE              67108864 /* 64MB */
+#define MAX_ATLAS_DIR_SIZE          268435456 /* 256MB */
+#define MAX_ATLAS_AGE               (90 * G_TIME_SPAN_DAY)
+#define SAVE_TIMEOUT                5 /* seconds */
+
+/* The thumbnails of a document rendered for a rotation and a device
+ * scale, saved to a file in the user cache dir along with the cache
+ * key of the document. The file has a PNG tile per page, empty for the
+ * pages that were not rendered, and is mapped when it is loaded, so
+ * that only the tiles of the pages that are shown are read. Tiles are
+ * decoded and encoded in threads.
+ */
+struct _EvThumbnailsAtlas {
+	gchar        *filename;
+	gchar        *key;
+	gint          n_pages;
+	gint          rotation;
+	gint          device_scale;
+
+	/* Tiles of the file, indexed by page */
+	GVariant     *tiles;
+	/* Tiles encoded since the file was loaded, GBytes by page */
+	GHashTable   *new_tiles;
+	/* Thumbnails added that are not encoded yet, by page */
+	GHashTable   *new_surfaces;
+	gsize         size;
+
+	gboolean      dirty;
+	guint         save_id;
+	/* Cancelled when the atlas is freed */
+	GCancellable *cancellable;
+};
+
+typedef struct {
+	gchar      *filename;
+	gchar      *key;
+	gint        rotation;
+	gint        device_scale;
+	gint        n_pages;
+	guint       serial;
+	GVariant   *tiles;
+	GHashTable *new_tiles;
+	GHashTable *new_surfaces;
+} EvThumbnailsAtlasSave;
+
+typedef struct {
+	gint      page;
+	GBytes   *bytes;
+	GVariant *tile;
+} EvThumbnailsAtlasLookup;
+
+typedef struct {
+	const guchar *data;
+	gsize         length;
+} EvPngReader;
+
+/* Saves are written in threads, the newest one of a file wins */
+static GMutex      write_mutex;
+static GHashTable *written_serials = NULL;
+static guint       save_serial = 0;
+
+static gchar *
+ev_thumbnails_atlas_get_dirname (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "evince", "thumbnails", NULL);
+}
+
+static void
+ev_thumbnails_atlas_load (EvThumbnailsAtlas *atlas)
+{
+	GMappedFile *mapped_file;
+	GBytes      *bytes;
+	GVariant    *variant;
+	GVariant    *tiles;
+	const gchar *key;
+	guint32      version;
+	gint32       rotation, device_scale;
+
+	mapped_file = g_mapped_file_new (atlas->filename, FALSE, NULL);
+	if (!mapped_file)
+		return;
+
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	g_mapped_file_unref (mapped_file);
+	variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (EV_THUMBNAILS_ATLAS_FORMAT),
+								bytes, FALSE));
+	g_bytes_unref (bytes);
+
+	g_variant_get (variant, "(u&sii@aay)", &version, &key, &rotation, &device_scale, &tiles);
+
+	/* The tiles keep the mapping alive */
+	if (version == EV_THUMBNAILS_ATLAS_VERSION &&
+	    strcmp (key, atlas->key) == 0 &&
+	    rotation == atlas->rotation &&
+	    device_scale == atlas->device_scale &&
+	    g_variant_n_children (tiles) == (gsize) atlas->n_pages) {
+		atlas->tiles = tiles;
+		atlas->size = g_variant_get_size (tiles);
+
+		/* The atlas was used, keep it longer when pruning the cache */
+		g_utime (atlas->filename, NULL);
+	} else {
+		g_variant_unref (tiles);
+	}
+
+	g_variant_unref (variant);
+}
+
+/**
+ * ev_thumbnails_atlas_new:
+ * @document: an #EvDocument
+ * @rotation: the rotation of the thumbnails
+ * @device_scale: the device scale of the thumbnails
+ *
+ * Returns: (nullable): the atlas of @document, with the tiles saved the
+ *   last time it was shown if it did not change since then, or %NULL if
+ *   @document has no cache key or is protected by a password
+ */
+EvThumbnailsAtlas *
+ev_thumbnails_atlas_new (EvDocument *document,
+			 gint        rotation,
+			 gint        device_scale)
+{
+	EvThumbnailsAtlas *atlas;
+	const gchar       *key;
+	gchar             *checksum;
+	gchar             *basename;
+	gchar             *dirname;
+
+	/* The pages of documents protected by a password are not saved */
+	if (EV_IS_DOCUMENT_SECURITY (document) &&
+	    ev_document_security_has_document_security (EV_DOCUMENT_SECURITY (document)))
+		return NULL;
+
+	key = ev_document_get_cache_key (document);
+	if (!key)
+		return NULL;
+
+	atlas = g_new0 (EvThumbnailsAtlas, 1);
+	atlas->key = g_strdup (key);
+	atlas->n_pages = ev_document_get_n_pages (document);
+	atlas->rotation = rotation;
+	atlas->device_scale = device_scale;
+	atlas->new_tiles = g_hash_table_new_full (NULL, NULL, NULL,
+						  (GDestroyNotify) g_bytes_unref);
+	atlas->new_surfaces = g_hash_table_new_full (NULL, NULL, NULL,
+						     (GDestroyNotify) cairo_surface_destroy);
+	atlas->cancellable = g_cancellable_new ();
+
+	checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, ev_document_get_uri (document), -1);
+	basename = g_strconcat (checksum, ".atlas", NULL);
+	dirname = ev_thumbnails_atlas_get_dirname ();
+	atlas->filename = g_build_filename (dirname, basename, NULL);
+	g_free (dirname);
+	g_free (basename);
+	g_free (checksum);
+
+	ev_thumbnails_atlas_load (atlas);
+
+	return atlas;
+}
+
+static cairo_status_t
+read_png (EvPngReader   *reader,
+	  unsigned char *data,
+	  unsigned int   length)
+{
+	if (length > reader->length)
+		return CAIRO_STATUS_READ_ERROR;
+
+	memcpy (data, reader->data, length);
+	reader->data += length;
+	reader->length -= length;
+
+	return CAIRO_STATUS_SUCCESS;
+}
+
+static cairo_status_t
+write_png (GByteArray          *array,
+	   const unsigned char *data,
+	   unsigned int         length)
+{
+	g_byte_array_append (array, data, length);
+
+	return CAIRO_STATUS_SUCCESS;
+}
+
+static GBytes *
+encode_tile (cairo_surface_t *surface)
+{
+	GByteArray *array;
+
+	array = g_byte_array_new ();
+	if (cairo_surface_write_to_png_stream (surface, (cairo_write_func_t) write_png,
+					       array) != CAIRO_STATUS_SUCCESS) {
+		g_byte_array_unref (array);
+		return NULL;
+	}
+
+	return g_byte_array_free_to_bytes (array);
+}
+
+static void
+ev_thumbnails_atlas_save_free (EvThumbnailsAtlasSave *save)
+{
+	g_free (save->filename);
+	g_free (save->key);
+	g_clear_pointer (&save->tiles, g_variant_unref);
+	g_hash_table_destroy (save->new_tiles);
+	g_hash_table_destroy (save->new_surfaces);
+	g_free (save);
+}
+
+/* Encodes the thumbnails of @save, that are added to its tiles, and
+ * writes them to the file. Returns the tiles encoded, by page.
+ */
+static GHashTable *
+ev_thumbnails_atlas_write (EvThumbnailsAtlasSave *save)
+{
+	GVariantBuilder builder;
+	GVariant       *variant;
+	GHashTable     *encoded;
+	GHashTableIter  iter;
+	gpointer        page, surface;
+	gchar          *dirname;
+	GError         *error = NULL;
+	gint            i;
+	static gsize    pruned = 0;
+
+	encoded = g_hash_table_new_full (NULL, NULL, NULL,
+					 (GDestroyNotify) g_bytes_unref);
+	g_hash_table_iter_init (&iter, save->new_surfaces);
+	while (g_hash_table_iter_next (&iter, &page, &surface)) {
+		GBytes *bytes = encode_tile (surface);
+
+		if (!bytes)
+			continue;
+
+		g_hash_table_insert (encoded, page, bytes);
+		g_hash_table_insert (save->new_tiles, page, g_bytes_ref (bytes));
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aay"));
+	for (i = 0; i < save->n_pages; i++) {
+		GBytes *bytes;
+
+		bytes = g_hash_table_lookup (save->new_tiles, GINT_TO_POINTER (i));
+		if (bytes) {
+			g_variant_builder_add_value (&builder,
+						     g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING,
+									       bytes, TRUE));
+		} else if (save->tiles) {
+			GVariant *tile = g_variant_get_child_value (save->tiles, i);
+
+			g_variant_builder_add_value (&builder, tile);
+			g_variant_unref (tile);
+		} else {
+			g_variant_builder_add_value (&builder,
+						     g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+										NULL, 0, sizeof (guint8)));
+		}
+	}
+
+	variant = g_variant_ref_sink (g_variant_new ("(usii@aay)",
+						     EV_THUMBNAILS_ATLAS_VERSION,
+						     save->key,
+						     save->rotation,
+						     save->device_scale,
+						     g_variant_builder_end (&builder)));
+
+	dirname = ev_thumbnails_atlas_get_dirname ();
+	g_mkdir_with_parents (dirname, 0700);
+
+	g_mutex_lock (&write_mutex);
+	if (!written_serials)
+		written_serials = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	/* An older save finishing last must not overwrite a newer one */
+	if (GPOINTER_TO_UINT (g_hash_table_lookup (written_serials, save->filename)) < save->serial) {
+		if (g_file_set_contents (save->filename,
+					 g_variant_get_data (variant),
+					 g_variant_get_size (variant),
+					 &error)) {
+			g_hash_table_insert (written_serials, g_strdup (save->filename),
+					     GUINT_TO_POINTER (save->serial));
+		} else {
+			g_warning ("Failed to save thumbnails: %s", error->message);
+			g_error_free (error);
+		}
+	}
+	g_mutex_unlock (&write_mutex);
+
+	g_variant_unref (variant);
+
+	/* Once per session is enough to keep the cache bounded */
+	if (g_once_init_enter (&pruned)) {
+		ev_file_prune_cache_dir (dirname, MAX_ATLAS_DIR_SIZE, MAX_ATLAS_AGE);
+		g_once_init_leave (&pruned, 1);
+	}
+	g_free (dirname);
+
+	return encoded;
+}
+
+static void
+write_atlas_thread (GTask                 *task,
+		    gpointer               source_object,
+		    EvThumbnailsAtlasSave *save,
+		    GCancellable          *cancellable)
+{
+	g_task_return_pointer (task, ev_thumbnails_atlas_write (save),
+			       (GDestroyNotify) g_hash_table_destroy);
+}
+
+static void
+atlas_saved_cb (GObject           *source_object,
+		GAsyncResult      *result,
+		EvThumbnailsAtlas *atlas)
+{
+	EvThumbnailsAtlasSave *save = g_task_get_task_data (G_TASK (result));
+	GHashTable            *encoded;
+	GHashTableIter         iter;
+	gpointer               page, bytes;
+
+	/* The atlas was freed */
+	encoded = g_task_propagate_pointer (G_TASK (result), NULL);
+	if (!encoded)
+		return;
+
+	/* The thumbnails are kept encoded, unless they were replaced */
+	g_hash_table_iter_init (&iter, encoded);
+	while (g_hash_table_iter_next (&iter, &page, &bytes)) {
+		if (g_hash_table_lookup (atlas->new_surfaces, page) !=
+		    g_hash_table_lookup (save->new_surfaces, page))
+			continue;
+
+		g_hash_table_remove (atlas->new_surfaces, page);
+		g_hash_table_insert (atlas->new_tiles, page, g_bytes_ref (bytes));
+		atlas->size += g_bytes_get_size (bytes);
+	}
+	g_hash_table_destroy (encoded);
+}
+
+/* Saves the atlas to its file in a thread. Thumbnails are encoded by
+ * the thread too, and kept encoded afterwards.
+ */
+static void
+ev_thumbnails_atlas_save (EvThumbnailsAtlas *atlas,
+			  gboolean           freeing)
+{
+	EvThumbnailsAtlasSave *save;
+	GHashTableIter         iter;
+	GTask                 *task;
+	gpointer               page, value;
+
+	if (!atlas->dirty)
+		return;
+
+	save = g_new0 (EvThumbnailsAtlasSave, 1);
+	save->filename = g_strdup (atlas->filename);
+	save->key = g_strdup (atlas->key);
+	save->rotation = atlas->rotation;
+	save->device_scale = atlas->device_scale;
+	save->n_pages = atlas->n_pages;
+	save->serial = ++save_serial;
+	save->tiles = atlas->tiles ? g_variant_ref (atlas->tiles) : NULL;
+	save->new_tiles = g_hash_table_new_full (NULL, NULL, NULL,
+						 (GDestroyNotify) g_bytes_unref);
+	g_hash_table_iter_init (&iter, atlas->new_tiles);
+	while (g_hash_table_iter_next (&iter, &page, &value))
+		g_hash_table_insert (save->new_tiles, page, g_bytes_ref (value));
+	save->new_surfaces = g_hash_table_new_full (NULL, NULL, NULL,
+						    (GDestroyNotify) cairo_surface_destroy);
+	g_hash_table_iter_init (&iter, atlas->new_surfaces);
+	while (g_hash_table_iter_next (&iter, &page, &value))
+		g_hash_table_insert (save->new_surfaces, page, cairo_surface_reference (value));
+
+	atlas->dirty = FALSE;
+
+	/* Nothing is returned to atlases being freed */
+	task = freeing ?
+		g_task_new (NULL, NULL, NULL, NULL) :
+		g_task_new (NULL, atlas->cancellable,
+			    (GAsyncReadyCallback) atlas_saved_cb, atlas);
+	g_task_set_task_data (task, save, (GDestroyNotify) ev_thumbnails_atlas_save_free);
+	g_task_run_in_thread (task, (GTaskThreadFunc) write_atlas_thread);
+	g_object_unref (task);
+}
+
+/**
+ * ev_thumbnails_atlas_free:
+ * @atlas: (nullable): an #EvThumbnailsAtlas
+ *
+ * Frees @atlas, its thumbnails not saved yet are saved in a thread.
+ */
+void
+ev_thumbnails_atlas_free (EvThumbnailsAtlas *atlas)
+{
+	if (!atlas)
+		return;
+
+	if (atlas->save_id > 0)
+		g_source_remove (atlas->save_id);
+	ev_thumbnails_atlas_save (atlas, TRUE);
+
+	g_cancellable_cancel (atlas->cancellable);
+	g_object_unref (atlas->cancellable);
+	g_free (atlas->filename);
+	g_free (atlas->key);
+	g_clear_pointer (&atlas->tiles, g_variant_unref);
+	g_hash_table_destroy (atlas->new_tiles);
+	g_hash_table_destroy (atlas->new_surfaces);
+	g_free (atlas);
+}
+
+/**
+ * ev_thumbnails_atlas_has_page:
+ * @atlas: an #EvThumbnailsAtlas
+ * @page: the index of the page
+ *
+ * Returns: whether @atlas has a thumbnail of @page, which is not decoded
+ */
+gboolean
+ev_thumbnails_atlas_has_page (EvThumbnailsAtlas *atlas,
+			      gint               page)
+{
+	GVariant *tile;
+	gboolean  has_page;
+
+	g_return_val_if_fail (page >= 0 && page < atlas->n_pages, FALSE);
+
+	if (g_hash_table_contains (atlas->new_surfaces, GINT_TO_POINTER (page)) ||
+	    g_hash_table_contains (atlas->new_tiles, GINT_TO_POINTER (page)))
+		return TRUE;
+
+	if (!atlas->tiles)
+		return FALSE;
+
+	tile = g_variant_get_child_value (atlas->tiles, page);
+	has_page = g_variant_get_size (tile) > 0;
+	g_variant_unref (tile);
+
+	return has_page;
+}
+
+static void
+ev_thumbnails_atlas_lookup_free (EvThumbnailsAtlasLookup *lookup)
+{
+	g_clear_pointer (&lookup->bytes, g_bytes_unref);
+	g_clear_pointer (&lookup->tile, g_variant_unref);
+	g_free (lookup);
+}
+
+static void
+decode_tile_thread (GTask                   *task,
+		    gpointer                 source_object,
+		    EvThumbnailsAtlasLookup *lookup,
+		    GCancellable            *cancellable)
+{
+	cairo_surface_t *surface;
+	EvPngReader      reader;
+
+	if (lookup->bytes)
+		reader.data = g_bytes_get_data (lookup->bytes, &reader.length);
+	else
+		reader.data = g_variant_get_fixed_array (lookup->tile, &reader.length, sizeof (guint8));
+
+	surface = cairo_image_surface_create_from_png_stream ((cairo_read_func_t) read_png, &reader);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy (surface);
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+					 "Invalid thumbnail of page %d", lookup->page);
+		return;
+	}
+
+	g_task_return_pointer (task, surface, (GDestroyNotify) cairo_surface_destroy);
+}
+
+/**
+ * ev_thumbnails_atlas_lookup_async:
+ * @atlas: an #EvThumbnailsAtlas
+ * @page: the index of the page
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: the function to call when the thumbnail is decoded
+ * @user_data: user data to pass to @callback
+ *
+ * Decodes the thumbnail of @page in a thread. @atlas can be freed
+ * before @callback is called.
+ */
+void
+ev_thumbnails_atlas_lookup_async (EvThumbnailsAtlas   *atlas,
+				  gint                 page,
+				  GCancellable        *cancellable,
+				  GAsyncReadyCallback  callback,
+				  gpointer             user_data)
+{
+	EvThumbnailsAtlasLookup *lookup;
+	cairo_surface_t         *surface;
+	GBytes                  *bytes;
+	GTask                   *task;
+
+	g_return_if_fail (page >= 0 && page < atlas->n_pages);
+
+	task = g_task_new (NULL, cancellable, callback, user_data);
+
+	lookup = g_new0 (EvThumbnailsAtlasLookup, 1);
+	lookup->page = page;
+	g_task_set_task_data (task, lookup, (GDestroyNotify) ev_thumbnails_atlas_lookup_free);
+
+	surface = g_hash_table_lookup (atlas->new_surfaces, GINT_TO_POINTER (page));
+	bytes = g_hash_table_lookup (atlas->new_tiles, GINT_TO_POINTER (page));
+	if (surface) {
+		g_task_return_pointer (task, cairo_surface_reference (surface),
+				       (GDestroyNotify) cairo_surface_destroy);
+	} else if (bytes || atlas->tiles) {
+		if (bytes)
+			lookup->bytes = g_bytes_ref (bytes);
+		else
+			lookup->tile = g_variant_get_child_value (atlas->tiles, page);
+		g_task_run_in_thread (task, (GTaskThreadFunc) decode_tile_thread);
+	} else {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+					 "No thumbnail of page %d", page);
+	}
+	g_object_unref (task);
+}
+
+/**
+ * ev_thumbnails_atlas_lookup_finish:
+ * @result: the #GAsyncResult passed to the callback
+ * @page: (out): return location for the index of the page
+ * @error: a #GError location to store an error, or %NULL
+ *
+ * Returns: (transfer full) (nullable): the thumbnail of @page, or %NULL
+ *   if it is not in the atlas or the lookup was cancelled
+ */
+cairo_surface_t *
+ev_thumbnails_atlas_lookup_finish (GAsyncResult  *result,
+				   gint          *page,
+				   GError       **error)
+{
+	EvThumbnailsAtlasLookup *lookup;
+
+	g_return_val_if_fail (G_IS_TASK (result), NULL);
+
+	lookup = g_task_get_task_data (G_TASK (result));
+	*page = lookup->page;
+
+	return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static gboolean
+save_timeout_cb (EvThumbnailsAtlas *atlas)
+{
+	atlas->save_id = 0;
+	ev_thumbnails_atlas_save (atlas, FALSE);
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * ev_thumbnails_atlas_add:
+ * @atlas: an #EvThumbnailsAtlas
+ * @page: the index of the page
+ * @surface: the thumbnail of @page, an image surface that is not modified
+ *   afterwards
+ *
+ * Adds the thumbnail of @page to @atlas. The atlas is encoded and saved
+ * in a thread a few seconds after the last thumbnail is added, and when
+ * it is freed.
+ */
+void
+ev_thumbnails_atlas_add (EvThumbnailsAtlas *atlas,
+			 gint               page,
+			 cairo_surface_t   *surface)
+{
+	g_return_if_fail (page >= 0 && page < atlas->n_pages);
+
+	if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE ||
+	    atlas->size > MAX_ATLAS_SIZE)
+		return;
+
+	g_hash_table_insert (atlas->new_surfaces, GINT_TO_POINTER (page),
+			     cairo_surface_reference (surface));
+	atlas->dirty = TRUE;
+
+	if (atlas->save_id > 0)
+		g_source_remove (atlas->save_id);
+	atlas->save_id = g_timeout_add_seconds (SAVE_TIMEOUT, (GSourceFunc) save_timeout_cb, atlas);
+}
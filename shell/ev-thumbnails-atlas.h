@@ -0,0 +1,46 @@
+/* ev-thumbnails-atlas.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <cairo.h>
+#include <evince-document.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EvThumbnailsAtlas EvThumbnailsAtlas;
+
+EvThumbnailsAtlas *ev_thumbnails_atlas_new           (EvDocument          *document,
+						      gint                 rotation,
+						      gint                 device_scale);
+void               ev_thumbnails_atlas_free          (EvThumbnailsAtlas   *atlas);
+gboolean           ev_thumbnails_atlas_has_page      (EvThumbnailsAtlas   *atlas,
+						      gint                 page);
+void               ev_thumbnails_atlas_lookup_async  (EvThumbnailsAtlas   *atlas,
+						      gint                 page,
+						      GCancellable        *cancellable,
+						      GAsyncReadyCallback  callback,
+						      gpointer             user_data);
+cairo_surface_t   *ev_thumbnails_atlas_lookup_finish (GAsyncResult        *result,
+						      gint                *page,
+						      GError             **error);
+void               ev_thumbnails_atlas_add           (EvThumbnailsAtlas   *atlas,
+						      gint                 page,
+						      cairo_surface_t     *surface);
+
+G_END_DECLS
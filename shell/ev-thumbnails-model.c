@@ -0,0 +1,756 @@
+/* ev-thumbnails-model.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <cairo-gobject.h>
+
+#include "ev-thumbnails-model.h"
+
+#define DEFAULT_MAX_SIZE 33554432 /* 32MB */
+
+/* The model has a row per page, plus a blank first row in dual mode,
+ * but nothing is stored for a page until a job or a thumbnail is set
+ * for it. The page string and the loading icon are built when asked.
+ *
+ * Iters hold the page plus one, so that they stay valid when the blank
+ * row is inserted or removed, and 0 for the blank row.
+ */
+#define ITER_PAGE(iter)       (GPOINTER_TO_INT ((iter)->user_data) - 1)
+#define ITER_SET_PAGE(iter,p) ((iter)->user_data = GINT_TO_POINTER ((p) + 1))
+
+typedef struct {
+	gint             page;
+	EvJob           *job;
+	cairo_surface_t *surface;
+	gsize            size;
+	GList           *link;
+} EvThumbnailsItem;
+
+typedef struct {
+	EvDocument *document;
+	gint        n_pages;
+	gboolean    blank_first;
+	gint        stamp;
+
+	/* Visible rows, their thumbnails are never dropped */
+	gint        start_row;
+	gint        end_row;
+
+	/* Pages with a job or a thumbnail */
+	GHashTable *items;
+
+	/* Pages with a thumbnail, the most recently set first. The
+	 * last ones are dropped when the size of the thumbnails goes
+	 * over max_size, and rendered again when they are visible. */
+	GQueue      lru;
+	gsize       size;
+	gsize       max_size;
+
+	EvThumbnailsModelLoadingIconFunc loading_icon_func;
+	gpointer                         loading_icon_data;
+} EvThumbnailsModelPrivate;
+
+static void ev_thumbnails_model_tree_model_init (GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (EvThumbnailsModel, ev_thumbnails_model, G_TYPE_OBJECT,
+			 G_ADD_PRIVATE (EvThumbnailsModel)
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						ev_thumbnails_model_tree_model_init))
+
+#define GET_PRIVATE(o) ev_thumbnails_model_get_instance_private (o)
+
+static void
+ev_thumbnails_item_free (EvThumbnailsItem *item)
+{
+	g_clear_object (&item->job);
+	g_clear_pointer (&item->surface, cairo_surface_destroy);
+	g_free (item);
+}
+
+static gint
+ev_thumbnails_model_get_n_rows (EvThumbnailsModel *model)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+
+	return priv->n_pages + (priv->blank_first ? 1 : 0);
+}
+
+static gint
+ev_thumbnails_model_page_to_row (EvThumbnailsModel *model,
+				 gint               page)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+
+	return page + (priv->blank_first ? 1 : 0);
+}
+
+static void
+ev_thumbnails_model_row_changed (EvThumbnailsModel *model,
+				 gint               page)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+	GtkTreePath              *path;
+	GtkTreeIter               iter;
+
+	iter.stamp = priv->stamp;
+	ITER_SET_PAGE (&iter, page);
+	path = gtk_tree_path_new_from_indices (ev_thumbnails_model_page_to_row (model, page), -1);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+static EvThumbnailsItem *
+ev_thumbnails_model_lookup_item (EvThumbnailsModel *model,
+				 gint               page,
+				 gboolean           create)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+	EvThumbnailsItem         *item;
+
+	item = g_hash_table_lookup (priv->items, GINT_TO_POINTER (page));
+	if (item || !create)
+		return item;
+
+	item = g_new0 (EvThumbnailsItem, 1);
+	item->page = page;
+	g_hash_table_insert (priv->items, GINT_TO_POINTER (page), item);
+
+	return item;
+}
+
+static void
+ev_thumbnails_model_drop_surface (EvThumbnailsModel *model,
+				  EvThumbnailsItem  *item)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+
+	if (!item->surface)
+		return;
+
+	g_queue_delete_link (&priv->lru, item->link);
+	item->link = NULL;
+	priv->size -= item->size;
+	item->size = 0;
+	g_clear_pointer (&item->surface, cairo_surface_destroy);
+}
+
+/* Removes the item when there is nothing left in it */
+static void
+ev_thumbnails_model_check_item (EvThumbnailsModel *model,
+				EvThumbnailsItem  *item)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+
+	if (!item->job && !item->surface)
+		g_hash_table_remove (priv->items, GINT_TO_POINTER (item->page));
+}
+
+static void
+ev_thumbnails_model_trim (EvThumbnailsModel *model)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+	GList                    *l = priv->lru.tail;
+
+	while (l && priv->size > priv->max_size) {
+		EvThumbnailsItem *item = l->data;
+		gint              page = item->page;
+		gint              row;
+
+		l = l->prev;
+
+		row = ev_thumbnails_model_page_to_row (model, page);
+		if (row >= priv->start_row && row <= priv->end_row)
+			continue;
+
+		ev_thumbnails_model_drop_surface (model, item);
+		ev_thumbnails_model_check_item (model, item);
+		ev_thumbnails_model_row_changed (model, page);
+	}
+}
+
+static gboolean
+ev_thumbnails_model_iter_is_valid (EvThumbnailsModel *model,
+				   GtkTreeIter       *iter)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+	gint                      page;
+
+	if (!iter || iter->stamp != priv->stamp)
+		return FALSE;
+
+	page = ITER_PAGE (iter);
+
+	return page < priv->n_pages && (page >= 0 || (page == -1 && priv->blank_first));
+}
+
+static void
+ev_thumbnails_model_set_iter (EvThumbnailsModel *model,
+			      GtkTreeIter       *iter,
+			      gint               row)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+
+	iter->stamp = priv->stamp;
+	ITER_SET_PAGE (iter, row - (priv->blank_first ? 1 : 0));
+	iter->user_data2 = NULL;
+	iter->user_data3 = NULL;
+}
+
+/* GtkTreeModel */
+static GtkTreeModelFlags
+ev_thumbnails_model_get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_ITERS_PERSIST | GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint
+ev_thumbnails_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return EV_THUMBNAILS_MODEL_N_COLUMNS;
+}
+
+static GType
+ev_thumbnails_model_get_column_type (GtkTreeModel *tree_model,
+				     gint          index)
+{
+	switch (index) {
+	case EV_THUMBNAILS_MODEL_COLUMN_PAGE_STRING:
+		return G_TYPE_STRING;
+	case EV_THUMBNAILS_MODEL_COLUMN_SURFACE:
+		return CAIRO_GOBJECT_TYPE_SURFACE;
+	case EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET:
+		return G_TYPE_BOOLEAN;
+	case EV_THUMBNAILS_MODEL_COLUMN_JOB:
+		return EV_TYPE_JOB_THUMBNAIL;
+	default:
+		g_assert_not_reached ();
+	}
+
+	return G_TYPE_INVALID;
+}
+
+static gboolean
+ev_thumbnails_model_get_iter (GtkTreeModel *tree_model,
+			      GtkTreeIter  *iter,
+			      GtkTreePath  *path)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+	gint               row;
+
+	if (gtk_tree_path_get_depth (path) != 1)
+		return FALSE;
+
+	row = gtk_tree_path_get_indices (path)[0];
+	if (row < 0 || row >= ev_thumbnails_model_get_n_rows (model))
+		return FALSE;
+
+	ev_thumbnails_model_set_iter (model, iter, row);
+
+	return TRUE;
+}
+
+static GtkTreePath *
+ev_thumbnails_model_get_path (GtkTreeModel *tree_model,
+			      GtkTreeIter  *iter)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+
+	g_return_val_if_fail (ev_thumbnails_model_iter_is_valid (model, iter), NULL);
+
+	return gtk_tree_path_new_from_indices (ev_thumbnails_model_page_to_row (model, ITER_PAGE (iter)), -1);
+}
+
+static void
+ev_thumbnails_model_get_value (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter,
+			       gint          column,
+			       GValue       *value)
+{
+	EvThumbnailsModel        *model = EV_THUMBNAILS_MODEL (tree_model);
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+	EvThumbnailsItem         *item;
+	gint                      page;
+
+	g_return_if_fail (ev_thumbnails_model_iter_is_valid (model, iter));
+
+	g_value_init (value, ev_thumbnails_model_get_column_type (tree_model, column));
+
+	/* The blank row has no page string, no surface and no job,
+	 * but its thumbnail is set */
+	page = ITER_PAGE (iter);
+	if (page < 0) {
+		if (column == EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET)
+			g_value_set_boolean (value, TRUE);
+		return;
+	}
+
+	item = ev_thumbnails_model_lookup_item (model, page, FALSE);
+
+	switch (column) {
+	case EV_THUMBNAILS_MODEL_COLUMN_PAGE_STRING: {
+		gchar *page_label;
+
+		page_label = ev_document_get_page_label (priv->document, page);
+		g_value_take_string (value, g_markup_printf_escaped ("<i>%s</i>", page_label));
+		g_free (page_label);
+	}
+		break;
+	case EV_THUMBNAILS_MODEL_COLUMN_SURFACE:
+		if (item && item->surface)
+			g_value_set_boxed (value, item->surface);
+		else if (priv->loading_icon_func)
+			g_value_set_boxed (value, priv->loading_icon_func (model, page,
+									  priv->loading_icon_data));
+		break;
+	case EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET:
+		g_value_set_boolean (value, item && item->surface);
+		break;
+	case EV_THUMBNAILS_MODEL_COLUMN_JOB:
+		g_value_set_object (value, item ? item->job : NULL);
+		break;
+	}
+}
+
+static gboolean
+ev_thumbnails_model_iter_next (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter)
+{
+	EvThumbnailsModel        *model = EV_THUMBNAILS_MODEL (tree_model);
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+	gint                      page;
+
+	g_return_val_if_fail (ev_thumbnails_model_iter_is_valid (model, iter), FALSE);
+
+	page = ITER_PAGE (iter) + 1;
+	if (page >= priv->n_pages) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	ITER_SET_PAGE (iter, page);
+
+	return TRUE;
+}
+
+static gboolean
+ev_thumbnails_model_iter_previous (GtkTreeModel *tree_model,
+				   GtkTreeIter  *iter)
+{
+	EvThumbnailsModel        *model = EV_THUMBNAILS_MODEL (tree_model);
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+	gint                      page;
+
+	g_return_val_if_fail (ev_thumbnails_model_iter_is_valid (model, iter), FALSE);
+
+	page = ITER_PAGE (iter) - 1;
+	if (page < (priv->blank_first ? -1 : 0)) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	ITER_SET_PAGE (iter, page);
+
+	return TRUE;
+}
+
+static gboolean
+ev_thumbnails_model_iter_nth_child (GtkTreeModel *tree_model,
+				    GtkTreeIter  *iter,
+				    GtkTreeIter  *parent,
+				    gint          n)
+{
+	EvThumbnailsModel *model = EV_THUMBNAILS_MODEL (tree_model);
+
+	if (parent || n < 0 || n >= ev_thumbnails_model_get_n_rows (model)) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	ev_thumbnails_model_set_iter (model, iter, n);
+
+	return TRUE;
+}
+
+static gboolean
+ev_thumbnails_model_iter_children (GtkTreeModel *tree_model,
+				   GtkTreeIter  *iter,
+				   GtkTreeIter  *parent)
+{
+	return ev_thumbnails_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gboolean
+ev_thumbnails_model_iter_has_child (GtkTreeModel *tree_model,
+				    GtkTreeIter  *iter)
+{
+	return FALSE;
+}
+
+static gint
+ev_thumbnails_model_iter_n_children (GtkTreeModel *tree_model,
+				     GtkTreeIter  *iter)
+{
+	if (iter)
+		return 0;
+
+	return ev_thumbnails_model_get_n_rows (EV_THUMBNAILS_MODEL (tree_model));
+}
+
+static gboolean
+ev_thumbnails_model_iter_parent (GtkTreeModel *tree_model,
+				 GtkTreeIter  *iter,
+				 GtkTreeIter  *child)
+{
+	iter->stamp = 0;
+
+	return FALSE;
+}
+
+static void
+ev_thumbnails_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = ev_thumbnails_model_get_flags;
+	iface->get_n_columns = ev_thumbnails_model_get_n_columns;
+	iface->get_column_type = ev_thumbnails_model_get_column_type;
+	iface->get_iter = ev_thumbnails_model_get_iter;
+	iface->get_path = ev_thumbnails_model_get_path;
+	iface->get_value = ev_thumbnails_model_get_value;
+	iface->iter_next = ev_thumbnails_model_iter_next;
+	iface->iter_previous = ev_thumbnails_model_iter_previous;
+	iface->iter_children = ev_thumbnails_model_iter_children;
+	iface->iter_has_child = ev_thumbnails_model_iter_has_child;
+	iface->iter_n_children = ev_thumbnails_model_iter_n_children;
+	iface->iter_nth_child = ev_thumbnails_model_iter_nth_child;
+	iface->iter_parent = ev_thumbnails_model_iter_parent;
+}
+
+static void
+ev_thumbnails_model_finalize (GObject *object)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (EV_THUMBNAILS_MODEL (object));
+
+	g_queue_clear (&priv->lru);
+	g_hash_table_destroy (priv->items);
+	g_clear_object (&priv->document);
+
+	G_OBJECT_CLASS (ev_thumbnails_model_parent_class)->finalize (object);
+}
+
+static void
+ev_thumbnails_model_init (EvThumbnailsModel *model)
+{
+	EvThumbnailsModelPrivate *priv = GET_PRIVATE (model);
+
+	priv->stamp = g_random_int ();
+	priv->start_row = -1;
+	priv->end_row = -1;
+	priv->max_size = DEFAULT_MAX_SIZE;
+	priv->items = g_hash_table_new_full (NULL, NULL, NULL,
+					     (GDestroyNotify) ev_thumbnails_item_free);
+}
+
+static void
+ev_thumbnails_model_class_init (EvThumbnailsModelClass *klass)
+{
+	GObjectClass *g_object_class = G_OBJECT_CLASS (klass);
+
+	g_object_class->finalize = ev_thumbnails_model_finalize;
+}
+
+EvThumbnailsModel *
+ev_thumbnails_model_new (void)
+{
+	return g_object_new (EV_TYPE_THUMBNAILS_MODEL, NULL);
+}
+
+/**
+ * ev_thumbnails_model_set_document:
+ * @model: an #EvThumbnailsModel
+ * @document: (nullable): an #EvDocument
+ *
+ * Removes all the rows of @model, with their jobs and thumbnails,
+ * and adds a row for every page of @document. The jobs must have
+ * been cancelled by the caller. A row is signalled for every page,
+ * so views should be detached from @model meanwhile for documents
+ * with many pages.
+ */
+void
+ev_thumbnails_model_set_document (EvThumbnailsModel *model,
+				  EvDocument        *document)
+{
+	EvThumbnailsModelPrivate *priv;
+	GtkTreeModel             *tree_model;
+	GtkTreePath              *path;
+	GtkTreeIter               iter;
+	gint                      n_pages, i;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+	g_return_if_fail (document == NULL || EV_IS_DOCUMENT (document));
+
+	priv = GET_PRIVATE (model);
+	tree_model = GTK_TREE_MODEL (model);
+
+	ev_thumbnails_model_set_blank_first (model, FALSE);
+	for (i = priv->n_pages - 1; i >= 0; i--) {
+		priv->n_pages = i;
+		path = gtk_tree_path_new_from_indices (i, -1);
+		gtk_tree_model_row_deleted (tree_model, path);
+		gtk_tree_path_free (path);
+	}
+
+	g_queue_clear (&priv->lru);
+	g_hash_table_remove_all (priv->items);
+	priv->size = 0;
+	priv->start_row = -1;
+	priv->end_row = -1;
+	priv->stamp++;
+
+	g_set_object (&priv->document, document);
+	if (!document)
+		return;
+
+	n_pages = ev_document_get_n_pages (document);
+	for (i = 0; i < n_pages; i++) {
+		priv->n_pages = i + 1;
+		ev_thumbnails_model_set_iter (model, &iter, i);
+		path = gtk_tree_path_new_from_indices (i, -1);
+		gtk_tree_model_row_inserted (tree_model, path, &iter);
+		gtk_tree_path_free (path);
+	}
+}
+
+void
+ev_thumbnails_model_set_loading_icon_func (EvThumbnailsModel               *model,
+					   EvThumbnailsModelLoadingIconFunc func,
+					   gpointer                         user_data)
+{
+	EvThumbnailsModelPrivate *priv;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+
+	priv = GET_PRIVATE (model);
+	priv->loading_icon_func = func;
+	priv->loading_icon_data = user_data;
+}
+
+/**
+ * ev_thumbnails_model_set_blank_first:
+ * @model: an #EvThumbnailsModel
+ * @blank_first: whether to show a blank row before the first page
+ *
+ * Inserts or removes the blank first row used in dual mode. Iters of
+ * the pages stay valid.
+ */
+void
+ev_thumbnails_model_set_blank_first (EvThumbnailsModel *model,
+				     gboolean           blank_first)
+{
+	EvThumbnailsModelPrivate *priv;
+	GtkTreePath              *path;
+	GtkTreeIter               iter;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+
+	priv = GET_PRIVATE (model);
+
+	blank_first = blank_first != FALSE;
+	if (priv->blank_first == blank_first)
+		return;
+
+	priv->blank_first = blank_first;
+
+	path = gtk_tree_path_new_first ();
+	if (blank_first) {
+		ev_thumbnails_model_set_iter (model, &iter, 0);
+		gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, &iter);
+	} else {
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+	}
+	gtk_tree_path_free (path);
+}
+
+gboolean
+ev_thumbnails_model_get_blank_first (EvThumbnailsModel *model)
+{
+	g_return_val_if_fail (EV_IS_THUMBNAILS_MODEL (model), FALSE);
+
+	return GET_PRIVATE (model)->blank_first;
+}
+
+/**
+ * ev_thumbnails_model_set_visible_range:
+ * @model: an #EvThumbnailsModel
+ * @start_row: the first visible row
+ * @end_row: the last visible row
+ *
+ * Sets the rows whose thumbnails are kept when the thumbnails
+ * go over the size limit.
+ */
+void
+ev_thumbnails_model_set_visible_range (EvThumbnailsModel *model,
+				       gint               start_row,
+				       gint               end_row)
+{
+	EvThumbnailsModelPrivate *priv;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+
+	priv = GET_PRIVATE (model);
+	priv->start_row = start_row;
+	priv->end_row = end_row;
+
+	ev_thumbnails_model_trim (model);
+}
+
+/**
+ * ev_thumbnails_model_set_job:
+ * @model: an #EvThumbnailsModel
+ * @iter: a valid #GtkTreeIter of a page
+ * @job: (nullable): the #EvJobThumbnail rendering the page
+ */
+void
+ev_thumbnails_model_set_job (EvThumbnailsModel *model,
+			     GtkTreeIter       *iter,
+			     EvJob             *job)
+{
+	EvThumbnailsItem *item;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+	g_return_if_fail (ev_thumbnails_model_iter_is_valid (model, iter));
+	g_return_if_fail (job == NULL || EV_IS_JOB_THUMBNAIL (job));
+	g_return_if_fail (ITER_PAGE (iter) >= 0);
+
+	item = ev_thumbnails_model_lookup_item (model, ITER_PAGE (iter), job != NULL);
+	if (!item)
+		return;
+
+	g_set_object (&item->job, job);
+	ev_thumbnails_model_check_item (model, item);
+	ev_thumbnails_model_row_changed (model, ITER_PAGE (iter));
+}
+
+/**
+ * ev_thumbnails_model_set_thumbnail:
+ * @model: an #EvThumbnailsModel
+ * @iter: a valid #GtkTreeIter of a page
+ * @surface: the thumbnail of the page
+ *
+ * Sets the thumbnail of the page and removes its job. The least
+ * recently set thumbnails out of the visible range are removed
+ * when the thumbnails go over the size limit.
+ */
+void
+ev_thumbnails_model_set_thumbnail (EvThumbnailsModel *model,
+				   GtkTreeIter       *iter,
+				   cairo_surface_t   *surface)
+{
+	EvThumbnailsModelPrivate *priv;
+	EvThumbnailsItem         *item;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+	g_return_if_fail (ev_thumbnails_model_iter_is_valid (model, iter));
+	g_return_if_fail (surface != NULL);
+	g_return_if_fail (ITER_PAGE (iter) >= 0);
+
+	priv = GET_PRIVATE (model);
+
+	item = ev_thumbnails_model_lookup_item (model, ITER_PAGE (iter), TRUE);
+	g_clear_object (&item->job);
+
+	cairo_surface_reference (surface);
+	ev_thumbnails_model_drop_surface (model, item);
+	item->surface = surface;
+	if (cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE)
+		item->size = cairo_image_surface_get_stride (surface) *
+			cairo_image_surface_get_height (surface);
+	g_queue_push_head (&priv->lru, item);
+	item->link = priv->lru.head;
+	priv->size += item->size;
+
+	ev_thumbnails_model_row_changed (model, item->page);
+	ev_thumbnails_model_trim (model);
+}
+
+/**
+ * ev_thumbnails_model_reset_page:
+ * @model: an #EvThumbnailsModel
+ * @iter: a valid #GtkTreeIter of a page
+ *
+ * Removes the job and the thumbnail of the page, which shows its
+ * loading icon again until a new thumbnail is set.
+ */
+void
+ev_thumbnails_model_reset_page (EvThumbnailsModel *model,
+				GtkTreeIter       *iter)
+{
+	EvThumbnailsItem *item;
+
+	g_return_if_fail (EV_IS_THUMBNAILS_MODEL (model));
+	g_return_if_fail (ev_thumbnails_model_iter_is_valid (model, iter));
+	g_return_if_fail (ITER_PAGE (iter) >= 0);
+
+	item = ev_thumbnails_model_lookup_item (model, ITER_PAGE (iter), FALSE);
+	if (item) {
+		g_clear_object (&item->job);
+		ev_thumbnails_model_drop_surface (model, item);
+		ev_thumbnails_model_check_item (model, item);
+	}
+
+	ev_thumbnails_model_row_changed (model, ITER_PAGE (iter));
+}
+
+gint
+ev_thumbnails_model_get_page (EvThumbnailsModel *model,
+			      GtkTreeIter       *iter)
+{
+	g_return_val_if_fail (EV_IS_THUMBNAILS_MODEL (model), -1);
+	g_return_val_if_fail (ev_thumbnails_model_iter_is_valid (model, iter), -1);
+
+	return ITER_PAGE (iter);
+}
+
+/**
+ * ev_thumbnails_model_get_thumbnails:
+ * @model: an #EvThumbnailsModel
+ *
+ * Returns: (transfer full): an array with the thumbnail of every page
+ *   of @model, or %NULL for the pages without thumbnail
+ */
+GPtrArray *
+ev_thumbnails_model_get_thumbnails (EvThumbnailsModel *model)
+{
+	EvThumbnailsModelPrivate *priv;
+	GPtrArray                *thumbnails;
+	GList                    *l;
+
+	g_return_val_if_fail (EV_IS_THUMBNAILS_MODEL (model), NULL);
+
+	priv = GET_PRIVATE (model);
+
+	thumbnails = g_ptr_array_new_full (priv->n_pages, (GDestroyNotify) cairo_surface_destroy);
+	g_ptr_array_set_size (thumbnails, priv->n_pages);
+
+	for (l = priv->lru.head; l; l = l->next) {
+		EvThumbnailsItem *item = l->data;
+
+		g_ptr_array_index (thumbnails, item->page) = cairo_surface_reference (item->surface);
+	}
+
+	return thumbnails;
+}
@@ -0,0 +1,85 @@
+/* ev-thumbnails-model.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+#include <gtk/gtk.h>
+#include <cairo.h>
+#include <evince-document.h>
+#include <evince-view.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EvThumbnailsModel        EvThumbnailsModel;
+typedef struct _EvThumbnailsModelClass   EvThumbnailsModelClass;
+
+#define EV_TYPE_THUMBNAILS_MODEL              (ev_thumbnails_model_get_type())
+#define EV_THUMBNAILS_MODEL(object)           (G_TYPE_CHECK_INSTANCE_CAST((object), EV_TYPE_THUMBNAILS_MODEL, EvThumbnailsModel))
+#define EV_THUMBNAILS_MODEL_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST((klass), EV_TYPE_THUMBNAILS_MODEL, EvThumbnailsModelClass))
+#define EV_IS_THUMBNAILS_MODEL(object)        (G_TYPE_CHECK_INSTANCE_TYPE((object), EV_TYPE_THUMBNAILS_MODEL))
+#define EV_IS_THUMBNAILS_MODEL_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE((klass), EV_TYPE_THUMBNAILS_MODEL))
+#define EV_THUMBNAILS_MODEL_GET_CLASS(object) (G_TYPE_INSTANCE_GET_CLASS((object), EV_TYPE_THUMBNAILS_MODEL, EvThumbnailsModelClass))
+
+enum {
+	EV_THUMBNAILS_MODEL_COLUMN_PAGE_STRING,
+	EV_THUMBNAILS_MODEL_COLUMN_SURFACE,
+	EV_THUMBNAILS_MODEL_COLUMN_THUMBNAIL_SET,
+	EV_THUMBNAILS_MODEL_COLUMN_JOB,
+	EV_THUMBNAILS_MODEL_N_COLUMNS
+};
+
+/* Returns the surface shown for @page until its thumbnail is set,
+ * owned by the caller of ev_thumbnails_model_set_loading_icon_func() */
+typedef cairo_surface_t *(* EvThumbnailsModelLoadingIconFunc) (EvThumbnailsModel *model,
+							      gint               page,
+							      gpointer           user_data);
+
+struct _EvThumbnailsModel {
+	GObject base_instance;
+};
+
+struct _EvThumbnailsModelClass {
+	GObjectClass base_class;
+};
+
+GType              ev_thumbnails_model_get_type              (void) G_GNUC_CONST;
+EvThumbnailsModel *ev_thumbnails_model_new                   (void);
+void               ev_thumbnails_model_set_document          (EvThumbnailsModel               *model,
+							      EvDocument                      *document);
+void               ev_thumbnails_model_set_loading_icon_func (EvThumbnailsModel               *model,
+							      EvThumbnailsModelLoadingIconFunc func,
+							      gpointer                         user_data);
+void               ev_thumbnails_model_set_blank_first       (EvThumbnailsModel               *model,
+							      gboolean                         blank_first);
+gboolean           ev_thumbnails_model_get_blank_first       (EvThumbnailsModel               *model);
+void               ev_thumbnails_model_set_visible_range     (EvThumbnailsModel               *model,
+							      gint                             start_row,
+							      gint                             end_row);
+void               ev_thumbnails_model_set_job               (EvThumbnailsModel               *model,
+							      GtkTreeIter                     *iter,
+							      EvJob                           *job);
+void               ev_thumbnails_model_set_thumbnail         (EvThumbnailsModel               *model,
+							      GtkTreeIter                     *iter,
+							      cairo_surface_t                 *surface);
+void               ev_thumbnails_model_reset_page            (EvThumbnailsModel               *model,
+							      GtkTreeIter                     *iter);
+gint               ev_thumbnails_model_get_page              (EvThumbnailsModel               *model,
+							      GtkTreeIter                     *iter);
+GPtrArray         *ev_thumbnails_model_get_thumbnails        (EvThumbnailsModel               *model);
+
+G_END_DECLS
@@ -53,6 +53,7 @@
 #include "ev-document-links.h"
 #include "ev-document-annotations.h"
 #include "ev-document-misc.h"
+#include "ev-document-text.h"
 #include "ev-file-exporter.h"
 #include "ev-file-helpers.h"
 #include "ev-file-monitor.h"
@@ -218,6 +219,7 @@ typedef struct {
 	EvJob            *load_job;
 	EvJob            *reload_job;
 	EvJob            *save_job;
+	EvJob            *index_job;
 	gboolean          close_after_save;
 
 	/* Printing */
@@ -260,6 +262,8 @@ typedef struct {
 #define GS_SCHEMA_NAME           "org.gnome.Evince"
 #define GS_OVERRIDE_RESTRICTIONS "override-restrictions"
 #define GS_PAGE_CACHE_SIZE       "page-cache-size"
+#define GS_JOB_THREADS           "job-threads"
+#define GS_INDEX_DOCUMENTS       "index-documents"
 #define GS_AUTO_RELOAD           "auto-reload"
 #define GS_LAST_DOCUMENT_DIRECTORY "document-directory"
 #define GS_LAST_PICTURES_DIRECTORY "pictures-directory"
@@ -1570,6 +1574,14 @@ page_cache_size_changed (GSettings *settings,
 				     (gsize) page_cache_mb * 1024 * 1024);
 }
 
+static void
+job_threads_changed (GSettings *settings,
+		     gchar     *key,
+		     EvWindow  *ev_window)
+{
+	ev_job_scheduler_set_n_threads (g_settings_get_uint (settings, GS_JOB_THREADS));
+}
+
 static void
 allow_links_change_zoom_changed (GSettings *settings,
 			 gchar     *key,
@@ -1657,6 +1669,10 @@ ev_window_ensure_settings (EvWindow *ev_window)
 			  "changed::"GS_PAGE_CACHE_SIZE,
 			  G_CALLBACK (page_cache_size_changed),
 			  ev_window);
+        g_signal_connect (priv->settings,
+			  "changed::"GS_JOB_THREADS,
+			  G_CALLBACK (job_threads_changed),
+			  ev_window);
         g_signal_connect (priv->settings,
 			  "changed::"GS_ALLOW_LINKS_CHANGE_ZOOM,
 			  G_CALLBACK (allow_links_change_zoom_changed),
@@ -1665,6 +1681,38 @@ ev_window_ensure_settings (EvWindow *ev_window)
         return priv->settings;
 }
 
+static void
+ev_window_clear_index_job (EvWindow *ev_window)
+{
+	EvWindowPrivate *priv = GET_PRIVATE (ev_window);
+
+	if (priv->index_job != NULL) {
+		if (!ev_job_is_finished (priv->index_job))
+			ev_job_cancel (priv->index_job);
+
+		g_clear_object (&priv->index_job);
+	}
+}
+
+static void
+ev_window_index_document (EvWindow *ev_window)
+{
+	EvWindowPrivate *priv = GET_PRIVATE (ev_window);
+
+	ev_window_clear_index_job (ev_window);
+
+	if (!EV_IS_DOCUMENT_FIND (priv->document) ||
+	    !EV_IS_DOCUMENT_TEXT (priv->document))
+		return;
+
+	if (!g_settings_get_boolean (ev_window_ensure_settings (ev_window),
+				     GS_INDEX_DOCUMENTS))
+		return;
+
+	priv->index_job = ev_job_index_new (priv->document);
+	ev_job_scheduler_push_job (priv->index_job, EV_JOB_PRIORITY_NONE);
+}
+
 static gboolean
 ev_window_setup_document (EvWindow *ev_window)
 {
@@ -1713,6 +1761,8 @@ ev_window_setup_document (EvWindow *ev_window)
 
 	g_clear_pointer (&priv->search_string, g_free);
 
+	ev_window_index_document (ev_window);
+
 	if (EV_WINDOW_IS_PRESENTATION (priv))
 		gtk_widget_grab_focus (priv->presentation_view);
 	else if (!gtk_search_bar_get_search_mode (GTK_SEARCH_BAR (priv->search_bar)))
@@ -2475,6 +2525,8 @@ ev_window_open_uri (EvWindow       *ev_window,
 	setup_model_from_metadata (ev_window);
 
 	priv->load_job = ev_job_load_new (priv->uri);
+	ev_job_load_set_load_flags (EV_JOB_LOAD (priv->load_job),
+				    EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE);
 	g_signal_connect (priv->load_job,
 			  "finished",
 			  G_CALLBACK (ev_window_load_job_cb),
@@ -2608,6 +2660,8 @@ ev_window_reload_local (EvWindow *ev_window)
 
 	uri = priv->local_uri ? priv->local_uri : priv->uri;
 	priv->reload_job = ev_job_load_new (uri);
+	ev_job_load_set_load_flags (EV_JOB_LOAD (priv->reload_job),
+				    EV_DOCUMENT_LOAD_FLAG_LAZY_CACHE);
 	g_signal_connect (priv->reload_job, "finished",
 			  G_CALLBACK (ev_window_reload_job_cb),
 			  ev_window);
@@ -6168,6 +6222,8 @@ ev_window_dispose (GObject *object)
 		ev_window_clear_save_job (window);
 	}
 
+	ev_window_clear_index_job (window);
+
 	if (priv->local_uri) {
 		ev_window_clear_local_uri (window);
 		priv->local_uri = NULL;
@@ -6966,10 +7022,10 @@ image_save_dialog_response_cb (GtkFileChooserNative *fc,
                         goto has_error;
 	}
 
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (priv->document);
 	pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (priv->document),
 					       priv->image);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (priv->document);
 
 	file_format = gdk_pixbuf_format_get_name (format);
 	gdk_pixbuf_save (pixbuf, filename, file_format, &error, NULL);
@@ -7052,10 +7108,10 @@ ev_window_popup_cmd_copy_image (GSimpleAction *action,
 
 	clipboard = gtk_widget_get_clipboard (GTK_WIDGET (window),
 					      GDK_SELECTION_CLIPBOARD);
-	ev_document_doc_mutex_lock ();
+	ev_document_lock (priv->document);
 	pixbuf = ev_document_images_get_image (EV_DOCUMENT_IMAGES (priv->document),
 					       priv->image);
-	ev_document_doc_mutex_unlock ();
+	ev_document_unlock (priv->document);
 
 	gtk_clipboard_set_image (clipboard, pixbuf);
 	g_object_unref (pixbuf);
@@ -7121,11 +7177,11 @@ ev_window_popup_cmd_annot_properties (GSimpleAction *action,
 	}
 
 	if (mask != EV_ANNOTATIONS_SAVE_NONE) {
-		ev_document_doc_mutex_lock ();
+		ev_document_lock (priv->document);
 		ev_document_annotations_save_annotation (EV_DOCUMENT_ANNOTATIONS (priv->document),
 							 priv->annot,
 							 mask);
-		ev_document_doc_mutex_unlock ();
+		ev_document_unlock (priv->document);
 
 		/* FIXME: update annot region only */
 		ev_view_reload (EV_VIEW (priv->view));
@@ -7699,6 +7755,8 @@ ev_window_init (EvWindow *ev_window)
 					     GS_PAGE_CACHE_SIZE);
 	ev_view_set_page_cache_size (EV_VIEW (priv->view),
 				     (gsize) page_cache_mb * 1024 * 1024);
+	ev_job_scheduler_set_n_threads (g_settings_get_uint (ev_window_ensure_settings (ev_window),
+							     GS_JOB_THREADS));
 	allow_links_change_zoom = g_settings_get_boolean (ev_window_ensure_settings (ev_window),
 				     GS_ALLOW_LINKS_CHANGE_ZOOM);
 	ev_view_set_allow_links_change_zoom (EV_VIEW (priv->view),
@@ -21,11 +21,18 @@
 #include <evince-document.h>
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
+#include <errno.h>
 #include <locale.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#ifndef G_OS_WIN32
+#include <unistd.h>
+#endif
+
 #ifdef G_OS_WIN32
 #include <io.h>
 #include <conio.h>
@@ -42,11 +49,15 @@ static gboolean finished = TRUE;
 
 static gint size = THUMBNAIL_SIZE;
 static gboolean time_limit = TRUE;
+static const gchar *batch_file;
+static gint n_jobs = 0;
 static const gchar **file_arguments;
 
 static const GOptionEntry goption_options[] = {
 	{ "size", 's', 0, G_OPTION_ARG_INT, &size, NULL, "SIZE" },
         { "no-limit", 'l', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &time_limit, "Don't limit the thumbnailing time to 15 seconds", NULL },
+	{ "batch", 'b', 0, G_OPTION_ARG_FILENAME, &batch_file, "Read lines of tab separated <input> <output> [size] from FILE, or from the standard input if FILE is -, and thumbnail them in one process", "FILE" },
+	{ "jobs", 'j', 0, G_OPTION_ARG_INT, &n_jobs, "Number of files thumbnailed in parallel in batch mode, the number of processors by default", "N" },
 	{ G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &file_arguments, NULL, "<input> <ouput>" },
 	{ NULL }
 };
@@ -58,6 +69,29 @@ struct AsyncData {
 	gboolean     success;
 };
 
+struct BatchRequest {
+	gchar   *input;
+	gchar   *output;
+	gint     size;
+	/* Protected by the mutex of the batch */
+	gint64   started;
+	gboolean timed_out;
+};
+
+struct BatchData {
+	gint         n_files;
+	gint         n_failed;
+
+	GMutex       mutex;
+	GCond        cond;
+	GThreadPool *pool;
+	/* Requests pushed that did not finish nor time out */
+	gint         n_pending;
+	gint         n_timed_out;
+	GList       *running;
+	gboolean     done;
+};
+
 /* Time monitor: copied from totem */
 G_GNUC_NORETURN static gpointer
 time_monitor (gpointer data)
@@ -139,6 +173,19 @@ evince_thumbnailer_get_document (GFile *file)
 	if (!path) {
 		gchar *base_name, *template;
 
+		/* Backends that read from a GFile don't need a local copy */
+		document = ev_document_factory_get_document_for_gfile (file,
+								       EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE,
+								       NULL, &error);
+		if (document)
+			return document;
+		if (g_error_matches (error, EV_DOCUMENT_ERROR, EV_DOCUMENT_ERROR_ENCRYPTED)) {
+			/* FIXME: Create a thumb for cryp docs */
+			g_error_free (error);
+			return NULL;
+		}
+		g_clear_error (&error);
+
 		base_name = g_file_get_basename (file);
 		template = g_strdup_printf ("document.XXXXXX-%s", base_name);
 		g_free (base_name);
@@ -167,7 +214,7 @@ evince_thumbnailer_get_document (GFile *file)
 		g_free (path);
 	}
 
-	document = ev_document_factory_get_document_full (uri, EV_DOCUMENT_LOAD_FLAG_NO_CACHE, &error);
+	document = ev_document_factory_get_document_full (uri, EV_DOCUMENT_LOAD_FLAG_FIRST_PAGE, &error);
 	if (tmp_file) {
 		if (document) {
 			g_object_weak_ref (G_OBJECT (document),
@@ -194,49 +241,283 @@ evince_thumbnailer_get_document (GFile *file)
 	return document;
 }
 
+/* Takes the document lock itself, ev_document_get_page_size() needs
+ * the document unlocked */
 static gboolean
 evince_thumbnail_pngenc_get (EvDocument *document, const char *thumbnail, int size)
 {
 	EvRenderContext *rc;
 	double width, height;
-	GdkPixbuf *pixbuf;
+	cairo_surface_t *surface;
+	cairo_status_t status;
 	EvPage *page;
 
-	page = ev_document_get_page (document, 0);
-	
 	ev_document_get_page_size (document, 0, &width, &height);
 
+	ev_document_lock (document);
+	page = ev_document_get_page (document, 0);
 	rc = ev_render_context_new (page, 0, size / MAX (height, width));
-	pixbuf = ev_document_get_thumbnail (document, rc);
+	surface = ev_document_get_thumbnail_surface (document, rc);
 	g_object_unref (rc);
 	g_object_unref (page);
-	
-	if (pixbuf != NULL) {
-		if (gdk_pixbuf_save (pixbuf, thumbnail, "png", NULL, NULL)) {
-			g_object_unref  (pixbuf);
-			return TRUE;
-		}
+	ev_document_unlock (document);
 
-		g_object_unref  (pixbuf);
-	}
-	
-	return FALSE;
+	if (surface == NULL)
+		return FALSE;
+
+	/* The rendered surface is encoded as is, without converting it
+	 * to a GdkPixbuf first */
+	status = cairo_surface_write_to_png (surface, thumbnail);
+	cairo_surface_destroy (surface);
+
+	return status == CAIRO_STATUS_SUCCESS;
 }
 
 static gpointer
 evince_thumbnail_pngenc_get_async (struct AsyncData *data)
 {
-	ev_document_doc_mutex_lock ();
 	data->success = evince_thumbnail_pngenc_get (data->document,
 						     data->output,
 						     data->size);
-	ev_document_doc_mutex_unlock ();
 	
 	g_idle_add ((GSourceFunc)gtk_main_quit, NULL);
 	
 	return NULL;
 }
 
+static void
+batch_request_free (struct BatchRequest *request)
+{
+	g_free (request->input);
+	g_free (request->output);
+	g_free (request);
+}
+
+/* Runs in the threads of the pool, documents are loaded and rendered
+ * in parallel while the backends and fontconfig are set up only once
+ * for the whole process */
+static void
+batch_request_run (struct BatchRequest *request,
+		   struct BatchData    *batch)
+{
+	EvDocument *document;
+	GFile      *file;
+	GTimer     *timer;
+	gboolean    success = FALSE;
+
+	g_mutex_lock (&batch->mutex);
+	request->started = g_get_monotonic_time ();
+	batch->running = g_list_prepend (batch->running, request);
+	g_mutex_unlock (&batch->mutex);
+
+	timer = g_timer_new ();
+
+	file = g_file_new_for_commandline_arg (request->input);
+	document = evince_thumbnailer_get_document (file);
+	g_object_unref (file);
+
+	if (document) {
+		success = evince_thumbnail_pngenc_get (document,
+						       request->output,
+						       request->size);
+		g_object_unref (document);
+	}
+
+	g_mutex_lock (&batch->mutex);
+	batch->running = g_list_remove (batch->running, request);
+	if (request->timed_out) {
+		/* It was reported as failed already */
+		if (success)
+			g_unlink (request->output);
+	} else {
+		g_print ("%s\t%s\t%.1f ms\n",
+			 request->input,
+			 success ? "ok" : "failed",
+			 g_timer_elapsed (timer, NULL) * 1000);
+		if (!success)
+			batch->n_failed++;
+		batch->n_pending--;
+		g_cond_broadcast (&batch->cond);
+	}
+	g_mutex_unlock (&batch->mutex);
+	g_timer_destroy (timer);
+
+	batch_request_free (request);
+}
+
+/* Reports the requests running for longer than the time limit as
+ * failed. Their threads can't be stopped: they are left running, and
+ * another thread is added to the pool to replace each of them. */
+static gpointer
+batch_watchdog (struct BatchData *batch)
+{
+	g_mutex_lock (&batch->mutex);
+	while (!batch->done) {
+		gint64 now = g_get_monotonic_time ();
+		GList *l;
+
+		for (l = batch->running; l; l = l->next) {
+			struct BatchRequest *request = l->data;
+
+			if (request->timed_out || now - request->started < DEFAULT_SLEEP_TIME)
+				continue;
+
+			request->timed_out = TRUE;
+			g_print ("%s\ttimed out\t%.1f ms\n",
+				 request->input,
+				 (now - request->started) / 1000.);
+			batch->n_failed++;
+			batch->n_timed_out++;
+			batch->n_pending--;
+			g_thread_pool_set_max_threads (batch->pool,
+						       g_thread_pool_get_max_threads (batch->pool) + 1,
+						       NULL);
+		}
+		g_cond_broadcast (&batch->cond);
+
+		g_cond_wait_until (&batch->cond, &batch->mutex, now + G_USEC_PER_SEC);
+	}
+	g_mutex_unlock (&batch->mutex);
+
+	return NULL;
+}
+
+static struct BatchRequest *
+batch_request_parse (const gchar *line)
+{
+	struct BatchRequest *request;
+	gchar              **fields;
+	gint                 n_fields;
+
+	fields = g_strsplit (line, "\t", 3);
+	n_fields = g_strv_length (fields);
+	if (n_fields < 2 || *fields[0] == '\0' || *fields[1] == '\0') {
+		g_strfreev (fields);
+		return NULL;
+	}
+
+	request = g_new (struct BatchRequest, 1);
+	request->input = g_strdup (fields[0]);
+	request->output = g_strdup (fields[1]);
+	request->size = n_fields > 2 ? atoi (fields[2]) : size;
+	g_strfreev (fields);
+
+	if (request->size < 1) {
+		batch_request_free (request);
+		return NULL;
+	}
+
+	return request;
+}
+
+/* Reads the requests from @filename, one per line, and pushes them to a
+ * pool of @n_threads threads while reading, so that requests can be
+ * piped from another process. Prints the time spent on every file.
+ * Unless there's no time limit, files that take longer than the limit
+ * of a single file fail, without stopping the batch. */
+static gboolean
+evince_thumbnailer_run_batch (const gchar *filename,
+			      gint         n_threads)
+{
+	struct BatchData batch = { 0, };
+	GThreadPool     *pool;
+	GThread         *watchdog = NULL;
+	GTimer          *timer;
+	GString         *line;
+	FILE            *stream;
+	gchar            buffer[1024];
+	gdouble          elapsed;
+	GError          *error = NULL;
+
+	if (g_strcmp0 (filename, "-") == 0) {
+		stream = stdin;
+	} else {
+		stream = g_fopen (filename, "r");
+		if (!stream) {
+			g_printerr ("Error opening %s: %s\n", filename, g_strerror (errno));
+			return FALSE;
+		}
+	}
+
+	pool = g_thread_pool_new ((GFunc) batch_request_run, &batch,
+				  n_threads, FALSE, &error);
+	if (!pool) {
+		g_printerr ("Error creating threads: %s\n", error->message);
+		g_error_free (error);
+		if (stream != stdin)
+			fclose (stream);
+		return FALSE;
+	}
+
+	g_mutex_init (&batch.mutex);
+	g_cond_init (&batch.cond);
+	batch.pool = pool;
+	if (time_limit)
+		watchdog = g_thread_new ("ThumbnailerWatchdog", (GThreadFunc) batch_watchdog, &batch);
+
+	timer = g_timer_new ();
+	line = g_string_new (NULL);
+	while (fgets (buffer, sizeof (buffer), stream)) {
+		struct BatchRequest *request;
+
+		g_string_append (line, buffer);
+		if (line->len == 0 || line->str[line->len - 1] != '\n')
+			if (!feof (stream))
+				continue;
+
+		g_strchomp (line->str);
+		if (line->str[0] != '\0') {
+			request = batch_request_parse (line->str);
+			if (request) {
+				batch.n_files++;
+				g_mutex_lock (&batch.mutex);
+				batch.n_pending++;
+				g_mutex_unlock (&batch.mutex);
+				g_thread_pool_push (pool, request, NULL);
+			} else {
+				g_printerr ("Invalid request: %s\n", line->str);
+			}
+		}
+		g_string_truncate (line, 0);
+	}
+	g_string_free (line, TRUE);
+
+	if (stream != stdin)
+		fclose (stream);
+
+	/* Waits for all the requests to finish or time out */
+	g_mutex_lock (&batch.mutex);
+	while (batch.n_pending > 0)
+		g_cond_wait (&batch.cond, &batch.mutex);
+	batch.done = TRUE;
+	g_cond_broadcast (&batch.cond);
+	g_mutex_unlock (&batch.mutex);
+
+	if (watchdog)
+		g_thread_join (watchdog);
+
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+
+	g_print ("%d files, %d failed, %.2f s, %.1f files/s\n",
+		 batch.n_files, batch.n_failed, elapsed,
+		 elapsed > 0 ? batch.n_files / elapsed : 0.);
+
+	/* Threads still rendering files that timed out can't be waited
+	 * for, nor can the backends be shut down under them: exit with
+	 * the status of a failed batch */
+	if (batch.n_timed_out > 0) {
+		fflush (stdout);
+		_exit (254);
+	}
+
+	g_thread_pool_free (pool, FALSE, TRUE);
+	g_mutex_clear (&batch.mutex);
+	g_cond_clear (&batch.cond);
+
+	return batch.n_failed == 0;
+}
+
 static void
 print_usage (GOptionContext *context)
 {
@@ -271,6 +552,28 @@ main (int argc, char *argv[])
 		return -1;
 	}
 
+	if (batch_file) {
+		gboolean success;
+
+		g_option_context_free (context);
+
+		if (size < 1) {
+			g_printerr ("Size cannot be smaller than 1 pixel\n");
+			return -1;
+		}
+
+		if (!ev_init ())
+			return -1;
+
+		/* The time limit applies to every file, a slow file fails
+		 * without aborting the whole batch */
+		success = evince_thumbnailer_run_batch (batch_file,
+							n_jobs > 0 ? n_jobs : (gint) g_get_num_processors ());
+		ev_shutdown ();
+
+		return success ? 0 : -2;
+	}
+
 	input = file_arguments ? file_arguments[0] : NULL;
 	output = input ? file_arguments[1] : NULL;
 	if (!input || !output) {